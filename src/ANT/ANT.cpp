@@ -32,6 +32,10 @@
 #include <QtDebug>
 #include "RealtimeData.h"
 
+#ifndef WIN32
+#include <poll.h>
+#endif
+
 #ifdef Q_OS_LINUX // to get stat /dev/xxx for major/minor
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -99,6 +103,7 @@ ANT::ANT(QObject *parent, DeviceConfiguration *devConf, QString athlete) : QThre
     Status=0;
     deviceFilename = devConf ? devConf->portSpec : "";
     baud=115200;
+    replaying = false;
     powerchannels=0;
     configuring = false;
 
@@ -268,14 +273,15 @@ void ANT::run()
 
     while(1)
     {
-        // read more bytes from the device
-        uint8_t byte;
+        // read whatever has arrived, waiting a little if nothing has
+        // partial messages are carried over in the receive state machine
+        uint8_t buffer[ANT_READ_SIZE];
 
-        int rc = rawRead(&byte, 1);
+        int rc = rawRead(buffer, ANT_READ_SIZE);
 
-        if (rc > 0)
-            receiveByte((unsigned char)byte);
-        else {
+        if (rc > 0) {
+            for (int i=0; i<rc; i++) receiveByte((unsigned char)buffer[i]);
+        } else if (rc < 0) {
 
             // Recognise USB device removal. Linux transitions through -5 (I/O error)
             // to -6 (No such device or address). Windows seems to stick on -5
@@ -774,6 +780,9 @@ ANT::startWaitingSearch()
 bool
 ANT::discover(QString name)
 {
+    // captures replay wherever we are
+    if (ANTReplay::isCapture(name)) return true;
+
 #ifdef WIN32
 Q_UNUSED(name);
 #endif
@@ -1068,6 +1077,12 @@ ANT::processMessage(void) {
 
 int ANT::closePort()
 {
+    if (replaying) {
+        replay.close();
+        replaying = false;
+        return 0;
+    }
+
 #ifdef WIN32
 #ifdef GC_HAVE_LIBUSB
     switch (usbMode) {
@@ -1111,6 +1126,14 @@ bool ANT::find()
 
 int ANT::openPort()
 {
+    // replaying a capture, no stick needed
+    if (ANTReplay::isCapture(deviceFilename)) {
+        if (!replay.open(deviceFilename)) return -1;
+        replaying = true;
+        channels = ANT_MAX_CHANNELS;
+        return 0;
+    }
+
 #ifdef WIN32
 #ifdef GC_HAVE_LIBUSB
     int rc;
@@ -1206,6 +1229,9 @@ int ANT::rawWrite(uint8_t *bytes, int size) // unix!!
 
     int rc=0;
 
+    // the capture already has the replies
+    if (replaying) return size;
+
 #ifdef WIN32
 #ifdef GC_HAVE_LIBUSB
     switch (usbMode) {
@@ -1253,8 +1279,12 @@ int ANT::rawWrite(uint8_t *bytes, int size) // unix!!
 
 }
 
+// returns what has arrived (up to size), 0 when nothing arrived
+// in time and -1 or a negative error code when the read failed
 int ANT::rawRead(uint8_t bytes[], int size)
 {
+    if (replaying) return replay.read(bytes, size, ANT_READ_WAIT);
+
 #ifdef WIN32
 #ifdef GC_HAVE_LIBUSB
     switch (usbMode) {
@@ -1280,17 +1310,20 @@ int ANT::rawRead(uint8_t bytes[], int size)
         return usb2->read((char *)bytes, size);
     }
 #endif
-    int i=0;
-    uint8_t byte;
-
-    // read one byte at a time sleeping when no data ready
-    // until we timeout waiting then return error
-    for (i=0; i<size; i++) {
-        int rc = read(devicePort, &byte, 1);
-        if (rc == -1 || rc == 0) return -1; // error!
-        else bytes[i] = byte;
-    }
-    return i;
+    // wait for something to arrive then take all of it
+    struct pollfd ready;
+    ready.fd = devicePort;
+    ready.events = POLLIN;
+    ready.revents = 0;
+
+    int rc = poll(&ready, 1, ANT_READ_WAIT);
+    if (rc == 0 || (rc == -1 && errno == EINTR)) return 0; // nothing yet
+    if (rc == -1) return -1; // error!
+
+    rc = read(devicePort, bytes, size);
+    if (rc == -1 && (errno == EAGAIN || errno == EINTR)) return 0;
+    if (rc <= 0) return -1; // error or hangup
+    return rc;
 
 #endif
     return -1; // keep compiler happy.
@@ -80,6 +80,8 @@
 #include "LibUsb.h"    // for Garmin USB2 sticks
 #endif
 
+#include "ANTReplay.h"  // antlog.raw captures instead of a stick
+
 #include <QDebug>
 
 #include "Settings.h" // for wheel size config
@@ -88,6 +90,11 @@
 #define ANT_READTIMEOUT    1000
 #define ANT_WRITETIMEOUT   2000
 
+// bulk reads; a whole USB2 packet and how long to wait for one
+// before looking at the controller queue again
+#define ANT_READ_SIZE      64
+#define ANT_READ_WAIT      50
+
 class ANTMessage;
 class ANTChannel;
 
@@ -687,6 +694,8 @@ private:
     // access to device file
     QString deviceFilename;
     int baud;
+    ANTReplay replay;
+    bool replaying;                 // deviceFilename is a capture
 #ifdef WIN32
     HANDLE devicePort;              // file descriptor for reading from com3
     DCB deviceSettings;             // serial port settings baud rate et al
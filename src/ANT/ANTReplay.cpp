@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ANTReplay.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <string.h>
+
+// message framing as ANT.h, not included so this only needs QtCore
+// and can be tested on its own (see test/antreplay)
+static const uint8_t SYNC_BYTE = 0xA4;      // ANT_SYNC_BYTE
+static const int OFFSET_LENGTH = 1;         // ANT_OFFSET_LENGTH
+static const int MAX_LENGTH = 9;            // ANT_MAX_LENGTH
+static const int MAX_MESSAGE_SIZE = 12;     // ANT_MAX_MESSAGE_SIZE
+
+// one record per message as written by ANTLogger::logRawAntMessage
+// direction ('R' or 'S'), msecs since epoch (little endian) and the message
+static const int RECORD_SIZE = 1 + 8 + MAX_MESSAGE_SIZE;
+
+ANTReplay::ANTReplay() : offset(0), count(0), speed(1.0), first(-1), due(0), isOpen(false)
+{
+}
+
+QString
+ANTReplay::path(QString spec)
+{
+    int at = spec.lastIndexOf('@');
+    return at > 0 ? spec.left(at) : spec;
+}
+
+bool
+ANTReplay::isCapture(QString spec)
+{
+    // devices are never regular files
+    QFileInfo info(path(spec));
+    return info.exists() && info.isFile();
+}
+
+bool
+ANTReplay::open(QString spec)
+{
+    close();
+
+    QFile file(path(spec));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    capture = file.readAll();
+    file.close();
+
+    // optional speed up, zero or less means no waiting at all
+    int at = spec.lastIndexOf('@');
+    speed = 1.0;
+    if (at > 0) {
+        bool ok;
+        double x = spec.mid(at+1).toDouble(&ok);
+        if (ok) speed = x;
+    }
+
+    isOpen = true;
+    clock.start();
+    return true;
+}
+
+void
+ANTReplay::close()
+{
+    capture.clear();
+    pending.clear();
+    offset = count = 0;
+    first = -1;
+    due = 0;
+    isOpen = false;
+}
+
+bool
+ANTReplay::next()
+{
+    while (offset + RECORD_SIZE <= capture.size()) {
+
+        const uint8_t *record = (const uint8_t *)capture.constData() + offset;
+        offset += RECORD_SIZE;
+
+        // only what the stick sent us, not what we sent it
+        if (record[0] != 'R') continue;
+
+        qint64 millis = 0;
+        for (int i=7; i>=0; i--) millis = (millis << 8) | record[1+i];
+
+        const uint8_t *message = record + 9;
+        int length = message[OFFSET_LENGTH];
+        if (message[0] != SYNC_BYTE || length == 0 || length > MAX_LENGTH) continue;
+
+        // the logger doesn't keep the checksum so put it back
+        uint8_t checksum = 0;
+        for (int i=0; i<length+3; i++) checksum ^= message[i];
+        pending.append((const char *)message, length+3);
+        pending.append((char)checksum);
+
+        // when it is due relative to the first message
+        if (first < 0) first = millis;
+        due = speed > 0 ? qint64((millis - first) / speed) : 0;
+        count++;
+        return true;
+    }
+    return false;
+}
+
+int
+ANTReplay::read(uint8_t *bytes, int size, int timeout)
+{
+    if (!isOpen) return -1;
+
+    // wait for the next message to be due, at most timeout
+    if (pending.isEmpty() && !next()) {
+        QThread::msleep(timeout);
+        return 0;
+    }
+    qint64 wait = due - clock.elapsed();
+    if (wait > 0) {
+        QThread::msleep(qMin(wait, qint64(timeout)));
+        if (due > clock.elapsed()) return 0;
+    }
+
+    // everything that is due now, whole messages only
+    int n = 0;
+    while (!pending.isEmpty() && n + pending.size() <= size) {
+        memcpy(bytes + n, pending.constData(), pending.size());
+        n += pending.size();
+        pending.clear();
+        if (!next() || due > clock.elapsed()) break;
+    }
+    return n;
+}
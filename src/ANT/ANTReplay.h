@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_ANTReplay_h
+#define _GC_ANTReplay_h 1
+
+#include <QString>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <stdint.h>
+
+// Plays back an antlog.raw capture written by ANTLogger as if it
+// were a stick, the received messages are returned as wire bytes
+// (sync, length, id, data, checksum) when they are due so they go
+// through the same framing and ANT::processMessage as live data.
+//
+// The port spec names the capture, with an optional speed suffix
+//     /path/antlog.raw       - real time
+//     /path/antlog.raw@10    - ten times faster
+//     /path/antlog.raw@0     - as fast as it can be decoded
+class ANTReplay
+{
+    public:
+        ANTReplay();
+
+        // is the port spec a capture file rather than a device?
+        static bool isCapture(QString spec);
+
+        bool open(QString spec);
+        void close();
+
+        // wire bytes for messages due by now, waits up to timeout msecs
+        // for the next one, 0 if nothing is due and -1 when not open
+        int read(uint8_t *bytes, int size, int timeout);
+
+        bool atEnd() const { return offset >= capture.size() && pending.isEmpty(); }
+        int messages() const { return count; }
+
+    private:
+        static QString path(QString spec);
+        bool next(); // frame the next received message into pending
+
+        QByteArray capture;
+        QByteArray pending;
+        int offset;
+        int count;
+        double speed;
+        qint64 first, due;
+        bool isOpen;
+        QElapsedTimer clock;
+};
+#endif
@@ -64,7 +64,7 @@ CPPlot::CPPlot(CriticalPowerWindow *parent, Context *context, bool rangemode) :
     model(0), modelVariant(0), fit(0), fitdata(0), modelDecay(false),
 
     // state
-    context(context), bestsCache(NULL), veloCP(0), dateCP(0), dateCV(0.0), sport(""),
+    context(context), bestsCache(NULL), bestsAggregate(NULL), bestsRide(NULL), keepBests(false), veloCP(0), dateCP(0), dateCV(0.0), sport(""),
     rideSeries(RideFile::watts), criticalSeries(CriticalPowerWindow::CriticalSeriesType::watts),
     isFiltered(false), shadeMode(2),
     shadeIntervals(true), rangemode(rangemode), 
@@ -951,8 +951,10 @@ CPPlot::plotModel(QVector<double> vector, QColor plotColor, PDModel *baseline)
 void
 CPPlot::clearCurves()
 {
-    // bests ridefilecache
-    if (bestsCache) {
+    // bests ridefilecache, unless it just arrived
+    if (!keepBests) {
+        delete bestsAggregate;
+        bestsAggregate = NULL;
         delete bestsCache;
         bestsCache = NULL;
     }
@@ -1200,18 +1202,24 @@ CPPlot::plotBests(RideItem *rideItem)
 
     // do we need to get the cache ?
     if (bestsCache == NULL) {
+
+        // already on its way, we plot again when it arrives
+        if (bestsAggregate) return;
+
         // isFiltered and files are filters from CriticalPowerWindow's filter setting
         // we also need to take into account the perspective filter if on trends so
         // we pass isFiltered and files for filterlist to take care of them,
         // but only if rangemode (aka on trends)
         if (rangemode) {
-            bestsCache = new RideFileCache(context, startDate, endDate,
+            bestsAggregate = new RideFileCacheAggregate(context, startDate, endDate,
                             isFiltered || (parent->myPerspective && parent->myPerspective->isFiltered()),
                             parent->myPerspective ? parent->myPerspective->filterlist(DateRange(startDate,endDate), isFiltered, files) : files,
-                            rangemode, rideItem);
+                            rangemode, rideItem, this);
         } else {
-            bestsCache = new RideFileCache(context, startDate, endDate, isFiltered, files, rangemode, rideItem);
+            bestsAggregate = new RideFileCacheAggregate(context, startDate, endDate, isFiltered, files, rangemode, rideItem, this);
         }
+        connect(bestsAggregate, SIGNAL(finished()), this, SLOT(bestsReady()));
+        return;
     }
 
     // how much we got ?
@@ -1990,6 +1998,7 @@ CPPlot::setRide(RideItem *rideItem)
 {
     // null ride ?
     if (!rideItem) return;
+    bestsRide = rideItem;
 
     // Season Compare Mode -- so nothing for us to do
     if (rangemode && context->isCompareDateRanges) return calculateForDateRanges(context->compareDateRanges);
@@ -2030,8 +2039,10 @@ CPPlot::setRide(RideItem *rideItem)
     // delete if sport changed
     if (!rangemode) {
         setSport(rideItem->sport);
-        delete bestsCache;
-        bestsCache = NULL;
+        if (!keepBests) {
+            delete bestsCache;
+            bestsCache = NULL;
+        }
         clearCurves();
         plotBests(rideItem);
     } else {
@@ -2279,6 +2290,22 @@ CPPlot::exportBests(QString filename)
     f.close();
 }
 
+// the bests aggregated in the background have arrived, plot
+// everything again now they are here, without losing them
+void
+CPPlot::bestsReady()
+{
+    bestsCache = bestsAggregate->take();
+    bestsAggregate->deleteLater();
+    bestsAggregate = NULL;
+
+    // on trends the ride may have gone whilst we waited
+    keepBests = true;
+    clearCurves();
+    setRide(rangemode ? const_cast<RideItem*>(context->currentRideItem()) : bestsRide);
+    keepBests = false;
+}
+
 // perspective filter changed, we need to replot with new bests
 void
 CPPlot::perspectiveFilterChanged()
@@ -119,6 +119,9 @@ class CPPlot : public QwtPlot
         void refreshUpdate(QDate);
         void refreshEnd();
 
+        // the bests have been aggregated
+        void bestsReady();
+
     private:
 
         CriticalPowerWindow *parent;
@@ -159,6 +162,9 @@ class CPPlot : public QwtPlot
         // Data and State
         Context *context;
         RideFileCache *bestsCache;
+        RideFileCacheAggregate *bestsAggregate; // bestsCache on its way
+        RideItem *bestsRide; // to plot again when it arrives
+        bool keepBests;
         int veloCP;
         int dateCP;
         double dateCV;
@@ -47,7 +47,7 @@ static const int gearDigits  = 2;
 //
 // Constructor
 //
-HistogramWindow::HistogramWindow(Context *context, bool rangemode) : GcChartWindow(context), context(context), stale(true), source(NULL), active(false), bactive(false), rangemode(rangemode), compareStale(false), useCustom(false), useToToday(false), precision(99)
+HistogramWindow::HistogramWindow(Context *context, bool rangemode) : GcChartWindow(context), context(context), stale(true), source(NULL), aggregating(NULL), active(false), bactive(false), rangemode(rangemode), compareStale(false), useCustom(false), useToToday(false), precision(99)
 {
 
     QWidget *c = new QWidget;
@@ -1006,8 +1006,6 @@ HistogramWindow::updateChart()
     // Lets get the data then
     if (stale) {
 
-        RideFileCache *old = source;
-
         if (rangemode) {
 
             // set the date range to the appropriate selection
@@ -1030,34 +1028,19 @@ HistogramWindow::updateChart()
             if (data->isChecked()) {
 
                 // plotting a data series, so refresh the ridefilecache
-
+                // in the background and plot it when it arrives
+                delete aggregating;
                 if (rangemode) {
                     // filterlist takes care of both chart and perspective filters to generate the file list
-                    source = new RideFileCache(context, use.from, use.to, isfiltered || (myPerspective && myPerspective->isFiltered()),
-                                               myPerspective ? myPerspective->filterlist(use, isfiltered, files) : files, rangemode);
-                } else source = new RideFileCache(context, use.from, use.to, isfiltered, files, rangemode);
+                    aggregating = new RideFileCacheAggregate(context, use.from, use.to, isfiltered || (myPerspective && myPerspective->isFiltered()),
+                                               myPerspective ? myPerspective->filterlist(use, isfiltered, files) : files, rangemode, NULL, this);
+                } else aggregating = new RideFileCacheAggregate(context, use.from, use.to, isfiltered, files, rangemode, NULL, this);
+                connect(aggregating, SIGNAL(finished()), this, SLOT(sourceReady()));
 
                 cfrom = use.from;
                 cto = use.to;
-                stale = false;
-
-                if (old) delete old; // guarantee source pointer changes
                 stale = false; // well we tried
-
-                // and which series to plot
-                powerHist->setSeries(series);
-
-                // and now the controls
-                powerHist->setShading(shadeZones->isChecked() ? true : false);
-                powerHist->setZoned(showInZones->isChecked() ? true : false);
-                powerHist->setCPZoned(showInCPZones->isChecked() ? true : false);
-                powerHist->setZoneLimited(showZoneLimits->isChecked() ? true : false);
-                powerHist->setlnY(showLnY->isChecked() ? true : false);
-                powerHist->setWithZeros(showZeroes->isChecked() ? true : false);
-                powerHist->setSumY(showSumY->currentIndex()== 0 ? true : false);
-
-                // set the data on the plot
-                powerHist->setData(source);
+                return;
 
             } else {
 
@@ -1116,6 +1099,39 @@ HistogramWindow::updateChart()
     } // if stale
 }
 
+// the date range aggregated in the background has arrived
+void
+HistogramWindow::sourceReady()
+{
+    RideFileCache *old = source;
+    source = aggregating->take();
+    aggregating->deleteLater();
+    aggregating = NULL;
+    if (old) delete old; // guarantee source pointer changes
+
+    // switched to compare or metrics whilst we waited
+    if (isCompare() || !data->isChecked()) return;
+
+    // and which series to plot
+    powerHist->setSeries(series);
+
+    // and now the controls
+    powerHist->setShading(shadeZones->isChecked() ? true : false);
+    powerHist->setZoned(showInZones->isChecked() ? true : false);
+    powerHist->setCPZoned(showInCPZones->isChecked() ? true : false);
+    powerHist->setZoneLimited(showZoneLimits->isChecked() ? true : false);
+    powerHist->setlnY(showLnY->isChecked() ? true : false);
+    powerHist->setWithZeros(showZeroes->isChecked() ? true : false);
+    powerHist->setSumY(showSumY->currentIndex()== 0 ? true : false);
+
+    // set the data on the plot
+    powerHist->setData(source);
+
+    powerHist->recalc(true); // interval changed? force recalc
+    powerHist->replot();
+    interval = false;
+}
+
 void
 HistogramWindow::perspectiveFilterChanged()
 {
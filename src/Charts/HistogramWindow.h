@@ -192,6 +192,7 @@ class HistogramWindow : public GcChartWindow
         void setBinWidthFromLineEdit();
         void forceReplot();
         void updateChart();
+        void sourceReady(); // date range aggregated
 
         void treeSelectionChanged();
 
@@ -226,6 +227,7 @@ class HistogramWindow : public GcChartWindow
         bool stale;
         QDate cfrom, cto;
         RideFileCache *source;
+        RideFileCacheAggregate *aggregating; // the next source
         bool interval;
 
         SearchFilterBox *searchBox;
@@ -26,6 +26,7 @@
 #include "LTMWindow.h"
 #include "RideMetric.h"
 #include "RideCache.h"
+#include "MetricStore.h"
 #include "RideFileCache.h"
 #include "Banister.h"
 #include "Estimator.h"
@@ -2684,7 +2685,6 @@ LTMPlot::createMetricData(Context *context, LTMSettings *settings, MetricDetail
     bool aggZero = metricDetail.metric ? metricDetail.metric->aggregateZero() : false;
     n=-1;
     int lastDay=0;
-    unsigned long secondsPerGroupBy=0;
     bool wantZero = forceZero ? 1 : (metricDetail.curveStyle == QwtPlotCurve::Steps);
 
     // curve specific filter
@@ -2692,138 +2692,85 @@ LTMPlot::createMetricData(Context *context, LTMSettings *settings, MetricDetail
     if (!SearchFilterBox::isNull(metricDetail.datafilter))
         spec.addMatches(SearchFilterBox::matches(context, metricDetail.datafilter));
 
-    //
-    double ymean_prev=0.0;
-
-    foreach (RideItem *ride, context->athlete->rideCache->rides()) { 
-
-        // filter out unwanted stuff
-        if (!spec.pass(ride)) continue;
-
-        // day we are on
-        int currentDay = groupForDate(ride->dateTime.date(), settings->groupBy);
-
-        // value for day
-        double value;
-        if (metricDetail.type == METRIC_META)
-            value = ride->getText(metricDetail.name, "0.0").toDouble();
-        else
-            value = ride->getForSymbol(metricDetail.symbol);
-
-        // check values are bounded to stop QWT going berserk
-        if (std::isnan(value) || std::isinf(value)) value = 0;
+    // the rides we want from the metric store, and their groups
+    const RideMetric *m = metricDetail.type == METRIC_META ? NULL : RideMetricFactory::instance().rideMetric(metricDetail.symbol);
+    int index = m ? m->index() : -1;
+    QVector<int> indexes;
+    if (metricDetail.type != METRIC_META) indexes << index;
+    QSharedPointer<const MetricSnapshot> store = context->athlete->rideCache->metricStore()->snapshot(indexes);
+    QVector<int> rows = store->rows(spec);
+
+    MetricSnapshot::period by = MetricSnapshot::Day;
+    switch (settings->groupBy) {
+    case LTM_WEEK: by = MetricSnapshot::Week; break;
+    case LTM_MONTH: by = MetricSnapshot::Month; break;
+    case LTM_YEAR: by = MetricSnapshot::Year; break;
+    case LTM_ALL: by = MetricSnapshot::All; break;
+    }
+    QVector<int> groups = store->groups(rows, by, settings->start.date());
+
+    // the values, metadata fields aren't in the store
+    MetricColumn column;
+    if (metricDetail.type == METRIC_META) {
+        const QVector<RideItem*> &rides = store->rides;
+        column.values.fill(0, rides.count());
+        column.counts.fill(1, rides.count());
+        foreach(int row, rows) column.values[row] = rides[row]->getText(metricDetail.name, "0.0").toDouble();
+    } else {
+        column = store->column(index);
 
-        // skip unavailable values
-        if (value == RideFile::NA) continue;
+        // counts are only used for metrics
+        if (!metricDetail.metric) column.counts.fill(1);
+    }
 
-        // set aggZero to false and value to zero if is temperature and -255
-        if (metricDetail.metric && metricDetail.metric->symbol() == "average_temp" && value == RideFile::NA) {
-            value = 0;
-            aggZero = false;
+    // convert from stored metric value to imperial and seconds to hours
+    double scale = 1, offset = 0;
+    if (metricDetail.metric) {
+        if (GlobalContext::context()->useMetricUnits == false) {
+            scale = metricDetail.metric->conversion();
+            offset = metricDetail.metric->conversionSum();
         }
-
-        if (metricDetail.metric) {
-            // convert from stored metric value to imperial
-            if (GlobalContext::context()->useMetricUnits == false) {
-                value *= metricDetail.metric->conversion();
-                value += metricDetail.metric->conversionSum();
-            }
-
-            // convert seconds to hours
-            if (metricDetail.metric->units(true) == "seconds" ||
-                metricDetail.metric->units(true) == tr("seconds")) value /= 3600;
+        if (metricDetail.metric->units(true) == "seconds" ||
+            metricDetail.metric->units(true) == tr("seconds")) {
+            scale /= 3600;
+            offset /= 3600;
         }
+    }
 
-        if (value || wantZero) {
-            unsigned long seconds = metricDetail.metric ? ride->getCountForSymbol(metricDetail.metric->symbol()) : 1;
-            if (currentDay > lastDay) {
-                if (lastDay && wantZero) {
-                    while (lastDay<currentDay && n<=maxdays) {
-                        lastDay++;
-                        n++;
-                        x[n]=lastDay - groupForDate(settings->start.date(), settings->groupBy);
-                        y[n]=0;
-                    }
-                } else {
-                    n++;
-                }
-
-                // drop out of roange
-                if (n>maxdays) break;
-                // first time thru
-                if (n<0) n=0;
-
-                ymean_prev = ride->getStdMeanForSymbol(metricDetail.symbol);
+    // sum totals, average averages and choose best for Peaks
+    int type = metricDetail.metric ? metricDetail.metric->type() : RideMetric::Average;
+    if (metricDetail.uunits == "Ramp" || metricDetail.uunits == tr("Ramp")) type = RideMetric::Total;
+    if (metricDetail.type == METRIC_BEST) type = RideMetric::Peak;
 
-                y[n] = value;
-                x[n] = currentDay - groupForDate(settings->start.date(), settings->groupBy);
+    QVector<int> keys;
+    QVector<double> values;
+    MetricStore::groupBy(column, rows, groups, type, aggZero, wantZero, scale, offset, keys, values);
 
-                // only increment counter if nonzero or we aggregate zeroes
-                if (value || aggZero) secondsPerGroupBy = seconds; 
-                else secondsPerGroupBy = 0;
+    for (int i=0; i<keys.count(); i++) {
 
-            } else {
-                // sum totals, average averages and choose best for Peaks
-                int type = metricDetail.metric ? metricDetail.metric->type() : RideMetric::Average;
+        // day we are on
+        int currentDay = keys[i];
 
-                if (metricDetail.uunits == "Ramp" ||
-                    metricDetail.uunits == tr("Ramp")) type = RideMetric::Total;
+        if (lastDay && wantZero) {
+            while (lastDay<currentDay && n<=maxdays) {
+                lastDay++;
+                n++;
+                x[n]=lastDay - groupForDate(settings->start.date(), settings->groupBy);
+                y[n]=0;
+            }
+        } else {
+            n++;
+        }
 
-                if (metricDetail.type == METRIC_BEST) type = RideMetric::Peak;
+        // drop out of roange
+        if (n>maxdays) break;
+        // first time thru
+        if (n<0) n=0;
 
-                // first time thru
-                if (n<0) n=0;
+        y[n] = values[i];
+        x[n] = currentDay - groupForDate(settings->start.date(), settings->groupBy);
 
-                switch (type) {
-                case RideMetric::Total:
-                    y[n] += value;
-                    break;
-                case RideMetric::Average:
-                    {
-                    // average should be calculated taking into account
-                    // the duration of the ride, otherwise high value but
-                    // short rides will skew the overall average
-                    if (value || aggZero) y[n] = ((y[n]*secondsPerGroupBy)+(seconds*value)) / (secondsPerGroupBy+seconds);
-                    break;
-                    }
-                case RideMetric::Low:
-                    if (value < y[n]) y[n] = value;
-                    break;
-                case RideMetric::Peak:
-                    if (value > y[n]) y[n] = value;
-                    break;
-                case RideMetric::MeanSquareRoot:
-                    if (value) y[n] = sqrt((pow(y[n],2)*secondsPerGroupBy + pow(value,2)*seconds)/(secondsPerGroupBy+seconds));
-                    break;
-                case RideMetric::StdDev:
-                    if (value)
-                        {
-                            double ymean_next = ride->getStdMeanForSymbol(metricDetail.symbol);
-                            double ymean =  (secondsPerGroupBy*ymean_prev + ymean_next*seconds)/(secondsPerGroupBy + seconds);
-
-                            // Combining two standard deviations using
-                            // the formula:
-                            //
-                            //   sqrt(((n1-1)*S1^2+(n2-1)*S2^2+n1*(ymean_1-ymean)^2+n2*(ymean_2-ymean)^2)/(n1+n2))
-                            //
-                            // where:
-                            //
-                            //   ymean = (n1*ymean_1 + n2*ymean_2)/(n1+n2)
-
-                            y[n] = pow(y[n],2)*(secondsPerGroupBy-1) + pow(value,2)*(seconds-1);
-                            y[n] += pow(ymean_prev - ymean,2)*secondsPerGroupBy + pow(ymean_next - ymean,2)*seconds;
-                            y[n] /= (secondsPerGroupBy + seconds);
-                            y[n] = sqrt(y[n]);
-
-                            ymean_prev = ymean;
-                        }
-                    break;
-                }
-                // increment group counter if nonzero or we aggregate zeroes
-                if (value || aggZero) secondsPerGroupBy += seconds;
-            }
-            lastDay = currentDay;
-        }
+        lastDay = currentDay;
     }
 }
 
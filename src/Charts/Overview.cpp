@@ -105,7 +105,7 @@ OverviewWindow::addTile()
 
         // update after config changed
         if (added->parent->scope & OverviewScope::ANALYSIS && added->parent->currentRideItem) added->setData(added->parent->currentRideItem);
-        if (added->parent->scope & OverviewScope::TRENDS ) added->setDateRange(added->parent->currentDateRange);
+        if (added->parent->scope & OverviewScope::TRENDS ) added->parent->compute(added);
 
         // update geometry
         space->updateGeometry();
@@ -161,7 +161,7 @@ OverviewWindow::importChart()
             // initialise to current selected daterange / activity as appropriate
             // need to do after geometry as it won't be visible till added to space
             if (scope == OverviewScope::ANALYSIS && space->currentRideItem) add->setData(space->currentRideItem);
-            if (scope == OverviewScope::TRENDS ) add->setDateRange(space->currentDateRange);
+            if (scope == OverviewScope::TRENDS ) space->compute(add);
 
             // and update- sometimes a little wonky
             space->updateGeometry();
@@ -648,7 +648,7 @@ OverviewConfigDialog::close()
 
         // update after config changed
         if (item->parent->scope & OverviewScope::ANALYSIS && item->parent->currentRideItem) item->setData(item->parent->currentRideItem);
-        if (item->parent->scope & OverviewScope::TRENDS ) item->setDateRange(item->parent->currentDateRange);
+        if (item->parent->scope & OverviewScope::TRENDS ) item->parent->compute(item);
 
         item=NULL;
     }
@@ -21,6 +21,7 @@
 #include "AbstractView.h"
 #include "Athlete.h"
 #include "RideCache.h"
+#include "MetricStore.h"
 #include "IntervalItem.h"
 
 #include "Zones.h"
@@ -1553,29 +1554,47 @@ MetricOverviewItem::setData(RideItem *item)
     }
 }
 
-void
-MetricOverviewItem::setDateRange(DateRange dr)
+bool
+MetricOverviewItem::prepare(DateRange dr)
 {
-    if (!metric) return; // avoid crashes when metric is not available
+    if (!metric) return false; // avoid crashes when metric is not available
 
     // for metrics lets truncate to today
     if (dr.to > QDate::currentDate()) dr.to = QDate::currentDate();
 
-    Specification spec;
+    spec = Specification();
     spec.setDateRange(dr);
     setFilter(this, spec);
 
+    // the rides and the metric, taken here on the GUI thread
+    computing.store = parent->context->athlete->rideCache->metricStore()->snapshot(QVector<int>() << metric->index());
+    computing.metric = metric;
+    computing.symbol = symbol;
+    computing.dr = dr;
+    return true;
+}
+
+void
+MetricOverviewItem::complete()
+{
+    const RideMetric *metric = computing.metric;
+    DateRange dr = computing.dr;
+
+    // the rides and the metric from the metric store
+    QSharedPointer<const MetricSnapshot> store = computing.store;
+    QVector<int> rows = store->rows(spec);
+    const MetricColumn &column = store->column(metric->index());
+    bool useMetricUnits = GlobalContext::context()->useMetricUnits;
+
     // aggregate sum and count etc
     double v=0; // value
     double c=0; // count
     bool first=true;
-    foreach(RideItem *item, parent->context->athlete->rideCache->rides()) {
-
-        if (!spec.pass(item)) continue;
+    foreach(int row, rows) {
 
         // get value and count
-        double value = item->getForSymbol(symbol, GlobalContext::context()->useMetricUnits);
-        double count = item->getCountForSymbol(symbol);
+        double value = metric->value(column.values[row], useMetricUnits);
+        double count = column.counts[row];
         if (count <= 0) count = 1;
 
         // ignore zeroes when aggregating?
@@ -1617,30 +1636,25 @@ MetricOverviewItem::setDateRange(DateRange dr)
 
     // get the metric value
     const RideMetricFactory &factory = RideMetricFactory::instance();
-    RideMetric *m = const_cast<RideMetric*>(factory.rideMetric(symbol));
+    RideMetric *m = const_cast<RideMetric*>(factory.rideMetric(computing.symbol));
     if (std::isinf(v) || std::isnan(v)) v=0;
     if (m) {
-        value = m->toString(v);
+        computing.value = m->toString(v);
     } else {
-        value = Utils::removeDP(QString("%1").arg(v));
-        if (value == "nan") value ="";
+        computing.value = Utils::removeDP(QString("%1").arg(v));
+        if (computing.value == "nan") computing.value ="";
     }
 
     // metric history
     QList<QPointF> points;
-
-    // how many days
-    QDate earliest(1900,01,01);
-    sparkline->setDays(earliest.daysTo(dr.to) - earliest.daysTo(dr.from));
+    int from = dr.from.toJulianDay();
 
     double min=0, max=0;
     double sum=0;
     first=true;
-    foreach(RideItem *item, parent->context->athlete->rideCache->rides()) {
-
-        if (!spec.pass(item)) continue;
+    foreach(int row, rows) {
 
-        double v = item->getForSymbol(symbol, GlobalContext::context()->useMetricUnits);
+        double v = metric->value(column.values[row], useMetricUnits);
 
         // no zero values
         if (v == 0) continue;
@@ -1651,68 +1665,93 @@ MetricOverviewItem::setDateRange(DateRange dr)
             v = sum;
         }
 
-        points << QPointF(earliest.daysTo(item->dateTime.date()) - earliest.daysTo(dr.from), v);
+        points << QPointF(store->days[row] - from, v);
 
         if (v < min) min=v;
         if (first || v > max) max=v;
         first = false;
     }
+    computing.points = points;
+    computing.min = min;
+    computing.max = max;
+}
+
+void
+MetricOverviewItem::finish()
+{
+    value = computing.value;
+
+    // how many days
+    QDate earliest(1900,01,01);
+    sparkline->setDays(earliest.daysTo(computing.dr.to) - earliest.daysTo(computing.dr.from));
 
     // do we want fill?
-    sparkline->setFill(metric->type()== RideMetric::Total || metric->type()== RideMetric::RunningTotal);
+    sparkline->setFill(computing.metric->type()== RideMetric::Total || computing.metric->type()== RideMetric::RunningTotal);
 
     // update the sparkline
-    sparkline->setPoints(points);
+    sparkline->setPoints(computing.points);
 
     // set range
-    sparkline->setRange(min*1.1,max*1.1); // add 10% to each direction
-
+    sparkline->setRange(computing.min*1.1,computing.max*1.1); // add 10% to each direction
+    // don't hold on to the rides
+    computing.store.clear();
 }
 
 static bool entrylessthan(struct topnentry &a, const topnentry &b) { return a.v < b.v; }
 static bool entrymorethan(struct topnentry &a, const topnentry &b) { return a.v > b.v; }
 
-void
-TopNOverviewItem::setDateRange(DateRange dr)
+bool
+TopNOverviewItem::prepare(DateRange dr)
 {
-    if (!metric) return; // avoid crashes when metric is not available
-
-    // clear out the old values
-    ranked.clear();
+    if (!metric) return false; // avoid crashes when metric is not available
 
     // filtering
-    Specification spec;
+    spec = Specification();
     spec.setDateRange(dr);
     setFilter(this, spec);
 
+    computing.symbol = symbol;
+    computing.ranked.clear();
+    return true;
+}
+
+void
+TopNOverviewItem::accumulate(RideItem *item)
+{
+    // get value and count
+    double v = item->getForSymbol(computing.symbol, GlobalContext::context()->useMetricUnits);
+    QString value = item->getStringForSymbol(computing.symbol, GlobalContext::context()->useMetricUnits);
+
+    // add to the list, tsb is looked up when we finish
+    QColor color = (item->color.red() == 1 && item->color.green() == 1 && item->color.blue() == 1) ? GColor(CPLOTMARKER) : item->color;
+    computing.ranked << topnentry(item->dateTime.date(), v, value, color, 0, item);
+}
+
+void
+TopNOverviewItem::finish()
+{
+    ranked = computing.ranked;
+    computing.ranked.clear();
+
     // pmc data
     PMCData stressdata(parent->context, spec, "coggan_tss");
     maxvalue="";
     maxv=0; // must never have -ve max
     minv=0; // always zero minimum
-    foreach(RideItem *item, parent->context->athlete->rideCache->rides()) {
-
-        if (!spec.pass(item)) continue;
-
-        // get value and count
-        double v = item->getForSymbol(symbol, GlobalContext::context()->useMetricUnits);
-        QString value = item->getStringForSymbol(symbol, GlobalContext::context()->useMetricUnits);
-        int index = stressdata.indexOf(item->dateTime.date());
-        double tsb = 0;
-        if (index >= 0 && index < stressdata.sb().count()) tsb = stressdata.sb()[index];
+    for(int i=0; i<ranked.count(); i++) {
 
-        // add to the list
-        QColor color = (item->color.red() == 1 && item->color.green() == 1 && item->color.blue() == 1) ? GColor(CPLOTMARKER) : item->color;
-        ranked << topnentry(item->dateTime.date(), v, value, color, tsb, item);
+        topnentry &entry = ranked[i];
+        int index = stressdata.indexOf(entry.date);
+        if (index >= 0 && index < stressdata.sb().count()) entry.tsb = stressdata.sb()[index];
 
         // biggest value?
-        if (v > maxv) {
-            maxvalue=value;
-            maxv = v;
+        if (entry.v > maxv) {
+            maxvalue=entry.value;
+            maxv = entry.v;
         }
 
         // minv should be 0 unless it goes negative
-        if (v < minv) minv=v;
+        if (entry.v < minv) minv=entry.v;
     }
 
     // sort the list
@@ -1843,88 +1882,90 @@ static bool lessthan(const aggmeta &a, const aggmeta &b)
     return a.value > b.value;
 }
 
-void
-DonutOverviewItem::setDateRange(DateRange dr)
+bool
+DonutOverviewItem::prepare(DateRange dr)
 {
-    if (!metric) return; // avoid crashes when metric is not available
-
-    // stop any animation before starting, just in case- stops a crash
-    // when we update a chart in the middle of its animation
-    if (chart) chart->setAnimationOptions(QChart::NoAnimation);;
-
-    // enable animation when setting values (disabled at all other times)
-    if (chart) chart->setAnimationOptions(QChart::SeriesAnimations);
+    if (!metric) return false; // avoid crashes when metric is not available
 
-    struct aggregator {
-        aggregator(double v, double c) : value(v), count(c) {}
-        double value, count;
-    };
-
-    Specification spec;
+    spec = Specification();
     spec.setDateRange(dr);
     setFilter(this, spec);
 
-    // aggregate sum and count etc
-    QMap<QString, aggregator> data;
-    foreach(RideItem *item, parent->context->athlete->rideCache->rides()) {
+    computing.symbol = symbol;
+    computing.meta = meta;
+    computing.metric = metric;
+    computing.data.clear();
+    return true;
+}
 
-        if (!spec.pass(item)) continue;
+void
+DonutOverviewItem::accumulate(RideItem *item)
+{
+    const RideMetric *metric = computing.metric;
 
-        // get meta value
-        QString category = item->getText(meta, "");
-        aggregator d = data.value(category, aggregator(-1,-1));
+    // get meta value
+    QString category = item->getText(computing.meta, "");
+    aggmeta d = computing.data.value(category, aggmeta(category, -1, 0, -1));
 
-        // is this first time we've seen this meta value?
-        bool first = false;
-        if (d.value == -1 && d.count == -1) {
-            first = true;
-            d.value=0;
-            d.count=0;
-        }
+    // is this first time we've seen this meta value?
+    bool first = false;
+    if (d.value == -1 && d.count == -1) {
+        first = true;
+        d.value=0;
+        d.count=0;
+    }
 
-        // get metric value and count
-        double value = item->getForSymbol(symbol, GlobalContext::context()->useMetricUnits);
-        double count = item->getCountForSymbol(symbol);
-        if (count <= 0) count = 1;
+    // get metric value and count
+    double value = item->getForSymbol(computing.symbol, GlobalContext::context()->useMetricUnits);
+    double count = item->getCountForSymbol(computing.symbol);
+    if (count <= 0) count = 1;
 
-        // ignore zeroes when aggregating?
-        if (metric->aggregateZero() == false && value == 0) continue;
-
-        // what we gonna do with this?
-        switch(metric->type()) {
-        case RideMetric::StdDev:
-        case RideMetric::MeanSquareRoot:
-        case RideMetric::Average:
-            d.value = (d.value*d.count) + (value * count); // convert to sum
-            d.count += count;
-            d.value = d.value / d.count; // turn back to average
-            break;
-        case RideMetric::Total:
-        case RideMetric::RunningTotal:
-            d.value += value;
-            break;
-        case RideMetric::Peak:
-            if (first || value > d.value) d.value = value;
-            break;
-        case RideMetric::Low:
-            if (first || value < d.value) d.value = value;
-            break;
-            break;
-        }
+    // ignore zeroes when aggregating?
+    if (metric->aggregateZero() == false && value == 0) return;
 
-        // update map
-        data.insert(category, d);
+    // what we gonna do with this?
+    switch(metric->type()) {
+    case RideMetric::StdDev:
+    case RideMetric::MeanSquareRoot:
+    case RideMetric::Average:
+        d.value = (d.value*d.count) + (value * count); // convert to sum
+        d.count += count;
+        d.value = d.value / d.count; // turn back to average
+        break;
+    case RideMetric::Total:
+    case RideMetric::RunningTotal:
+        d.value += value;
+        break;
+    case RideMetric::Peak:
+        if (first || value > d.value) d.value = value;
+        break;
+    case RideMetric::Low:
+        if (first || value < d.value) d.value = value;
+        break;
+        break;
     }
 
+    // update map
+    computing.data.insert(category, d);
+}
+
+void
+DonutOverviewItem::finish()
+{
+    // stop any animation before starting, just in case- stops a crash
+    // when we update a chart in the middle of its animation
+    if (chart) chart->setAnimationOptions(QChart::NoAnimation);;
+
+    // enable animation when setting values (disabled at all other times)
+    if (chart) chart->setAnimationOptions(QChart::SeriesAnimations);
+
     // now create a sorted list of values
     values.clear();
 
     double sum=0;
-    QMapIterator<QString, aggregator>it(data);
-    while (it.hasNext()) {
-        it.next();
-        values << aggmeta(it.key(), it.value().value, 0, it.value().count);
-        sum += it.value().value;
+    foreach(aggmeta d, computing.data) {
+        values << d;
+        sum += d.value;
     }
 
     // calculate as percentages
@@ -2015,115 +2056,156 @@ DonutOverviewItem::hoverSlice(QPieSlice *slice, bool state)
     update();
 }
 
-void
-ZoneOverviewItem::setDateRange(DateRange dr)
+template<class T>
+static QVector<zonerange>
+zoneRanges(const T *zones)
 {
-    QVector<double> vals(10); // max 10 seems ok
-    vals.fill(0);
-
-    // stop any animation before starting, just in case- stops a crash
-    // when we update a chart in the middle of its animation
-    if (chart) chart->setAnimationOptions(QChart::NoAnimation);;
+    QVector<zonerange> returning;
+    for (int i=0; zones && i<zones->getRangeSize(); i++) {
+        zonerange add;
+        add.begin = zones->getStartDate(i);
+        add.end = zones->getEndDate(i);
+        add.zones = zones->numZones(i);
+        returning << add;
+    }
+    return returning;
+}
 
-    // enable animation when setting values (disabled at all other times)
-    if (chart) chart->setAnimationOptions(QChart::SeriesAnimations);
+// as whichRange() then numZones(), 0 if not in a range
+static int
+zonesOn(const QVector<zonerange> &ranges, QDate date)
+{
+    foreach(const zonerange &range, ranges)
+        if ((date >= range.begin || range.begin.isNull()) && (date < range.end || range.end.isNull()))
+            return range.zones;
+    return 0;
+}
 
-    Specification spec;
+bool
+ZoneOverviewItem::prepare(DateRange dr)
+{
+    spec = Specification();
     spec.setDateRange(dr);
     setFilter(this, spec);
 
-    // aggregate sum and count etc
-    foreach(RideItem *item, parent->context->athlete->rideCache->rides()) {
-
-        if (!spec.pass(item)) continue;
+    computing.series = series;
+    computing.polarized = polarized;
+    computing.zones = categories.count();
+    computing.vals.fill(0, 10); // max 10 seems ok
 
+    // the zones are read here, not in accumulate
+    computing.ranges.clear();
+    if (!polarized) {
+        Athlete *athlete = parent->context->athlete;
         switch(series) {
+        case RideFile::hr:
+            foreach(QString sport, athlete->hrzones_.keys()) computing.ranges.insert(sport, zoneRanges(athlete->hrzones_.value(sport)));
+            break;
+        default:
+        case RideFile::watts:
+            foreach(QString sport, athlete->zones_.keys()) computing.ranges.insert(sport, zoneRanges(athlete->zones_.value(sport)));
+            break;
+        case RideFile::kph:
+            computing.ranges.insert("Run", zoneRanges(athlete->paceZones(false)));
+            computing.ranges.insert("Swim", zoneRanges(athlete->paceZones(true)));
+            break;
+        case RideFile::wbal:
+            break;
+        }
+    }
+    return true;
+}
 
-            //
-            // HEARTRATE
-            //
-            case RideFile::hr:
-            {
-                if (polarized) {
-                    for(int i=0; i<3; i++) {
-                        vals[i] += item->getForSymbol(timeInZonesHRPolarized[i]);
-                    }
-                } else if (parent->context->athlete->hrZones(item->sport)) {
-
-                    int numhrzones;
-                    int hrrange = parent->context->athlete->hrZones(item->sport)->whichRange(item->dateTime.date());
-
-                    if (hrrange > -1) {
-
-                        numhrzones = parent->context->athlete->hrZones(item->sport)->numZones(hrrange);
-                        for(int i=0; i<categories.count() && i < numhrzones;i++) {
-                            vals[i] += item->getForSymbol(timeInZonesHR[i]);
-                        }
-                    }
+void
+ZoneOverviewItem::accumulate(RideItem *item)
+{
+    QVector<double> &vals = computing.vals;
+    bool polarized = computing.polarized;
+    int zones = computing.zones;
+
+    switch(computing.series) {
+
+        //
+        // HEARTRATE
+        //
+        case RideFile::hr:
+        {
+            if (polarized) {
+                for(int i=0; i<3; i++) {
+                    vals[i] += item->getForSymbol(timeInZonesHRPolarized[i]);
                 }
-            }
-            break;
+            } else {
 
-            //
-            // POWER
-            //
-            default:
-            case RideFile::watts:
-            {
-                if (polarized) {
-                    for(int i=0; i<3; i++) {
-                        vals[i] += item->getForSymbol(timeInZonesPolarized[i]);
-                    }
-                } else if (parent->context->athlete->zones(item->sport)) {
-
-                    int numzones;
-                    int range = parent->context->athlete->zones(item->sport)->whichRange(item->dateTime.date());
-
-                    if (range > -1) {
-
-                        numzones = parent->context->athlete->zones(item->sport)->numZones(range);
-                        for(int i=0; i<categories.count() && i < numzones;i++) {
-                            vals[i] += item->getForSymbol(timeInZones[i]);
-                        }
-                    }
+                // no zones for the sport uses Bike, as Athlete::hrZones()
+                int numhrzones = zonesOn(computing.ranges.value(item->sport, computing.ranges.value("Bike")), item->dateTime.date());
+                for(int i=0; i<zones && i < numhrzones;i++) {
+                    vals[i] += item->getForSymbol(timeInZonesHR[i]);
                 }
             }
-            break;
+        }
+        break;
 
-            //
-            // PACE
-            //
-            case RideFile::kph:
-            {
-                if (polarized) {
-                    for(int i=0; i<3; i++) {
-                        vals[i] += item->getForSymbol(paceTimeInZonesPolarized[i]);
-                    }
-                } else if ((item->isRun || item->isSwim) && parent->context->athlete->paceZones(item->isSwim)) {
-
-                    int numzones;
-                    int range = parent->context->athlete->paceZones(item->isSwim)->whichRange(item->dateTime.date());
-
-                    if (range > -1) {
-
-                        numzones = parent->context->athlete->paceZones(item->isSwim)->numZones(range);
-                        for(int i=0; i<categories.count() && i < numzones;i++) {
-                            vals[i] += item->getForSymbol(paceTimeInZones[i]);
-                        }
-                    }
+        //
+        // POWER
+        //
+        default:
+        case RideFile::watts:
+        {
+            if (polarized) {
+                for(int i=0; i<3; i++) {
+                    vals[i] += item->getForSymbol(timeInZonesPolarized[i]);
+                }
+            } else {
+
+                // no zones for the sport uses Bike, as Athlete::zones()
+                int numzones = zonesOn(computing.ranges.value(item->sport, computing.ranges.value("Bike")), item->dateTime.date());
+                for(int i=0; i<zones && i < numzones;i++) {
+                    vals[i] += item->getForSymbol(timeInZones[i]);
                 }
             }
-            break;
+        }
+        break;
+
+        //
+        // PACE
+        //
+        case RideFile::kph:
+        {
+            if (polarized) {
+                for(int i=0; i<3; i++) {
+                    vals[i] += item->getForSymbol(paceTimeInZonesPolarized[i]);
+                }
+            } else if (item->isRun || item->isSwim) {
 
-            case RideFile::wbal:
-            {
-                for(int i=0; i<4; i++) {
-                    vals[i] += item->getForSymbol(timeInZonesWBAL[i]);
+                int numzones = zonesOn(computing.ranges.value(item->isSwim ? "Swim" : "Run"), item->dateTime.date());
+                for(int i=0; i<zones && i < numzones;i++) {
+                    vals[i] += item->getForSymbol(paceTimeInZones[i]);
                 }
             }
-            break;
         }
+        break;
+
+        case RideFile::wbal:
+        {
+            for(int i=0; i<4; i++) {
+                vals[i] += item->getForSymbol(timeInZonesWBAL[i]);
+            }
+        }
+        break;
     }
+}
+
+void
+ZoneOverviewItem::finish()
+{
+    const QVector<double> &vals = computing.vals;
+
+    // stop any animation before starting, just in case- stops a crash
+    // when we update a chart in the middle of its animation
+    if (chart) chart->setAnimationOptions(QChart::NoAnimation);;
+
+    // enable animation when setting values (disabled at all other times)
+    if (chart) chart->setAnimationOptions(QChart::SeriesAnimations);
 
     // now update the barset converting to percentages
     double sum=0;
@@ -2327,8 +2409,8 @@ RouteOverviewItem::setData(RideItem *item)
     }
 }
 
-void
-IntervalOverviewItem::setDateRange(DateRange dr)
+bool
+IntervalOverviewItem::prepare(DateRange dr)
 {
     // for metrics lets truncate to today
     if (dr.to > QDate::currentDate()) dr.to = QDate::currentDate();
@@ -2336,59 +2418,69 @@ IntervalOverviewItem::setDateRange(DateRange dr)
     RideMetricFactory &factory = RideMetricFactory::instance();
     const RideMetric *xm = factory.rideMetric(xsymbol);
     const RideMetric *ym = factory.rideMetric(ysymbol);
-    if (!xm || !ym) return; // avoid crashes when metrics are not available
-
-    xdp = xm->precision();
-    ydp = ym->precision();
-    bubble->setAxisNames(xm ? xm->name() : "NA", ym ? ym->name() : "NA");
+    if (!xm || !ym) return false; // avoid crashes when metrics are not available
 
-    Specification spec;
+    spec = Specification();
     spec.setDateRange(dr);
     setFilter(this, spec);
 
-    double minx = 0;
-    double maxx = 0;
-    double miny = 0;
-    double maxy = 0;
-    double xoff = 0;
-    double yoff = 0;
-    bool first=true;
-
-    QList<BPointF> points;
-    foreach(RideItem *item, parent->context->athlete->rideCache->rides()) {
-
-        if (!spec.pass(item)) continue;
-
-
-        // get the x and y VALUE
-        double x = item->getForSymbol(xsymbol, GlobalContext::context()->useMetricUnits);
-        double y = item->getForSymbol(ysymbol, GlobalContext::context()->useMetricUnits);
-        double z = item->getForSymbol(zsymbol, GlobalContext::context()->useMetricUnits);
+    computing.xsymbol = xsymbol;
+    computing.ysymbol = ysymbol;
+    computing.zsymbol = zsymbol;
+    computing.xm = xm;
+    computing.ym = ym;
+    computing.points.clear();
+    computing.minx = computing.maxx = computing.miny = computing.maxy = 0;
+    computing.xoff = computing.yoff = 0;
+    computing.first = true;
+    return true;
+}
 
-        // truncate dates and use offsets
-        if (first && xm->isDate())  xoff = x;
-        if (first && ym->isDate())  yoff = y;
-        x -= xoff;
-        y -= yoff;
+void
+IntervalOverviewItem::accumulate(RideItem *item)
+{
+    // get the x and y VALUE
+    double x = item->getForSymbol(computing.xsymbol, GlobalContext::context()->useMetricUnits);
+    double y = item->getForSymbol(computing.ysymbol, GlobalContext::context()->useMetricUnits);
+    double z = item->getForSymbol(computing.zsymbol, GlobalContext::context()->useMetricUnits);
+
+    // truncate dates and use offsets
+    bool first = computing.first;
+    if (first && computing.xm->isDate())  computing.xoff = x;
+    if (first && computing.ym->isDate())  computing.yoff = y;
+    x -= computing.xoff;
+    y -= computing.yoff;
+
+    BPointF add;
+    add.x = x;
+    add.xoff = computing.xoff;
+    add.y = y;
+    add.yoff = computing.yoff;
+    add.z = z;
+    add.fill = item->color;
+    add.item = item; // for click thru
+    if (add.fill.red() == 1 && add.fill.green() == 1 && add.fill.blue() == 1) add.fill = GColor(CPLOTMARKER);
+    add.label = item->getText("Workout Code","blank");
+    computing.points << add;
+
+    if (first || x<computing.minx) computing.minx=x;
+    if (first || y<computing.miny) computing.miny=y;
+    if (first || x>computing.maxx) computing.maxx=x;
+    if (first || y>computing.maxy) computing.maxy=y;
+    computing.first = false;
+}
 
-        BPointF add;
-        add.x = x;
-        add.xoff = xoff;
-        add.y = y;
-        add.yoff = yoff;
-        add.z = z;
-        add.fill = item->color;
-        add.item = item; // for click thru
-        if (add.fill.red() == 1 && add.fill.green() == 1 && add.fill.blue() == 1) add.fill = GColor(CPLOTMARKER);
-        add.label = item->getText("Workout Code","blank");
-        points << add;
+void
+IntervalOverviewItem::finish()
+{
+    xdp = computing.xm->precision();
+    ydp = computing.ym->precision();
+    bubble->setAxisNames(computing.xm->name(), computing.ym->name());
 
-        if (first || x<minx) minx=x;
-        if (first || y<miny) miny=y;
-        if (first || x>maxx) maxx=x;
-        if (first || y>maxy) maxy=y;
-        first = false;
-    }
+    double minx = computing.minx;
+    double maxx = computing.maxx;
+    double miny = computing.miny;
+    double maxy = computing.maxy;
 
     // set scale
     double ydiff = (maxy-miny) / 10.0f;
@@ -2399,7 +2491,8 @@ IntervalOverviewItem::setDateRange(DateRange dr)
     maxy=ceil(maxy); miny=floor(miny);
 
     // set range before points to filter
-    bubble->setPoints(points, minx,maxx,miny,maxy, true);
+    bubble->setPoints(computing.points, minx,maxx,miny,maxy, true);
+    computing.points.clear();
 }
 
 void
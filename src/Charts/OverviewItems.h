@@ -41,6 +41,7 @@ class Routeline;
 class ProgressBar;
 class VScrollBar;
 class ColorButton;
+class MetricSnapshot;
 
 // sparklines number of points - look back 6 weeks
 #define SPARKDAYS 42
@@ -253,7 +254,9 @@ class MetricOverviewItem : public ChartSpaceItem
         void itemPaint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *);
         void itemGeometryChanged();
         void setData(RideItem *item);
-        void setDateRange(DateRange);
+        bool prepare(DateRange);
+        void complete();
+        void finish();
 
         QWidget *config() { return configwidget; }
 
@@ -275,6 +278,17 @@ class MetricOverviewItem : public ChartSpaceItem
         QPixmap gold, silver, bronze; // medals
 
         OverviewItemConfig *configwidget;
+
+        // trends, from the metric store snapshot taken in prepare()
+        struct {
+            QSharedPointer<const MetricSnapshot> store;
+            const RideMetric *metric;
+            QString symbol;
+            DateRange dr;
+            QString value;
+            QList<QPointF> points;
+            double min, max;
+        } computing;
 };
 
 // top N uses this to hold details for date range
@@ -313,7 +327,9 @@ class TopNOverviewItem : public ChartSpaceItem
         void itemPaint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) override;
         void itemGeometryChanged() override;
         void setData(RideItem *) override {} // doesn't support analysis view
-        void setDateRange(DateRange) override;
+        bool prepare(DateRange) override;
+        void accumulate(RideItem *) override;
+        void finish() override;
         QRectF hotspot() override;
 
         QWidget *config() override { return configwidget; }
@@ -341,6 +357,12 @@ class TopNOverviewItem : public ChartSpaceItem
         RideItem *clickthru = nullptr;
 
         OverviewItemConfig *configwidget;
+
+        // trends, ranked in finish()
+        struct {
+            QString symbol;
+            QList<topnentry> ranked;
+        } computing;
 };
 
 class MetaOverviewItem : public ChartSpaceItem
@@ -402,6 +424,13 @@ class PMCOverviewItem : public ChartSpaceItem
         OverviewItemConfig *configwidget;
 };
 
+// zone ranges for the zone histogram, copied in prepare() since the
+// athlete's zones can be changed while the pool is computing
+struct zonerange {
+    QDate begin, end;
+    int zones;
+};
+
 class ZoneOverviewItem : public ChartSpaceItem
 {
     Q_OBJECT
@@ -414,7 +443,9 @@ class ZoneOverviewItem : public ChartSpaceItem
         void itemPaint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) override;
         void itemGeometryChanged() override;
         void setData(RideItem *item) override;
-        void setDateRange(DateRange) override;
+        bool prepare(DateRange) override;
+        void accumulate(RideItem *) override;
+        void finish() override;
         void dragChanged(bool x) override;
 
         QWidget *config() override { return configwidget; }
@@ -433,6 +464,15 @@ class ZoneOverviewItem : public ChartSpaceItem
         QBarCategoryAxis *barcategoryaxis;
 
         OverviewItemConfig *configwidget;
+
+        // trends, time in zone
+        struct {
+            RideFile::seriestype series;
+            bool polarized;
+            int zones;
+            QVector<double> vals;
+            QHash<QString, QVector<zonerange> > ranges; // by sport, pace by Run or Swim
+        } computing;
 };
 
 struct aggmeta {
@@ -455,7 +495,9 @@ class DonutOverviewItem : public ChartSpaceItem
         void itemPaint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *);
         void itemGeometryChanged();
         void setData(RideItem *) {} // trends view only
-        void setDateRange(DateRange);
+        bool prepare(DateRange);
+        void accumulate(RideItem *);
+        void finish();
         void dragChanged(bool x);
 
         QWidget *config() { return configwidget ; }
@@ -479,6 +521,13 @@ class DonutOverviewItem : public ChartSpaceItem
 
         OverviewItemConfig *configwidget;
 
+        // trends, aggregated by category
+        struct {
+            QString symbol, meta;
+            const RideMetric *metric;
+            QMap<QString, aggmeta> data;
+        } computing;
+
     public slots:
         void hoverSlice(QPieSlice *slice, bool state);
 };
@@ -507,6 +556,21 @@ class RouteOverviewItem : public ChartSpaceItem
         OverviewItemConfig *configwidget;
 };
 
+// for now the basics are x and y and a radius z, color fill
+class BPointF {
+public:
+
+    BPointF() : x(0), y(0), z(0), xoff(0), yoff(0), fill(GColor(Qt::gray)), item(NULL) {}
+
+    double score(BPointF &other);
+
+    double x,y,z;
+    double xoff, yoff; // add to x,y,z when converting to string (used for dates)
+    QColor fill;
+    QString label;
+    RideItem *item;
+};
+
 class IntervalOverviewItem : public ChartSpaceItem
 {
     Q_OBJECT
@@ -520,7 +584,9 @@ class IntervalOverviewItem : public ChartSpaceItem
         void itemGeometryChanged();
         void setData(RideItem *item);
         void setData(RideItem *item, bool animate);
-        void setDateRange(DateRange);
+        bool prepare(DateRange);
+        void accumulate(RideItem *);
+        void finish();
 
         QWidget *config() { return configwidget; }
 
@@ -538,6 +604,15 @@ class IntervalOverviewItem : public ChartSpaceItem
 
         OverviewItemConfig *configwidget;
 
+        // trends, a bubble for each activity
+        struct {
+            QString xsymbol, ysymbol, zsymbol;
+            const RideMetric *xm, *ym;
+            QList<BPointF> points;
+            double minx, maxx, miny, maxy, xoff, yoff;
+            bool first;
+        } computing;
+
     public slots:
         void intervalSelectRefresh();
         void intervalHover(IntervalItem *);
@@ -548,22 +623,6 @@ class IntervalOverviewItem : public ChartSpaceItem
 // below are theviz widgets used by the overview items
 //
 
-// for now the basics are x and y and a radius z, color fill
-class BPointF {
-public:
-
-    BPointF() : x(0), y(0), z(0), xoff(0), yoff(0), fill(GColor(Qt::gray)), item(NULL) {}
-
-    double score(BPointF &other);
-
-    double x,y,z;
-    double xoff, yoff; // add to x,y,z when converting to string (used for dates)
-    QColor fill;
-    QString label;
-    RideItem *item;
-};
-
-
 // bubble chart, very very basic just a visualisation
 class BubbleViz : public QObject, public QGraphicsItem
 {
@@ -25,14 +25,66 @@
 #include "RideFile.h"
 #include "RideFileCache.h"
 #include "CsvRideFile.h"
+#include "RideFileColumns.h"
 
 #include "Zones.h"
 #include "HrZones.h"
 #include "PaceZones.h"
 #include "Measures.h"
 
-#include <QTemporaryFile>
 #include <QFile>
+#include <QIODevice>
+#include <QDataStream>
+#include <QDebug>
+#include <QMutexLocker>
+
+QString
+APIRide::getText(QString name, QString fallback) const
+{
+    // Start Date and Time are special cases, defined as metadata fields but stored in a different way
+    if (name == "Start Date") return QString::number(QDate(1900,01,01).daysTo(dateTime.date()));
+    if (name == "Start Time") return QString::number(QTime(0,0,0).secsTo(dateTime.time()));
+    return metadata.value(name, fallback);
+}
+
+bool
+APISnapshot::meanmax(QString key, QVector<float> &values) const
+{
+    QMutexLocker locker(&lock);
+    if (!curves.contains(key)) return false;
+    values = curves.value(key);
+    return true;
+}
+
+void
+APISnapshot::setMeanmax(QString key, const QVector<float> &values)
+{
+    QMutexLocker locker(&lock);
+    curves.insert(key, values);
+}
+
+bool
+APIWebService::notModified(QSharedPointer<APISnapshot> snap, HttpRequest &request, HttpResponse &response)
+{
+    // what comes back depends on the rides and what was asked for
+    QByteArray asked = request.getPath();
+    QMultiMap<QByteArray,QByteArray> parameters = request.getParameterMap();
+    QMultiMap<QByteArray,QByteArray>::const_iterator it;
+    for (it = parameters.constBegin(); it != parameters.constEnd(); ++it) asked += "&" + it.key() + "=" + it.value();
+    QByteArray etag = "\"" + snap->version + "-" + QByteArray::number(qHash(asked), 16) + "\"";
+
+    response.setHeader("ETag", etag);
+
+    foreach(QByteArray tag, request.getHeader("If-None-Match").split(',')) {
+        tag = tag.trimmed();
+        if (tag == etag || tag == "*") {
+            response.setStatus(304, "Not Modified");
+            response.write(QByteArray(), true);
+            return true;
+        }
+    }
+    return false;
+}
 
 void
 APIWebService::service(HttpRequest &request, HttpResponse &response)
@@ -72,8 +124,7 @@ APIWebService::athleteData(QStringList &paths, HttpRequest &request, HttpRespons
         response.write("missing athlete.");
         return;
     } else {
-        QFile ridedb(home.absolutePath() + "/" + paths[0] + "/cache/rideDB.json");
-        if (!ridedb.exists()) {
+        if (snapshot(paths[0]).isNull()) {
             response.setStatus(404); // malformed URL
             response.setHeader("Content-Type", "text; charset=ISO-8859-1");
             response.write("unknown athlete " + paths[0].toLocal8Bit());
@@ -196,7 +247,7 @@ APIWebService::listAthletes(HttpRequest &, HttpResponse &response)
 
 
 void 
-APIWebService::writeRideLine(RideItem &item, HttpRequest *request, HttpResponse *response)
+APIWebService::writeRideLine(const APIRide &item, HttpRequest *request, HttpResponse *response)
 {
 
     // honour the since parameter
@@ -219,7 +270,7 @@ APIWebService::writeRideLine(RideItem &item, HttpRequest *request, HttpResponse
     if (settings->intervals == true) {
 
         // loop through all available intervals for this ride item
-        foreach(IntervalItem *interval, item.intervals()){ 
+        foreach(const APIInterval &interval, item.intervals){ 
 
             // date, time, filename
             response->bwrite(item.dateTime.date().toString("yyyy/MM/dd").toLocal8Bit());
@@ -230,22 +281,22 @@ APIWebService::writeRideLine(RideItem &item, HttpRequest *request, HttpResponse
 
             // now the interval name and type
             response->bwrite(", \"");
-            response->bwrite(interval->name.toLocal8Bit());
+            response->bwrite(interval.name.toLocal8Bit());
             response->bwrite("\", ");
-            response->bwrite(QString("%1").arg(static_cast<int>(interval->type)).toLocal8Bit());
+            response->bwrite(QString("%1").arg(interval.type).toLocal8Bit());
 
             // essentially the same as below .. cut and paste (refactor?XXX)
             if (settings->wanted.count()) {
                 // specific metrics
                 foreach(int index, settings->wanted) {
-                    double value = interval->metrics()[index];
+                    double value = interval.metrics[index];
                     response->bwrite(",");
                     response->bwrite(QString("%1").arg(value, 'f').simplified().toLocal8Bit());
                 }
             } else {
     
                 // all metrics...
-                foreach(double value, interval->metrics()) {
+                foreach(double value, interval.metrics) {
                     response->bwrite(",");
                     response->bwrite(QString("%1").arg(value, 'f').simplified().toLocal8Bit());
                 }
@@ -265,14 +316,14 @@ APIWebService::writeRideLine(RideItem &item, HttpRequest *request, HttpResponse
         if (settings->wanted.count()) {
             // specific metrics
             foreach(int index, settings->wanted) {
-                double value = item.metrics()[index];
+                double value = item.metrics[index];
                 response->bwrite(",");
                 response->bwrite(QString("%1").arg(value, 'f').simplified().toLocal8Bit());
             }
         } else {
     
             // all metrics...
-            foreach(double value, item.metrics()) {
+            foreach(double value, item.metrics) {
                 response->bwrite(",");
                 response->bwrite(QString("%1").arg(value, 'f').simplified().toLocal8Bit());
             }
@@ -295,13 +346,83 @@ APIWebService::writeRideLine(RideItem &item, HttpRequest *request, HttpResponse
     }
 }
 
+// writers stream into the response as they go via this, it is
+// buffered by bwrite and sent chunked as the buffer fills
+class HttpResponseDevice : public QIODevice
+{
+    public:
+        HttpResponseDevice(HttpResponse &response) : response(response), start(true), sent(0) { open(QIODevice::WriteOnly); }
+
+        // bytes passed on to the response
+        qint64 written() const { return sent; }
+
+    protected:
+        qint64 readData(char *, qint64) { return -1; }
+        qint64 writeData(const char *data, qint64 len) {
+            QByteArray chunk(data, len);
+
+            // the writers add a BOM for files, not wanted on the wire
+            if (start && chunk.startsWith("\xEF\xBB\xBF")) chunk.remove(0, 3);
+            start = false;
+
+            if (chunk.isEmpty()) return len;
+            response.bwrite(chunk);
+            sent += chunk.size();
+            return len;
+        }
+
+    private:
+        HttpResponse &response;
+        bool start;
+        qint64 sent;
+};
+
+// compact columnar format for bulk download of samples, all little endian:
+//
+//   "GCCOLS01" quint32 samples quint32 columns
+//   per column: quint8 bytes per value (4 or 8) quint8 name length, name
+//   then each column in turn, samples values of float32 or float64
+//
+// secs, distance and position need double precision, the rest are floats
+static bool
+writeColumns(RideFile *ride, QIODevice &device)
+{
+    QSharedPointer<const RideFileColumns> columns = ride->columns();
+
+    QList<RideFile::SeriesType> series;
+    for (int i=0; i<static_cast<int>(RideFile::none); i++)
+        if (columns->isPresent(static_cast<RideFile::SeriesType>(i)))
+            series << static_cast<RideFile::SeriesType>(i);
+
+    QDataStream out(&device);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    out.writeRawData("GCCOLS01", 8);
+    out << quint32(columns->count()) << quint32(series.count());
+
+    foreach(RideFile::SeriesType s, series) {
+        bool precise = s == RideFile::secs || s == RideFile::km || s == RideFile::lon || s == RideFile::lat;
+        QByteArray name = RideFile::seriesName(s, true).toLatin1();
+        out << quint8(precise ? 8 : 4) << quint8(name.length());
+        out.writeRawData(name.constData(), name.length());
+    }
+
+    foreach(RideFile::SeriesType s, series) {
+        bool precise = s == RideFile::secs || s == RideFile::km || s == RideFile::lon || s == RideFile::lat;
+        out.setFloatingPointPrecision(precise ? QDataStream::DoublePrecision : QDataStream::SinglePrecision);
+
+        const double *values = columns->column(s);
+        for (int i=0; i<columns->count(); i++) out << values[i];
+    }
+    return out.status() == QDataStream::Ok;
+}
+
 void
 APIWebService::listActivity(QString athlete, QStringList paths, HttpRequest &request, HttpResponse &response)
 {
     // does it exist ?
     QString filename = QString("%1/%2/activities/%3").arg(home.absolutePath()).arg(athlete).arg(paths[0]);
 
-    QString contents;
     QFile file(filename);
     if (file.exists() && file.open(QFile::ReadOnly | QFile::Text)) {
 
@@ -323,6 +444,7 @@ APIWebService::listActivity(QString athlete, QStringList paths, HttpRequest &req
                 if (accepts == "application/vnd.garmin.tcx") format="tcx";
                 if (accepts == "application/vnd.trainingpeaks.pwx") format="pwx";
                 if (accepts == "application/xml" || accepts == "text/xml") format="tcx";
+                if (accepts == "application/vnd.goldencheetah.columns") format="columns";
                 if (format != "") break;
             }
         }
@@ -336,6 +458,7 @@ APIWebService::listActivity(QString athlete, QStringList paths, HttpRequest &req
         formats << "csv"; // full csv list (not powertap)
         formats << "json"; // gc json
         formats << "pwx"; // gc json
+        formats << "columns"; // binary samples by column
 
         // unsupported format
         if (!formats.contains(format)) {
@@ -347,13 +470,6 @@ APIWebService::listActivity(QString athlete, QStringList paths, HttpRequest &req
             }
             response.write("\r\n");
             return;
-        } else {
-
-            // set the content type appropriately
-            if (format == "tcx") response.setHeader("Content-Type", "application/vnd.garmin.tcx+xml; charset=ISO-8859-1");
-            if (format == "csv") response.setHeader("Content-Type", "text/csv; charset=ISO-8859-1");
-            if (format == "json") response.setHeader("Content-Type", "application/json; charset=ISO-8859-1");
-            if (format == "pwx") response.setHeader("Content-Type", "application/vnd.trainingpeaks.pwx+xml; charset=ISO-8859-1");
         }
 
         // lets read the file in as a ridefile
@@ -370,46 +486,43 @@ APIWebService::listActivity(QString athlete, QStringList paths, HttpRequest &req
             return;
         }
 
-        // write out to a temporary file in
-        // the format requested
+        // set the content type appropriately
+        if (format == "tcx") response.setHeader("Content-Type", "application/vnd.garmin.tcx+xml; charset=UTF-8");
+        if (format == "csv") response.setHeader("Content-Type", "text/csv; charset=UTF-8");
+        if (format == "json") response.setHeader("Content-Type", "application/json; charset=UTF-8");
+        if (format == "pwx") response.setHeader("Content-Type", "application/vnd.trainingpeaks.pwx+xml; charset=UTF-8");
+        if (format == "columns") response.setHeader("Content-Type", "application/vnd.goldencheetah.columns");
+
+        // stream straight into the response in the format requested, once
+        // we start the status has gone so a failure just ends it short
         bool success;
-        QTemporaryFile tempfile; // deletes file when goes out of scope
-        QString tempname;
-        if (tempfile.open()) tempname = tempfile.fileName();
-        else {
-            response.setStatus(500);
-            response.write("error opening temporary file");
-            return;
-        }
-        QFile out(tempname);
+        HttpResponseDevice out(response);
 
         if (format == "csv") {
             CsvFileReader writer;
-            success = writer.writeRideFile(NULL, f, out, CsvFileReader::gc);
+            success = writer.streamRideFile(NULL, f, out, CsvFileReader::gc);
+        } else if (format == "columns") {
+            success = writeColumns(f, out);
         } else {
-            success = RideFileFactory::instance().writeRideFile(NULL, f, out, format);
+            success = RideFileFactory::instance().streamRideFile(NULL, f, out, format);
         }
+        delete f;
 
-        if (success) {
+        if (!success) {
+            qDebug()<<"API: unable to write"<<format<<"for"<<filename;
 
-            // read in the whole thing
-            out.open(QFile::ReadOnly | QFile::Text);
-            QTextStream in(&out);
-#if QT_VERSION < 0x060000
-            in.setCodec ("UTF-8");
-#endif
-            contents = in.readAll();
-            out.close();
-
-            // write back in one hit
-            response.write(contents.toLocal8Bit(), true);
-            return;
-
-        } else {
-            response.setStatus(500);
-            response.write("unable to write output, internal error.\n");
-            return;
+            // nothing went out so we can still say so
+            if (out.written() == 0) {
+                response.setStatus(500);
+                response.setHeader("Content-Type", "text/plain; charset=UTF-8");
+                response.write("unable to write ");
+                response.write(format.toLocal8Bit());
+                response.write("\r\n");
+                return;
+            }
         }
+        response.flush();
+        return;
 
     } else {
 
@@ -450,6 +563,15 @@ APIWebService::listMMP(QString athlete, QStringList paths, HttpRequest &request,
 
     QString filename=paths[0];
 
+    // curves come from the .cpx files, which are updated along with rideDB.json
+    QSharedPointer<APISnapshot> snap = snapshot(athlete);
+    if (snap.isNull()) {
+        response.setStatus(404);
+        response.write("unknown athlete.\n");
+        return;
+    }
+    if (notModified(snap, request, response)) return;
+
     if (paths[0] == "bests") {
 
         // header
@@ -467,8 +589,15 @@ APIWebService::listMMP(QString athlete, QStringList paths, HttpRequest &request,
         QDate before(3000,01,01);
         if (beforep != "") before = QDate::fromString(beforep,"yyyy/MM/dd");
 
+        QVector<float> values;
+        QString key = QString("bests:%1:%2:%3").arg(seriesp).arg(since.toJulianDay()).arg(before.toJulianDay());
+        if (!snap->meanmax(key, values)) {
+            values = RideFileCache::meanMaxFor(home.absolutePath() + "/" + athlete + "/cache", series, since, before);
+            snap->setMeanmax(key, values);
+        }
+
         int secs=0;
-        foreach(float value, RideFileCache::meanMaxFor(home.absolutePath() + "/" + athlete + "/cache", series, since, before)) {
+        foreach(float value, values) {
             if (secs >0) response.bwrite(QString("%1, %2\n").arg(secs).arg(value).toLocal8Bit());
             secs++;
         }
@@ -482,9 +611,16 @@ APIWebService::listMMP(QString athlete, QStringList paths, HttpRequest &request,
         response.bwrite(seriesp.toLocal8Bit());
         response.bwrite("\n");
 
-        if (QFileInfo(CPXfilename).exists()) {
+        QVector<float> values;
+        QString key = QString("%1:%2").arg(CPXfilename).arg(seriesp);
+        if (!snap->meanmax(key, values) && QFileInfo(CPXfilename).exists()) {
+            values = RideFileCache::meanMaxFor(CPXfilename, series);
+            snap->setMeanmax(key, values);
+        }
+
+        if (values.count()) {
             int secs=0;
-            foreach(float value, RideFileCache::meanMaxFor(CPXfilename, series)) {
+            foreach(float value, values) {
                 if (secs >0) response.bwrite(QString("%1, %2\n").arg(secs).arg(value).toLocal8Bit());
                 secs++;
             }
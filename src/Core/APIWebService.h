@@ -23,6 +23,11 @@
 #include "RideItem.h"
 #include "RideMetadata.h"
 #include <QDir>
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
 
 struct listRideSettings {
     bool intervals;
@@ -31,6 +36,51 @@ struct listRideSettings {
     QList<QString> metawanted; // metadata to list
 };
 
+// what is listed for a ride and its intervals, plain values rather
+// than RideItems since the handler threads share them
+struct APIInterval {
+    QString name;
+    int type;
+    QVector<double> metrics;
+};
+
+struct APIRide {
+    QString fileName;
+    QDateTime dateTime;
+    QVector<double> metrics;
+    QMap<QString, QString> metadata;
+    QList<APIInterval> intervals;
+
+    QString getText(QString name, QString fallback) const; // as RideItem::getText
+};
+
+// A read-only copy of an athlete's cache/rideDB.json that stays resident
+// so requests don't parse it every time. Requests running concurrently
+// share it, when the file changes a new one is read and replaces it as a
+// whole; requests already holding the old one finish with it.
+class APISnapshot
+{
+    public:
+        APISnapshot() : size(0) {}
+
+        // the rideDB.json it was read from
+        QDateTime modified;
+        qint64 size;
+        QByteArray version; // for etags
+
+        // rides with their metrics and intervals
+        QVector<APIRide> rides;
+
+        // mean max curves computed so far, they're only good
+        // for as long as the rides are, so they live here too
+        bool meanmax(QString key, QVector<float> &values) const;
+        void setMeanmax(QString key, const QVector<float> &values);
+
+    private:
+        mutable QMutex lock;
+        QHash<QString, QVector<float> > curves;
+};
+
 class APIWebService : public HttpRequestHandler
 {
 
@@ -52,10 +102,19 @@ class APIWebService : public HttpRequestHandler
         void listMeasures(QString athlete, QStringList paths, HttpRequest &request, HttpResponse &response);
 
         // utility
-        void writeRideLine(RideItem &item, HttpRequest *request, HttpResponse *response);
+        void writeRideLine(const APIRide &item, HttpRequest *request, HttpResponse *response);
+
+        // the athlete's snapshot, read again when rideDB.json has changed; null if there isn't one
+        QSharedPointer<APISnapshot> snapshot(QString athlete);
+
+        // sets the etag, true if the client already has this and it was told so
+        bool notModified(QSharedPointer<APISnapshot> snap, HttpRequest &request, HttpResponse &response);
 
     private:
         QDir home;
+
+        QMutex snapshotLock;
+        QHash<QString, QSharedPointer<APISnapshot> > snapshots;
 };
 
 #endif
@@ -26,6 +26,7 @@
 #include "RideCache.h"
 #include "Estimator.h"
 #include "RideFileCache.h"
+#include "MeanMaxIndex.h"
 #include "RideMetric.h"
 #include "Settings.h"
 #include "TimeUtils.h"
@@ -161,12 +162,15 @@ Athlete::Athlete(Context *context, const QDir &homeDir)
     // Routes
     routes = new Routes(context, home->config());
 
+    // Mean max aggregates, before the ride cache refreshes any cpx files
+    meanMaxIndex = new MeanMaxIndex(context);
+
     // Daily Measures
     measures = new Measures(home->config(), true);
 
     // auto downloader
     cloudAutoDownload = new CloudServiceAutoDownload(context);
-    connect(context, SIGNAL(refreshEnd()), cloudAutoDownload, SLOT(autoDownload()));
+    if (context->mainWindow) connect(context, SIGNAL(refreshEnd()), cloudAutoDownload, SLOT(autoDownload()));
 
     // now most dependencies are in get cache
     QEventLoop loop;
@@ -175,7 +179,8 @@ Athlete::Athlete(Context *context, const QDir &homeDir)
     connect(rideCache, SIGNAL(loadComplete()), this, SLOT(loadComplete()));
 
     // we need to block on load complete if first (before mainwindow ready)
-    if (context->mainWindow->isStarting()) {
+    // or headless, where there is no mainwindow at all
+    if (context->mainWindow == NULL || context->mainWindow->isStarting()) {
         loop.exec();
     }
 }
@@ -195,7 +200,7 @@ Athlete::loadComplete()
 #ifdef GC_HAVE_ICAL
     rideCalendar = new ICalendar(context); // my local/remote calendar entries
     davCalendar = new CalDAV(context); // remote caldav
-    davCalendar->download(true); // refresh the diary window but do not show any error messages
+    if (context->mainWindow) davCalendar->download(true); // refresh the diary window but do not show any error messages
 #endif
 
     // trap signals
@@ -252,6 +257,7 @@ Athlete::~Athlete()
 
     delete namedSearches;
     delete routes;
+    delete meanMaxIndex;
     delete seasons;
     delete measures;
 
@@ -304,6 +310,8 @@ Athlete::checkCPX(RideItem*ride)
             newList.append(p);
     }
     cpxCache = newList;
+
+    meanMaxIndex->invalidate(ride->dateTime.date());
 }
 
 void
@@ -558,15 +566,19 @@ Athlete::getPMCFor(QString metricName, int stsdays, int ltsdays)
 {
     PMCData *returning = NULL;
 
+    // shared by everyone using the same metric and constants
+    QString key = metricName;
+    if (stsdays >= 0 || ltsdays >= 0) key += QString(":%1:%2").arg(stsdays).arg(ltsdays);
+
     // if we don't already have one, create it
-    returning = pmcData.value(metricName, NULL);
+    returning = pmcData.value(key, NULL);
     if (!returning) {
 
         // specification is blank and passes for all
         returning = new PMCData(context, Specification(), metricName, stsdays, ltsdays);
 
         // add to our collection
-        pmcData.insert(metricName, returning);
+        pmcData.insert(key, returning);
     }
 
     return returning;
@@ -577,15 +589,19 @@ Athlete::getPMCFor(Leaf *expr, DataFilterRuntime *df, int stsdays, int ltsdays)
 {
     PMCData *returning = NULL;
 
+    // shared by everyone using the same expression and constants
+    QString key = expr->signature();
+    if (stsdays >= 0 || ltsdays >= 0) key += QString(":%1:%2").arg(stsdays).arg(ltsdays);
+
     // if we don't already have one, create it
-    returning = pmcData.value(expr->signature(), NULL);
+    returning = pmcData.value(key, NULL);
     if (!returning) {
 
         // specification is blank and passes for all
         returning = new PMCData(context, Specification(), expr, df, stsdays, ltsdays);
 
         // add to our collection
-        pmcData.insert(expr->signature(), returning);
+        pmcData.insert(key, returning);
     }
 
     return returning;
@@ -44,6 +44,7 @@ class Seasons;
 class RideNavigator;
 class NamedSearches;
 class RideFileCache;
+class MeanMaxIndex;
 class RideItem;
 class IntervalItem;
 class IntervalTreeView;
@@ -93,6 +94,7 @@ class Athlete : public QObject
         Seasons *seasons;
         Routes *routes;
         QList<RideFileCache*> cpxCache;
+        MeanMaxIndex *meanMaxIndex; // pre-aggregated weeks, months and years
         RideCache *rideCache;
         Measures *measures;
 
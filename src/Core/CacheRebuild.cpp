@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "CacheRebuild.h"
+
+#include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+#include "Settings.h"
+
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QFile>
+#include <stdio.h>
+
+#if defined(Q_OS_WIN)
+#define PSAPI_VERSION 2 // K32GetProcessMemoryInfo is in kernel32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+CacheRebuild::CacheRebuild(const QDir &home) : home(home), done(false)
+{
+}
+
+qint64
+CacheRebuild::peakMemory()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize / 1024;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(Q_OS_MAC)
+    return usage.ru_maxrss / 1024; // bytes on a mac
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+void
+CacheRebuild::refreshEnd()
+{
+    done = true;
+    loop.quit();
+}
+
+// start from nothing so every run does the same work
+void
+CacheRebuild::clear()
+{
+    AthleteDirectoryStructure structure(home);
+    QDir cache = structure.cache();
+
+    QStringList names;
+    names << "rideDB.json" << "rideDB.bin";
+    names << cache.entryList(QStringList() << "*.cpx", QDir::Files);
+    foreach(QString name, names) QFile::remove(cache.absoluteFilePath(name));
+}
+
+static void
+report(const char *stage, qint64 rides, qint64 samples, double secs, const char *per)
+{
+    if (secs <= 0) secs = 1e-9;
+    printf("%-10s %8.2fs %10.1f rides/s", stage, secs, double(rides) / secs);
+    if (samples) printf(" %12.0f samples/s", double(samples) / secs);
+    printf("%s\n", per);
+}
+
+int
+CacheRebuild::run()
+{
+    QString cyclist = home.dirName();
+    int threads = QThreadPool::globalInstance()->maxThreadCount();
+    printf("Rebuilding caches for %s on %d threads\n", cyclist.toLocal8Bit().constData(), threads);
+    fflush(stdout);
+
+    QElapsedTimer timer;
+    timer.start();
+    clear();
+
+    // no mainwindow, so the athlete blocks until the ride list is loaded and
+    // the ride cache refreshes on all cores, we wait for that to finish
+    Context *context = new Context(NULL);
+    connect(context, SIGNAL(refreshEnd()), this, SLOT(refreshEnd()));
+
+    Athlete *athlete = new Athlete(context, home);
+    double loaded = timer.nsecsElapsed() / 1e9;
+
+    if (!done) loop.exec();
+    double refreshed = timer.nsecsElapsed() / 1e9;
+
+    // copy before we close down
+    const RideCacheStats &stats = athlete->rideCache->stats;
+    qint64 count = athlete->rideCache->count();
+    qint64 rides = stats.rides.loadAcquire();
+    qint64 samples = stats.samples.loadAcquire();
+    qint64 failed = stats.failed.loadAcquire();
+    qint64 nsecs[RideCacheStats::Stages];
+    for (int i=0; i<RideCacheStats::Stages; i++) nsecs[i] = stats.nsecs[i].loadAcquire();
+
+    // writes rideDB and the indexes, and we exited cleanly
+    delete athlete;
+    appsettings->setCValue(cyclist, GC_VERSION_USED, VERSION_LATEST);
+    appsettings->setCValue(cyclist, GC_SAFEEXIT, true);
+    appsettings->syncQSettings();
+    delete context;
+    double saved = timer.nsecsElapsed() / 1e9;
+
+    // stages within the refresh are time summed across the threads, so
+    // the rates are per thread, the refresh as a whole is wall clock
+    printf("%lld activities, %lld refreshed, %lld samples, %lld failed\n", count, rides, samples, failed);
+    report("load", count, 0, loaded, "");
+    for (int i=0; i<RideCacheStats::Stages; i++)
+        report(RideCacheStats::stageName(i), rides, samples, nsecs[i] / 1e9, " per thread");
+    report("refresh", rides, samples, refreshed - loaded, "");
+    report("save", count, 0, saved - refreshed, "");
+    report("total", rides, samples, saved, "");
+    printf("peak memory %lld KB\n", peakMemory());
+    fflush(stdout);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef _GC_CacheRebuild_h
+#define _GC_CacheRebuild_h 1
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QDir>
+#include <QEventLoop>
+
+// Headless rebuild of an athlete's caches, run from the command line
+//
+//   GoldenCheetah --rebuild [directory] athlete
+//
+// rideDB, the .cpx files and discovered intervals are thrown away and
+// rebuilt from the activities using all cores, much as the GUI does after
+// a DBSchemaVersion or RideFileCacheVersion bump. Throughput for each stage
+// and the peak memory used are printed so it can be used as a repeatable
+// benchmark. run() returns non-zero if any activity couldn't be read.
+class CacheRebuild : public QObject
+{
+    Q_OBJECT
+
+    public:
+        CacheRebuild(const QDir &home); // the athlete directory
+
+        int run();
+
+        // peak resident memory in KB, or 0 if we can't tell
+        static qint64 peakMemory();
+
+    public slots:
+        void refreshEnd();
+
+    private:
+        void clear();
+
+        QDir home;
+        QEventLoop loop;
+        bool done;
+};
+
+#endif // _GC_CacheRebuild_h
@@ -19,12 +19,15 @@
 #include "Utils.h"
 #include "Statistic.h"
 #include "DataFilter.h"
+#include "DataFilterProgram.h"
 #include "Context.h"
 #include "Athlete.h"
 #include "RideItem.h"
 #include "IntervalItem.h"
 #include "RideNavigator.h"
 #include "RideFileCache.h"
+#include "RideCache.h"
+#include "MetricStore.h"
 #include "PMCData.h"
 #include "Banister.h"
 #include "LTMSettings.h"
@@ -401,6 +404,22 @@ static struct {
     { "", -1 }
 };
 
+// offset into DataFilterFunctions, -1 if not found or the wrong number of parameters
+static int functionIndex(Leaf *leaf)
+{
+    for (int i=0; DataFilterFunctions[i].parameters != -1; i++) {
+        if (DataFilterFunctions[i].name == leaf->function) {
+
+            // parameter mismatch not allowed; function signature mismatch
+            // should be impossible...
+            if (DataFilterFunctions[i].parameters && DataFilterFunctions[i].parameters != leaf->fparms.count())
+                return -1;
+            return i;
+        }
+    }
+    return -1;
+}
+
 static QStringList pdmodels(Context *context)
 {
     QStringList returning;
@@ -745,6 +764,49 @@ Leaf::isDynamic(Leaf *leaf)
     return false;
 }
 
+// the current ride, estimates, PMC, measures, zones, other rides and
+// scripts all change without the ride itself changing, so results for
+// expressions that use them can't be remembered, see MetricStore::filter
+bool
+Leaf::usesState()
+{
+    static const QStringList symbols = QStringList() << "Current" << "config" << "ctl" << "atl" << "tsb" << "banister";
+    static const QStringList functions = QStringList()
+        << "estimate" << "estimates" << "lts" << "sts" << "sb" << "rr" << "banister" << "pmc"
+        << "measure" << "measures" << "zones" << "tests" << "events" << "meanmax" << "powerindex"
+        << "metrics" << "metricstrings" << "aggmetrics" << "aggmetricstrings" << "asaggstring"
+        << "activities" << "intervals" << "intervalstrings" << "random" << "store" << "fetch"
+        << "set" << "unset" << "isset" << "print" << "autoprocess" << "postprocess";
+
+    switch(type) {
+    case Leaf::Script :
+        return true;
+    case Leaf::Compound :
+        foreach(Leaf *p, *(lvalue.b)) if (p->usesState()) return true;
+        return false;
+    case Leaf::Symbol :
+        return symbols.contains(*lvalue.n, Qt::CaseInsensitive);
+    case Leaf::Operation:
+    case Leaf::BinaryOperation:
+    case Leaf::Logical :
+        return lvalue.l->usesState() || (op && rvalue.l->usesState());
+    case Leaf::UnaryOperation:
+        return lvalue.l->usesState();
+    case Leaf::Function:
+        if (functions.contains(function)) return true;
+        if (series && lvalue.l && lvalue.l->usesState()) return true;
+        foreach(Leaf* l, fparms) if (l->usesState()) return true;
+        return false;
+    case Leaf::Index:
+    case Leaf::Select:
+        return lvalue.l->usesState() || fparms[0]->usesState();
+    case Leaf::Conditional:
+        return cond.l->usesState() || lvalue.l->usesState() || (rvalue.l && rvalue.l->usesState());
+    default:
+        return false;
+    }
+}
+
 void
 DataFilter::setSignature(QString &query)
 {
@@ -1659,6 +1721,9 @@ void Leaf::clear(Leaf *leaf)
 {
     if (leaf == NULL) return; // critical to avoid crashes
 
+    delete leaf->program;
+    leaf->program = NULL;
+
     switch(leaf->type) {
     case Leaf::Script :
     case Leaf::String : delete leaf->lvalue.s; break;
@@ -1771,6 +1836,9 @@ void Leaf::validateFilter(Context *context, DataFilterRuntime *df, Leaf *leaf)
 
     case Leaf::Function :
         {
+            // look it up once, not every time it is called
+            leaf->fid = functionIndex(leaf);
+
             // is the symbol valid?
             QRegExp bestValidSymbols("^(apower|power|hr|cadence|speed|torque|vam|xpower|isopower|wpk)$", Qt::CaseInsensitive);
             QRegExp tizValidSymbols("^(power|hr)$", Qt::CaseInsensitive);
@@ -3180,6 +3248,7 @@ DataFilter::DataFilter(QObject *parent, Context *context, QString formula) : QOb
         treeRoot=NULL;
 
     errors = DataFiltererrors;
+    if (treeRoot && errors.count() == 0) compile();
 }
 
 Result DataFilter::evaluate(RideItem *item, RideFilePoint *p)
@@ -3272,6 +3341,10 @@ QStringList DataFilter::check(QString query)
         // no errors just failed to finish
         if (!treeRoot) DataFiltererrors << tr("malformed expression.");
 
+    } else {
+
+        // yep, compile it
+        compile();
     }
 
     errors = DataFiltererrors;
@@ -3322,6 +3395,7 @@ QStringList DataFilter::parseFilter(Context *context, QString query, QStringList
 
         // successfully parsed, lets check semantics
         //treeRoot->print(0,NULL);
+        compile();
         emit parseGood();
 
         // clear current filter list
@@ -3374,6 +3448,7 @@ void DataFilter::clearFilter()
         treeRoot = NULL;
         errors.clear();
     }
+    rt.functions.clear(); // they were in the tree
     rt.isdynamic = false;
     sig = "";
 }
@@ -3409,6 +3484,24 @@ void DataFilter::configChanged(qint32)
 
     // sample date series
     rt.dataSeriesSymbols = RideFile::symbols();
+
+    // the lookups are resolved when compiled
+    if (treeRoot && errors.count() == 0) compile();
+}
+
+void
+DataFilter::compile()
+{
+    // user metrics and charts call functions by name, so compile
+    // each of them, otherwise its just the one expression
+    QList<Leaf*> entries;
+    if (rt.functions.count()) entries = rt.functions.values();
+    else entries << treeRoot;
+
+    foreach(Leaf *entry, entries) {
+        delete entry->program;
+        entry->program = DataFilterProgram::compile(&rt, entry);
+    }
 }
 
 void
@@ -3461,6 +3554,12 @@ Result Leaf::eval(DataFilterRuntime *df, Leaf *leaf, const Result &x, long it, R
     // if error state all bets are off
     //if (inerror) return Result(0);
 
+    // compiled to bytecode when validated
+    if (leaf->program) {
+        Result result;
+        if (leaf->program->run(df, result, it, m, p, c)) return result;
+    }
+
     switch(leaf->type) {
 
     //
@@ -4982,12 +5081,18 @@ Result Leaf::eval(DataFilterRuntime *df, Leaf *leaf, const Result &x, long it, R
             // do we aggregate zero values ?
             bool aggZero = e ? e->aggregateZero() : true;
 
-            // loop through rides for daterange
-            foreach(RideItem *ride, m->context->athlete->rideCache->rides()) {
+            // the rides for the daterange and the metric from the metric store
+            int index = e ? e->index() : -1;
+            QSharedPointer<const MetricSnapshot> store = m->context->athlete->rideCache->metricStore()->snapshot(QVector<int>() << index);
+            QVector<int> rows = store->rows(spec);
+            const QVector<RideItem*> &rides = store->rides;
+            const MetricColumn &column = store->column(index);
+            bool useMetricUnits = GlobalContext::context()->useMetricUnits;
 
-                if (!s.pass(ride)) continue; // relies upon the daterange being passed to eval...
-                if (!spec.pass(ride)) continue; // relies upon the daterange being passed to eval...
+            foreach(int row, rows) {
 
+                RideItem *ride = rides[row];
+                if (!s.pass(ride)) continue; // relies upon the daterange being passed to eval...
 
                 double value=0;
                 QString asstring;
@@ -4998,13 +5103,13 @@ Result Leaf::eval(DataFilterRuntime *df, Leaf *leaf, const Result &x, long it, R
                     value= QTime(0,0,0).secsTo(ride->dateTime.time());
                     if (wantstrings) asstring = ride->dateTime.toString("hh:mm:ss");
                 } else {
-                    value =  ride->getForSymbol(o_symbol, GlobalContext::context()->useMetricUnits);
+                    value = e ? e->value(column.values[row], useMetricUnits) : 0;
                     if (wantstrings) e ? asstring = e->toString(value) : "(null)";
                 }
 
                 // keep count of time for ride, useful when averaging
                 count++;
-                double duration = ride->getCountForSymbol(o_symbol);
+                double duration = column.counts[row];
                 if (value || aggZero) totalduration += duration;
                 withduration += value * duration;
                 runningtotal += value;
@@ -6752,19 +6857,7 @@ Result Leaf::eval(DataFilterRuntime *df, Leaf *leaf, const Result &x, long it, R
 
         // if we get here its general function handling
         // what function is being called?
-        int fnum=-1;
-        for (int i=0; DataFilterFunctions[i].parameters != -1; i++) {
-            if (DataFilterFunctions[i].name == leaf->function) {
-
-                // parameter mismatch not allowed; function signature mismatch
-                // should be impossible...
-                if (DataFilterFunctions[i].parameters && DataFilterFunctions[i].parameters != leaf->fparms.count())
-                    fnum=-1;
-                else
-                    fnum = i;
-                break;
-            }
-        }
+        int fnum = leaf->fid != -2 ? leaf->fid : functionIndex(leaf);
 
         // not found...
         if (fnum < 0) return Result(0);
@@ -7440,6 +7533,7 @@ Result Leaf::eval(DataFilterRuntime *df, Leaf *leaf, const Result &x, long it, R
                         // now run the data processor
                         if (dp->postProcess(f)) {
                             // rideFile is now dirty!
+                            f->invalidateColumns();
                             m->setDirty(true);
                         }
                     }
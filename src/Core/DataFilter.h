@@ -112,12 +112,13 @@ class Result {
 };
 
 class DataFilterRuntime;
+class DataFilterProgram;
 class Leaf {
     Q_DECLARE_TR_FUNCTIONS(Leaf)
 
     public:
 
-        Leaf(int loc, int leng) : type(none),lvalue(),rvalue(),cond(),op(0),series(NULL),dynamic(false),loc(loc),leng(leng),inerror(false) { }
+        Leaf(int loc, int leng) : type(none),lvalue(),rvalue(),cond(),op(0),series(NULL),dynamic(false),loc(loc),leng(leng),inerror(false),fid(-2),program(NULL) { }
 
         // evaluate against a RideItem using its context
         //
@@ -135,6 +136,7 @@ class Leaf {
         void print(int level, DataFilterRuntime*);  // print leaf and all children
         void color(Leaf *, QTextDocument *);  // update the document to match
         bool isDynamic(Leaf *);
+        bool usesState(); // depends on more than the ride and the date
         void validateFilter(Context *context, DataFilterRuntime *, Leaf*); // validate
         bool isNumber(DataFilterRuntime *df, Leaf *leaf);
         void findSymbols(QStringList &symbols); // when working with formulas
@@ -167,6 +169,9 @@ class Leaf {
         int loc, leng;
         bool inerror;
         RideFile::XDataJoin xjoin; // how to join xdata with main
+
+        int fid; // offset in the function table, -1 not found, -2 not looked up yet
+        DataFilterProgram *program; // compiled when validated, see DataFilterProgram.h
 };
 
 class UserChart;
@@ -239,6 +244,9 @@ class DataFilter : public QObject
         QString signature() { return sig; }
         Leaf *root() { return treeRoot; }
 
+        // the result for a ride only changes when the ride does
+        bool cacheable() { return treeRoot && errors.count() == 0 && !treeRoot->usesState(); }
+
         // for random number generation
         const gsl_rng_type *T;
         gsl_rng *r;
@@ -272,6 +280,7 @@ class DataFilter : public QObject
 
     private:
         void setSignature(QString &query);
+        void compile(); // bytecode for the validated tree
 
         Leaf *treeRoot;
         QStringList errors;
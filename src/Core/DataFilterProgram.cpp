@@ -0,0 +1,609 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "DataFilterProgram.h"
+#include "DataFilter.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "RideItem.h"
+#include "RideMetric.h"
+#include "PMCData.h"
+#include "Utils.h"
+
+#include <QRegExp>
+#include <QVarLengthArray>
+#include <math.h>
+
+#include "DataFilter_yacc.h"
+
+// offsets into DataFilterFunctions, see DataFilter.cpp
+enum { Func_cos=0, Func_tan, Func_sin, Func_acos, Func_atan, Func_asin, Func_cosh, Func_tanh, Func_sinh, Func_acosh, Func_atanh, Func_asinh,
+       Func_exp, Func_log, Func_log10, Func_ceil, Func_floor, Func_round, Func_fabs, Func_isinf, Func_isnan,
+       Func_sum, Func_mean, Func_max, Func_min, Func_sqrt=63 };
+
+QString
+DataFilterProgram::Value::asString() const
+{
+    // as Result::string()
+    if (isNumber) return Utils::removeDP("%1").arg(number);
+    return string;
+}
+
+DataFilterProgram *
+DataFilterProgram::compile(DataFilterRuntime *df, Leaf *root)
+{
+    DataFilterProgram *program = new DataFilterProgram();
+    if (root == NULL || !program->compile(df, root, true)) {
+        delete program;
+        return NULL;
+    }
+    return program;
+}
+
+void
+DataFilterProgram::add(opcode op, int arg, int count)
+{
+    code << Instruction(op, arg, count);
+
+    // track the stack so run() can size it up front
+    switch (op) {
+    case Push: case Load: sp++; break;
+    case Binary: case And: case Or: case Elvis: case JumpFalse: case Pop: sp--; break;
+    case Call: sp -= count-1; break;
+    default: break;
+    }
+    if (sp > depth) depth = sp;
+}
+
+void
+DataFilterProgram::push(const Value &value)
+{
+    constants << value;
+    add(Push, constants.count()-1);
+}
+
+bool
+DataFilterProgram::constant(int from, int instructions) const
+{
+    if (code.count() != from + instructions) return false;
+    for (int i=from; i<code.count(); i++) if (code[i].op != Push) return false;
+    return true;
+}
+
+void
+DataFilterProgram::fold(int from, int values, const Value &value)
+{
+    // the code from..end pushed values, replace with the result
+    code.resize(from);
+    sp -= values;
+    push(value);
+}
+
+bool
+DataFilterProgram::compile(DataFilterRuntime *df, Leaf *leaf, bool entry)
+{
+    if (leaf == NULL) return false;
+
+    int from = code.count();
+
+    switch(leaf->type) {
+
+    case Leaf::Float :
+        push(Value(leaf->lvalue.f));
+        return true;
+
+    case Leaf::Integer :
+        push(Value(leaf->lvalue.i));
+        return true;
+
+    case Leaf::String :
+    {
+        // dates are numbers
+        QString string = *(leaf->lvalue.s);
+        QDate date = QDate::fromString(string, "yyyy/MM/dd");
+        if (date.isValid()) push(Value(QDate(1900,01,01).daysTo(date)));
+        else push(Value(string));
+        return true;
+    }
+
+    case Leaf::Symbol :
+        return symbol(df, leaf);
+
+    case Leaf::Logical :
+    {
+        // parenthesis
+        if (leaf->op == 0) return compile(df, leaf->lvalue.l, false);
+        if (leaf->op != AND && leaf->op != OR) return false;
+
+        if (!compile(df, leaf->lvalue.l, false)) return false;
+
+        if (constant(from, 1)) {
+
+            // short circuit, or the answer is the rhs
+            bool left = constantAt(from).isTrue();
+            if (leaf->op == AND && !left) { fold(from, 1, Value(0)); return true; }
+            if (leaf->op == OR && left) { fold(from, 1, Value(1)); return true; }
+            code.resize(from);
+            sp--;
+
+            if (!compile(df, leaf->rvalue.l, false)) return false;
+            if (constant(from, 1)) fold(from, 1, Value(constantAt(from).isTrue() ? 1 : 0));
+            else add(Truth);
+            return true;
+        }
+
+        int branch = code.count();
+        add(leaf->op == AND ? And : Or);
+        if (!compile(df, leaf->rvalue.l, false)) return false;
+        add(Truth);
+        code[branch].arg = code.count();
+        return true;
+    }
+
+    case Leaf::UnaryOperation :
+    {
+        if (leaf->op != '-' && leaf->op != '!') return false;
+        if (!compile(df, leaf->lvalue.l, false)) return false;
+
+        if (constant(from, 1)) {
+            double value = constantAt(from).asNumber();
+            fold(from, 1, Value(leaf->op == '-' ? value * -1 : !value));
+        } else {
+            add(leaf->op == '-' ? Negate : Not);
+        }
+        return true;
+    }
+
+    case Leaf::BinaryOperation :
+    case Leaf::Operation :
+    {
+        switch (leaf->op) {
+
+        case ELVIS:
+        {
+            // rhs is only evaluated when the lhs is zero
+            if (!compile(df, leaf->lvalue.l, false)) return false;
+
+            if (constant(from, 1)) {
+                Value lhs = constantAt(from);
+                if (lhs.asNumber() != 0) { fold(from, 1, Value(lhs.isNumber ? lhs.number : 0)); return true; }
+                code.resize(from);
+                sp--;
+
+                if (!compile(df, leaf->rvalue.l, false)) return false;
+                if (constant(from, 1)) fold(from, 1, Value(constantAt(from).asNumber()));
+                else add(Number);
+                return true;
+            }
+
+            int branch = code.count();
+            add(Elvis);
+            if (!compile(df, leaf->rvalue.l, false)) return false;
+            add(Number);
+            code[branch].arg = code.count();
+            return true;
+        }
+
+        case ADD: case SUBTRACT: case DIVIDE: case MULTIPLY: case POW:
+        case EQ: case NEQ: case LT: case LTE: case GT: case GTE:
+        case MATCHES: case ENDSWITH: case BEGINSWITH: case CONTAINS:
+        {
+            if (!compile(df, leaf->lvalue.l, false)) return false;
+            int rhs = code.count();
+            if (!compile(df, leaf->rvalue.l, false)) return false;
+
+            if (constant(from, 2)) fold(from, 2, binary(leaf->op, constantAt(from), constantAt(rhs)));
+            else add(Binary, leaf->op);
+            return true;
+        }
+
+        default: // assignment
+            return false;
+        }
+    }
+
+    case Leaf::Conditional :
+    {
+        if (leaf->op != IF_ && leaf->op != 0) return false; // while
+
+        if (!compile(df, leaf->cond.l, false)) return false;
+
+        if (constant(from, 1)) {
+
+            // only one branch can ever be taken
+            bool taken = constantAt(from).isTrue();
+            code.resize(from);
+            sp--;
+
+            if (taken) return compile(df, leaf->lvalue.l, false);
+            if (leaf->rvalue.l) return compile(df, leaf->rvalue.l, false);
+            push(Value(0));
+            return true;
+        }
+
+        int branch = code.count();
+        add(JumpFalse);
+        if (!compile(df, leaf->lvalue.l, false)) return false;
+
+        int skip = code.count();
+        add(Jump);
+        sp--; // the else branch starts without the if branch's value
+        code[branch].arg = code.count();
+
+        if (leaf->rvalue.l) {
+            if (!compile(df, leaf->rvalue.l, false)) return false;
+        } else {
+            push(Value(0));
+        }
+        code[skip].arg = code.count();
+        return true;
+    }
+
+    case Leaf::Function :
+    {
+        // old style functions with a data series, or user defined
+        if (leaf->series) return false;
+        if (leaf->function != "count" && df->functions.contains(leaf->function)) return false;
+
+        int count = leaf->fparms.count();
+        switch (leaf->fid) {
+        case Func_cos: case Func_tan: case Func_sin: case Func_acos: case Func_atan: case Func_asin:
+        case Func_cosh: case Func_tanh: case Func_sinh: case Func_acosh: case Func_atanh: case Func_asinh:
+        case Func_exp: case Func_log: case Func_log10: case Func_ceil: case Func_floor:
+        case Func_fabs: case Func_isinf: case Func_isnan: case Func_sqrt:
+            if (count != 1) return false;
+            break;
+        case Func_round:
+            if (count < 1) return false;
+            break;
+        case Func_sum: case Func_mean: case Func_max: case Func_min:
+            break;
+        default:
+            return false;
+        }
+
+        foreach(Leaf *parm, leaf->fparms)
+            if (!compile(df, parm, false)) return false;
+
+        if (constant(from, count)) {
+            QVector<Value> args;
+            for (int i=0; i<count; i++) args << constantAt(from+i);
+            fold(from, count, call(leaf->fid, args.constData(), count));
+        } else {
+            add(Call, leaf->fid, count);
+        }
+        return true;
+    }
+
+    case Leaf::Compound :
+    {
+        // another function's body
+        if (leaf->function != "" && !entry) return false;
+
+        QList<Leaf*> &statements = *(leaf->lvalue.b);
+        if (statements.isEmpty()) {
+            push(Value(0));
+            return true;
+        }
+
+        // programs have no side effects so only the last statement
+        // matters, but they all need to compile to be sure of that
+        for (int i=0; i<statements.count(); i++) {
+            int start = code.count();
+            if (!compile(df, statements[i], false)) return false;
+            if (i < statements.count()-1) {
+                code.resize(start);
+                sp--;
+            }
+        }
+        return true;
+    }
+
+    default:
+        // indexes, selects, scripts
+        return false;
+    }
+}
+
+bool
+DataFilterProgram::symbol(DataFilterRuntime *df, Leaf *leaf)
+{
+    QString name = *(leaf->lvalue.n);
+
+    // user symbols, and x, are only known when running
+    if (name == "x" || df->symbols.contains(name)) return false;
+
+    Symbol symbol;
+    symbol.name = name;
+    symbol.series = df->dataSeriesSymbols.contains(name) ? RideFile::seriesForSymbol(name) : -1;
+    symbol.metric = -1;
+
+    // same order as Leaf::eval
+    if (name == "i") symbol.kind = Iteration;
+    else if (name == "isRide") symbol.kind = IsRide;
+    else if (name == "isRun") symbol.kind = IsRun;
+    else if (name == "isSwim") symbol.kind = IsSwim;
+    else if (name == "isXtrain") symbol.kind = IsXtrain;
+    else if (name == "isAero") symbol.kind = IsAero;
+    else if (!name.compare("NA", Qt::CaseInsensitive)) symbol.kind = NA;
+    else if (!name.compare("RECINTSECS", Qt::CaseInsensitive)) symbol.kind = RecIntSecs;
+    else if (!name.compare("Current", Qt::CaseInsensitive)) symbol.kind = Current;
+    else if (!name.compare("Today", Qt::CaseInsensitive)) symbol.kind = Today;
+    else if (!name.compare("Date", Qt::CaseInsensitive)) symbol.kind = Date;
+    else if (!name.compare("Time", Qt::CaseInsensitive)) symbol.kind = Time;
+    else if (!name.compare("ctl", Qt::CaseInsensitive)) symbol.kind = CTL;
+    else if (!name.compare("atl", Qt::CaseInsensitive)) symbol.kind = ATL;
+    else if (!name.compare("tsb", Qt::CaseInsensitive)) symbol.kind = TSB;
+    else {
+        symbol.rename = df->lookupMap.value(name, "");
+        if (df->lookupType.value(name)) {
+            symbol.kind = Metric;
+            const RideMetric *metric = RideMetricFactory::instance().rideMetric(symbol.rename);
+            if (metric) symbol.metric = metric->index();
+        } else {
+            symbol.kind = Text;
+        }
+    }
+
+    symbols << symbol;
+    add(Load, symbols.count()-1);
+    return true;
+}
+
+DataFilterProgram::Value
+DataFilterProgram::load(const Symbol &symbol, long it, RideItem *m, RideFilePoint *p, const QHash<QString,RideMetric*> *c) const
+{
+    if (m == NULL) return Value(0); // no ride then no context
+
+    // ride series when running through samples
+    if (p && symbol.series != -1) {
+        if (symbol.series == RideFile::index) return Value(m->ride()->dataPoints().indexOf(p));
+        return Value(p->value(static_cast<RideFile::SeriesType>(symbol.series)));
+    }
+
+    switch (symbol.kind) {
+    case Iteration: return Value(it);
+    case IsRide: return Value(m->isBike ? 1 : 0);
+    case IsRun: return Value(m->isRun ? 1 : 0);
+    case IsSwim: return Value(m->isSwim ? 1 : 0);
+    case IsXtrain: return Value(m->isXtrain ? 1 : 0);
+    case IsAero: return Value(m->isAero ? 1 : 0);
+    case NA: return Value(RideFile::NA);
+    case RecIntSecs: return Value(m->ride(false) ? m->ride(false)->recIntSecs() : 1);
+
+    case Current:
+        if (m->context->currentRideItem())
+            return Value(QDate(1900,01,01).daysTo(m->context->currentRideItem()->dateTime.date()));
+        return Value(0);
+
+    case Today: return Value(QDate(1900,01,01).daysTo(QDate::currentDate()));
+    case Date: return Value(QDate(1900,01,01).daysTo(m->dateTime.date()));
+    case Time: return Value(QTime(0,0,0).secsTo(m->dateTime.time()));
+
+    case CTL: return Value(m->context->athlete->getPMCFor("coggan_tss")->lts(m->dateTime.date()));
+    case ATL: return Value(m->context->athlete->getPMCFor("coggan_tss")->sts(m->dateTime.date()));
+    case TSB: return Value(m->context->athlete->getPMCFor("coggan_tss")->sb(m->dateTime.date()));
+
+    case Metric:
+    {
+        // metadata overrides the metric
+        QString meta = m->getText(symbol.rename, "unknown");
+        if (meta != "unknown") return Value(meta.toDouble());
+        if (c) return Value(RideMetric::getForSymbol(symbol.rename, c));
+
+        // straight from the ride metrics, unless user metrics have moved it
+        const RideMetricFactory &factory = RideMetricFactory::instance();
+        if (symbol.metric >= 0 && symbol.metric < factory.metricCount() && m->metrics().size() == factory.metricCount()
+            && factory.metricName(symbol.metric) == symbol.rename)
+            return Value(m->metrics()[symbol.metric]);
+        return Value(m->getForSymbol(symbol.rename));
+    }
+
+    default:
+    case Text:
+        return Value(m->getText(symbol.rename, ""));
+    }
+}
+
+DataFilterProgram::Value
+DataFilterProgram::binary(int op, const Value &lhs, const Value &rhs)
+{
+    switch (op) {
+
+    case ADD: case SUBTRACT: case DIVIDE: case MULTIPLY: case POW:
+        if (lhs.isNumber && rhs.isNumber) {
+            switch (op) {
+            case ADD: return Value(lhs.number + rhs.number);
+            case SUBTRACT: return Value(lhs.number - rhs.number);
+            case DIVIDE: return Value(rhs.number ? lhs.number / rhs.number : 0);
+            case MULTIPLY: return Value(lhs.number * rhs.number);
+            case POW: return Value(pow(lhs.number, rhs.number));
+            }
+        }
+
+        // strings only concatenate, anything else is the lhs
+        if (op == ADD) return Value(lhs.asString() + rhs.asString());
+        return lhs;
+
+    case EQ: return lhs.isNumber ? Value(lhs.number == rhs.asNumber()) : Value(lhs.string == rhs.asString());
+    case NEQ: return lhs.isNumber ? Value(lhs.number != rhs.asNumber()) : Value(lhs.string != rhs.asString());
+    case LT: return lhs.isNumber ? Value(lhs.number < rhs.asNumber()) : Value(lhs.string < rhs.asString());
+    case LTE: return lhs.isNumber ? Value(lhs.number <= rhs.asNumber()) : Value(lhs.string <= rhs.asString());
+    case GT: return lhs.isNumber ? Value(lhs.number > rhs.asNumber()) : Value(lhs.string > rhs.asString());
+    case GTE: return lhs.isNumber ? Value(lhs.number >= rhs.asNumber()) : Value(lhs.string >= rhs.asString());
+
+    case MATCHES:
+        if (!lhs.isNumber && !rhs.isNumber) return Value(QRegExp(rhs.string).exactMatch(lhs.string));
+        return Value(0);
+    case ENDSWITH:
+        if (!lhs.isNumber && !rhs.isNumber) return Value(lhs.string.endsWith(rhs.string));
+        return Value(0);
+    case BEGINSWITH:
+        if (!lhs.isNumber && !rhs.isNumber) return Value(lhs.string.startsWith(rhs.string));
+        return Value(0);
+    case CONTAINS:
+        if (!lhs.isNumber && !rhs.isNumber) return Value(lhs.string.contains(rhs.string));
+        return Value(0);
+    }
+    return Value(0);
+}
+
+DataFilterProgram::Value
+DataFilterProgram::call(int fid, const Value *args, int count)
+{
+    switch (fid) {
+
+    case Func_cos: return Value(cos(args[0].asNumber()));
+    case Func_tan: return Value(tan(args[0].asNumber()));
+    case Func_sin: return Value(sin(args[0].asNumber()));
+    case Func_acos: return Value(acos(args[0].asNumber()));
+    case Func_atan: return Value(atan(args[0].asNumber()));
+    case Func_asin: return Value(asin(args[0].asNumber()));
+    case Func_cosh: return Value(cosh(args[0].asNumber()));
+    case Func_tanh: return Value(tanh(args[0].asNumber()));
+    case Func_sinh: return Value(sinh(args[0].asNumber()));
+    case Func_acosh: return Value(acosh(args[0].asNumber()));
+    case Func_atanh: return Value(atanh(args[0].asNumber()));
+    case Func_asinh: return Value(asinh(args[0].asNumber()));
+    case Func_exp: return Value(exp(args[0].asNumber()));
+    case Func_log: return Value(log(args[0].asNumber()));
+    case Func_log10: return Value(log10(args[0].asNumber()));
+    case Func_ceil: return Value(ceil(args[0].asNumber()));
+    case Func_floor: return Value(floor(args[0].asNumber()));
+    case Func_fabs: return Value(fabs(args[0].asNumber()));
+    case Func_isinf: return Value(Utils::myisinf(args[0].asNumber()));
+    case Func_isnan: return Value(Utils::myisnan(args[0].asNumber()));
+    case Func_sqrt: return Value(sqrt(args[0].asNumber()));
+
+    case Func_round:
+    {
+        double factor = count == 2 ? pow(10, args[1].asNumber()) : 1;
+        return Value(round(args[0].asNumber()*factor)/factor);
+    }
+
+    case Func_sum:
+    case Func_mean:
+    {
+        double sum=0;
+        for (int i=0; i<count; i++) sum += args[i].asNumber();
+        if (fid == Func_sum) return Value(sum);
+        return Value(count ? sum/double(count) : 0);
+    }
+
+    case Func_max:
+    case Func_min:
+    {
+        double best=0;
+        for (int i=0; i<count; i++) {
+            double value = args[i].asNumber();
+            if (i == 0 || (fid == Func_max && value > best) || (fid == Func_min && value < best)) best = value;
+        }
+        return Value(best);
+    }
+    }
+    return Value(0);
+}
+
+bool
+DataFilterProgram::run(DataFilterRuntime *df, Result &result, long it, RideItem *m, RideFilePoint *p,
+                       const QHash<QString,RideMetric*> *c) const
+{
+    QVarLengthArray<Value, 32> stack(depth);
+    const Instruction *instructions = code.constData();
+    int pc=0, top=-1;
+
+    while (pc < code.count()) {
+
+        const Instruction &i = instructions[pc++];
+        switch (i.op) {
+
+        case Push:
+            stack[++top] = constants[i.arg];
+            break;
+
+        case Load:
+        {
+            const Symbol &symbol = symbols[i.arg];
+
+            // defined by the user at runtime, e.g. by lmfit(), so evaluate the tree
+            if (m && !df->symbols.isEmpty() && !(p && symbol.series != -1) && df->symbols.contains(symbol.name))
+                return false;
+
+            stack[++top] = load(symbol, it, m, p, c);
+        }
+        break;
+
+        case Negate:
+            stack[top] = Value(stack[top].asNumber() * -1);
+            break;
+
+        case Not:
+            stack[top] = Value(!stack[top].asNumber());
+            break;
+
+        case Binary:
+            top--;
+            stack[top] = binary(i.arg, stack[top], stack[top+1]);
+            break;
+
+        case Call:
+            top -= i.count-1;
+            stack[top] = call(i.arg, stack.constData()+top, i.count);
+            break;
+
+        case Truth:
+            stack[top] = Value(stack[top].isTrue() ? 1 : 0);
+            break;
+
+        case Number:
+            stack[top] = Value(stack[top].asNumber());
+            break;
+
+        case And:
+            if (!stack[top].isTrue()) { stack[top] = Value(0); pc = i.arg; }
+            else top--;
+            break;
+
+        case Or:
+            if (stack[top].isTrue()) { stack[top] = Value(1); pc = i.arg; }
+            else top--;
+            break;
+
+        case Elvis:
+            if (stack[top].asNumber() != 0) { stack[top] = Value(stack[top].isNumber ? stack[top].number : 0); pc = i.arg; }
+            else top--;
+            break;
+
+        case JumpFalse:
+            if (!stack[top--].isTrue()) pc = i.arg;
+            break;
+
+        case Jump:
+            pc = i.arg;
+            break;
+
+        case Pop:
+            top--;
+            break;
+        }
+    }
+
+    const Value &value = stack[top];
+    result = value.isNumber ? Result(value.number) : Result(value.string);
+    return true;
+}
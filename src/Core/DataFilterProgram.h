@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_DataFilterProgram_h
+#define _GC_DataFilterProgram_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+class Leaf;
+class Result;
+class RideItem;
+class RideMetric;
+class RideFilePoint;
+class DataFilterRuntime;
+
+// DataFilterProgram is a validated expression compiled to bytecode for a
+// small stack machine, so evaluating a filter or user metric for every
+// ride doesn't walk the tree, compare function names or look symbols up
+// by name each time.
+//
+// Only the scalar subset of the language is compiled: literals, ride
+// symbols and metrics, the arithmetic, comparison and logical operators,
+// conditionals, blocks and the math functions. Constant expressions are
+// folded and branches that can't be taken are dropped. If anything else
+// is used (user symbols and functions, vectors, assignment, while loops
+// and the rest of the built in functions) compile() returns NULL and
+// Leaf::eval walks the tree as before.
+//
+// Programs have no side effects, so if a symbol has been defined by the
+// user at runtime run() returns false and the tree is evaluated instead.
+class DataFilterProgram
+{
+    public:
+
+        // NULL if the expression can't be compiled
+        static DataFilterProgram *compile(DataFilterRuntime *df, Leaf *root);
+
+        // thread safe, the program isn't changed by running it
+        bool run(DataFilterRuntime *df, Result &result, long it, RideItem *m, RideFilePoint *p,
+                 const QHash<QString,RideMetric*> *c) const;
+
+        // values on the stack, a number or a string like Result but never a vector
+        struct Value {
+            Value() : isNumber(true), number(0) {}
+            Value(double number) : isNumber(true), number(number) {}
+            Value(QString string) : isNumber(false), number(0), string(string) {}
+
+            double asNumber() const { return isNumber ? number : string.toDouble(); }
+            QString asString() const;
+            bool isTrue() const { return isNumber && number; }
+
+            bool isNumber;
+            double number;
+            QString string;
+        };
+
+    private:
+
+        DataFilterProgram() : sp(0), depth(0) {}
+
+        enum opcode { Push=0, Load, Negate, Not, Binary, Call, Truth, Number, And, Or, Elvis, JumpFalse, Jump, Pop };
+
+        struct Instruction {
+            Instruction(opcode op, int arg=0, int count=0) : op(op), arg(arg), count(count) {}
+            Instruction() : op(Push), arg(0), count(0) {}
+            opcode op;
+            int arg;   // constant, symbol, operator, function or jump target
+            int count; // parameters for Call
+        };
+
+        // ride symbols, resolved when compiled
+        enum kind { Iteration=0, IsRide, IsRun, IsSwim, IsXtrain, IsAero, NA, RecIntSecs,
+                    Current, Today, Date, Time, CTL, ATL, TSB, Metric, Text };
+
+        struct Symbol {
+            QString name;
+            int kind;
+            int series;     // data series when iterating samples, -1 if not one
+            QString rename; // metric or metadata field
+            int metric;     // metric index, -1 if not a metric
+        };
+
+        bool compile(DataFilterRuntime *df, Leaf *leaf, bool entry);
+        bool symbol(DataFilterRuntime *df, Leaf *leaf);
+
+        // code generation
+        void add(opcode op, int arg=0, int count=0);
+        void push(const Value &value);
+        bool constant(int from, int instructions) const;
+        Value constantAt(int pc) const { return constants[code[pc].arg]; }
+        void fold(int from, int values, const Value &value);
+
+        // the operators and functions, shared by folding and the vm
+        static Value binary(int op, const Value &lhs, const Value &rhs);
+        static Value call(int fid, const Value *args, int count);
+        Value load(const Symbol &symbol, long it, RideItem *m, RideFilePoint *p, const QHash<QString,RideMetric*> *c) const;
+
+        QVector<Instruction> code;
+        QVector<Value> constants;
+        QVector<Symbol> symbols;
+        int sp, depth; // stack pointer when compiling and the deepest it got
+};
+
+#endif // _GC_DataFilterProgram_h
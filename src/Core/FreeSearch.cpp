@@ -22,10 +22,23 @@
 #include "RideItem.h"
 #include "IntervalItem.h"
 #include "RideCache.h"
+#include "SearchIndex.h"
 
-FreeSearch::FreeSearch(QObject *parent, Context *context) : QObject(parent), context(context)
+#include <QSet>
+
+FreeSearch::FreeSearch(QObject *parent, Context *context) : QObject(parent), context(context), synced(false)
 {
-    // nothing to do, all the data we need is in the ridecache
+    // all the data we need is in the ridecache and its search index, which
+    // only needs bringing up to date when the rides change, not as we type
+    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(ridesChanged()));
+    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(ridesChanged()));
+    connect(context, SIGNAL(rideChanged(RideItem*)), this, SLOT(ridesChanged()));
+    connect(context, SIGNAL(rideSaved(RideItem*)), this, SLOT(ridesChanged()));
+    connect(context, SIGNAL(rideDirty(RideItem*)), this, SLOT(ridesChanged()));
+    connect(context, SIGNAL(intervalsChanged()), this, SLOT(ridesChanged()));
+    connect(context, SIGNAL(intervalsUpdate(RideItem*)), this, SLOT(ridesChanged()));
+    connect(context, SIGNAL(metadataFlush()), this, SLOT(ridesChanged()));
+    connect(context, SIGNAL(refreshEnd()), this, SLOT(ridesChanged()));
 }
 
 FreeSearch::~FreeSearch()
@@ -76,6 +89,22 @@ static QStringList searchSplit(QString string)
     return returning;
 }
 
+// does the ride have the phrase in its metadata or interval names
+static bool hasPhrase(RideItem *item, const QString &phrase)
+{
+    QMapIterator<QString,QString> meta(item->metadata());
+    while (meta.hasNext()) {
+        meta.next();
+        if (SearchIndex::searchable(meta.key()) && meta.value().contains(phrase, Qt::CaseInsensitive)) return true;
+    }
+
+    // user intervals - even autodiscovered
+    foreach(IntervalItem *interval, item->intervals())
+        if (interval->name.contains(phrase, Qt::CaseInsensitive)) return true;
+
+    return false;
+}
+
 QList<QString> FreeSearch::search(QString query)
 {
     filenames.clear();
@@ -83,35 +112,35 @@ QList<QString> FreeSearch::search(QString query)
     // search split will tokenise and handle quoting and escaping
     QStringList tokens = searchSplit(query);
 
-    foreach(RideItem*item, context->athlete->rideCache->rides()) {
-
-        QMapIterator<QString,QString> meta(item->metadata());
-        meta.toFront();
-        while (meta.hasNext()) {
-            meta.next();
-
-            // does the super string contain the tokens?
-            foreach(QString token, tokens) {
-
-                if (meta.value().contains(token, Qt::CaseInsensitive)) {
-                    filenames << item->fileName;
-                    goto nextItem;
-                }
-            }
-        }
+    // rides with all the words (as prefixes) from the index
+    SearchIndex *index = context->athlete->rideCache->searchIndex();
+    if (!synced) index->sync(context->athlete->rideCache->rides());
+    synced = true;
+    QStringList found = index->search(tokens);
+
+    // phrases and tokens with punctuation need checking, the
+    // index only knows the rides have all the words in them
+    QStringList phrases;
+    foreach(QString token, tokens) {
+        QStringList words = SearchIndex::words(token);
+        if (words.count() != 1 || words.first() != token.toCaseFolded()) phrases << token;
+    }
 
-        // user intervals - even autodiscovered
-        foreach(IntervalItem *interval, item->intervals()) {
+    // keep in ride cache order
+    QSet<QString> matches;
+    foreach(QString name, found) matches.insert(name);
+    foreach(RideItem*item, context->athlete->rideCache->rides()) {
 
-            foreach (QString token, tokens) {
+        if (!matches.contains(item->fileName)) continue;
 
-                if (interval->name.contains(token, Qt::CaseInsensitive)) {
-                    filenames << item->fileName;
-                    goto nextItem;
-                }
+        bool all = true;
+        foreach(QString phrase, phrases) {
+            if (!hasPhrase(item, phrase)) {
+                all = false;
+                break;
             }
         }
-        nextItem:;
+        if (all) filenames << item->fileName;
     }
 
     emit results(filenames);
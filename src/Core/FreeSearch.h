@@ -44,6 +44,9 @@ public slots:
     // search metadata texts in ridecache
     QList<QString> search(QString query);
 
+    // rides were added, deleted or changed
+    void ridesChanged() { synced = false; }
+
 signals:
     void results(QStringList);
 
@@ -51,6 +54,9 @@ private:
     Context *context;
     QDir dir;
 
+    // the search index has seen the latest changes
+    bool synced;
+
     // Query results
     QStringList filenames;
 };
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MetricStore.h"
+
+#include "RideItem.h"
+#include "RideMetric.h"
+#include "RideFile.h"
+#include "DataFilter.h"
+#include "Context.h"
+
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+
+MetricStore::MetricStore() : stale(true), generation(0)
+{
+}
+
+void
+MetricStore::setRides(const QVector<RideItem*> &rides)
+{
+    QMutexLocker locker(&mutex);
+    latest = rides;
+    stale = true;
+    generation++;
+}
+
+void
+MetricStore::invalidate()
+{
+    QMutexLocker locker(&mutex);
+    stale = true;
+    generation++;
+}
+
+void
+MetricStore::refresh()
+{
+    if (!stale) return;
+
+    items = latest;
+    files.resize(items.count());
+    days_.resize(items.count());
+    for (int i=0; i<items.count(); i++) {
+        files[i] = items[i]->fileName;
+        days_[i] = items[i]->dateTime.date().toJulianDay();
+    }
+
+    columns.clear();
+    filters.clear();
+    stale = false;
+}
+
+const MetricColumn &
+MetricStore::column(int index)
+{
+    QHash<int, MetricColumn>::const_iterator it = columns.constFind(index);
+    if (it != columns.constEnd()) return it.value();
+
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    const RideMetric *metric = index >= 0 && index < factory.metricCount() ? factory.metric(index) : NULL;
+    bool stddev = metric && metric->type() == RideMetric::StdDev;
+
+    MetricColumn add;
+    add.values.fill(0, items.count());
+    add.counts.fill(1, items.count());
+    if (stddev) add.stdmeans.fill(0, items.count());
+
+    // as getForSymbol et al
+    for (int i=0; metric && i<items.count(); i++) {
+        RideItem *item = items[i];
+        if (item->metrics().size() != factory.metricCount()) continue;
+
+        add.values[i] = item->metrics()[index];
+        if (item->counts()[index]) add.counts[i] = item->counts()[index];
+        if (stddev) add.stdmeans[i] = item->stdmeans().value(index, 0.0f);
+    }
+
+    return columns.insert(index, add).value();
+}
+
+QSharedPointer<const MetricSnapshot>
+MetricStore::snapshot(const QVector<int> &indexes)
+{
+    QMutexLocker locker(&mutex);
+    refresh();
+
+    // the vectors are implicitly shared so this is cheap
+    MetricSnapshot *returning = new MetricSnapshot;
+    returning->generation = generation;
+    returning->rides = items;
+    returning->files = files;
+    returning->days = days_;
+    foreach(int index, indexes) returning->columns.insert(index, column(index));
+
+    return QSharedPointer<const MetricSnapshot>(returning);
+}
+
+const MetricColumn &
+MetricSnapshot::column(int index) const
+{
+    static const MetricColumn none;
+
+    QHash<int, MetricColumn>::const_iterator it = columns.constFind(index);
+    if (it != columns.constEnd()) return it.value();
+    return none;
+}
+
+QVector<int>
+MetricSnapshot::rows(Specification spec) const
+{
+    // rides in the date range
+    DateRange dr = spec.dateRange();
+    int from = 0, to = days.count();
+    if (dr.from != QDate()) from = std::lower_bound(days.constBegin(), days.constEnd(), int(dr.from.toJulianDay())) - days.constBegin();
+    if (dr.to != QDate()) to = std::upper_bound(days.constBegin(), days.constEnd(), int(dr.to.toJulianDay())) - days.constBegin();
+
+    QVector<int> returning;
+    if (to <= from) return returning;
+    returning.reserve(to - from);
+
+    // and the filters
+    FilterSet fs = spec.filterSet();
+    bool filtered = spec.isFiltered();
+    for (int i=from; i<to; i++)
+        if (!filtered || fs.pass(files[i]))
+            returning << i;
+
+    return returning;
+}
+
+QStringList
+MetricStore::filter(Context *context, QString expression)
+{
+    // same expression, same day and units
+    QString key = QString("%1:%2:%3").arg(QDate::currentDate().toJulianDay())
+                                     .arg(GlobalContext::context()->useMetricUnits ? 1 : 0)
+                                     .arg(DataFilter::fingerprint(expression));
+
+    mutex.lock();
+    refresh();
+    QVector<RideItem*> rides = items;
+    QVector<QString> names = files;
+    quint64 when = generation;
+    QHash<QString, QBitArray>::const_iterator it = filters.constFind(key);
+    bool found = it != filters.constEnd();
+    QBitArray bits = found ? it.value() : QBitArray(rides.count());
+    mutex.unlock();
+
+    // not locked while we evaluate as filters can use filters
+    if (!found) {
+        DataFilter df(NULL, context, expression);
+        for (int i=0; i<rides.count(); i++) {
+            Result res = df.evaluate(rides[i], NULL);
+            if (res.isNumber && res.number()) bits.setBit(i);
+        }
+
+        // unless the rides changed while we were at it, or
+        // it can change without them changing
+        bool cacheable = df.cacheable();
+        mutex.lock();
+        if (when == generation && cacheable) filters.insert(key, bits);
+        mutex.unlock();
+    }
+
+    QStringList returning;
+    for (int i=0; i<bits.size(); i++) if (bits.testBit(i)) returning << names[i];
+    return returning;
+}
+
+QVector<int>
+MetricSnapshot::groups(const QVector<int> &rows, period by, QDate origin) const
+{
+    QVector<int> returning(rows.count());
+
+    int start = origin.toJulianDay();
+    for (int i=0; i<rows.count(); i++) {
+        int day = days[rows[i]];
+        switch (by) {
+        case Week: returning[i] = 1 + ((day - start) / 7); break; // must start from 1 not zero!
+        case Month: { QDate date = QDate::fromJulianDay(day); returning[i] = (date.year()*12) + date.month(); } break;
+        case Year: returning[i] = QDate::fromJulianDay(day).year(); break;
+        case All: returning[i] = 1; break;
+        default:
+        case Day: returning[i] = day; break;
+        }
+    }
+    return returning;
+}
+
+void
+MetricStore::groupBy(const MetricColumn &column, const QVector<int> &rows, const QVector<int> &groups,
+                     int type, bool aggZero, bool wantZero, double scale, double offset,
+                     QVector<int> &keys, QVector<double> &values)
+{
+    keys.clear();
+    values.clear();
+
+    const double *v = column.values.constData();
+    const double *c = column.counts.constData();
+    const double *m = column.stdmeans.isEmpty() ? NULL : column.stdmeans.constData();
+
+    double y = 0, ymean_prev = 0;
+    unsigned long secondsPerGroupBy = 0;
+
+    for (int i=0; i<rows.count(); i++) {
+
+        int row = rows[i];
+        double value = v[row];
+
+        // check values are bounded and skip unavailable values
+        if (std::isnan(value) || std::isinf(value)) value = 0;
+        if (value == RideFile::NA) continue;
+        value = (value * scale) + offset;
+
+        if (!value && !wantZero) continue;
+
+        unsigned long seconds = c[row];
+        double ymean = m ? m[row] : 0;
+
+        if (keys.isEmpty() || groups[i] != keys.last()) {
+
+            // first in the group
+            if (!keys.isEmpty()) values << y;
+            keys << groups[i];
+            y = value;
+            ymean_prev = ymean;
+
+            // only increment counter if nonzero or we aggregate zeroes
+            secondsPerGroupBy = (value || aggZero) ? seconds : 0;
+            continue;
+        }
+
+        switch (type) {
+        case RideMetric::Total:
+            y += value;
+            break;
+        case RideMetric::Average:
+            // average should be calculated taking into account
+            // the duration of the ride, otherwise high value but
+            // short rides will skew the overall average
+            if (value || aggZero) y = ((y*secondsPerGroupBy)+(seconds*value)) / (secondsPerGroupBy+seconds);
+            break;
+        case RideMetric::Low:
+            if (value < y) y = value;
+            break;
+        case RideMetric::Peak:
+            if (value > y) y = value;
+            break;
+        case RideMetric::MeanSquareRoot:
+            if (value) y = sqrt((pow(y,2)*secondsPerGroupBy + pow(value,2)*seconds)/(secondsPerGroupBy+seconds));
+            break;
+        case RideMetric::StdDev:
+            if (value) {
+                // Combining two standard deviations using the formula:
+                //
+                //   sqrt(((n1-1)*S1^2+(n2-1)*S2^2+n1*(ymean_1-ymean)^2+n2*(ymean_2-ymean)^2)/(n1+n2))
+                //
+                // where:
+                //
+                //   ymean = (n1*ymean_1 + n2*ymean_2)/(n1+n2)
+                double combined = (secondsPerGroupBy*ymean_prev + ymean*seconds)/(secondsPerGroupBy + seconds);
+
+                y = pow(y,2)*(secondsPerGroupBy-1) + pow(value,2)*(seconds-1);
+                y += pow(ymean_prev - combined,2)*secondsPerGroupBy + pow(ymean - combined,2)*seconds;
+                y /= (secondsPerGroupBy + seconds);
+                y = sqrt(y);
+
+                ymean_prev = combined;
+            }
+            break;
+        }
+
+        // increment group counter if nonzero or we aggregate zeroes
+        if (value || aggZero) secondsPerGroupBy += seconds;
+    }
+    if (!keys.isEmpty()) values << y;
+}
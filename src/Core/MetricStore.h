@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_MetricStore_h
+#define _GC_MetricStore_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <QHash>
+#include <QBitArray>
+#include <QStringList>
+#include <QDate>
+#include <QMutex>
+#include <QSharedPointer>
+
+#include "Specification.h"
+
+class RideItem;
+class Context;
+
+// a metric for every ride in the ride cache, in date order
+class MetricColumn
+{
+    public:
+        QVector<double> values;     // as stored, i.e. metric units
+        QVector<double> counts;     // never zero, usually the duration
+        QVector<double> stdmeans;   // only for StdDev metrics
+};
+
+// the rides, their dates and some of the columns as they were at one
+// point in time, so they always agree with each other. It is never
+// changed once made so it can be held on to and used from any thread,
+// but the ride items should only be looked at on the GUI thread
+class MetricSnapshot
+{
+    public:
+        quint64 generation;         // of the store when it was taken
+        QVector<RideItem*> rides;
+        QVector<QString> files;     // filename of each ride
+        QVector<int> days;          // julian day of each ride
+
+        // a metric by RideMetric::index(), empty unless asked for
+        const MetricColumn &column(int index) const;
+
+        // the rides that pass a specification
+        QVector<int> rows(Specification spec) const;
+
+        // group for each row
+        enum period { Day, Week, Month, Year, All };
+        QVector<int> groups(const QVector<int> &rows, period by, QDate origin) const;
+
+    private:
+        friend class MetricStore;
+        QHash<int, MetricColumn> columns;
+};
+
+// MetricStore holds the metric values for all rides as columns, one
+// contiguous array per metric, so the trends charts, overview tiles and
+// the metrics() functions in formulas don't have to look up each metric
+// by name in each ride, and the rides in a date range are found with a
+// binary search. Columns are built when first asked for and thrown away
+// when the ride cache changes.
+//
+// They are handed out in a MetricSnapshot, taken with the lock held, so
+// the rides, rows and columns used together always match even if the
+// store is invalidated while they are being used.
+//
+// groupBy() aggregates a column by day, week, month or year in the way
+// that matches each metric's type, as the trends charts have always done.
+//
+// It also remembers which rides pass a filter expression, as a bit for
+// each ride, since charts with lots of curves often use the same filter
+// over and over. They are keyed by the expression fingerprint and thrown
+// away with the columns, or when the config changes or the day rolls over.
+// Expressions that use more than the ride, like the current ride, estimates
+// or the PMC, can change at any time so are evaluated every time.
+class MetricStore
+{
+    public:
+        MetricStore();
+
+        // the rides in the ride cache changed, on the GUI thread
+        void setRides(const QVector<RideItem*> &rides);
+
+        // rides or their metrics changed, thread safe
+        void invalidate();
+
+        // the rides and the columns for these metrics (RideMetric::index())
+        QSharedPointer<const MetricSnapshot> snapshot(const QVector<int> &indexes = QVector<int>());
+
+        // the rides that pass a filter expression, in date order
+        QStringList filter(Context *context, QString expression);
+
+        // aggregate the rows by group, in order. Totals are summed, averages
+        // and rms are weighted by count, std deviations are combined, peaks
+        // and lows are the max and min. Zero values are skipped unless
+        // wantZero and only count towards averages if aggZero. Values are
+        // converted as value*scale + offset
+        static void groupBy(const MetricColumn &column, const QVector<int> &rows, const QVector<int> &groups,
+                            int type, bool aggZero, bool wantZero, double scale, double offset,
+                            QVector<int> &keys, QVector<double> &values);
+
+    private:
+
+        // with the lock held
+        void refresh();
+        const MetricColumn &column(int index);
+
+        QMutex mutex;
+        bool stale;
+        quint64 generation; // invalidations
+
+        QVector<RideItem*> latest; // as set by the ride cache
+        QVector<RideItem*> items;
+        QVector<QString> files;
+        QVector<int> days_;
+        QHash<int, MetricColumn> columns;
+        QHash<QString, QBitArray> filters;
+};
+
+#endif // _GC_MetricStore_h
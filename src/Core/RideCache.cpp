@@ -20,6 +20,9 @@
 #include "Context.h"
 #include "Athlete.h"
 #include "RideFileCache.h"
+#include "RideDBStore.h"
+#include "SearchIndex.h"
+#include "MetricStore.h"
 #include "RideCacheModel.h"
 #include "Specification.h"
 #include "DataProcessor.h"
@@ -40,6 +43,7 @@
 // we initialise the global user metrics
 #include "RideMetric.h"
 #include "UserMetricSettings.h"
+#include "Settings.h"
 #include "UserMetricParser.h"
 #include <QXmlInputSource>
 #include <QXmlSimpleReader>
@@ -68,6 +72,10 @@ RideCache::RideCache(Context *context) : context(context)
     progress_ = 100;
     exiting = false;
     estimator = new Estimator(context);
+    store = new RideDBStore(QString("%1/%2").arg(context->athlete->home->cache().canonicalPath()).arg("rideDB.bin"));
+    search_ = new SearchIndex(QString("%1/%2").arg(context->athlete->home->cache().canonicalPath()).arg("search.idx"));
+    search_->read();
+    columns_ = new MetricStore();
 
     // initial load of user defined metrics - do once we have an initial context
     // but before we refresh or check metrics for the first time
@@ -137,6 +145,7 @@ RideCache::RideCache(Context *context) : context(context)
 
     // now sort it - we need to use find on it
     std::sort(rides_.begin(), rides_.end(), rideCacheLessThan);
+    columns_->setRides(rides_);
 
     // load the store - will unstale once cache restored
     RideCacheLoader *rideCacheLoader = new RideCacheLoader(this);
@@ -150,6 +159,10 @@ RideCache::postLoad()
 {
     // set model once we have the basics
     model_ = new RideCacheModel(context, this);
+    columns_->setRides(rides_);
+
+    // saving refreshes the ride, but doesn't tell us
+    connect(context, SIGNAL(rideSaved(RideItem*)), this, SLOT(itemSaved(RideItem*)));
 
     // after the first ridecache refresh we set initial pd estimates
     first= true;
@@ -184,8 +197,13 @@ RideCache::~RideCache()
     // cancel any refresh that may be running
     cancel();
 
-    // save to store
+    // save to store, rideDB.json first so the binary store is newer
     save();
+    store->save(rides_);
+    delete store;
+    search_->write();
+    delete search_;
+    delete columns_;
 }
 
 void
@@ -210,6 +228,8 @@ RideCache::initEstimates()
 void
 RideCache::configChanged(qint32 what)
 {
+    // filters may use the config
+    columns_->invalidate();
 
     // if the wbal formula changed invalidate all cached values
     if (what & CONFIG_WBAL) {
@@ -243,6 +263,7 @@ RideCache::itemChanged()
     // NOTE ONLY CONNECT THIS TO RIDEITEMS !!!
     // BECAUSE IT IS ASSUMED BELOW THE SENDER IS A RIDEITEM
     RideItem *item = static_cast<RideItem*>(QObject::sender());
+    columns_->invalidate();
 
     // the model is particularly interested in ANY item that changes
     emit itemChanged(item);
@@ -255,6 +276,13 @@ RideCache::itemChanged()
     }
 }
 
+void
+RideCache::itemSaved(RideItem*)
+{
+    // metrics were refreshed
+    columns_->invalidate();
+}
+
 // add a new ride
 void
 RideCache::addRide(QString name, bool dosignal, bool select, bool useTempActivities, bool planned)
@@ -297,6 +325,7 @@ RideCache::addRide(QString name, bool dosignal, bool select, bool useTempActivit
 
     // refresh metrics for *this ride only*
     last->refresh();
+    columns_->setRides(rides_);
 
     if (dosignal) context->notifyRideAdded(last); // here so emitted BEFORE rideSelected is emitted!
 
@@ -376,6 +405,9 @@ RideCache::removeRide(const QString& filenameToDelete) {
     model_->startRemove(index);
     rides_.remove(index, 1);
     delete_<<todelete;
+    search_->remove(filenameToDelete);
+    store->remove(filenameToDelete);
+    columns_->setRides(rides_);
     model_->endRemove(index);
 
     // delete the file by renaming it
@@ -522,7 +554,17 @@ RideCache::threadCompleted(RideCacheRefreshThread*thread)
         //fprintf(stderr,"refresh ended\n"); fflush(stderr);
         context->notifyRefreshEnd();
         garbageCollect();
+
+        // rideDB.json is read by the api web services and by scripts, it
+        // is written first so the binary store is newer and used at startup
         save();
+        store->save(rides_);
+
+        // and what is in them, for searching
+        search_->write();
+
+        // and where they went, for matching routes
+        context->athlete->routes->writeIndex();
     }
 }
 
@@ -581,9 +623,10 @@ RideCache::refresh()
         //future = QtConcurrent::map(reverse_, itemRefresh);
         //watcher.setFuture(future);
 
-        // calculate number of threads and work per thread
+        // calculate number of threads and work per thread, leaving
+        // half the cores for the gui unless there isn't one
         int maxthreads = QThreadPool::globalInstance()->maxThreadCount();
-        int threads = maxthreads / 2;
+        int threads = context->mainWindow ? maxthreads / 2 : maxthreads;
         if (threads==0) threads=1; // need at least one!
         int n=0;
 
@@ -882,6 +925,18 @@ RideCache::isMetricRelevantForRides(Specification specification,
     return false;
 }
 
+const char *
+RideCacheStats::stageName(int stage)
+{
+    switch (stage) {
+    case Parse: return "parse";
+    case Cpx: return "cpx";
+    case Metrics: return "metrics";
+    case Intervals: return "intervals";
+    default: return "";
+    }
+}
+
 // refresh metrics
 void RideCacheRefreshThread::run()
 {
@@ -899,6 +954,9 @@ void RideCacheRefreshThread::run()
         RideItem *item = cache->reverse_[n];
         if(item->isstale) {
             item->refresh();
+            cache->store->update(item);
+            cache->search_->update(item);
+            cache->columns_->invalidate();
             if (item == item->context->currentRideItem())
                 item->context->notifyRideChanged(item);
         }
@@ -27,6 +27,7 @@
 
 #include <QVector>
 #include <QThread>
+#include <QAtomicInteger>
 
 #include <QFuture>
 #include <QFutureWatcher>
@@ -40,6 +41,21 @@ class AthleteBest;
 class RideCacheModel;
 class Estimator;
 class Banister;
+class RideDBStore;
+class SearchIndex;
+class MetricStore;
+
+// work done refreshing rides, updated by the refresh threads and
+// reported by the headless rebuild (see CacheRebuild.h)
+struct RideCacheStats
+{
+    enum stage { Parse=0, Cpx, Metrics, Intervals, Stages };
+
+    QAtomicInteger<qint64> rides, samples, failed;
+    QAtomicInteger<qint64> nsecs[Stages]; // summed over threads
+
+    static const char *stageName(int stage);
+};
 
 class RideCache : public QObject
 {
@@ -82,6 +98,15 @@ class RideCache : public QObject
         // is running ?
         bool isRunning() { return refreshThreads.count() != 0; }
 
+        // words in the metadata and interval names for free search
+        SearchIndex *searchIndex() { return search_; }
+
+        // metrics for all rides as columns, for trends and aggregation
+        MetricStore *metricStore() { return columns_; }
+
+        // work done refreshing so far
+        RideCacheStats stats;
+
         // how is update going?
         QMutex updateMutex;
         int updates; // for watching progress
@@ -105,7 +130,7 @@ class RideCache : public QObject
 
     public slots:
 
-        // restore / dump cache to disk (json)
+        // restore / dump cache to disk (binary store, falling back to json)
         void load();
         void postLoad();
         void save(bool opendata=false, QString filename="");
@@ -124,6 +149,7 @@ class RideCache : public QObject
 
         // item telling us it changed
         void itemChanged();
+        void itemSaved(RideItem*);
 
         // clear deleted objects
         void garbageCollect();
@@ -164,6 +190,9 @@ class RideCache : public QObject
         QVector<RideCacheRefreshThread*> refreshThreads;
 
         Estimator *estimator;
+        RideDBStore *store; // cache/rideDB.bin
+        SearchIndex *search_; // cache/search.idx
+        MetricStore *columns_;
         bool first; // updated when estimates are marked stale
 };
 
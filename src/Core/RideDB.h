@@ -47,6 +47,7 @@
 #define RIDEDB_VERSION "2.0"
 
 class APIWebService;
+struct APIRide;
 class HttpResponse;
 class HttpRequest;
 
@@ -65,6 +66,9 @@ struct RideDBContext {
     HttpRequest *request;
     HttpResponse *response;
 
+    // or copying the rides for an api snapshot
+    QVector<APIRide> *snapshot;
+
     // the scanner
     void *scanner;
 
@@ -19,6 +19,7 @@
 
 #include "RideDB.h"
 #include "RideFileCache.h"
+#include "RideDBStore.h"
 #include "Settings.h"
 #ifdef GC_WANT_HTTP
 #include "APIWebService.h"
@@ -76,10 +77,23 @@ ride: '{' rideelement_list '}'                                  {
                                                                     // search for one to update using serial search,
                                                                     // if the performance is too slow we can move to
                                                                     // a binary search, but suspect this ok < 10000 rides
-                                                                    if (jc->api != NULL) {
+                                                                    if (jc->snapshot != NULL) {
                                                                     #ifdef GC_WANT_HTTP
-                                                                        // we're listing rides in the api
-                                                                        jc->api->writeRideLine(jc->item, jc->request, jc->response);
+                                                                        // keeping what the api lists as plain values
+                                                                        APIRide copy;
+                                                                        copy.fileName = jc->item.fileName;
+                                                                        copy.dateTime = jc->item.dateTime;
+                                                                        copy.metrics = jc->item.metrics();
+                                                                        copy.metadata = jc->item.metadata();
+                                                                        foreach(IntervalItem *interval, jc->item.intervals()) {
+                                                                            APIInterval i;
+                                                                            i.name = interval->name;
+                                                                            i.type = static_cast<int>(interval->type);
+                                                                            i.metrics = interval->metrics();
+                                                                            copy.intervals << i;
+                                                                        }
+                                                                        jc->snapshot->append(copy);
+                                                                        qDeleteAll(jc->item.intervals());
                                                                     #endif
                                                                     } else {
                                                                         double progress= round(double(jc->loading++) / double(jc->cache->rides().count()) * 100.0f);
@@ -323,6 +337,14 @@ RideCache::load()
 {
     // only load if it exists !
     QFile rideDB(QString("%1/%2").arg(context->athlete->home->cache().canonicalPath()).arg("rideDB.json"));
+
+    // the binary store is much quicker, unless rideDB.json has been
+    // written since e.g. by an older version or after a crash
+    QFileInfo json(rideDB.fileName()), binary(store->fileName());
+    if (binary.exists() && (!json.exists() || json.lastModified() <= binary.lastModified()) &&
+        store->load(context, this))
+        return;
+
     if (rideDB.exists() && rideDB.open(QFile::ReadOnly)) {
 
         QDir directory = context->athlete->home->activities();
@@ -341,6 +363,7 @@ RideCache::load()
         jc->context = context;
         jc->cache = this;
         jc->api = NULL;
+        jc->snapshot = NULL;
         jc->old = false;
         jc->loading = 0;
         jc->lastProgressUpdate = 0.0;
@@ -855,20 +878,22 @@ APIWebService::listRides(QString athlete, HttpRequest &request, HttpResponse &re
 {
     listRideSettings settings;
 
-    // the ride db
-    QString ridedb = QString("%1/%2/cache/rideDB.json").arg(home.absolutePath()).arg(athlete);
-    QFile rideDB(ridedb);
+    // the rides as of the last time rideDB.json changed
+    QSharedPointer<APISnapshot> snap = snapshot(athlete);
 
     // list activities and associated metrics
     response.setHeader("Content-Type", "text; charset=ISO-8859-1");
 
     // not known..
-    if (!rideDB.exists()) {
+    if (snap.isNull()) {
         response.setStatus(404);
         response.write("malformed URL or unknown athlete.\n");
         return;
     }
 
+    // they've got this already
+    if (notModified(snap, request, response)) return;
+
     // intervals or rides?
     QString intervalsp = request.getParameter("intervals");
     if (intervalsp.toUpper() == "TRUE") settings.intervals = true;
@@ -986,51 +1011,8 @@ APIWebService::listRides(QString athlete, HttpRequest &request, HttpResponse &re
         }
         response.bwrite("\n");
 
-        // parse the rideDB and write a line for each entry
-        if (rideDB.exists() && rideDB.open(QFile::ReadOnly)) {
-
-            // ok, lets read it in
-            QTextStream stream(&rideDB);
-#if QT_VERSION < 0x060000
-            stream.setCodec("UTF-8");
-#endif
-
-            // Read the entire file into a QString -- we avoid using fopen since it
-            // doesn't handle foreign characters well. Instead we use QFile and parse
-            // from a QString
-            QString contents = stream.readAll();
-            rideDB.close();
-
-            // create scanner context for reentrant parsing
-            RideDBContext *jc = new RideDBContext;
-            jc->cache = NULL;
-            jc->api = this;
-            jc->response = &response;
-            jc->request = &request;
-            jc->old = false;
-
-            // clean item
-            jc->item.path = home.absolutePath() + "/activities";
-            jc->item.context = NULL;
-            jc->item.isstale = jc->item.isdirty = jc->item.isedit = false;
-
-            RideDBlex_init(&scanner);
-
-            // inform the parser/lexer we have a new file
-            RideDB_setString(contents, scanner);
-
-            // setup
-            jc->errors.clear();
-
-            // parse it
-            RideDBparse(jc);
-
-            // clean up
-            RideDBlex_destroy(scanner);
-
-            // regardless of errors we're done !
-            delete jc;
-        }
+        // a line for each ride in the snapshot
+        foreach(const APIRide &item, snap->rides) writeRideLine(item, &request, &response);
 
     } else {
 
@@ -1077,4 +1059,66 @@ APIWebService::listRides(QString athlete, HttpRequest &request, HttpResponse &re
     }
     response.flush();
 }
+
+QSharedPointer<APISnapshot>
+APIWebService::snapshot(QString athlete)
+{
+    QFileInfo info(QString("%1/%2/cache/rideDB.json").arg(home.absolutePath()).arg(athlete));
+    if (!info.exists()) return QSharedPointer<APISnapshot>();
+
+    // still current ?
+    snapshotLock.lock();
+    QSharedPointer<APISnapshot> current = snapshots.value(athlete);
+    snapshotLock.unlock();
+    if (current && current->modified == info.lastModified() && current->size == info.size()) return current;
+
+    // read it again, concurrent requests might both do this
+    // but it is only the first request after a change
+    QSharedPointer<APISnapshot> replace(new APISnapshot);
+    replace->modified = info.lastModified();
+    replace->size = info.size();
+    replace->version = QByteArray::number(replace->modified.toMSecsSinceEpoch(), 16) + "-" + QByteArray::number(replace->size, 16);
+
+    QFile rideDB(info.absoluteFilePath());
+    if (rideDB.open(QFile::ReadOnly)) {
+
+        // ok, lets read it in
+        QTextStream stream(&rideDB);
+#if QT_VERSION < 0x060000
+        stream.setCodec("UTF-8");
+#endif
+        QString contents = stream.readAll();
+        rideDB.close();
+
+        // create scanner context for reentrant parsing
+        RideDBContext *jc = new RideDBContext;
+        jc->cache = NULL;
+        jc->api = this;
+        jc->snapshot = &replace->rides;
+        jc->response = NULL;
+        jc->request = NULL;
+        jc->old = false;
+
+        // clean item
+        jc->item.path = home.absolutePath() + "/" + athlete + "/activities";
+        jc->item.context = NULL;
+        jc->item.isstale = jc->item.isdirty = jc->item.isedit = false;
+
+        RideDBlex_init(&scanner);
+        RideDB_setString(contents, scanner);
+        jc->errors.clear();
+        RideDBparse(jc);
+        RideDBlex_destroy(scanner);
+
+        // regardless of errors we're done !
+        delete jc;
+    }
+
+    // swap it in
+    snapshotLock.lock();
+    snapshots.insert(athlete, replace);
+    snapshotLock.unlock();
+
+    return replace;
+}
 #endif
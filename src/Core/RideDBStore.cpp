@@ -0,0 +1,664 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideDBStore.h"
+
+#include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+#include "RideItem.h"
+#include "IntervalItem.h"
+#include "RideMetric.h"
+
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <cmath>
+#include <cstring>
+#include <cstddef> // for offsetof
+
+static inline quint64 align8(quint64 offset) { return (offset + 7) & ~quint64(7); }
+static inline double finite(double value) { return std::isinf(value) || std::isnan(value) ? 0 : value; }
+
+// FNV-1a
+static inline quint32 fnv(quint32 hash, const void *bytes, quint64 length)
+{
+    const uchar *p = (const uchar*)bytes;
+    for (quint64 k=0; k<length; k++) hash = (hash ^ p[k]) * 16777619u;
+    return hash;
+}
+
+// a record, its row in the matrix (every stride values) and its blob
+static quint32
+checksum(const RideDBRecord &r, const double *values, const double *counts, quint32 columns, quint64 stride, const char *blob)
+{
+    quint32 hash = fnv(2166136261u, &r, offsetof(RideDBRecord, checksum));
+    for (quint32 c=0; c<columns; c++) {
+        hash = fnv(hash, values + c * stride, sizeof(double));
+        hash = fnv(hash, counts + c * stride, sizeof(double));
+    }
+    return fnv(hash, blob, r.extraSize);
+}
+
+RideDBStore::RideDBStore(QString filename) : file(filename), data(NULL), size(0), stale(true)
+{
+}
+
+RideDBStore::~RideDBStore()
+{
+    close();
+}
+
+//
+// MEMORY MAPPED ACCESS
+//
+bool
+RideDBStore::open()
+{
+    close();
+
+    if (file.open(QIODevice::ReadWrite) == false) return false;
+
+    size = file.size();
+    if (size < qint64(sizeof(RideDBStoreHeader))) {
+        file.close();
+        return false;
+    }
+
+    uchar *mapped = file.map(0, size);
+    if (mapped == NULL) {
+        file.close();
+        return false;
+    }
+
+    // current version and the sections are all in the file ?
+    const RideDBStoreHeader *head = (const RideDBStoreHeader*)mapped;
+    quint64 matrix = quint64(head->columns) * quint64(head->rides) * sizeof(double);
+    bool valid = head->magic == RideDBStoreMagic && head->version == RideDBStoreVersion &&
+                 head->records % 8 == 0 && head->values % 8 == 0 && head->counts % 8 == 0 && head->strings % 4 == 0 &&
+                 head->records + quint64(head->rides) * sizeof(RideDBRecord) <= quint64(size) &&
+                 head->names + quint64(head->columns) * sizeof(quint32) <= quint64(size) &&
+                 head->values + matrix <= quint64(size) &&
+                 head->counts + matrix <= quint64(size) &&
+                 head->strings + head->stringsSize <= quint64(size) &&
+                 head->extra <= quint64(size);
+
+    if (!valid) {
+        file.unmap(mapped);
+        file.close();
+        return false;
+    }
+    data = mapped;
+
+    // string table, each is a length then utf8 padded to 4 bytes
+    const uchar *strings = data + head->strings;
+    quint64 pos = 0;
+    while (pos + sizeof(quint32) <= head->stringsSize) {
+        quint32 length;
+        memcpy(&length, strings + pos, sizeof(quint32));
+        if (pos + sizeof(quint32) + length > head->stringsSize) break;
+
+        QString string = QString::fromUtf8((const char*)strings + pos + sizeof(quint32), length);
+        ids.insert(string, quint32(pos));
+        loaded.insert(quint32(pos), string);
+        pos += (sizeof(quint32) + length + 3) & ~quint64(3);
+    }
+
+    // match the columns to the metrics we have now
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    const quint32 *names = (const quint32*)(data + head->names);
+    columnOf.fill(-1, factory.metricCount());
+    indexOf.fill(-1, head->columns);
+    for (quint32 c=0; c<head->columns; c++) {
+        const RideMetric *m = factory.rideMetric(string(names[c]));
+        if (m && m->index() >= 0 && m->index() < columnOf.count()) {
+            indexOf[c] = m->index();
+            columnOf[m->index()] = c;
+        }
+    }
+
+    for (quint32 i=0; i<head->rides; i++) records.insert(string(record(i)->fileName), i);
+
+    return true;
+}
+
+void
+RideDBStore::close()
+{
+    if (data) file.unmap(data);
+    file.close();
+    data = NULL;
+    size = 0;
+
+    records.clear();
+    ids.clear();
+    loaded.clear();
+    columnOf.clear();
+    indexOf.clear();
+}
+
+QString
+RideDBStore::string(quint32 id)
+{
+    return loaded.value(id, QString());
+}
+
+//
+// RESTORE
+//
+bool
+RideDBStore::load(Context *context, RideCache *cache)
+{
+    QMutexLocker locker(&mutex);
+
+    if (!file.exists() || !open()) {
+        stale = true;
+        return false;
+    }
+    stale = false;
+
+    const RideDBStoreHeader *head = header();
+    const double *values = (const double*)(data + head->values);
+    const double *counts = (const double*)(data + head->counts);
+    QString folder = context->athlete->home->root().canonicalPath();
+    double lastProgressUpdate = 0;
+
+    // clean item, as rideDB.json
+    RideItem item;
+    item.path = context->athlete->home->activities().canonicalPath();
+    item.context = context;
+    item.isstale = item.isdirty = item.isedit = false;
+
+    for (quint32 i=0; i<head->rides; i++) {
+
+        double progress = round(double(i) / double(head->rides) * 100.0f);
+        if (progress > lastProgressUpdate) {
+            context->notifyLoadProgress(folder, progress);
+            lastProgressUpdate = progress;
+        }
+
+        const RideDBRecord &r = *record(i);
+        item.fileName = string(r.fileName);
+
+        // torn by a crash whilst updating, it stays stale and gets refreshed
+        if (r.extra + r.extraSize > quint64(size) ||
+            r.checksum != checksum(r, values + i, counts + i, head->columns, head->rides, (const char*)data + r.extra)) {
+            qDebug()<<"unable to load:"<<item.fileName<<"record in rideDB.bin is damaged";
+            continue;
+        }
+
+        item.dateTime = QDateTime::fromMSecsSinceEpoch(r.date);
+        item.fingerprint = r.fingerprint;
+        item.crc = r.crc;
+        item.metacrc = r.metacrc;
+        item.timestamp = r.timestamp;
+        item.weight = r.weight;
+        item.dbversion = r.dbversion;
+        item.udbversion = r.udbversion;
+        item.zoneRange = r.zoneRange;
+        item.hrZoneRange = r.hrZoneRange;
+        item.paceZoneRange = r.paceZoneRange;
+        item.color = QColor(QRgb(r.color));
+        item.present = string(r.present);
+        item.sport = string(r.sport);
+        item.isBike = item.sport == "Bike";
+        item.isRun = item.sport == "Run";
+        item.isSwim = item.sport == "Swim";
+        item.isXtrain = !item.isBike && !item.isRun && !item.isSwim && item.sport != "Aero";
+        item.isAero = r.flags & RideDBAero;
+        item.samples = r.flags & RideDBSamples;
+
+        // our row in each column
+        item.metrics().fill(0.0f);
+        item.counts().fill(0.0f);
+        for (int c=0; c<indexOf.count(); c++) {
+            if (indexOf[c] < 0) continue;
+            item.metrics()[indexOf[c]] = values[quint64(c) * head->rides + i];
+            item.counts()[indexOf[c]] = counts[quint64(c) * head->rides + i];
+        }
+
+        if (!readExtra(r, &item)) {
+            qDebug()<<"unable to load:"<<item.fileName<<"rideDB.bin is corrupt";
+            qDeleteAll(item.intervals());
+            item.clearIntervals();
+            continue;
+        }
+
+        // find entry and update it
+        int index = cache->find(&item);
+        if (index == -1) {
+            // deleted since, drop it next time we save
+            qDebug()<<"unable to load:"<<item.fileName<<item.dateTime<<item.weight;
+            qDeleteAll(item.intervals());
+            stale = true;
+        } else cache->rides().at(index)->setFrom(item);
+
+        // intervals now belong to the ride
+        item.clearIntervals();
+    }
+    return true;
+}
+
+bool
+RideDBStore::readExtra(const RideDBRecord &r, RideItem *item)
+{
+    item->overrides_.clear();
+    item->metadata().clear();
+    item->xdata().clear();
+    item->stdmeans().clear();
+    item->stdvariances().clear();
+
+    if (r.extra + r.extraSize > quint64(size)) return false;
+
+    QByteArray bytes = QByteArray::fromRawData((const char*)data + r.extra, r.extraSize);
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    // strings are in the table, or inline if added after it was written
+    auto text = [&]() {
+        quint32 id = RideDBStoreInline;
+        QString string;
+        stream >> id;
+        if (id == RideDBStoreInline) stream >> string;
+        else string = this->string(id);
+        return string;
+    };
+
+    // std metrics are a column then value
+    auto stds = [&](QMap<int,double> &map) {
+        quint32 n = 0;
+        stream >> n;
+        for (quint32 k=0; k<n && stream.status() == QDataStream::Ok; k++) {
+            quint32 c; double value;
+            stream >> c >> value;
+            if (c < quint32(indexOf.count()) && indexOf[c] >= 0) map.insert(indexOf[c], value);
+        }
+    };
+
+    quint32 n = 0;
+    stream >> n;
+    for (quint32 k=0; k<n && stream.status() == QDataStream::Ok; k++) item->overrides_ << text();
+
+    n = 0;
+    stream >> n;
+    for (quint32 k=0; k<n && stream.status() == QDataStream::Ok; k++) {
+        QString key = text();
+        item->metadata().insert(key, text());
+    }
+
+    n = 0;
+    stream >> n;
+    for (quint32 k=0; k<n && stream.status() == QDataStream::Ok; k++) {
+        QString key = text();
+        QStringList series;
+        quint32 count = 0;
+        stream >> count;
+        for (quint32 j=0; j<count && stream.status() == QDataStream::Ok; j++) series << text();
+        item->xdata().insert(key, series);
+    }
+
+    stds(item->stdmeans());
+    stds(item->stdvariances());
+
+    // intervals, metrics are sparse
+    n = 0;
+    stream >> n;
+    for (quint32 k=0; k<n && stream.status() == QDataStream::Ok; k++) {
+
+        IntervalItem interval;
+        qint32 type, seq;
+        quint32 color, metrics;
+
+        interval.name = text();
+        stream >> interval.start >> interval.stop >> interval.startKM >> interval.stopKM;
+        stream >> type >> interval.test >> color >> seq >> interval.route;
+        interval.type = static_cast<RideFileInterval::intervaltype>(type);
+        interval.color = QColor(QRgb(color));
+        interval.displaySequence = seq;
+
+        metrics = 0;
+        stream >> metrics;
+        for (quint32 j=0; j<metrics && stream.status() == QDataStream::Ok; j++) {
+            quint32 c; double value, count;
+            stream >> c >> value >> count;
+            if (c < quint32(indexOf.count()) && indexOf[c] >= 0) {
+                interval.metrics()[indexOf[c]] = value;
+                interval.counts()[indexOf[c]] = count;
+            }
+        }
+        stds(interval.stdmeans());
+        stds(interval.stdvariances());
+
+        if (stream.status() == QDataStream::Ok) item->addInterval(interval);
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+//
+// SAVE
+//
+QByteArray
+RideDBStore::extra(RideItem *item) const
+{
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    auto text = [&](const QString &string) {
+        quint32 id = stringId(string);
+        stream << id;
+        if (id == RideDBStoreInline) stream << string;
+    };
+
+    auto stds = [&](const QMap<int,double> &map) {
+        QList<QPair<quint32,double> > list;
+        QMap<int,double>::const_iterator i;
+        for (i=map.constBegin(); i != map.constEnd(); i++) {
+            int c = columnOf.value(i.key(), -1);
+            if (c >= 0 && finite(i.value())) list << QPair<quint32,double>(c, i.value());
+        }
+        stream << quint32(list.count());
+        for (int k=0; k<list.count(); k++) stream << list[k].first << list[k].second;
+    };
+
+    stream << quint32(item->overrides_.count());
+    foreach(QString name, item->overrides_) text(name);
+
+    stream << quint32(item->metadata().count());
+    QMap<QString,QString>::const_iterator m;
+    for (m=item->metadata().constBegin(); m != item->metadata().constEnd(); m++) {
+        text(m.key());
+        text(m.value());
+    }
+
+    stream << quint32(item->xdata().count());
+    QMap<QString,QStringList>::const_iterator x;
+    for (x=item->xdata().constBegin(); x != item->xdata().constEnd(); x++) {
+        text(x.key());
+        stream << quint32(x.value().count());
+        foreach(QString series, x.value()) text(series);
+    }
+
+    stds(item->stdmeans());
+    stds(item->stdvariances());
+
+    stream << quint32(item->intervals().count());
+    foreach(IntervalItem *interval, item->intervals()) {
+
+        text(interval->name);
+        stream << interval->start << interval->stop << interval->startKM << interval->stopKM;
+        stream << qint32(interval->type) << interval->test << quint32(interval->color.rgb())
+               << qint32(interval->displaySequence) << interval->route;
+
+        // only the metrics that aren't zero
+        QList<int> nonzero;
+        for (int i=0; i<interval->metrics().count() && i<columnOf.count(); i++)
+            if (columnOf[i] >= 0 && (finite(interval->metrics()[i]) || finite(interval->counts()[i])))
+                nonzero << i;
+
+        stream << quint32(nonzero.count());
+        foreach(int i, nonzero)
+            stream << quint32(columnOf[i]) << finite(interval->metrics()[i]) << finite(interval->counts()[i]);
+
+        stds(interval->stdmeans());
+        stds(interval->stdvariances());
+    }
+
+    return bytes;
+}
+
+bool
+RideDBStore::save(const QVector<RideItem*> &rides)
+{
+    QMutexLocker locker(&mutex);
+
+    // unmap before replacing it
+    close();
+
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+
+    // same rides as rideDB.json
+    QVector<RideItem*> saving;
+    foreach(RideItem *item, rides) {
+        if (item->metrics().count() == 0 || item->skipsave == true) continue;
+        saving << item;
+    }
+    quint32 n = saving.count();
+
+    // a column for each metric
+    quint32 columns = factory.metricCount();
+    columnOf.fill(-1, columns);
+    indexOf.fill(-1, columns);
+    for (quint32 c=0; c<columns; c++) {
+        int index = factory.rideMetric(factory.metricName(c))->index();
+        if (index < 0 || index >= int(columns)) continue;
+        indexOf[c] = index;
+        columnOf[index] = c;
+    }
+
+    // string table
+    QByteArray strings;
+    auto intern = [&](const QString &string) {
+        if (ids.contains(string)) return;
+        QByteArray utf8 = string.toUtf8();
+        quint32 length = utf8.size();
+        ids.insert(string, strings.size());
+        strings.append((const char*)&length, sizeof(quint32));
+        strings.append(utf8);
+        while (strings.size() % 4) strings.append('\0');
+    };
+
+    for (quint32 c=0; c<columns; c++) intern(factory.metricName(c));
+    foreach(RideItem *item, saving) {
+        intern(item->fileName);
+        intern(item->sport);
+        intern(item->present);
+        foreach(QString name, item->overrides_) intern(name);
+        QMap<QString,QString>::const_iterator m;
+        for (m=item->metadata().constBegin(); m != item->metadata().constEnd(); m++) {
+            intern(m.key());
+            intern(m.value());
+        }
+        QMap<QString,QStringList>::const_iterator x;
+        for (x=item->xdata().constBegin(); x != item->xdata().constEnd(); x++) {
+            intern(x.key());
+            foreach(QString series, x.value()) intern(series);
+        }
+        foreach(IntervalItem *interval, item->intervals()) intern(interval->name);
+    }
+
+    // layout
+    RideDBStoreHeader head;
+    memset(&head, 0, sizeof(head));
+    head.magic = RideDBStoreMagic;
+    head.version = RideDBStoreVersion;
+    head.rides = n;
+    head.columns = columns;
+    head.records = align8(sizeof(RideDBStoreHeader));
+    head.names = head.records + quint64(n) * sizeof(RideDBRecord);
+    head.values = align8(head.names + quint64(columns) * sizeof(quint32));
+    head.counts = head.values + quint64(columns) * n * sizeof(double);
+    head.strings = head.counts + quint64(columns) * n * sizeof(double);
+    head.stringsSize = strings.size();
+    head.extra = align8(head.strings + head.stringsSize);
+
+    // records and their blobs, with some room to grow
+    QVector<RideDBRecord> rows(n);
+    QVector<QByteArray> blobs(n);
+    quint64 offset = head.extra;
+    for (quint32 i=0; i<n; i++) {
+        RideItem *item = saving[i];
+        RideDBRecord &r = rows[i];
+        memset(&r, 0, sizeof(RideDBRecord));
+
+        r.date = item->dateTime.toMSecsSinceEpoch();
+        r.fingerprint = item->fingerprint;
+        r.crc = item->crc;
+        r.metacrc = item->metacrc;
+        r.timestamp = item->timestamp;
+        r.weight = item->weight;
+        r.dbversion = item->dbversion;
+        r.udbversion = item->udbversion;
+        r.zoneRange = item->zoneRange;
+        r.hrZoneRange = item->hrZoneRange;
+        r.paceZoneRange = item->paceZoneRange;
+        r.color = item->color.rgb();
+        r.flags = (item->isAero ? RideDBAero : 0) | (item->samples ? RideDBSamples : 0);
+        r.fileName = stringId(item->fileName);
+        r.sport = stringId(item->sport);
+        r.present = stringId(item->present);
+
+        blobs[i] = extra(item);
+        r.extra = offset;
+        r.extraSize = blobs[i].size();
+        r.extraCapacity = align8(r.extraSize + r.extraSize / 4 + 64);
+        offset += r.extraCapacity;
+    }
+
+    // the value of a metric for a ride, as stored in the matrix
+    auto cell = [&](int matrix, quint32 c, quint32 i) {
+        const QVector<double> &from = matrix ? saving[i]->counts() : saving[i]->metrics();
+        return indexOf[c] >= 0 && indexOf[c] < from.count() ? finite(from[indexOf[c]]) : 0;
+    };
+
+    // now the checksums, each ride's row is contiguous here
+    QVector<double> values(columns), counts(columns);
+    for (quint32 i=0; i<n; i++) {
+        for (quint32 c=0; c<columns; c++) {
+            values[c] = cell(0, c, i);
+            counts[c] = cell(1, c, i);
+        }
+        rows[i].checksum = checksum(rows[i], values.constData(), counts.constData(), columns, 1, blobs[i].constData());
+    }
+
+    QSaveFile out(file.fileName());
+    if (!out.open(QIODevice::WriteOnly)) {
+        qDebug()<<"unable to write"<<file.fileName();
+        stale = true;
+        return false;
+    }
+
+    auto pad = [&](quint64 to) {
+        if (quint64(out.pos()) < to) out.write(QByteArray(to - out.pos(), '\0'));
+    };
+
+    out.write((const char*)&head, sizeof(head));
+    pad(head.records);
+    out.write((const char*)rows.constData(), quint64(n) * sizeof(RideDBRecord));
+
+    QVector<quint32> names(columns);
+    for (quint32 c=0; c<columns; c++) names[c] = stringId(factory.metricName(c));
+    out.write((const char*)names.constData(), quint64(columns) * sizeof(quint32));
+    pad(head.values);
+
+    // metric matrix, a column at a time
+    QVector<double> column(n);
+    for (int matrix=0; matrix<2; matrix++) {
+        for (quint32 c=0; c<columns; c++) {
+            for (quint32 i=0; i<n; i++) column[i] = cell(matrix, c, i);
+            out.write((const char*)column.constData(), quint64(n) * sizeof(double));
+        }
+    }
+
+    out.write(strings);
+    pad(head.extra);
+    for (quint32 i=0; i<n; i++) {
+        out.write(blobs[i]);
+        pad(rows[i].extra + rows[i].extraCapacity);
+    }
+
+    if (!out.commit()) {
+        qDebug()<<"unable to write"<<file.fileName();
+        stale = true;
+        return false;
+    }
+
+    // map the new one for updates
+    stale = !open();
+    return !stale;
+}
+
+//
+// UPDATE IN PLACE
+//
+void
+RideDBStore::remove(QString fileName)
+{
+    QMutexLocker locker(&mutex);
+
+    // records can't be removed in place
+    if (records.contains(fileName)) stale = true;
+}
+
+void
+RideDBStore::update(RideItem *item)
+{
+    QMutexLocker locker(&mutex);
+
+    if (stale) return;
+
+    // a new ride, a new metric or a new sport means it needs a save()
+    int i = records.value(item->fileName, -1);
+    if (data == NULL || i < 0 || columnOf.count() < item->metrics().count() || columnOf.contains(-1) ||
+        stringId(item->sport) == RideDBStoreInline || stringId(item->present) == RideDBStoreInline) {
+        stale = true;
+        return;
+    }
+
+    // or the blob outgrew its space
+    RideDBRecord *r = record(i);
+    QByteArray blob = extra(item);
+    if (quint32(blob.size()) > r->extraCapacity || r->extra + r->extraCapacity > quint64(size)) {
+        stale = true;
+        return;
+    }
+
+    r->date = item->dateTime.toMSecsSinceEpoch();
+    r->fingerprint = item->fingerprint;
+    r->crc = item->crc;
+    r->metacrc = item->metacrc;
+    r->timestamp = item->timestamp;
+    r->weight = item->weight;
+    r->dbversion = item->dbversion;
+    r->udbversion = item->udbversion;
+    r->zoneRange = item->zoneRange;
+    r->hrZoneRange = item->hrZoneRange;
+    r->paceZoneRange = item->paceZoneRange;
+    r->color = item->color.rgb();
+    r->flags = (item->isAero ? RideDBAero : 0) | (item->samples ? RideDBSamples : 0);
+    r->sport = stringId(item->sport);
+    r->present = stringId(item->present);
+
+    // our row in the matrix
+    const RideDBStoreHeader *head = header();
+    double *values = (double*)(data + head->values);
+    double *counts = (double*)(data + head->counts);
+    for (int c=0; c<indexOf.count(); c++) {
+        if (indexOf[c] < 0 || indexOf[c] >= item->metrics().count()) continue;
+        values[quint64(c) * head->rides + i] = finite(item->metrics()[indexOf[c]]);
+        counts[quint64(c) * head->rides + i] = finite(item->counts()[indexOf[c]]);
+    }
+
+    memcpy(data + r->extra, blob.constData(), blob.size());
+    r->extraSize = blob.size();
+
+    // last, so a crash before here leaves it wrong
+    r->checksum = checksum(*r, values + i, counts + i, head->columns, head->rides, (const char*)data + r->extra);
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideDBStore_h
+#define _GC_RideDBStore_h 1
+#include "GoldenCheetah.h"
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+
+class Context;
+class RideCache;
+class RideItem;
+
+// cache/rideDB.bin is a binary copy of rideDB.json that is memory mapped
+// at startup, so restoring the ride cache doesn't need to parse the json.
+// rideDB.json is still written for the API web services and OpenData.
+//
+// The file is laid out as:
+//
+//  - RideDBStoreHeader with the offsets of each section below
+//  - a fixed size RideDBRecord for each ride, in date order
+//  - the metric name for each column of the metric matrix
+//  - the metric matrix, values then counts, a column for each metric with
+//    a row for each ride, so any metric across all rides is contiguous
+//  - a string table for filenames, sports, metric names and metadata
+//  - a variable length blob for each ride with the overrides, metadata,
+//    xdata, std metrics and intervals, with some room to grow
+//
+// Columns are matched to RideMetric::index() by name when loading, so
+// adding or removing metrics doesn't invalidate it.
+//
+// When a ride is refreshed its record, its row in the metric matrix and
+// its blob are updated in place through the mapping. If that isn't possible
+// (a new ride, a new metric or the blob outgrew its space) the store is
+// marked stale and rewritten in full by save(). Rides that are deleted
+// also mark it stale, so their records are pruned by the next save().
+//
+// Each record has a checksum of itself, its row and its blob. An update
+// torn by a crash leaves it wrong, that ride is left stale when loading
+// so it alone is refreshed and the rest of the store is still used.
+static const quint32 RideDBStoreMagic = 0x42444347; // "GCDB"
+static const quint32 RideDBStoreVersion = 2;
+static const quint32 RideDBStoreInline = 0xffffffff; // string not in the table
+
+enum RideDBStoreFlag { RideDBAero = 0x01, RideDBSamples = 0x02 };
+
+struct RideDBStoreHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 rides, columns;
+    quint64 records, names, values, counts, strings, extra;  // offsets
+    quint64 stringsSize;
+};
+
+struct RideDBRecord {
+    qint64 date;                            // msecs since epoch
+    quint64 fingerprint, crc, metacrc, timestamp;
+    double weight;
+    qint32 dbversion, udbversion;
+    qint32 zoneRange, hrZoneRange, paceZoneRange;
+    quint32 color;                          // QRgb
+    quint32 flags;                          // RideDBStoreFlag
+    quint32 fileName, sport, present;       // string table
+    quint32 extraSize, extraCapacity;
+    quint64 extra;                          // offset of the blob
+    quint32 checksum;                       // must follow the fields it covers
+    quint32 spare;
+};
+
+class RideDBStore
+{
+    public:
+        RideDBStore(QString filename);
+        ~RideDBStore();
+
+        QString fileName() const { return file.fileName(); }
+
+        // restore the rides in the cache from the store, returns false
+        // if it doesn't exist or isn't valid, rides not found stay stale
+        bool load(Context *context, RideCache *cache);
+
+        // write every ride, replacing the file
+        bool save(const QVector<RideItem*> &rides);
+
+        // a ride was refreshed, thread safe
+        void update(RideItem *item);
+
+        // a ride was deleted, it goes at the next save()
+        void remove(QString fileName);
+
+        // updates couldn't be made in place, needs a save()
+        bool isStale() const { return stale; }
+
+    private:
+
+        bool open();
+        void close();
+
+        // string table
+        QString string(quint32 id);
+        quint32 stringId(const QString &string) const { return ids.value(string, RideDBStoreInline); }
+
+        // the variable length part of a ride
+        QByteArray extra(RideItem *item) const;
+        bool readExtra(const RideDBRecord &record, RideItem *item);
+
+        QFile file;
+        uchar *data;
+        qint64 size;
+        bool stale;
+        QMutex mutex;
+
+        const RideDBStoreHeader *header() const { return (const RideDBStoreHeader*)data; }
+        RideDBRecord *record(int i) const { return (RideDBRecord*)(data + header()->records) + i; }
+
+        QHash<QString, int> records;    // by filename
+        QHash<QString, quint32> ids;    // string table
+        QHash<quint32, QString> loaded; // strings read, shared between rides
+        QVector<int> columnOf;          // metric index to column, -1 if not stored
+        QVector<int> indexOf;           // column to metric index, -1 if no longer exists
+};
+
+#endif // _GC_RideDBStore_h
@@ -21,6 +21,8 @@
 #include "RideMetric.h"
 #include "RideFile.h"
 #include "RideFileCache.h"
+#include "RideFileColumns.h"
+#include "PeakSearch.h"
 #include "RideMetadata.h"
 #include "IntervalItem.h"
 #include "Route.h"
@@ -39,6 +41,7 @@
 #include <QMap>
 #include <QMapIterator>
 #include <QByteArray>
+#include <QElapsedTimer>
 
 // used to create a temporary ride item that is not in the cache and just
 // used to enable using the same calling semantics in things like the
@@ -507,7 +510,7 @@ RideItem::checkStale()
                         + (appsettings->cvalue(context->athlete->cyclist, context->athlete->zones(sport)->useCPforFTPSetting(), 0).toInt() ? 1 : 0)
                         + static_cast<unsigned long>(context->athlete->paceZones(isSwim)->getFingerprint(dateTime.date()))
                         + static_cast<unsigned long>(context->athlete->hrZones(sport)->getFingerprint(dateTime.date()))
-                        + static_cast<unsigned long>(context->athlete->routes->getFingerprint())
+                        + static_cast<unsigned long>(context->athlete->routes->getFingerprint(fileName))
                         + static_cast<unsigned long>(getHrvFingerprint())
                         + appsettings->cvalue(context->athlete->cyclist, GC_DISCOVERY, 57).toInt(); // 57 does not include search for PEAKS
 
@@ -559,6 +562,11 @@ RideItem::refresh()
     // update current state coz we'll fix it below
     isstale = false;
 
+    // time spent in each stage, for the headless rebuild
+    RideCacheStats *stats = context->athlete->rideCache ? &context->athlete->rideCache->stats : NULL;
+    QElapsedTimer timer;
+    timer.start();
+
     // open ride file will extract details too, but only if not
     // already open since its a user entry point and will call
     // refresh when opened. We don't want a recursion here.
@@ -570,6 +578,8 @@ RideItem::refresh()
         f = ride(); // will call us but isstale is false above
     } else f=ride_;
 
+    if (stats) stats->nsecs[RideCacheStats::Parse] += timer.nsecsElapsed();
+
     if (f) {
 
         // get the metadata
@@ -617,7 +627,10 @@ RideItem::refresh()
         else paceZoneRange = -1;
 
         // RideFile cache refresh before metrics, as meanmax may be used in user formulas
+        timer.restart();
         RideFileCache updater(context, context->athlete->home->activities().canonicalPath() + "/" + fileName, getWeight(), ride_, true);
+        if (stats) stats->nsecs[RideCacheStats::Cpx] += timer.nsecsElapsed();
+        timer.restart();
 
         // refresh metrics etc
         const RideMetricFactory &factory = RideMetricFactory::instance();
@@ -652,15 +665,23 @@ RideItem::refresh()
                 count_[j] = 0.00f;
             }
 
+        if (stats) stats->nsecs[RideCacheStats::Metrics] += timer.nsecsElapsed();
+
         // Update auto intervals AFTER ridefilecache as used for bests
+        timer.restart();
         updateIntervals();
+        if (stats) {
+            stats->nsecs[RideCacheStats::Intervals] += timer.nsecsElapsed();
+            stats->samples += f->dataPoints().count();
+            stats->rides++;
+        }
 
         // update fingerprints etc, crc done above
         fingerprint = static_cast<unsigned long>(context->athlete->zones(sport)->getFingerprint(dateTime.date()))
                     + (appsettings->cvalue(context->athlete->cyclist, context->athlete->zones(sport)->useCPforFTPSetting(), 0).toInt() ? 1 : 0)
                     + static_cast<unsigned long>(context->athlete->paceZones(isSwim)->getFingerprint(dateTime.date()))
                     + static_cast<unsigned long>(context->athlete->hrZones(sport)->getFingerprint(dateTime.date()))
-                    + static_cast<unsigned long>(context->athlete->routes->getFingerprint()) +
+                    + static_cast<unsigned long>(context->athlete->routes->getFingerprint(fileName)) +
                     + static_cast<unsigned long>(getHrvFingerprint())
                     + appsettings->cvalue(context->athlete->cyclist, GC_DISCOVERY, 57).toInt(); // 57 does not include search for PEAKS
 
@@ -687,6 +708,7 @@ RideItem::refresh()
 
     } else {
         qDebug()<<"** FILE READ ERROR: "<<fileName;
+        if (stats) stats->failed++;
         isstale = false;
         samples = false;
     }
@@ -850,6 +872,33 @@ RideItem::getStringForSymbol(QString name, bool useMetricUnits)
     return returning;
 }
 
+// best window for each of the durations (in secs, zero terminated) in one
+// pass over the 1s series, stop is -1 if the ride is shorter than it
+static QList<AddIntervalDialog::AddedInterval>
+discoverPeaks(RideFile *f, RideFile::SeriesType series, const int *durations)
+{
+    int count=0;
+    while (durations[count] != 0) count++;
+
+    RideFileResampled resampled = f->resampled(series);
+    QVector<PeakSearch::Peak> peaks(count);
+    PeakSearch::search(resampled.sums.constData(), resampled.count(), durations, count, peaks.data());
+
+    // start and stop are the first and last samples, as AddIntervalDialog::findPeaks
+    // does, and gaps in recording are zero so count towards the duration
+    QList<AddIntervalDialog::AddedInterval> returning;
+    for (int i=0; i<count; i++) {
+        if (peaks[i].offset < 0) {
+            returning << AddIntervalDialog::AddedInterval(0, -1, 0);
+        } else {
+            double start = resampled.start + peaks[i].offset * resampled.interval;
+            double stop = start + (durations[i] - 1) * resampled.interval;
+            returning << AddIntervalDialog::AddedInterval(start, stop, peaks[i].total / durations[i]);
+        }
+    }
+    return returning;
+}
+
 struct effort {
     int start, duration, joules;
     int zone;
@@ -985,11 +1034,13 @@ RideItem::updateIntervals()
                                 tr("1 minute"), tr("5 minutes"), tr("10 minutes"), tr("20 minutes"), tr("30 minutes"), tr("45 minutes"),
                                 tr("1 hour") };
     
+        // go hunting for the best peaks, all at once
+        QList<AddIntervalDialog::AddedInterval> found = discoverPeaks(f, RideFile::watts, durations);
+
         for(int i=0; durations[i] != 0; i++) {
 
-            // go hunting for best peak
             QList<AddIntervalDialog::AddedInterval> results;
-            AddIntervalDialog::findPeaks(context, true, f, Specification(), RideFile::watts, RideFile::original, durations[i], 1, results, "", "");
+            if (found[i].stop >= 0) results << found[i];
 
             // did we get one ?
             if (results.count() > 0 && results[0].avg > 0 && results[0].stop > 0) {
@@ -1020,11 +1071,13 @@ RideItem::updateIntervals()
                                 tr("1 hour") };
 
         bool metric = appsettings->value(this, context->athlete->paceZones(f->isSwim())->paceSetting(), GlobalContext::context()->useMetricUnits).toBool();
+        // go hunting for the best peaks, all at once
+        QList<AddIntervalDialog::AddedInterval> found = discoverPeaks(f, RideFile::kph, durations);
+
         for(int i=0; durations[i] != 0; i++) {
 
-            // go hunting for best peak
             QList<AddIntervalDialog::AddedInterval> results;
-            AddIntervalDialog::findPeaks(context, true, f, Specification(), RideFile::kph, RideFile::original, durations[i], 1, results, "", "");
+            if (found[i].stop >= 0) results << found[i];
 
             // did we get one ?
             if (results.count() > 0 && results[0].avg > 0 && results[0].stop > 0) {
@@ -1054,86 +1107,19 @@ RideItem::updateIntervals()
     if ((discovery & RideFileInterval::intervalTypeBits(RideFileInterval::EFFORT)) &&
         CP > 0 && WPRIME > 0 && PMAX > 0 && !f->isRun() && !f->isSwim() && f->isDataPresent(RideFile::watts)) {
 
-        const int SAMPLERATE = 1000; // 1000ms samplerate = 1 second samples
-
-        RideFilePoint sample;        // we reuse this to aggregate all values
-        long time = 0L;              // current time accumulates as we run through data
-        double lastT = 0.0f;         // last sample time seen in seconds
+        // watts at 1s intervals and the running total, shared
+        // with the mean max and W'bal so its only done once
+        RideFileResampled resampled = f->resampled(RideFile::watts);
+        long secs = resampled.count();
 
-        // set the array size
-        int arraySize = f->dataPoints().last()->secs + f->recIntSecs();
-
-        // anything longer than a day or negative is skipped
-        if (arraySize >= 0 && arraySize < (24*3600)) { // no indent, as added late
+        // anything longer than a day or empty is skipped
+        if (secs > 0 && secs < (24*3600)) { // no indent, as added late
 
         QElapsedTimer timer;
         timer.start();
 
-        // setup an integrated series
-        long *integrated_series = (long*)malloc(sizeof(long) * arraySize);
-        long *pi = integrated_series;
-        long rtot = 0;
-
-        long secs = 0;
-        foreach(RideFilePoint *p, f->dataPoints()) {
-
-            // increment secs by recIntSecs as the time series
-            // always starts at zero, normalized by the file reader
-            double psecs = p->secs + f->recIntSecs();
-
-            // whats the dt in microseconds
-            int dt = (psecs * 1000) - (lastT * 1000);
-            lastT = psecs;
-
-
-            // ignore time goes backwards
-            if (dt < 0) continue;
-
-            //
-            // AGGREGATE INTO SAMPLES
-            //
-            while (secs < arraySize && dt) {
-
-                // we keep track of how much time has been aggregated
-                // into sample, so 'need' is whats left to aggregate 
-                // for the full sample
-                int need = SAMPLERATE - sample.secs;
-
-                // aggregate
-                if (dt < need) {
-
-                    // the entire sample read is less than we need
-                    // so aggregate the whole lot and wait fore more
-                    // data to be read. If there is no more data then
-                    // this will be lost, we don't keep incomplete samples
-                    sample.secs += dt;
-                    sample.watts += float(dt) * p->watts;
-                    dt = 0;
-
-                } else {
-
-                    // dt is more than we need to fill and entire sample
-                    // so lets just take the fraction we need
-                    dt -= need;
-
-                    // accumulating time and distance
-                    sample.secs = time; time += double(SAMPLERATE) / 1000.0f;
-
-                    // averaging sample data
-                    sample.watts += float(need) * p->watts;
-                    sample.watts /= 1000;
-
-                    // integrate
-                    rtot += sample.watts;
-                    *pi++ = rtot;
-                    secs++;
-                    // reset back to zero so we can aggregate
-                    // the next sample
-                    sample.secs = 0;
-                    sample.watts = 0;
-                }
-            }
-        }
+        // integrated_series[i] is the energy up to and including second i
+        const double *integrated_series = resampled.sums.constData() + 1;
 
         // now the data is integrated we can look at the 
         // accumulated energy for each ride
@@ -1174,7 +1160,7 @@ RideItem::updateIntervals()
                         found = true;
 
                         // register a candidate
-                        tte.start = i + 1; // see NOTE above
+                        tte.start = resampled.start + i + 1; // see NOTE above
                         tte.duration = t;
                         tte.joules = integrated_series[i+t]-integrated_series[i];
                         tte.quality = tc / double(t);
@@ -1227,7 +1213,7 @@ RideItem::updateIntervals()
                             foundSprint = true;
 
                             // register a candidate
-                            sprint.start = i + 1; // see NOTE above
+                            sprint.start = resampled.start + i + 1; // see NOTE above
                             sprint.duration = t;
                             sprint.joules = integrated_series[i+t]-integrated_series[i];
                             sprint.quality = double(t) + (sprint.joules/sprint.duration/1000.0);
@@ -1355,12 +1341,11 @@ RideItem::updateIntervals()
 
         }
 
-        free(integrated_series);
 
     // we skipped for whatever reason
         //qDebug()<<fileName<<"of"<<secs<<"seconds took "<<timer.elapsed()<<"ms to find"<<candidates.count();
     }
-    } // if arraySize is in bounds, no indent from above
+    } // if secs is in bounds, no indent from above
 
     //qDebug() << "SEARCH HILLS";
     if ((discovery & RideFileInterval::intervalTypeBits(RideFileInterval::CLIMB)) &&
@@ -1371,46 +1356,54 @@ RideItem::updateIntervals()
         // Initialisation
         int hills = 0;
 
-        RideFilePoint *pstart = f->dataPoints().at(0);
-        RideFilePoint *pstop = f->dataPoints().at(0);
+        // we walk the columns by index, so we don't need to look
+        // up where the start and stop points are when we find one
+        QSharedPointer<const RideFileColumns> columns = f->columns(QList<RideFile::SeriesType>() << RideFile::alt << RideFile::km << RideFile::secs);
+        const double *alt = columns->column(RideFile::alt);
+        const double *km = columns->column(RideFile::km);
+        const double *secs = columns->column(RideFile::secs);
+        int points = (alt && km && secs) ? columns->count() : 0; // no climbs without distance
 
-        foreach(RideFilePoint *p, f->dataPoints()) {
+        int pstart = 0;
+        int pstop = 0;
+
+        for (int p=0; p<points; p++) {
             // new min altitude
-            if (pstart->alt > p->alt) {
+            if (alt[pstart] > alt[p]) {
                 //update start
                 pstart = p;
                 // update stop
                 pstop = p;
             }
             // Update max altitude
-            if (pstop->alt < p->alt) {
+            if (alt[pstop] < alt[p]) {
                 // update stop
                 pstop = p;
             }
 
-            bool downhill = (pstop->alt > p->alt+0.2*(pstop->alt-pstart->alt));
-            bool flat = (!downhill && (p->km - pstop->km)>1/3.0*(p->km - pstart->km));
-            bool end = (p == f->dataPoints().last() );
+            bool downhill = (alt[pstop] > alt[p]+0.2*(alt[pstop]-alt[pstart]));
+            bool flat = (!downhill && (km[p] - km[pstop])>1/3.0*(km[p] - km[pstart]));
+            bool end = (p == points-1);
 
 
 
             if (flat || downhill || end ) {
-                double distance =  pstop->km - pstart->km;
+                double distance =  km[pstop] - km[pstart];
 
 
                 if (distance >= 0.5) {
                     // Candidat
 
                     // Check groundrise at end
-                    int start = f->dataPoints().indexOf(pstart);
-                    int stop = f->dataPoints().indexOf(pstop);
+                    int start = pstart;
+                    int stop = pstop;
 
                     for (int i=stop;i>start;i--) {
-                        RideFilePoint *p2 = f->dataPoints().at(i);
-                        double distance2 =  pstop->km - p2->km;
+                        int p2 = i;
+                        double distance2 =  km[pstop] - km[p2];
                         if (distance2>0.1) {
-                            if ((pstop->alt-p2->alt)/distance2<20.0) {
-                                //qDebug() << "        correct stop " << (pstop->alt-p2->alt)/distance2;
+                            if ((alt[pstop]-alt[p2])/distance2<20.0) {
+                                //qDebug() << "        correct stop " << (alt[pstop]-alt[p2])/distance2;
                                 pstop = p2;
                             } else
                                 i = start;
@@ -1418,32 +1411,32 @@ RideItem::updateIntervals()
                     }
 
                     for (int i=start;i<stop;i++) {
-                        RideFilePoint *p2 = f->dataPoints().at(i);
-                        double distance2 = p2->km-pstart->km;
+                        int p2 = i;
+                        double distance2 = km[p2]-km[pstart];
                         if (distance2>0.1) {
-                            if ((p2->alt-pstart->alt)/distance2<20.0) {
-                                //qDebug() << "        correct start " << (p2->alt-pstart->alt)/distance2;
+                            if ((alt[p2]-alt[pstart])/distance2<20.0) {
+                                //qDebug() << "        correct start " << (alt[p2]-alt[pstart])/distance2;
                                 pstart = p2;
                             } else
                                 i = stop;
                         }
                     }
 
-                    distance =  pstop->km - pstart->km;
-                    double height = pstop->alt - pstart->alt;
+                    distance =  km[pstop] - km[pstart];
+                    double height = alt[pstop] - alt[pstart];
 
                     if (distance >= 0.5) {
 
                         if ((distance < 4.0 && height/distance >= 60-10*distance) ||
                             (distance >= 4.0 && height/distance >= 20)) {
 
-                            //qDebug() << "    NEW HILL " << (hills+1) << " at " << pstart->km  << "km " << pstart->secs/60.0 <<"-"<< pstop->secs/60.0 << "min " << distance << "km " << height/distance/10.0 << "%";
+                            //qDebug() << "    NEW HILL " << (hills+1) << " at " << km[pstart]  << "km " << secs[pstart]/60.0 <<"-"<< secs[pstop]/60.0 << "min " << distance << "km " << height/distance/10.0 << "%";
 
                             // create a new interval item
                             IntervalItem *intervalItem = new IntervalItem(this, QString(tr("Climb %1")).arg(++hills),
-                                                                          pstart->secs, pstop->secs,
-                                                                          pstart->km,
-                                                                          pstop->km,
+                                                                          secs[pstart], secs[pstop],
+                                                                          km[pstart],
+                                                                          km[pstop],
                                                                           count++,
                                                                           QColor(Qt::green),
                                                                           false,
@@ -1452,7 +1445,7 @@ RideItem::updateIntervals()
                             intervalItem->refresh();        // XXX will get called in constructore when refactor
                             intervals_ << intervalItem;
                         } else {
-                            //qDebug() << "        NOT HILL " << "at " << pstart->km << "km " <<  pstart->secs/60.0 <<"-"<< pstop->secs/60.0 << "min " <<  distance  << "km" << height/distance/10.0 << "%";
+                            //qDebug() << "        NOT HILL " << "at " << km[pstart] << "km " <<  secs[pstart]/60.0 <<"-"<< secs[pstop]/60.0 << "min " <<  distance  << "km" << height/distance/10.0 << "%";
                         }
                     }
                 }
@@ -1464,8 +1457,8 @@ RideItem::updateIntervals()
     }
 
 
-    //Search routes
-    if ((discovery & RideFileInterval::intervalTypeBits(RideFileInterval::ROUTE)) && f->isDataPresent(RideFile::lon)) {
+    //Search routes, rides without GPS are searched too so the route index knows
+    if (discovery & RideFileInterval::intervalTypeBits(RideFileInterval::ROUTE)) {
 
         // set intervals for routes
         QList<IntervalItem*> here;
@@ -25,11 +25,14 @@
 #include "IntervalItem.h"
 #include "RouteParser.h"
 #include "RideFile.h"
+#include "RideFileColumns.h"
+#include "RouteIndex.h"
 
 #include <QString>
 #include <QFile>
 #include <QXmlInputSource>
 #include <QXmlSimpleReader>
+#include <algorithm>
 
 
 #define tr(s) QObject::tr(s)
@@ -124,7 +127,7 @@ RouteSegment::addPoint(RoutePoint _point)
 }
 
 void 
-RouteSegment::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
+RouteSegment::search(RideItem *item, RideFile*ride, const QVector<int> &starts, QList<IntervalItem*>&here)
 {
     //qDebug() << "Opening ride: " << item->fileName << " for " << name;
 
@@ -149,6 +152,13 @@ RouteSegment::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
         RideFilePoint* point;
 
         for (int i=lastpoint+1; i<ride->dataPoints().count();i++) {
+
+            // only the samples close to the first point can start it
+            if (start == -1) {
+                QVector<int>::const_iterator next = std::lower_bound(starts.constBegin(), starts.constEnd(), i);
+                if (next == starts.constEnd()) break;
+                i = *next;
+            }
             point = ride->dataPoints().at(i);
 
             double minimumdistance = -1;
@@ -166,14 +176,9 @@ RouteSegment::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
                     if (precision == -1 || _dist<precision)
                         precision = _dist;
 
-                    if (_dist>1) {
-                        // fare away from reference point
-                        i += 50;
-                    } else {
-                        if (_dist<minimumprecision) {
-                            start = 0; //try to start
-                            // qDebug() << "    Start point identified...";
-                        }
+                    if (_dist<minimumprecision) {
+                        start = 0; //try to start
+                        // qDebug() << "    Start point identified...";
                     }
                 }
 
@@ -318,12 +323,25 @@ Routes::Routes(Context *context, const QDir &home)
 {
     this->home = home;
     this->context = context;
+
+    // where the rides went
+    index = new RouteIndex(context->athlete->home->cache().canonicalPath() + "/routes.idx");
+    index->read();
+
     readRoutes();
 }
 
 Routes::~Routes()
 {
     writeRoutes();
+    writeIndex();
+    delete index;
+}
+
+void
+Routes::writeIndex()
+{
+    index->write();
 }
 
 quint16
@@ -341,6 +359,25 @@ Routes::getFingerprint() const
 #endif
 }
 
+quint16
+Routes::getFingerprint(const QString &filename)
+{
+    // until we know where the ride went any route might be in it
+    QList<int> candidates;
+    if (!index->candidates(filename, routes, candidates)) return getFingerprint();
+
+    // only the routes that might be in it, so adding a route
+    // elsewhere doesn't mean searching this ride again
+    QByteArray ba;
+    foreach(int i, candidates) ba += routes[i].id().toByteArray();
+
+#if QT_VERSION < 0x060000
+    return qChecksum(ba, ba.length());
+#else
+    return qChecksum(ba);
+#endif
+}
+
 void
 Routes::readRoutes()
 {
@@ -353,6 +390,7 @@ Routes::readRoutes()
     xmlReader.setErrorHandler(&handler);
     xmlReader.parse( source );
     routes = handler.getRoutes();
+    index->routesChanged();
 }
 
 int
@@ -361,6 +399,7 @@ Routes::newRoute(QString name)
     RouteSegment add;
     add.setName(name);
     routes.insert(0, add);
+    index->routesChanged();
 
     return 0; // always add at the top
 }
@@ -407,24 +446,59 @@ Routes::writeRoutes()
 
     QString file = QString(home.canonicalPath() + "/routes.xml");
     RouteParser::serialize(file, routes);
+
+    // points may have been added
+    index->routesChanged();
 }
 
 void
 Routes::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
 {
-    if (ride) {
-
-        // search all segments
-        for (int routecount=0;routecount<routes.count();routecount++) {
-            RouteSegment *segment = &routes[routecount];
+    if (!ride) return;
+
+    // where did it go, and which routes start and end there
+    QList<int> candidates;
+    index->candidates(index->update(item->fileName, ride), routes, candidates);
+    if (candidates.isEmpty()) return;
+
+    // the samples in each cell
+    QSharedPointer<const RideFileColumns> columns = ride->columns(QList<RideFile::SeriesType>() << RideFile::lat << RideFile::lon);
+    const double *lat = columns->column(RideFile::lat);
+    const double *lon = columns->column(RideFile::lon);
+    if (!lat || !lon) return;
+
+    QHash<quint32, QVector<int> > cells;
+    double minLat=180, maxLat=-180, minLon=180, maxLon=-180;
+    for (int i=0; i<columns->count(); i++) {
+        if (!RouteIndex::valid(lat[i], lon[i])) continue;
+        cells[RouteIndex::cell(lat[i], lon[i])] << i;
+        if (lat[i] < minLat) minLat = lat[i];
+        if (lat[i] > maxLat) maxLat = lat[i];
+        if (lon[i] < minLon) minLon = lon[i];
+        if (lon[i] > maxLon) maxLon = lon[i];
+    }
 
-            // The third decimal place is worth up to 110 m
-            if (ride->getMinPoint(RideFile::lat).toDouble()<segment->getMinLat()+0.001 &&
-                ride->getMaxPoint(RideFile::lat).toDouble()>segment->getMaxLat()-0.001 &&
-                ride->getMinPoint(RideFile::lon).toDouble()<segment->getMinLon()+0.001 &&
-                ride->getMaxPoint(RideFile::lon).toDouble()>segment->getMaxLon()-0.001   )
+    foreach(int routecount, candidates) {
+        RouteSegment *segment = &routes[routecount];
+
+        // The third decimal place is worth up to 110 m
+        if (minLat<segment->getMinLat()+0.001 && maxLat>segment->getMaxLat()-0.001 &&
+            minLon<segment->getMinLon()+0.001 && maxLon>segment->getMaxLon()-0.001) {
+
+            // samples within 100m of the first point, they are
+            // all in the cells around the cell its in
+            RoutePoint first = segment->getPoints().first();
+            QVector<quint32> near;
+            RouteIndex::around(first.lat, first.lon, near);
+            QVector<int> starts;
+            foreach(quint32 c, near) {
+                foreach(int i, cells.value(c))
+                    if (segment->distance(first.lat, first.lon, lat[i], lon[i]) < 0.100) starts << i;
+            }
+            if (starts.isEmpty()) continue;
+            std::sort(starts.begin(), starts.end());
 
-            segment->search(item, ride, here);
+            segment->search(item, ride, starts, here);
         }
     }
 }
@@ -30,6 +30,7 @@
 
 class  RideFile;
 class  Routes;
+class  RouteIndex;
 struct RoutePoint;
 
 class RouteSegment // represents a segment we match against
@@ -60,7 +61,7 @@ class RouteSegment // represents a segment we match against
         double distance(double lat1, double lon1, double lat2, double lon2);
 
         // find segments in ridefiles
-        void search(RideItem *, RideFile*, QList<IntervalItem*>&);
+        void search(RideItem *, RideFile*, const QVector<int> &starts, QList<IntervalItem*>&);
 
     private:
 
@@ -97,6 +98,9 @@ class Routes : public QObject { // top-level object with API and map of segments
         // checksum changes as routes added
         quint16 getFingerprint() const;
 
+        // checksum of the routes that might be in a ride
+        quint16 getFingerprint(const QString &filename);
+
         // managing the list of route segments
         void readRoutes();
         int newRoute(QString name);
@@ -105,6 +109,7 @@ class Routes : public QObject { // top-level object with API and map of segments
         void deleteRoute(int);
         void renameRoute(QUuid identifier, QString newname);
         void writeRoutes();
+        void writeIndex();
 
         // find in a ride
         void search(RideItem*, RideFile* ride, QList<IntervalItem*>&here);
@@ -115,6 +120,7 @@ class Routes : public QObject { // top-level object with API and map of segments
     private:
         QDir home;
         Context *context;
+        RouteIndex *index;
 };
 
 #endif // ROUTE_H
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RouteIndex.h"
+
+#include "Route.h"
+#include "RideFile.h"
+#include "RideFileColumns.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QMutexLocker>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+static const quint32 RouteIndexMagic = 0x58495247; // "GRIX"
+static const quint32 RouteIndexVersion = 1;
+
+// cells are 0.01 degrees, a row is always more than 1km high but a
+// column narrows towards the poles, so how many columns around a point
+// are needed to cover the 100m used when matching routes depends on the
+// latitude
+static const double RouteIndexCells = 100.0;
+static const quint32 RouteIndexColumns = 360 * 100;
+static const double RouteIndexNear = 0.100; // km
+
+RouteIndex::RouteIndex(QString filename) : filename(filename), dirty(false), built(false)
+{
+}
+
+bool
+RouteIndex::valid(double lat, double lon)
+{
+    // as used when matching routes, 180 and 540 are invalid markers
+    return lat != 0 && lon != 0 && ceil(lat) != 180 && ceil(lon) != 180 &&
+           ceil(lat) != 540 && ceil(lon) != 540 &&
+           lat >= -90 && lat <= 90 && lon >= -180 && lon <= 180;
+}
+
+quint32
+RouteIndex::cell(double lat, double lon)
+{
+    quint32 y = floor((lat + 90.0) * RouteIndexCells);
+    quint32 x = floor((lon + 180.0) * RouteIndexCells);
+    return (y << 16) | x;
+}
+
+void
+RouteIndex::around(double lat, double lon, QVector<quint32> &here)
+{
+    // km across a column at this latitude, 1 degree is 111.32km at the equator
+    double width = 111.32 / RouteIndexCells * cos(lat * M_PI / 180.0);
+    int columns = (RouteIndexColumns - 1) / 2; // all of them, once each
+    if (width > 0 && RouteIndexNear / width < columns) columns = ceil(RouteIndexNear / width);
+
+    quint32 c = cell(lat, lon);
+    int y = c >> 16, x = c & 0xffff;
+    for (int dy=-1; dy<=1; dy++) {
+        if (y+dy < 0) continue;
+        for (int dx=-columns; dx<=columns; dx++) {
+            // wrapping around at 180 degrees
+            quint32 wx = (x + dx + RouteIndexColumns) % RouteIndexColumns;
+            here << ((quint32(y+dy) << 16) | wx);
+        }
+    }
+}
+
+bool
+RouteIndex::read()
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (magic != RouteIndexMagic || version != RouteIndexVersion) return false;
+
+    QHash<QString, QVector<quint32> > loaded;
+    stream >> loaded;
+    if (stream.status() != QDataStream::Ok) return false;
+
+    QMutexLocker locker(&mutex);
+    rides = loaded;
+    dirty = false;
+    return true;
+}
+
+bool
+RouteIndex::write()
+{
+    QMutexLocker locker(&mutex);
+    if (!dirty) return true;
+
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug()<<"route index: can't write"<<filename;
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << RouteIndexMagic << RouteIndexVersion << rides;
+
+    if (!file.commit()) {
+        qDebug()<<"route index: can't write"<<filename;
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+QVector<quint32>
+RouteIndex::update(const QString &name, RideFile *ride)
+{
+    QVector<quint32> cells;
+
+    if (ride && ride->isDataPresent(RideFile::lat) && ride->isDataPresent(RideFile::lon)) {
+        QSharedPointer<const RideFileColumns> columns = ride->columns(QList<RideFile::SeriesType>() << RideFile::lat << RideFile::lon);
+        const double *lat = columns->column(RideFile::lat);
+        const double *lon = columns->column(RideFile::lon);
+
+        // consecutive samples are nearly always in the same cell
+        quint32 last = 0xffffffff;
+        for (int i=0; lat && lon && i<columns->count(); i++) {
+            if (!valid(lat[i], lon[i])) continue;
+            quint32 here = cell(lat[i], lon[i]);
+            if (here != last) cells << here;
+            last = here;
+        }
+        std::sort(cells.begin(), cells.end());
+        cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    }
+
+    QMutexLocker locker(&mutex);
+    QHash<QString, QVector<quint32> >::iterator it = rides.find(name);
+    if (it == rides.end() || it.value() != cells) {
+        rides.insert(name, cells);
+        dirty = true;
+    }
+    return cells;
+}
+
+void
+RouteIndex::routesChanged()
+{
+    QMutexLocker locker(&mutex);
+    built = false;
+    starts.clear();
+    ends.clear();
+}
+
+void
+RouteIndex::build(QList<RouteSegment> &routes)
+{
+    starts.clear();
+    ends.resize(routes.count());
+
+    for (int i=0; i<routes.count(); i++) {
+
+        ends[i].clear();
+        QList<RoutePoint> points = routes[i].getPoints();
+        if (points.isEmpty()) continue;
+
+        QVector<quint32> first;
+        around(points.first().lat, points.first().lon, first);
+        foreach(quint32 c, first) starts[c] << i;
+
+        around(points.last().lat, points.last().lon, ends[i]);
+        std::sort(ends[i].begin(), ends[i].end());
+    }
+    built = true;
+}
+
+void
+RouteIndex::lookup(const QVector<quint32> &cells, QList<int> &here) const
+{
+    QVector<bool> seen(ends.count(), false);
+
+    foreach(quint32 c, cells) {
+        QHash<quint32, QVector<int> >::const_iterator it = starts.constFind(c);
+        if (it == starts.constEnd()) continue;
+
+        foreach(int route, it.value()) {
+            if (seen[route]) continue;
+            seen[route] = true;
+
+            // and it goes near the end too
+            foreach(quint32 end, ends[route]) {
+                if (std::binary_search(cells.constBegin(), cells.constEnd(), end)) {
+                    here << route;
+                    break;
+                }
+            }
+        }
+    }
+    std::sort(here.begin(), here.end());
+}
+
+bool
+RouteIndex::candidates(const QString &name, QList<RouteSegment> &routes, QList<int> &here)
+{
+    QMutexLocker locker(&mutex);
+
+    QHash<QString, QVector<quint32> >::const_iterator it = rides.constFind(name);
+    if (it == rides.constEnd()) return false;
+
+    if (!built) build(routes);
+    lookup(it.value(), here);
+    return true;
+}
+
+void
+RouteIndex::candidates(const QVector<quint32> &cells, QList<RouteSegment> &routes, QList<int> &here)
+{
+    QMutexLocker locker(&mutex);
+
+    if (!built) build(routes);
+    lookup(cells, here);
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RouteIndex_h
+#define _GC_RouteIndex_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QVector>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+
+class RideFile;
+class RouteSegment;
+
+// RouteIndex remembers where every ride went, as the grid cells (0.01
+// degrees, about 1km high and narrower away from the equator) its GPS
+// track passes through, and is kept in cache/routes.idx between runs.
+//
+// A route can only be in a ride that passes through the cells around its
+// first and last points, so the routes to search for in a ride, or the
+// rides to search for a new route, are found without opening the ride
+// or looking at its samples. Routes are then matched against the samples
+// of those rides as before, starting from the points close to the start
+// of the route, which are found by only looking at the samples in the
+// cells around it.
+//
+// Rides are indexed when routes are searched for in them, and it is
+// thread safe since that happens in the ride cache refresh threads.
+class RouteIndex
+{
+    public:
+        RouteIndex(QString filename);
+
+        // from and to cache/routes.idx, write only if it changed
+        bool read();
+        bool write();
+
+        // where the ride went, returns the cells
+        QVector<quint32> update(const QString &filename, RideFile *ride);
+
+        // the routes (index into the list) that might be in a ride, returns
+        // false if we don't know where the ride went as it isn't indexed yet
+        bool candidates(const QString &filename, QList<RouteSegment> &routes, QList<int> &here);
+        void candidates(const QVector<quint32> &cells, QList<RouteSegment> &routes, QList<int> &here);
+
+        // routes were added, changed or deleted
+        void routesChanged();
+
+        // the grid
+        static bool valid(double lat, double lon);
+        static quint32 cell(double lat, double lon);
+
+        // the cell and those around it, enough to hold everything within
+        // 100m of the point, so more columns at higher latitudes
+        static void around(double lat, double lon, QVector<quint32> &here);
+
+    private:
+
+        void build(QList<RouteSegment> &routes);
+        void lookup(const QVector<quint32> &cells, QList<int> &here) const;
+
+        QString filename;
+        bool dirty;
+
+        QHash<QString, QVector<quint32> > rides;    // sorted cells by filename
+
+        bool built;
+        QHash<quint32, QVector<int> > starts;       // routes by the cells around their first point
+        QVector<QVector<quint32> > ends;            // cells around the last point of each route
+
+        QMutex mutex;
+};
+
+#endif // _GC_RouteIndex_h
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "SearchIndex.h"
+
+#include "RideItem.h"
+#include "IntervalItem.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QMutexLocker>
+#include <QSet>
+#include <QDebug>
+#include <algorithm>
+
+static const quint32 SearchIndexMagic = 0x58495347; // "GSIX"
+static const quint32 SearchIndexVersion = 1;
+
+SearchIndex::SearchIndex(QString filename) : filename(filename), dirty(false)
+{
+}
+
+QStringList
+SearchIndex::words(const QString &text)
+{
+    QStringList returning;
+    QString folded = text.toCaseFolded();
+
+    int from = -1;
+    for (int i=0; i<=folded.length(); i++) {
+        bool letter = i < folded.length() && folded[i].isLetterOrNumber();
+        if (letter && from < 0) from = i;
+        if (!letter && from >= 0) {
+            returning << folded.mid(from, i-from);
+            from = -1;
+        }
+    }
+    return returning;
+}
+
+bool
+SearchIndex::searchable(const QString &field)
+{
+    // made from the other fields and changes with config
+    return field != "Calendar Text";
+}
+
+quint32
+SearchIndex::signature(RideItem *item)
+{
+    // metadata crc is updated when the ride is refreshed, intervals can
+    // be added or renamed without a refresh so check them too
+    quint32 returning = item->metacrc;
+    foreach(IntervalItem *interval, item->intervals())
+        returning = (returning * 31) + qHash(interval->name);
+    return returning;
+}
+
+bool
+SearchIndex::read()
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (magic != SearchIndexMagic || version != SearchIndexVersion) return false;
+
+    QMap<QString, QVector<int> > p;
+    QVector<QString> f;
+    QVector<QStringList> c;
+    QVector<quint32> s;
+    stream >> p >> f >> c >> s;
+    if (stream.status() != QDataStream::Ok || f.count() != c.count() || f.count() != s.count()) return false;
+
+    QMutexLocker locker(&mutex);
+    postings = p;
+    files = f;
+    contents = c;
+    signatures = s;
+    ids.clear();
+    unused.clear();
+    for (int i=0; i<files.count(); i++) {
+        if (files[i] != "") ids.insert(files[i], i);
+        else unused << i;
+    }
+    dirty = false;
+    return true;
+}
+
+bool
+SearchIndex::write()
+{
+    QMutexLocker locker(&mutex);
+    if (!dirty) return true;
+
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug()<<"search index: can't write"<<filename;
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << SearchIndexMagic << SearchIndexVersion << postings << files << contents << signatures;
+
+    if (!file.commit()) {
+        qDebug()<<"search index: can't write"<<filename;
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+void
+SearchIndex::add(int id, const QStringList &words)
+{
+    foreach(const QString &word, words) {
+        QVector<int> &rides = postings[word];
+        QVector<int>::iterator it = std::lower_bound(rides.begin(), rides.end(), id);
+        if (it == rides.end() || *it != id) rides.insert(it, id);
+    }
+    contents[id] = words;
+}
+
+void
+SearchIndex::drop(int id)
+{
+    foreach(const QString &word, contents[id]) {
+        QMap<QString, QVector<int> >::iterator p = postings.find(word);
+        if (p == postings.end()) continue;
+
+        QVector<int>::iterator it = std::lower_bound(p->begin(), p->end(), id);
+        if (it != p->end() && *it == id) p->erase(it);
+        if (p->isEmpty()) postings.erase(p);
+    }
+    contents[id].clear();
+}
+
+void
+SearchIndex::update(RideItem *item)
+{
+    quint32 sig = signature(item);
+
+    // all the words, once each
+    QStringList all;
+    QMapIterator<QString,QString> meta(item->metadata());
+    while (meta.hasNext()) {
+        meta.next();
+        if (searchable(meta.key())) all << words(meta.value());
+    }
+    foreach(IntervalItem *interval, item->intervals()) all << words(interval->name);
+    all.removeDuplicates();
+
+    QMutexLocker locker(&mutex);
+
+    int id = ids.value(item->fileName, -1);
+    if (id >= 0) {
+        if (signatures[id] == sig && contents[id] == all) return;
+        drop(id);
+    } else {
+        // reuse a free slot if there is one
+        if (!unused.isEmpty()) {
+            id = unused.takeLast();
+        } else {
+            id = files.count();
+            files << QString();
+            contents << QStringList();
+            signatures << 0;
+        }
+        files[id] = item->fileName;
+        ids.insert(item->fileName, id);
+    }
+
+    signatures[id] = sig;
+    add(id, all);
+    dirty = true;
+}
+
+void
+SearchIndex::remove(const QString &name)
+{
+    QMutexLocker locker(&mutex);
+
+    int id = ids.value(name, -1);
+    if (id < 0) return;
+
+    drop(id);
+    files[id] = QString();
+    signatures[id] = 0;
+    ids.remove(name);
+    unused << id;
+    dirty = true;
+}
+
+void
+SearchIndex::sync(const QVector<RideItem*> &rides)
+{
+    QVector<RideItem*> changed;
+    QSet<QString> present;
+
+    mutex.lock();
+    foreach(RideItem *item, rides) {
+        present.insert(item->fileName);
+        int id = ids.value(item->fileName, -1);
+        if (id < 0 || signatures[id] != signature(item)) changed << item;
+    }
+    QStringList gone;
+    foreach(const QString &name, files) if (name != "" && !present.contains(name)) gone << name;
+    mutex.unlock();
+
+    foreach(RideItem *item, changed) update(item);
+    foreach(const QString &name, gone) remove(name);
+}
+
+QVector<int>
+SearchIndex::prefix(const QString &word) const
+{
+    QVector<int> returning;
+
+    // all the words that start with it are together
+    QMap<QString, QVector<int> >::const_iterator it = postings.lowerBound(word);
+    for (; it != postings.constEnd() && it.key().startsWith(word); ++it) returning += it.value();
+
+    std::sort(returning.begin(), returning.end());
+    returning.erase(std::unique(returning.begin(), returning.end()), returning.end());
+    return returning;
+}
+
+QStringList
+SearchIndex::search(const QStringList &tokens)
+{
+    QMutexLocker locker(&mutex);
+
+    QStringList all;
+    foreach(const QString &token, tokens) all << words(token);
+    all.removeDuplicates();
+
+    QStringList returning;
+    if (all.isEmpty()) return returning;
+
+    // shortest (most specific) lists first, so the intersection shrinks fast
+    QVector<QVector<int> > lists;
+    foreach(const QString &word, all) {
+        lists << prefix(word);
+        if (lists.last().isEmpty()) return returning;
+    }
+    std::sort(lists.begin(), lists.end(), [](const QVector<int> &a, const QVector<int> &b) { return a.count() < b.count(); });
+
+    QVector<int> found = lists[0];
+    for (int i=1; i<lists.count() && !found.isEmpty(); i++) {
+        QVector<int> both;
+        std::set_intersection(found.constBegin(), found.constEnd(),
+                              lists[i].constBegin(), lists[i].constEnd(), std::back_inserter(both));
+        found = both;
+    }
+
+    foreach(int id, found) returning << files[id];
+    return returning;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_SearchIndex_h
+#define _GC_SearchIndex_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+#include <QHash>
+#include <QMutex>
+
+class RideItem;
+
+// SearchIndex is an inverted index of the words in the metadata (notes,
+// keywords and so on) and interval names of every ride, for FreeSearch.
+//
+// Words are case folded and map to a sorted list of the rides they are
+// in, kept in a QMap so all the words starting with a prefix are next to
+// each other. A query is the intersection of the rides for each of its
+// words, and the words are prefixes since we search as the user types.
+//
+// Rides are re-indexed when the ride cache refreshes them, which is how
+// saved changes to metadata and intervals come through, and checked
+// against their metadata crc before each search so nothing is missed.
+// It is kept in cache/search.idx between runs.
+class SearchIndex
+{
+    public:
+        SearchIndex(QString filename);
+
+        // from and to cache/search.idx, write only if it changed
+        bool read();
+        bool write();
+
+        // add or refresh a ride, thread safe
+        void update(RideItem *item);
+        void remove(const QString &filename);
+
+        // bring up to date with the rides in the cache
+        void sync(const QVector<RideItem*> &rides);
+
+        // filenames of the rides that have every word in the tokens, as a
+        // prefix of one of their words. Phrases and tokens with punctuation
+        // are split into words, so the rides found still need checking
+        QStringList search(const QStringList &tokens);
+
+        // case folded words in some text
+        static QStringList words(const QString &text);
+
+        // metadata fields that are indexed, and so searched
+        static bool searchable(const QString &field);
+
+    private:
+
+        static quint32 signature(RideItem *item);
+
+        void add(int id, const QStringList &words);
+        void drop(int id);
+        QVector<int> prefix(const QString &word) const;
+
+        QString filename;
+        bool dirty;
+
+        QMap<QString, QVector<int> > postings;      // sorted ride ids by word
+        QVector<QString> files;                     // ride id to filename, empty if free
+        QVector<int> unused;                        // free ride ids
+        QVector<QStringList> contents;              // ride id to its words
+        QVector<quint32> signatures;                // ride id to metacrc and interval names
+        QHash<QString, int> ids;                    // filename to ride id
+
+        QMutex mutex;
+};
+
+#endif // _GC_SearchIndex_h
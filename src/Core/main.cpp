@@ -28,6 +28,7 @@
 #include "PowerProfile.h"
 #include "GcCrashDialog.h" // for versionHTML
 #include "OverviewItems.h"
+#include "CacheRebuild.h"
 
 #include <QApplication>
 #include <QtGui>
@@ -251,6 +252,7 @@ main(int argc, char *argv[])
     QString debugFile = QString();
 
     bool server = false;
+    bool rebuild = false;
     nogui = false;
     bool help = false;
 
@@ -277,6 +279,7 @@ main(int argc, char *argv[])
 #ifdef GC_WANT_HTTP
             fprintf(stderr, "--server            to run as an API server\n");
 #endif
+            fprintf(stderr, "--rebuild           to rebuild the athlete's caches without a gui, report timings and exit\n");
 #ifdef GC_DEBUG
             fprintf(stderr, "--debug             to turn on redirection of messages to goldencheetah.log [debug build]\n");
 #else
@@ -321,6 +324,10 @@ main(int argc, char *argv[])
             exit(1);
 #endif
 
+        } else if (arg == "--rebuild") {
+
+            nogui = rebuild = true;
+
 #ifdef GC_WANT_PYTHON
         } else if (arg == "--no-python") {
 
@@ -648,6 +655,31 @@ main(int argc, char *argv[])
             
         }
 
+        // headless rebuild of the caches for an athlete, then exit
+        if (rebuild) {
+
+            QString cyclist = lastOpened.toString();
+            QString homeDir = home.canonicalPath();
+            if (args.count() < 2 || cyclist == "" || !home.cd(cyclist)) {
+                printf("--rebuild needs an athlete to rebuild, exiting.\n");
+                delete trainDB;
+                terminate(2);
+            }
+
+            appsettings->initializeQSettingsAthlete(homeDir, cyclist);
+            GcUpgrade v3;
+            if (!v3.upgradeConfirmedByUser(home)) {
+                delete trainDB;
+                terminate(2);
+            }
+
+            CacheRebuild rebuilder(home);
+            ret = rebuilder.run();
+
+            delete trainDB;
+            terminate(ret);
+        }
+
 #ifdef GC_WANT_HTTP
 
         // The API server offers webservices (default port 12021, see httpserver.ini)
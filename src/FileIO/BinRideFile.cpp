@@ -19,6 +19,7 @@
 #include "BinRideFile.h"
 #include <QSharedPointer>
 #include <QMap>
+#include <QMutex>
 #include <QSet>
 #include <stdio.h>
 #include <stdint.h>
@@ -127,6 +128,11 @@ struct BinFileReaderState
         file(file), errors(errors), rideFile(NULL), start_time(0),
         interval(0), last_interval_secs(0.0),  stopped(true)
     {
+        // the names are shared, filled by the first reader, imports
+        // open files on the thread pool so the others wait for it
+        static QMutex filling;
+        QMutexLocker locker(&filling);
+
         if (global_record_types.isEmpty()) {
             global_record_types.insert(RECORD_TYPE__META,  "Meta Data");
             global_record_types.insert(RECORD_TYPE__RIDE_DATA,  "1 sec detail ride data");
@@ -769,15 +775,15 @@ struct BinFileReaderState
                 }
             }*/
             foreach(int num, unexpected_record_types) {
-                errors << QString("unexpected record type %1 (%2)\n").arg(global_record_types[num]).arg(num);
+                errors << QString("unexpected record type %1 (%2)\n").arg(global_record_types.value(num)).arg(num);
             }
             foreach(QSet<int> set, unexpected_format_identifiers_for_record_types) {
                 foreach(int num, set) {
                     int record_type = unexpected_format_identifiers_for_record_types.keys(set).takeFirst();
                     errors << QString("unexpected format identifier \"%1\" (%2) in \"%3\" (%4)\n")
-                            .arg(global_format_identifiers[num].toLatin1().constData())
+                            .arg(global_format_identifiers.value(num).toLatin1().constData())
                             .arg(num)
-                            .arg(global_record_types[record_type].toLatin1().constData())
+                            .arg(global_record_types.value(record_type).toLatin1().constData())
                             .arg(record_type);
                 }
             }
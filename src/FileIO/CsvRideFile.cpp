@@ -99,7 +99,7 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
     bool metric = true;
     enum temperature { degF, degC, degNone };
     typedef enum temperature Temperature;
-    static Temperature tempType = degNone;
+    Temperature tempType = degNone;
     QDateTime startTime, iBikeTime;
 
     // Minutes,Torq (N-m),Km/h,Watts,Km,Cadence,Hrate,ID
@@ -1524,16 +1524,23 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
 }
 
 bool
-CsvFileReader::writeRideFile(Context *, const RideFile *ride, QFile &file, CsvType format) const
+CsvFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file, CsvType format) const
 {
     if (!file.open(QIODevice::WriteOnly)) return(false);
+    bool ok = streamRideFile(context, ride, file, format);
+    file.close();
+    return ok;
+}
 
+bool
+CsvFileReader::streamRideFile(Context *, const RideFile *ride, QIODevice &device, CsvType format) const
+{
     // always save CSV in metric format
     bool bIsMetric = true;
 
     // Use the column headers that make WKO+ happy.
     double convertUnit;
-    QTextStream out(&file);
+    QTextStream out(&device);
 
     if (format == gc) {
         // CSV File header
@@ -1644,6 +1651,6 @@ CsvFileReader::writeRideFile(Context *, const RideFile *ride, QFile &file, CsvTy
         }
     }
 
-    file.close();
-    return true;
+    out.flush();
+    return out.status() == QTextStream::Ok;
 }
@@ -34,6 +34,11 @@ struct CsvFileReader : public RideFileReader {
 
     // write but able to select format
     bool writeRideFile(Context *context, const RideFile *ride, QFile &file, CsvType format) const;
+
+    // same again, but to any open sink
+    bool streamRideFile(Context *context, const RideFile *ride, QIODevice &out) const
+    { return streamRideFile(context, ride, out, powertap); }
+    bool streamRideFile(Context *context, const RideFile *ride, QIODevice &out, CsvType format) const;
     bool hasWrite() const { return true; }
 };
 
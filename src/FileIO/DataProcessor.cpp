@@ -106,6 +106,9 @@ DataProcessorFactory::autoProcess(RideFile *ride, QString mode, QString op)
             i.value()->postProcess(ride, NULL, op);
     }
 
+    // processors write the samples directly
+    ride->invalidateColumns();
+
     return changed;
 }
 
@@ -171,6 +174,7 @@ ManualDataProcessorDialog::okClicked()
     QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
 
     if (ride && ride->ride() && processor->postProcess((RideFile *)ride->ride(), config, "UPDATE") == true) {
+        ((RideFile *)ride->ride())->invalidateColumns();
         context->notifyRideSelected(ride);     // to remain compatible with rest of GC for now
     }
 
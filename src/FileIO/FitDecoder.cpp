@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "FitDecoder.h"
+
+#include <QString>
+#include <cstring>
+
+fit_float_value
+FitDecoder::float32(bool big)
+{
+    float f;
+    memcpy(&f, next(4), 4);
+    if (big) f = qbswap(f);
+    return f;
+}
+
+fit_string_value
+FitDecoder::text(int len)
+{
+    const uchar *here = next(len);
+    fit_string_value res = "";
+    for (int i = 0; i < len; ++i) if (here[i] != 0) res += char(here[i]);
+    return res;
+}
+
+fit_value_t
+FitDecoder::read(int decode, bool big)
+{
+    switch (decode) {
+    case UInt8: return uint8();
+    case Int8: return int8();
+    case Byte: return byte();
+    case UInt8z: return uint8z();
+    case Int16: return int16(big);
+    case UInt16: return uint16(big);
+    case UInt16z: return uint16z(big);
+    case Int32: return int32(big);
+    case UInt32: return uint32(big);
+    case UInt32z: return uint32z(big);
+    case Float32: return fit_value_t(float32(big));
+    default: return NA_VALUE;
+    }
+}
+
+//
+// The FIT header is either
+//
+// 12 bytes long- for the original FIT file protocol
+// 14 bytes long- for the current FIT file protocol (includes a header CRC)
+// >14 bytes long- it is for a later protocol
+//
+bool
+FitDecoder::header(int &data_size, QStringList &errors)
+{
+    bool ok = true;
+    try {
+
+        // make sure its 12 or 14 bytes long as that's all we know about
+        int header_size = uint8();
+        if (header_size != 12 && header_size != 14) {
+            errors << QString("bad header size: %1 (we only support 12 or 14)").arg(header_size);
+            ok = false;
+        }
+
+        uint8(); // protocol version
+        uint16(false); // profile version, always littleEndian
+
+        // length of data section excluding the header and trailing CRC record
+        data_size = uint32(false); // always littleEndian
+
+        // the chars ".FIT"
+        if (!has(4)) {
+            errors << "truncated header";
+            return false;
+        }
+        QString magic = QString::fromLatin1(reinterpret_cast<const char*>(next(4)), 4);
+        if (magic != ".FIT") {
+            errors << QString("bad header, expected \".FIT\" but got \"%1\"").arg(magic);
+            ok = false;
+        }
+
+        // header crc is optional so we don't check it
+        if (header_size == 14) uint16(false);
+
+    } catch (TruncatedRead &) {
+        errors << "truncated file header";
+        return false;
+    }
+    return ok;
+}
+
+//
+// A local message definition is comprised:
+//
+// Byte 1           Reserved (ignored)
+//      2           Architecture 0- little-endian 1- big endian
+//      3-4         Global Message Nunber (for semantics)
+//      5           Number of fields that follow (n)
+//      6 onwards   n x Field Definitions (number, size, base type)
+//
+// followed by developer fields if flagged in the header byte
+//
+//      1           Number of developer fields (m)
+//      2 onwards   m x Developer Field Definitions (number, size, developer id)
+//
+void
+FitDecoder::definition(int header_byte, FitMessage &def)
+{
+    def.local_msg_num = header_byte & 0xf;
+    def.fields.clear();
+
+    uint8(); // reserved
+    def.is_big_endian = uint8();
+    def.global_msg_num = uint16(def.is_big_endian);
+
+    int num_fields = uint8();
+    for (int i = 0; i < num_fields; ++i) {
+        FitField field = FitField();
+        field.num = uint8();
+        field.size = byte();
+        field.type = uint8() & 0x1F; // endianness bit and reserved bits masked off
+        field.deve_idx = -1;
+        def.fields.push_back(field);
+    }
+
+    if ((header_byte & 0x20) == 0x20) {
+        int num_fields = uint8();
+        for (int i = 0; i < num_fields; ++i) {
+            FitField field = FitField();
+            field.num = uint8();
+            field.size = byte();
+            field.deve_idx = uint8();
+            field.type = -1; // from the developer field description
+            def.fields.push_back(field);
+        }
+    }
+    layout(def);
+}
+
+// lists are sized by the field, anything else is a single value where
+// the extra bytes, if any, are skipped
+static void
+layoutAs(FitField &field, int decode, int width, bool list)
+{
+    field.decode = decode;
+    if (list) {
+        field.count = field.size / width;
+        field.skip = 0;
+    } else {
+        field.count = -1;
+        field.skip = field.size > width ? field.size - width : 0;
+    }
+}
+
+void
+FitDecoder::layout(FitMessage &def)
+{
+    def.size = 0;
+    for (size_t i = 0; i < def.fields.size(); i++) {
+        FitField &field = def.fields[i];
+        layout(field);
+
+        int width = 0;
+        switch (field.decode) {
+        case UInt8: case Int8: case Byte: case UInt8z: width = 1; break;
+        case Int16: case UInt16: case UInt16z: width = 2; break;
+        case Int32: case UInt32: case UInt32z: case Float32: width = 4; break;
+        case Text: width = field.size; break;
+        }
+
+        // single values are read whole even if the field says it is smaller
+        if (field.count >= 0) def.size += field.count * width;
+        else def.size += width + field.skip;
+    }
+}
+
+void
+FitDecoder::layout(FitField &field)
+{
+    switch (field.type) {
+
+    // enum, uint8 and uint8z, lists if bigger
+    case 0:
+    case 2: layoutAs(field, UInt8, 1, field.size != 1); break;
+    case 10: layoutAs(field, UInt8z, 1, field.size != 1); break;
+
+    // signed and zero invalid types are always single values
+    case 1: layoutAs(field, Int8, 1, false); break;
+    case 3: layoutAs(field, Int16, 2, false); break;
+    case 5: layoutAs(field, Int32, 4, false); break;
+    case 11: layoutAs(field, UInt16z, 2, false); break;
+    case 12: layoutAs(field, UInt32z, 4, false); break;
+
+    // uint16, list if bigger
+    case 4: layoutAs(field, UInt16, 2, field.size != 2); break;
+
+    // uint32, some devices (eg Coros Pace 2) declare it with size 1 or 2
+    case 6:
+        if (field.size == 1) layoutAs(field, UInt8, 1, false);
+        else if (field.size == 2) layoutAs(field, UInt16, 2, false);
+        else if (field.size >= 4) layoutAs(field, UInt32, 4, field.size != 4);
+        else {
+            field.decode = Skip;
+            field.count = -1;
+            field.skip = field.size;
+        }
+        break;
+
+    // string
+    case 7: field.decode = Text; field.count = -1; field.skip = 0; break;
+
+    // 32bit float, list if bigger
+    case 8: layoutAs(field, Float32, 4, field.size != 4); break;
+
+    // bytes, always a list
+    case 13: layoutAs(field, Byte, 1, true); break;
+
+    // 64 bit floats and integers are not yet implemented, nor are types
+    // we don't know so we just skip over them
+    default:
+        field.decode = Unknown;
+        field.count = -1;
+        field.skip = field.size;
+        break;
+    }
+}
+
+void
+FitDecoder::values(const FitMessage &def, std::vector<FitValue> &values)
+{
+    // its all there or none of it is
+    if (!has(def.size)) throw TruncatedRead();
+
+    bool big = def.is_big_endian;
+    values.reserve(def.fields.size());
+
+    for (size_t i = 0; i < def.fields.size(); i++) {
+        const FitField &field = def.fields[i];
+
+        // floats are in 'f', integers are in 'v' and strings are in 's'
+        FitValue value;
+        if (field.count >= 0) {
+            value.type = ListValue;
+            for (int j = 0; j < field.count; j++) value.list.append(read(field.decode, big));
+        } else {
+            switch (field.decode) {
+            case Text:
+                value.type = StringValue;
+                value.s = text(field.size);
+                break;
+
+            case Float32:
+                value.type = FloatValue;
+                value.f = float32(big);
+                if (value.f != value.f) value.f = 0; // No NAN
+                break;
+
+            case Unknown:
+            case Skip:
+                value.type = SingleValue;
+                value.v = NA_VALUE;
+                break;
+
+            default:
+                value.type = SingleValue;
+                value.v = read(field.decode, big);
+                break;
+            }
+        }
+        pos += field.skip;
+        values.push_back(value);
+    }
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef _GC_FitDecoder_h
+#define _GC_FitDecoder_h 1
+
+#include <QtGlobal>
+#include <QtEndian>
+#include <QList>
+#include <QStringList>
+#include <limits>
+#include <string>
+#include <vector>
+
+/* FIT has uint32 as largest integer type. So qint64 is large enough to
+ * store all integer types - no matter if they're signed or not */
+
+// this will need to change if float or other non-integer values are
+// introduced into the file format *FIXME*
+typedef qint64 fit_value_t;
+
+#define NA_VALUE std::numeric_limits<fit_value_t>::max()
+#define NA_VALUEF  (double)(0xFFFFFFFF)
+
+typedef std::string fit_string_value;
+typedef float fit_float_value;
+
+struct FitField {
+    int num;
+    int type; // FIT base_type
+    int size; // in bytes
+    int deve_idx; // Developer Data Index
+
+    // how to decode it, worked out once by FitDecoder::layout()
+    int decode; // FitDecoder::Decode
+    int count; // values in a list, -1 for a single value
+    int skip; // bytes left over after the value(s)
+};
+
+struct FitMessage {
+    int global_msg_num;
+    int local_msg_num;
+    bool is_big_endian;
+    int size; // bytes in a data message
+    std::vector<FitField> fields;
+};
+
+enum fitValueType { SingleValue, ListValue, FloatValue, StringValue };
+typedef enum fitValueType FitValueType;
+
+struct FitValue
+{
+    FitValueType type;
+    fit_value_t v;
+    fit_string_value s;
+    fit_float_value f;
+    QList<fit_value_t> list;
+    int size;
+};
+
+// FitDecoder reads FIT protocol records from a file held in memory, it
+// is mapped or read in one go rather than a QFile::read() for every field.
+//
+// Definition messages are decoded into a FitMessage and each field is
+// laid out there and then, so decoding the data messages that follow is
+// just a walk along the fields with no decisions about sizes and types.
+//
+// The base type readers return NA_VALUE for the FIT invalid values and
+// throw TruncatedRead if we run off the end of the file.
+//
+// This is just the protocol, FitFileParser in FitRideFile.cpp works out what
+// the messages mean. The benchmark in test/benchmark/fit uses it on its own.
+class FitDecoder
+{
+    public:
+
+        struct TruncatedRead {};
+
+        enum decode { Unknown=0, Skip, UInt8, Int8, Byte, UInt8z, Int16, UInt16, UInt16z,
+                      Int32, UInt32, UInt32z, Float32, Text };
+        typedef enum decode Decode;
+
+        FitDecoder() : data(NULL), length(0), pos(0) {}
+
+        // the file contents, must stay put whilst decoding
+        void setData(const uchar *data, qint64 length) { this->data = data; this->length = length; pos = 0; }
+
+        qint64 position() const { return pos; }
+        bool atEnd() const { return pos >= length; }
+        bool has(qint64 bytes) const { return length - pos >= bytes; }
+        void skip(qint64 bytes) { if (!has(bytes)) throw TruncatedRead(); pos += bytes; }
+
+        // base types
+        fit_value_t int8() { qint8 i = qint8(next(1)[0]); return i == 0x7f ? NA_VALUE : i; }
+        fit_value_t uint8() { quint8 i = next(1)[0]; return i == 0xff ? NA_VALUE : i; }
+        fit_value_t byte() { return next(1)[0]; }
+        fit_value_t uint8z() { quint8 i = next(1)[0]; return i == 0x00 ? NA_VALUE : i; }
+        fit_value_t int16(bool big) { qint16 i = big ? qFromBigEndian<qint16>(next(2)) : qFromLittleEndian<qint16>(next(2)); return i == 0x7fff ? NA_VALUE : i; }
+        fit_value_t uint16(bool big) { quint16 i = big ? qFromBigEndian<quint16>(next(2)) : qFromLittleEndian<quint16>(next(2)); return i == 0xffff ? NA_VALUE : i; }
+        fit_value_t uint16z(bool big) { quint16 i = big ? qFromBigEndian<quint16>(next(2)) : qFromLittleEndian<quint16>(next(2)); return i == 0x0000 ? NA_VALUE : i; }
+        fit_value_t int32(bool big) { qint32 i = big ? qFromBigEndian<qint32>(next(4)) : qFromLittleEndian<qint32>(next(4)); return i == 0x7fffffff ? NA_VALUE : i; }
+        fit_value_t uint32(bool big) { quint32 i = big ? qFromBigEndian<quint32>(next(4)) : qFromLittleEndian<quint32>(next(4)); return i == 0xffffffff ? NA_VALUE : i; }
+        fit_value_t uint32z(bool big) { quint32 i = big ? qFromBigEndian<quint32>(next(4)) : qFromLittleEndian<quint32>(next(4)); return i == 0x00000000 ? NA_VALUE : i; }
+        fit_float_value float32(bool big);
+        fit_string_value text(int len);
+
+        // the 12 or 14 byte file header, false with errors if we can't go on
+        bool header(int &data_size, QStringList &errors);
+
+        // a definition message following its header byte, developer fields
+        // get their type from a field description message so the caller must
+        // set it and then call layout()
+        void definition(int header_byte, FitMessage &def);
+
+        // a data message for def, a value for each field
+        void values(const FitMessage &def, std::vector<FitValue> &values);
+
+        // decode, count and skip for each field and the size of a data message
+        static void layout(FitMessage &def);
+        static void layout(FitField &field);
+
+    private:
+
+        const uchar *next(int bytes) {
+            if (length - pos < bytes) throw TruncatedRead();
+            const uchar *here = data + pos;
+            pos += bytes;
+            return here;
+        }
+        fit_value_t read(int decode, bool big);
+
+        const uchar *data;
+        qint64 length, pos;
+};
+
+#endif // _GC_FitDecoder_h
@@ -28,6 +28,7 @@
 #include "GcUpgrade.h" // for VERSION_CONFIG_PREFIX
 #include <QSharedPointer>
 #include <QMap>
+#include <QMutex>
 #include <QSet>
 #include <QtEndian>
 #include <QDebug>
@@ -96,10 +97,14 @@ QList<FitFieldDefinition> FITstandardfields;
 QStringList GenericDecodeList;
 
 // load the FITmetadata file, called the first time a FIT file
-// is parsed, so may not ever be called by the user
-bool loaded=false;
+// is parsed, so may not ever be called by the user. Imports parse
+// on the thread pool, the first caller loads and the others wait
+static QMutex loading;
+static bool loaded=false;
 static void loadMetadata()
 {
+    QMutexLocker locker(&loading);
+
     // only do it the first time
     if (loaded) return;
     loaded=true;
@@ -427,6 +432,7 @@ struct FitFileParser
     // this is ripe for refactoring. *FIXME*
     //
     QFile &file;
+    FitDecoder in; // reads the file contents from memory
     QStringList &errors;
     RideFile *rideFile;
     time_t start_time;
@@ -491,16 +497,10 @@ struct FitFileParser
 
     // yay, lets crash the whole fucking program if the reader
     // has problems. sheesh. this is definitely a *FIXME*
-    struct TruncatedRead {};
-    void read_unknown( int size, int *count = NULL ) {
-        if (!file.seek(file.pos() + size))
-            throw TruncatedRead();
-        if (count)
-            (*count) += size;
-    }
+    typedef FitDecoder::TruncatedRead TruncatedRead;
 
     //
-    // FIT DATA TYPE READERS
+    // FIT DATA TYPES
     //
     // The FIT protocol is very focused on strongly typed data
     // that must be read/written quite particularly and the
@@ -513,22 +513,10 @@ struct FitFileParser
     // timestamps are date_time types in the docs but
     // they map to the uint32 base type.
     //
-    // This section of the code contains all the readers
-    //              read_text
-    //              read_uint8
-    //              read_byte
-    //              read_uint8z
-    //              read_int16
-    //              read_uint16
-    //              read_uint16z
-    //              read_int32
-    //              read_uint32
-    //              read_uint32z
-    //
-    // There are 16 base types and not all are represented
-    // in our code, this should be fixed (e.g. floats)
+    // The base types are read by FitDecoder (see FitDecoder.h)
+    // from the file contents in memory.
     //
-    // Additionally there are some functions here for
+    // This section of the code contains some functions for
     // working with semantic types:
     //
     //              getSport
@@ -537,161 +525,6 @@ struct FitFileParser
     //              getSubSportId
     //
 
-    // base types
-
-    fit_string_value read_text(int len, int *count = NULL) {
-        char c;
-        fit_string_value res = "";
-        for (int i = 0; i < len; ++i) {
-            if (file.read(&c, 1) != 1)
-                throw TruncatedRead();
-            if (count)
-                *count += 1;
-
-            if (c != 0)
-                res += c;
-        }
-        return res;
-    }
-
-    fit_value_t read_int8(int *count = NULL) {
-        qint8 i;
-        if (file.read(reinterpret_cast<char*>( &i), 1) != 1)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 1;
-
-        return i == 0x7f ? NA_VALUE : i;
-    }
-
-    fit_value_t read_uint8(int *count = NULL) {
-        quint8 i;
-        if (file.read(reinterpret_cast<char*>( &i), 1) != 1)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 1;
-
-        return i == 0xff ? NA_VALUE : i;
-    }
-
-    fit_value_t read_byte(int *count = NULL) {
-        quint8 i;
-        if (file.read(reinterpret_cast<char*>( &i), 1) != 1)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 1;
-
-        return i;
-    }
-
-    fit_value_t read_uint8z(int *count = NULL) {
-        quint8 i;
-        if (file.read(reinterpret_cast<char*>( &i), 1) != 1)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 1;
-
-        return i == 0x00 ? NA_VALUE : i;
-    }
-
-    fit_value_t read_int16(bool is_big_endian, int *count = NULL) {
-        qint16 i;
-        if (file.read(reinterpret_cast<char*>(&i), 2) != 2)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 2;
-
-        i = is_big_endian
-            ? qFromBigEndian<qint16>( i )
-            : qFromLittleEndian<qint16>( i );
-
-        return i == 0x7fff ? NA_VALUE : i;
-    }
-
-    fit_value_t read_uint16(bool is_big_endian, int *count = NULL) {
-        quint16 i;
-        if (file.read(reinterpret_cast<char*>(&i), 2) != 2)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 2;
-
-        i = is_big_endian
-            ? qFromBigEndian<quint16>( i )
-            : qFromLittleEndian<quint16>( i );
-
-        return i == 0xffff ? NA_VALUE : i;
-    }
-
-    fit_value_t read_uint16z(bool is_big_endian, int *count = NULL) {
-        quint16 i;
-        if (file.read(reinterpret_cast<char*>(&i), 2) != 2)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 2;
-
-        i = is_big_endian
-            ? qFromBigEndian<quint16>( i )
-            : qFromLittleEndian<quint16>( i );
-
-        return i == 0x0000 ? NA_VALUE : i;
-    }
-
-    fit_value_t read_int32(bool is_big_endian, int *count = NULL) {
-        qint32 i;
-        if (file.read(reinterpret_cast<char*>(&i), 4) != 4)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 4;
-
-        i = is_big_endian
-            ? qFromBigEndian<qint32>( i )
-            : qFromLittleEndian<qint32>( i );
-
-        return i == 0x7fffffff ? NA_VALUE : i;
-    }
-
-    fit_value_t read_uint32(bool is_big_endian, int *count = NULL) {
-        quint32 i;
-        if (file.read(reinterpret_cast<char*>(&i), 4) != 4)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 4;
-
-        i = is_big_endian
-            ? qFromBigEndian<quint32>( i )
-            : qFromLittleEndian<quint32>( i );
-
-        return i == 0xffffffff ? NA_VALUE : i;
-    }
-
-    fit_value_t read_uint32z(bool is_big_endian, int *count = NULL) {
-        quint32 i;
-        if (file.read(reinterpret_cast<char*>(&i), 4) != 4)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 4;
-
-        i = is_big_endian
-            ? qFromBigEndian<quint32>( i )
-            : qFromLittleEndian<quint32>( i );
-
-        return i == 0x00000000 ? NA_VALUE : i;
-    }
-
-    fit_float_value read_float32(bool is_big_endian, int *count = NULL) {
-        float f;
-        if (file.read(reinterpret_cast<char*>(&f), 4) != 4)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 4;
-
-        if (is_big_endian) {
-            f = qbswap(f);
-        }
-
-        return f;
-    }
-
     // semantic types
 
     static QString getSport(quint8 sport_id) {
@@ -3910,57 +3743,7 @@ genericnext:
     //
     void read_header(bool &stop, QStringList &errors, int &data_size) {
 
-        stop = false;
-        try {
-
-            // read the header- make sure its 12 or 14 bytes long as that's all we know about
-            int header_size = read_uint8();
-            if (header_size != 12 && header_size != 14) {
-                errors << QString("bad header size: %1 (we only support 12 or 14)").arg(header_size);
-                stop = true;
-            }
-
-            // protocol version should be 1 or 2
-            int protocol_version = read_uint8();
-            (void) protocol_version;
-
-            // if the header size is 14 we have profile minor then profile major
-            // version. We still don't do anything with this information
-            int profile_version = read_uint16(false); // always littleEndian
-            (void) profile_version;
-            //qDebug() << "profile_version" << profile_version/100.0; // not sure what to do with this
-
-            // we always start with version info if debug is on
-            if (FIT_DEBUG) fprintf(stderr, "FIT Protocol Version %d, Profile Version %d\n", protocol_version, profile_version);
-
-            // length of data section excluding the header and trailing CRC record
-            data_size = read_uint32(false); // always littleEndian
-
-            // the chars ".FIT" for no other reason than it appears if you open
-            // the file in a text editor (they haven't heard of magic numbers)
-            char fit_str[5];
-            if (file.read(fit_str, 4) != 4) {
-                errors << "truncated header";
-                stop = true;
-            }
-            fit_str[4] = '\0';
-            if (strcmp(fit_str, ".FIT") != 0) {
-                errors << QString("bad header, expected \".FIT\" but got \"%1\"").arg(fit_str);
-                stop = true;
-            }
-
-            // read the rest of the header
-            int header_crc=0;
-            if (header_size == 14) {
-                header_crc = read_uint16(false);
-            }
-            Q_UNUSED(header_crc); // we don't check since its optional anyway
-
-        } catch (TruncatedRead &e) {
-            Q_UNUSED(e)
-            errors << "truncated file header";
-            stop = true;
-        }
+        stop = !in.header(data_size, errors);
     }
 
     //
@@ -3973,7 +3756,7 @@ genericnext:
     int read_record(bool &stop, QStringList &errors) {
 
         stop = false;
-        int count = 0;
+        qint64 start = in.position();
 
         // the header byte tells us what kind of record we are parsing
         //
@@ -3983,7 +3766,7 @@ genericnext:
         //     4        0x10            Reserved (should be ignored)
         //     0-3      0x0F (mask)     Local Message Number (also referred to as type)
         //
-        int header_byte = read_uint8(&count);
+        int header_byte = in.uint8();
 
         // For some reason the header byte is being parsed differently inside this if clause
         // this makes no sense but will not fix at this point *FIXME*
@@ -3998,9 +3781,6 @@ genericnext:
             // lets get the local message number
             int local_msg_num = header_byte & 0xf;
 
-            // Do we also have developer fields in this definition ?
-            bool hasDeveloperFields = (header_byte & 0x20) == 0x20 ;
-
             // If the definition already exists it will be replaced
             // with a blank new one, so re-defining as we go
             local_msg_types.insert(local_msg_num, FitMessage());
@@ -4008,94 +3788,33 @@ genericnext:
             // We get a reference to the newly created message definition to work with
             FitMessage &def = local_msg_types[local_msg_num];
 
-            //
-            // A local message definition is comprised:
-            //
-            // Byte 1           Reserved (ignored)
-            //      2           Architecture 0- little-endian 1- big endian
-            //      3-4         Global Message Nunber (for semantics)
-            //      5           Number of fields that follow (n)
-            //
-            //      6 onwards   n x Field Definitions
-            //
-            int reserved = read_uint8(&count); (void) reserved; // unused
-            def.is_big_endian = read_uint8(&count);
-            def.global_msg_num = read_uint16(def.is_big_endian, &count);
-            def.local_msg_num = local_msg_num;
-            int num_fields = read_uint8(&count);
-
-            if (FIT_DEBUG && FIT_DEBUG_LEVEL>0)  fprintf(stderr, "message definition: local=%d global=%d (%s) big endian=%d fields=%d\n",
-                                                                 def.local_msg_num, def.global_msg_num, fitMessageDesc(def.global_msg_num, false).toStdString().c_str(),
-                                                                 def.is_big_endian, num_fields );
+            // the fields and how to decode them, see FitDecoder::definition()
+            in.definition(header_byte, def);
 
+            // developer fields are referenced by developer id and field number, the
+            // definition is parsed as a separate message type (206) earlier on.
+            // See decodeDeveloperID and decodeDeveloperFieldDescription() for the details
+            for (size_t i = 0; i < def.fields.size(); ++i) {
+                FitField &field = def.fields[i];
+                if (field.deve_idx < 0) continue;
 
-            //
-            // Run through the field definitions that follow, comprised of
-            //
-            // Byte 1           Field Number
-            //      2           Field Size (also inferred from the base type next)
-            //      3           Base Type (see defn below)
-            //
-            // Base Type is comprised:
-            //
-            // Bit 7     0x80           Endianness (0- for single byte data, 1 for multi-byte)
-            //     5-6   0x60 (mask)    Reserved (ignored)
-            //     0-4   0x1F (mask)    Base type (max 32 types currently 17 defined in specs see FITBaseTypes above)
-            //
-            for (int i = 0; i < num_fields; ++i) {
-
-                def.fields.push_back(FitField());
-                FitField &field = def.fields.back();
-
-                field.num = read_uint8(&count);
-                field.size = read_uint8(&count);
-                int base_type = read_uint8(&count);
-                field.type = base_type & 0x1F;
-                field.deve_idx = -1;
-
-                if (FIT_DEBUG && FIT_DEBUG_LEVEL>3)  fprintf(stderr, "  field %d: %d bytes, num %d, type %d, size %d\n",
-                                                                     i, field.size, field.num, field.type, field.size );
+                QString key = QString("%1.%2").arg(field.deve_idx).arg(field.num);
+                FitFieldDefinition devField = local_deve_fields[key];
+                field.type = devField.type;
             }
+            FitDecoder::layout(def);
 
-            // Once all the standard field definitions have been read they will be followed
-            // by optional developer fields, these are indicated in the header (see
-            // hasDeveloperFields above)
-            //
-            //      1           Number of developer fields (m)
-            //      2           m x Developer Field Definitions if flag set in header
-            //
-            if (hasDeveloperFields) {
-
-                // first byte is the number of fields defined
-                int num_fields = read_uint8(&count);
-
-                //
-                // Run through the developer field references that follow, comprised of
-                //
-                // Byte 1           Developer Field Number
-                //      2           Field Size (also inferred from the base type next)
-                //      3           Developer ID (they start from 0)
-                //
-                // NOTE: the developer ID and field is not defined here, it is referenced by developer id
-                //       and field number. The definition is parsed as a separate message type (206).
-                //       See decodeDeveloperID and decodeDeveloperFieldDescription() for the details
-                //
-                for (int i = 0; i < num_fields; ++i) {
-
-                    def.fields.push_back(FitField());
-                    FitField &field = def.fields.back();
-
-                    field.num = read_uint8(&count);
-                    field.size = read_uint8(&count);
-                    field.deve_idx = read_uint8(&count);
+            // types we don't know are skipped
+            foreach(const FitField &field, def.fields)
+                if (field.decode == FitDecoder::Unknown) unknown_base_type.insert(field.type);
 
-                    QString key = QString("%1.%2").arg(field.deve_idx).arg(field.num);
-                    FitFieldDefinition devField = local_deve_fields[key];
-                    field.type = devField.type;
+            if (FIT_DEBUG && FIT_DEBUG_LEVEL>0)  fprintf(stderr, "message definition: local=%d global=%d (%s) big endian=%d fields=%d\n",
+                                                                 def.local_msg_num, def.global_msg_num, fitMessageDesc(def.global_msg_num, false).toStdString().c_str(),
+                                                                 def.is_big_endian, int(def.fields.size()));
 
-                    if (FIT_DEBUG && FIT_DEBUG_LEVEL>3)  fprintf(stderr, "  developer field %d: %d bytes, num %d, type %s, size %d\n",
-                                                                            i, field.size, field.num, fitBaseTypeDesc(field.type).toStdString().c_str(), field.size);
-                }
+            if (FIT_DEBUG && FIT_DEBUG_LEVEL>3) {
+                foreach(const FitField &field, def.fields)
+                    fprintf(stderr, "  field num %d, type %d, size %d, developer %d\n", field.num, field.type, field.size, field.deve_idx);
             }
 
         } else {
@@ -4134,7 +3853,7 @@ genericnext:
             if (!local_msg_types.contains(local_msg_num)) {
                 errors << QString("local type %1 without previous definition").arg(local_msg_num);
                 stop = true;
-                return count;
+                return in.position() - start;
             }
 
             // lets get the previously stored definition
@@ -4144,190 +3863,10 @@ genericnext:
                                                                    local_msg_num, def.global_msg_num, time_offset ); }
 
 
-            // now we just work through the definition and extract the field values
-            // from the file directly
+            // now we just work through the definition and extract the field values,
+            // FitDecoder checks for FIT NA values and sets them to NA_VALUE
             std::vector<FitValue> values;
-            foreach(const FitField &field, def.fields) {
-
-                // we store the value into a struct that has members
-                // for all the fit base types- so floats are in 'f' and
-                // integers are in 'v' and strings are in 's'
-                FitValue value;
-                int size;
-
-                // see FITbasetypes at the top of the file for the basic types
-                // that are supported. Note that the read_XXXX routines will
-                // check for FIT NA values and set to NA_VALUE where needed
-                //
-                // It is worth noting that size > the sizeof(type) indicates
-                // a list or array of values
-                switch (field.type) {
-
-                    // Enumerated type (8 bit)
-                    case 0: size = 1;
-
-                            if (field.size==size) {
-                                value.type = SingleValue; value.v = read_uint8(&count);;
-                             } else { // Multi-values
-                                value.type = ListValue;
-                                value.list.clear();
-                                for (int i=0;i<field.size/size;i++) {
-                                    value.list.append(read_uint8(&count));
-                                }
-                                size = field.size;
-                            }
-                            break;
-
-                    // Signed Int 8bit
-                    case 1: value.type = SingleValue; value.v = read_int8(&count); size = 1;  break;
-
-
-                    // Unsigned Int 8bit
-                    case 2: size = 1;
-                            if (field.size==size) {
-                                value.type = SingleValue; value.v = read_uint8(&count);
-                            } else { // Multi-values
-                                value.type = ListValue;
-                                value.list.clear();
-                                for (int i=0;i<field.size/size;i++) {
-                                    value.list.append(read_uint8(&count));
-                                }
-                                size = field.size;
-                            }
-                            break;
-
-                    // Signed Int 16
-                    case 3: value.type = SingleValue; value.v = read_int16(def.is_big_endian, &count); size = 2;  break;
-
-                    // Unsigned Int 16
-                    case 4: size = 2;
-                            if (field.size==size) {
-                                value.type = SingleValue; value.v = read_uint16(def.is_big_endian, &count);
-                            } else { // Multi-values
-                                value.type = ListValue;
-                                value.list.clear();
-                                for (int i=0;i<field.size/size;i++) {
-                                    value.list.append(read_uint16(def.is_big_endian, &count));
-                                }
-                                size = field.size;
-                            }
-                            break;
-
-                    // Signed Int 32
-                    case 5: value.type = SingleValue; value.v = read_int32(def.is_big_endian, &count); size = 4;  break;
-
-                    // Unsigned Int 32
-                    case 6: size = 4;
-                            if (field.size==size) {
-                                value.type = SingleValue; value.v = read_uint32(def.is_big_endian, &count);
-                            } else if (field.size<size) {
-                                // Some device (eg Coros Pace 2) seems to declare uint32 with size 1
-                                value.type = SingleValue;
-                                if (field.size == 1)
-                                    value.v = read_uint8(&count);
-                                if (field.size == 2)
-                                    value.v = read_uint16(def.is_big_endian, &count);
-                                size = field.size;
-                            } else { // Multi-values
-                                value.type = ListValue;
-                                value.list.clear();
-                                for (int i=0;i<field.size/size;i++) {
-                                    value.list.append(read_uint32(def.is_big_endian, &count));
-                                }
-                                size = field.size;
-                            }
-                            break;
-
-                    // String
-                    case 7:
-                        value.type = StringValue;
-                        value.s = read_text(field.size, &count);
-                        size = field.size;
-                        break;
-
-                    // 32bit Float
-                    case 8:
-                        size = 4;
-                        if (field.size==size) {
-                            value.type = FloatValue;
-                            value.f = read_float32(def.is_big_endian, &count);
-                            if (value.f != value.f) // No NAN
-                                value.f = 0;
-                        } else { // Multi-values
-                            value.type = ListValue;
-                            value.list.clear();
-                            for (int i=0;i<field.size/size;i++) {
-                                value.list.append(read_float32(def.is_big_endian, &count));
-                            }
-                            size = field.size;
-                        }
-                        break;
-
-                    // 64bit Float (unimplemented at present)
-                    //case 9:
-
-                    case 10: size = 1;
-                             if (field.size==size) {
-                                value.type = SingleValue; value.v = read_uint8z(&count); size = 1;
-                             } else { // Multi-values
-                                 value.type = ListValue;
-                                 value.list.clear();
-                                 for (int i=0;i<field.size/size;i++) {
-                                     value.list.append(read_uint8z(&count));
-                                 }
-                                 size = field.size;
-                             }
-                             break;
-
-                    // Unsigned Int 16bit - A zero value signifies an invalid value (unimplemented)
-                    case 11: value.type = SingleValue; value.v = read_uint16z(def.is_big_endian, &count); size = 2; break;
-
-                    // Unsigned Int 32bit - A zero value signifies an invalid value (unimplemented)
-                    case 12: value.type = SingleValue; value.v = read_uint32z(def.is_big_endian, &count); size = 4; break;
-
-                    // 8 bit byte
-                    case 13:
-                             value.type = ListValue;
-                             value.list.clear();
-                             for (int i=0;i<field.size;i++) {
-                                value.list.append(read_byte(&count));
-                             }
-                             size = value.list.size();
-                             break;
-
-                    // 64 bit integers are not yet implemented in the code
-                    // case 14: Signed Int 64 bit
-                    // case 15: Unsigned Int 64 bit
-                    // case 16: Unsigned Int 64 bit Zero is an invalid value
-
-                    // if in doubt just read the number of bytes for the
-                    // data type and discard it
-                    default:
-                        if (FIT_DEBUG && FIT_DEBUG_LEVEL>3)  { fprintf(stderr, "unknown type: %d size: %d \n", field.type, field.size);  }
-
-                        if (field.size > 0) read_unknown( field.size, &count );
-                        value.type = SingleValue;
-                        value.v = NA_VALUE;
-                        unknown_base_type.insert(field.type);
-                        size = field.size;
-                        break;
-                }
-
-                // Size is greater than expected
-                // Note we already check above for arrays
-                // So this is likely a redundant check
-                if (size < field.size) {
-                    if (FIT_DEBUG && FIT_DEBUG_LEVEL>4)  { fprintf(stderr, "   warning : size=%d for type=%d (num=%d)\n",
-                                                                           field.size, field.type, field.num); }
-
-                    // jump over unaccounted for data
-                    read_unknown( field.size-size, &count );
-                }
-
-                // add to the container
-                values.push_back(value);
-
-            }
+            in.values(def, values);
 
             // we have now extracted the data stored in the message- so lets pass it to the decoders
             // to handle- in this case we use the global message number to decide since it indicates
@@ -4484,7 +4023,7 @@ genericnext:
             }
             last_msg_type = def.global_msg_num;
         }
-        return count;
+        return in.position() - start;
     }
 
     //
@@ -4510,6 +4049,17 @@ genericnext:
             return NULL;
         }
 
+        // decode from memory, mapping the file if we can and reading it
+        // in one go if not (e.g. resources), it is unmapped on close
+        QByteArray contents;
+        const uchar *mapped = file.size() > 0 ? file.map(0, file.size()) : NULL;
+        if (mapped) {
+            in.setData(mapped, file.size());
+        } else {
+            contents = file.readAll();
+            in.setData(reinterpret_cast<const uchar*>(contents.constData()), contents.size());
+        }
+
         int data_size = 0;
         weatherXdata = new XDataSeries();
         weatherXdata->name = "WEATHER";
@@ -4585,7 +4135,7 @@ genericnext:
         else {
             if (!truncated) {
                 try {
-                    int crc = read_uint16( false ); // always littleEndian
+                    int crc = in.uint16( false ); // always littleEndian
                     (void) crc;
                 }
                 catch (TruncatedRead &e) {
@@ -4596,8 +4146,10 @@ genericnext:
 
                 // second file ?
                 try {
-                    while (file.canReadLine()) {
-                        read_header(stop, errors, data_size);
+                    while (in.has(12)) { // room for another header
+                        QStringList trailing;
+                        read_header(stop, trailing, data_size);
+                        if (stop) break; // not another file, just trailing bytes
                         if (!stop) {
 
                             int bytes_read = 0;
@@ -4614,7 +4166,7 @@ genericnext:
                         }
                         if (!truncated) {
                             try {
-                                int crc = read_uint16( false ); // always littleEndian
+                                int crc = in.uint16( false ); // always littleEndian
                                 (void) crc;
                             }
                             catch (TruncatedRead &e) {
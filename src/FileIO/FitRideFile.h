@@ -21,6 +21,7 @@
 #include "GoldenCheetah.h"
 
 #include "RideFile.h"
+#include "FitDecoder.h"
 
 struct FitFileReader : public RideFileReader {
 
@@ -47,26 +48,6 @@ struct FitFileReader : public RideFileReader {
 #define HRV_MSG_NUM             78
 #define SEGMENT_MSG_NUM         142
 
-/* FIT has uint32 as largest integer type. So qint64 is large enough to
- * store all integer types - no matter if they're signed or not */
-
-// this will need to change if float or other non-integer values are
-// introduced into the file format *FIXME*
-typedef qint64 fit_value_t;
-
-#define NA_VALUE std::numeric_limits<fit_value_t>::max()
-#define NA_VALUEF  (double)(0xFFFFFFFF)
-
-typedef std::string fit_string_value;
-typedef float fit_float_value;
-
-struct FitField {
-    int num;
-    int type; // FIT base_type
-    int size; // in bytes
-    int deve_idx; // Developer Data Index
-};
-
 struct FitFieldDefinition {
     int dev_id; // Developer Data Index (for developer fields)
     int num;
@@ -91,26 +72,6 @@ struct FitDeveApp {
     QList<FitFieldDefinition> fields;
 };
 
-struct FitMessage {
-    int global_msg_num;
-    int local_msg_num;
-    bool is_big_endian;
-    std::vector<FitField> fields;
-};
-
-enum fitValueType { SingleValue, ListValue, FloatValue, StringValue };
-typedef enum fitValueType FitValueType;
-
-struct FitValue
-{
-    FitValueType type;
-    fit_value_t v;
-    fit_string_value s;
-    fit_float_value f;
-    QList<fit_value_t> list;
-    int size;
-};
-
 // Fit types metadata
 struct FITproduct { int manu, prod; QString name; };
 struct FITmanufacturer { int manu; QString name; };
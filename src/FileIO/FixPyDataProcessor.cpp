@@ -2,6 +2,8 @@
 #include "FixPyRunner.h"
 #include "Athlete.h"
 
+#include <QMutex>
+
 // Config widget used by the Preferences/Options config panes
 class FixPyDataProcessorConfig : public DataProcessorConfig
 {
@@ -37,8 +39,16 @@ bool FixPyDataProcessor::postProcess(RideFile *rideFile, DataProcessorConfig *se
             }
         }
     }
+    // python fixes aren't safe to run concurrently, e.g. when importing,
+    // unless called from a script which is already running in python
+    static QMutex running;
+    if (useNewThread) running.lock();
+
     FixPyRunner pyRunner(context, rideFile, rideItem, useNewThread);
-    return pyRunner.run(pyScript->source, pyScript->iniKey, errText) == 0;
+    bool returning = pyRunner.run(pyScript->source, pyScript->iniKey, errText) == 0;
+
+    if (useNewThread) running.unlock();
+    return returning;
 }
 
 DataProcessorConfig *FixPyDataProcessor::processorConfig(QWidget *parent, const RideFile* ride)
@@ -795,10 +795,21 @@ JsonFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &fil
     // truncate existing
     file.resize(0);
 
+    bool ok = streamRideFile(context, ride, file);
+
+    // close
+    file.close();
+
+    return ok;
+}
+
+bool
+JsonFileReader::streamRideFile(Context *context, const RideFile *ride, QIODevice &device) const
+{
     QByteArray xml = toByteArray(context, ride, true, true, true, true);
 
     // setup streamer
-    QTextStream out(&file);
+    QTextStream out(&device);
     // unified codepage and BOM for identification on all platforms
 #if QT_VERSION < 0x060000
     out.setCodec("UTF-8");
@@ -808,8 +819,5 @@ JsonFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &fil
     out << xml;
     out.flush();
 
-    // close
-    file.close();
-
-    return true;
+    return out.status() == QTextStream::Ok;
 }
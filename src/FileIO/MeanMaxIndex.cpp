@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MeanMaxIndex.h"
+#include "RideFileCache.h"
+#include "Context.h"
+#include "Athlete.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QMutexLocker>
+#include <algorithm>
+
+static const quint32 MeanMaxIndexMagic = 0x58494d4d; // "MMIX"
+static const quint32 MeanMaxIndexVersion = 1;
+
+// buckets held in memory, they can be a few MB each
+static const int maxbuckets = 16;
+
+// FNV-1a over 64 bit values
+static inline void mix(quint64 &hash, quint64 value)
+{
+    hash ^= value;
+    hash *= 1099511628211ULL;
+}
+
+MeanMaxIndex::MeanMaxIndex(Context *context) : context(context)
+{
+    dir = QDir(context->athlete->home->cache().canonicalPath() + "/meanmax");
+    if (!dir.exists()) dir.mkpath(dir.absolutePath());
+}
+
+MeanMaxIndex::~MeanMaxIndex()
+{
+    foreach(Bucket bucket, buckets) delete bucket.cache;
+}
+
+QDate
+MeanMaxIndex::bucketEnd(Level level, QDate date)
+{
+    switch (level) {
+
+    case Year:
+        if (date.month() == 1 && date.day() == 1) return QDate(date.year(), 12, 31);
+        break;
+
+    case Month:
+        if (date.day() == 1) return QDate(date.year(), date.month(), date.daysInMonth());
+        break;
+
+    case Week:
+        if ((date.day()-1) % 7 == 0) {
+            QDate end = date.addDays(6);
+            QDate monthend(date.year(), date.month(), date.daysInMonth());
+            return end > monthend ? monthend : end;
+        }
+        break;
+
+    case Day:
+        return date;
+    }
+    return QDate();
+}
+
+QDate
+MeanMaxIndex::bucketStart(Level level, QDate date)
+{
+    switch (level) {
+    case Year: return QDate(date.year(), 1, 1);
+    case Month: return QDate(date.year(), date.month(), 1);
+    case Week: return QDate(date.year(), date.month(), ((date.day()-1)/7)*7 + 1);
+    default:
+    case Day: return date;
+    }
+}
+
+void
+MeanMaxIndex::ridesInRange(const QVector<RideFileCacheRide> &all, QDate start, QDate end, QString sport,
+                           QVector<RideFileCacheRide> &rides)
+{
+    // rides are sorted by date so jump straight to the first one
+    QVector<RideFileCacheRide>::const_iterator it = std::lower_bound(all.constBegin(), all.constEnd(), start,
+                        [](const RideFileCacheRide &ride, const QDate &date) { return ride.date < date; });
+
+    for (; it != all.constEnd() && it->date <= end; ++it) {
+        if (sport != "" && it->sport != sport) continue;
+        rides << *it;
+    }
+}
+
+quint64
+MeanMaxIndex::fingerprint(const QVector<RideFileCacheRide> &rides)
+{
+    // anything that would change the ride cpx or how it aggregates
+    quint64 hash = 14695981039346656037ULL;
+    foreach(const RideFileCacheRide &ride, rides) {
+        mix(hash, qHash(ride.fileName));
+        mix(hash, ride.crc);
+        mix(hash, ride.fingerprint);
+        mix(hash, quint64(ride.weight * 1000));
+        mix(hash, ride.date.toJulianDay());
+    }
+    mix(hash, RideFileCacheVersion);
+    return hash;
+}
+
+bool
+MeanMaxIndex::aggregate(RideFileCache *into, QDate start, QDate end, QString sport,
+                        const QVector<RideFileCacheRide> &all, RideFileCacheProgress *progress)
+{
+    QMutexLocker locker(&lock);
+
+    // walk through the range using the biggest bucket that fits
+    QDate date = start;
+    while (date <= end) {
+
+        // cancelled, whatever we have is partial
+        if (progress && progress->abort) {
+            into->incomplete = true;
+            break;
+        }
+
+        int level = Year;
+        for (; level > Day; level--) {
+            QDate bend = bucketEnd(static_cast<Level>(level), date);
+            if (bend.isValid() && bend <= end) break;
+        }
+
+        if (level == Day) {
+
+            // read the rides up to the next week or the end of the range
+            QDate next = bucketStart(Week, date).addDays(7);
+            if (next.month() != date.month())
+                next = QDate(date.year(), date.month(), 1).addMonths(1);
+            QDate last = next.addDays(-1) > end ? end : next.addDays(-1);
+
+            QVector<RideFileCacheRide> rides;
+            ridesInRange(all, date, last, sport, rides);
+            RideFileCache::aggregateRides(context, into, rides, progress);
+            date = last.addDays(1);
+
+        } else {
+
+            add(into, static_cast<Level>(level), date, sport, all, progress);
+            date = bucketEnd(static_cast<Level>(level), date).addDays(1);
+        }
+    }
+    return into->incomplete == false;
+}
+
+void
+MeanMaxIndex::add(RideFileCache *into, Level level, QDate start, QString sport,
+                  const QVector<RideFileCacheRide> &all, RideFileCacheProgress *progress)
+{
+    QDate end = bucketEnd(level, start);
+
+    QVector<RideFileCacheRide> rides;
+    ridesInRange(all, start, end, sport, rides);
+    if (rides.isEmpty()) return;
+
+    quint64 fp = fingerprint(rides);
+
+    // in memory ?
+    RideFileCache *cache = find(level, start, sport, fp);
+    if (cache) {
+        into->merge(*cache);
+        return;
+    }
+
+    // on disk ?
+    cache = load(level, start, sport, fp);
+    bool built = cache == NULL;
+    if (built) {
+
+        // build from rides, or the buckets one level down
+        cache = new RideFileCache(context);
+        if (level == Week) {
+            RideFileCache::aggregateRides(context, cache, rides, progress);
+        } else {
+            Level sub = static_cast<Level>(level-1);
+            for (QDate date=start; date <= end; date = bucketEnd(sub, date).addDays(1))
+                add(cache, sub, date, sport, all, progress);
+        }
+
+        // missing cpx files or aborted, use it this once but don't keep it
+        if (cache->incomplete) {
+            into->merge(*cache);
+            delete cache;
+            return;
+        }
+    }
+
+    Bucket bucket;
+    bucket.sport = sport;
+    bucket.level = level;
+    bucket.start = start;
+    bucket.fingerprint = fp;
+    bucket.cache = cache;
+    if (built) save(bucket);
+    remember(bucket);
+
+    into->merge(*cache);
+}
+
+RideFileCache *
+MeanMaxIndex::find(Level level, QDate start, QString sport, quint64 fingerprint)
+{
+    for (int i=0; i<buckets.count(); i++) {
+        Bucket &bucket = buckets[i];
+        if (bucket.level == level && bucket.start == start && bucket.sport == sport) {
+
+            // stale, the rides have changed
+            if (bucket.fingerprint != fingerprint) {
+                delete bucket.cache;
+                buckets.removeAt(i);
+                return NULL;
+            }
+
+            // most recently used
+            buckets.move(i, buckets.count()-1);
+            return buckets.last().cache;
+        }
+    }
+    return NULL;
+}
+
+void
+MeanMaxIndex::remember(const Bucket &bucket)
+{
+    if (buckets.count() >= maxbuckets) {
+        delete buckets.first().cache;
+        buckets.removeFirst();
+    }
+    buckets << bucket;
+}
+
+void
+MeanMaxIndex::invalidate(QDate date)
+{
+    QMutexLocker locker(&lock);
+
+    for (int i=0; i<buckets.count();) {
+        Bucket &bucket = buckets[i];
+        if (date >= bucket.start && date <= bucketEnd(bucket.level, bucket.start)) {
+            delete bucket.cache;
+            buckets.removeAt(i);
+        } else i++;
+    }
+
+    // all sports
+    for (int level=Week; level <= Year; level++) {
+        QString prefix = filename(static_cast<Level>(level), bucketStart(static_cast<Level>(level), date), "*");
+        foreach(QString name, dir.entryList(QStringList() << prefix, QDir::Files))
+            dir.remove(name);
+    }
+}
+
+QString
+MeanMaxIndex::filename(Level level, QDate start, QString sport) const
+{
+    // sport names are user defined so keep them out of the filename
+    QString sportkey = sport == "*" ? sport : QString::number(quint64(qHash(sport)), 16);
+    return QString("%1-%2-%3.mmx").arg(int(level)).arg(start.toString("yyyyMMdd")).arg(sportkey);
+}
+
+RideFileCache *
+MeanMaxIndex::load(Level level, QDate start, QString sport, quint64 fingerprint) const
+{
+    QFile file(dir.absoluteFilePath(filename(level, start, sport)));
+    if (!file.open(QIODevice::ReadOnly)) return NULL;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version, cacheversion;
+    quint64 fp;
+    QString filesport;
+    in >> magic >> version >> cacheversion >> fp >> filesport;
+    if (magic != MeanMaxIndexMagic || version != MeanMaxIndexVersion ||
+        cacheversion != quint32(RideFileCacheVersion) || fp != fingerprint || filesport != sport) return NULL;
+
+    RideFileCache *cache = new RideFileCache(context);
+
+    QList<QVector<double>*> meanmax, dist;
+    QList<QVector<QDate>*> dates;
+    QList<QVector<float>*> tiz;
+    cache->aggregateArrays(meanmax, dates, dist, tiz);
+
+    foreach(QVector<double> *p, meanmax) in >> *p;
+    foreach(QVector<QDate> *p, dates) in >> *p;
+    foreach(QVector<double> *p, dist) in >> *p;
+    foreach(QVector<float> *p, tiz) in >> *p;
+
+    if (in.status() != QDataStream::Ok) {
+        qDebug()<<"corrupt meanmax index file"<<file.fileName();
+        delete cache;
+        return NULL;
+    }
+    return cache;
+}
+
+void
+MeanMaxIndex::save(const Bucket &bucket) const
+{
+    QSaveFile file(dir.absoluteFilePath(filename(bucket.level, bucket.start, bucket.sport)));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+
+    out << MeanMaxIndexMagic << MeanMaxIndexVersion << quint32(RideFileCacheVersion)
+        << bucket.fingerprint << bucket.sport;
+
+    QList<QVector<double>*> meanmax, dist;
+    QList<QVector<QDate>*> dates;
+    QList<QVector<float>*> tiz;
+    bucket.cache->aggregateArrays(meanmax, dates, dist, tiz);
+
+    foreach(QVector<double> *p, meanmax) out << *p;
+    foreach(QVector<QDate> *p, dates) out << *p;
+    foreach(QVector<double> *p, dist) out << *p;
+    foreach(QVector<float> *p, tiz) out << *p;
+
+    if (!file.commit()) qDebug()<<"cannot write meanmax index file"<<file.fileName();
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_MeanMaxIndex_h
+#define _GC_MeanMaxIndex_h 1
+#include "GoldenCheetah.h"
+
+#include <QDate>
+#include <QDir>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+class Context;
+class RideFileCache;
+struct RideFileCacheRide;
+struct RideFileCacheProgress;
+
+// MeanMaxIndex holds pre-aggregated mean-max, distribution and time in zone
+// for calendar buckets so that a date range aggregate (e.g. a season CP
+// curve) doesn't need to read every .cpx file in the range.
+//
+// Buckets nest, so any date range is covered by a handful of them:
+//
+//   year  - Jan 1st to Dec 31st
+//   month - 1st to the last day of the month
+//   week  - 7 day blocks within a month: 1-7, 8-14, 15-21, 22-28, 29-end
+//
+// whatever is left over at the edges is read from the ride .cpx files.
+//
+// Buckets are kept per sport ("" for all sports), held in memory and saved
+// to cache/meanmax so they survive a restart. A fingerprint of the rides in
+// the bucket is kept alongside and checked before it is used, and when a
+// ride is added, deleted or its .cpx refreshed the buckets that contain it
+// are dropped via invalidate().
+class MeanMaxIndex
+{
+    public:
+
+        enum level { Day=0, Week, Month, Year };
+        typedef enum level Level;
+
+        MeanMaxIndex(Context *context);
+        ~MeanMaxIndex();
+
+        // aggregate rides from start to end inclusive for sport ("" = all)
+        // into an empty aggregate, returns false if any ride cpx is missing
+        // or it was aborted. rides are all the rides in the range in date
+        // order, copied on the GUI thread so this can run in the background
+        bool aggregate(RideFileCache *into, QDate start, QDate end, QString sport,
+                       const QVector<RideFileCacheRide> &rides, RideFileCacheProgress *progress = NULL);
+
+        // a ride on this date has changed, drop buckets that contain it
+        void invalidate(QDate date);
+
+    private:
+
+        struct Bucket {
+            QString sport;
+            Level level;
+            QDate start;
+            quint64 fingerprint;
+            RideFileCache *cache;
+        };
+
+        // last day of the bucket at this level that starts on date, or an
+        // invalid date if date is not the start of a bucket at this level
+        static QDate bucketEnd(Level level, QDate date);
+
+        // start of the bucket at this level that contains date
+        static QDate bucketStart(Level level, QDate date);
+
+        // rides in a range, they are in date order
+        static void ridesInRange(const QVector<RideFileCacheRide> &all, QDate start, QDate end, QString sport,
+                                 QVector<RideFileCacheRide> &rides);
+        static quint64 fingerprint(const QVector<RideFileCacheRide> &rides);
+
+        // merge the bucket into the aggregate, building it if needed
+        void add(RideFileCache *into, Level level, QDate start, QString sport,
+                 const QVector<RideFileCacheRide> &all, RideFileCacheProgress *progress);
+
+        // in memory buckets
+        RideFileCache *find(Level level, QDate start, QString sport, quint64 fingerprint);
+        void remember(const Bucket &bucket);
+
+        // on disk
+        QString filename(Level level, QDate start, QString sport) const;
+        RideFileCache *load(Level level, QDate start, QString sport, quint64 fingerprint) const;
+        void save(const Bucket &bucket) const;
+
+        Context *context;
+        QDir dir;
+        QList<Bucket> buckets; // most recently used last
+        QMutex lock;
+};
+
+#endif // _GC_MeanMaxIndex_h
@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MeanMaxKernel.h"
+
+// SSE2 is always there on x86_64, AVX2 is checked at runtime and the
+// code for it is compiled for that target only, so no build flags needed
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GC_MEANMAX_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#define GC_MEANMAX_AVX2 1
+#define GC_TARGET_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(__GNUC__) || defined(__clang__)
+#define GC_MEANMAX_AVX2 1
+#define GC_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+
+typedef data_t (*partialfn)(const data_t *, int, int, int, int *);
+
+//
+// The reference implementation, see RideFileCache.cpp for
+// the description of Mark Rages' algorithm
+//
+static data_t
+partial_max_mean(const data_t *dataseries_i, int start, int end, int length, int *offset)
+{
+    int i=0;
+    data_t candidate=0;
+
+    int best_i=0;
+
+    for (i=start; i<(1+end-length); i++) {
+        data_t test_energy=dataseries_i[length+i]-dataseries_i[i];
+        if (test_energy>candidate) {
+            candidate=test_energy;
+            best_i=i;
+        }
+    }
+    if (offset) *offset=best_i;
+
+    return candidate;
+}
+
+static data_t
+divided_max_mean(const data_t *dataseries_i, int datalength, int length, int *offset, partialfn partial)
+{
+    int shift=length;
+
+    //if sorting data the following is an important speedup hack
+    if (shift>180) shift=180;
+
+    int window_length=length+shift;
+
+    if (window_length>datalength) window_length=datalength;
+
+    // put down as many windows as will fit without overrunning data
+    int start=0;
+    int end=0;
+    data_t energy=0;
+
+    data_t candidate=0;
+    int this_offset=0;
+
+    for (start=0; start+window_length<=datalength; start+=shift) {
+        end=start+window_length;
+        energy=dataseries_i[end]-dataseries_i[start];
+
+        if (energy < candidate) {
+          continue;
+        }
+        data_t window_mm=partial(dataseries_i, start, end, length, &this_offset);
+
+        if (window_mm>candidate) {
+            candidate=window_mm;
+            if (offset) *offset=this_offset;
+        }
+    }
+
+    // if the overlapping windows don't extend to the end of the data,
+    // let's tack another one on at the end
+
+    if (end<datalength) {
+        start=datalength-window_length;
+        end=datalength;
+        energy=dataseries_i[end]-dataseries_i[start];
+
+        if (energy >= candidate) {
+
+            data_t window_mm=partial(dataseries_i, start, end, length, &this_offset);
+
+            if (window_mm>candidate) {
+                candidate=window_mm;
+                if (offset) *offset=this_offset;
+            }
+        }
+    }
+
+    return candidate;
+}
+
+// combine the per lane bests, the earliest wins a tie just
+// as it would scanning one at a time
+static inline void
+reduceLanes(const double *value, const double *index, int lanes, data_t &candidate, int &best_i)
+{
+    for (int k=0; k<lanes; k++) {
+        if (value[k] > candidate || (value[k] > 0 && value[k] == candidate && int(index[k]) < best_i)) {
+            candidate = value[k];
+            best_i = int(index[k]);
+        }
+    }
+}
+
+#ifdef GC_MEANMAX_SSE2
+static data_t
+partial_max_mean_sse2(const data_t *dataseries_i, int start, int end, int length, int *offset)
+{
+    int last=1+end-length;
+    int i=start;
+    data_t candidate=0;
+    int best_i=0;
+
+    if (last-i >= 2) {
+        __m128d best = _mm_setzero_pd();
+        __m128d bestidx = _mm_setzero_pd();
+        __m128d idx = _mm_set_pd(i+1, i);
+        const __m128d step = _mm_set1_pd(2);
+
+        for (; i+2 <= last; i += 2) {
+            __m128d test = _mm_sub_pd(_mm_loadu_pd(dataseries_i+length+i), _mm_loadu_pd(dataseries_i+i));
+            __m128d gt = _mm_cmpgt_pd(test, best);
+            best = _mm_or_pd(_mm_and_pd(gt, test), _mm_andnot_pd(gt, best));
+            bestidx = _mm_or_pd(_mm_and_pd(gt, idx), _mm_andnot_pd(gt, bestidx));
+            idx = _mm_add_pd(idx, step);
+        }
+
+        double value[2], index[2];
+        _mm_storeu_pd(value, best);
+        _mm_storeu_pd(index, bestidx);
+        reduceLanes(value, index, 2, candidate, best_i);
+    }
+
+    for (; i<last; i++) {
+        data_t test_energy=dataseries_i[length+i]-dataseries_i[i];
+        if (test_energy>candidate) {
+            candidate=test_energy;
+            best_i=i;
+        }
+    }
+    if (offset) *offset=best_i;
+
+    return candidate;
+}
+
+// brute force up to 4 durations (ascending) at once over the whole ride,
+// results and offsets are indexed the same as lengths
+static void
+brute_max_mean_sse2(const data_t *dataseries_i, int datalength, const int *lengths, int count, data_t *results, int *offsets)
+{
+    __m128d best[4], bestidx[4];
+    for (int k=0; k<count; k++) best[k] = bestidx[k] = _mm_setzero_pd();
+
+    __m128d idx = _mm_set_pd(1, 0);
+    const __m128d step = _mm_set1_pd(2);
+
+    // both lanes valid for every duration
+    int last = 1+datalength-lengths[count-1];
+    int i=0;
+    for (; i+2 <= last; i += 2) {
+        __m128d base = _mm_loadu_pd(dataseries_i+i);
+        for (int k=0; k<count; k++) {
+            __m128d test = _mm_sub_pd(_mm_loadu_pd(dataseries_i+lengths[k]+i), base);
+            __m128d gt = _mm_cmpgt_pd(test, best[k]);
+            best[k] = _mm_or_pd(_mm_and_pd(gt, test), _mm_andnot_pd(gt, best[k]));
+            bestidx[k] = _mm_or_pd(_mm_and_pd(gt, idx), _mm_andnot_pd(gt, bestidx[k]));
+        }
+        idx = _mm_add_pd(idx, step);
+    }
+
+    for (int k=0; k<count; k++) {
+        double value[2], index[2];
+        _mm_storeu_pd(value, best[k]);
+        _mm_storeu_pd(index, bestidx[k]);
+
+        data_t candidate=0;
+        int best_i=0;
+        reduceLanes(value, index, 2, candidate, best_i);
+
+        int length = lengths[k];
+        for (int j=i; j<1+datalength-length; j++) {
+            data_t test_energy=dataseries_i[length+j]-dataseries_i[j];
+            if (test_energy>candidate) {
+                candidate=test_energy;
+                best_i=j;
+            }
+        }
+        results[k] = candidate;
+        if (offsets) offsets[k] = best_i;
+    }
+}
+#endif
+
+#ifdef GC_MEANMAX_AVX2
+GC_TARGET_AVX2 static data_t
+partial_max_mean_avx2(const data_t *dataseries_i, int start, int end, int length, int *offset)
+{
+    int last=1+end-length;
+    int i=start;
+    data_t candidate=0;
+    int best_i=0;
+
+    if (last-i >= 4) {
+        __m256d best = _mm256_setzero_pd();
+        __m256d bestidx = _mm256_setzero_pd();
+        __m256d idx = _mm256_set_pd(i+3, i+2, i+1, i);
+        const __m256d step = _mm256_set1_pd(4);
+
+        for (; i+4 <= last; i += 4) {
+            __m256d test = _mm256_sub_pd(_mm256_loadu_pd(dataseries_i+length+i), _mm256_loadu_pd(dataseries_i+i));
+            __m256d gt = _mm256_cmp_pd(test, best, _CMP_GT_OQ);
+            best = _mm256_blendv_pd(best, test, gt);
+            bestidx = _mm256_blendv_pd(bestidx, idx, gt);
+            idx = _mm256_add_pd(idx, step);
+        }
+
+        double value[4], index[4];
+        _mm256_storeu_pd(value, best);
+        _mm256_storeu_pd(index, bestidx);
+        reduceLanes(value, index, 4, candidate, best_i);
+    }
+
+    for (; i<last; i++) {
+        data_t test_energy=dataseries_i[length+i]-dataseries_i[i];
+        if (test_energy>candidate) {
+            candidate=test_energy;
+            best_i=i;
+        }
+    }
+    if (offset) *offset=best_i;
+
+    return candidate;
+}
+
+GC_TARGET_AVX2 static void
+brute_max_mean_avx2(const data_t *dataseries_i, int datalength, const int *lengths, int count, data_t *results, int *offsets)
+{
+    __m256d best[4], bestidx[4];
+    for (int k=0; k<count; k++) best[k] = bestidx[k] = _mm256_setzero_pd();
+
+    __m256d idx = _mm256_set_pd(3, 2, 1, 0);
+    const __m256d step = _mm256_set1_pd(4);
+
+    // all lanes valid for every duration
+    int last = 1+datalength-lengths[count-1];
+    int i=0;
+    for (; i+4 <= last; i += 4) {
+        __m256d base = _mm256_loadu_pd(dataseries_i+i);
+        for (int k=0; k<count; k++) {
+            __m256d test = _mm256_sub_pd(_mm256_loadu_pd(dataseries_i+lengths[k]+i), base);
+            __m256d gt = _mm256_cmp_pd(test, best[k], _CMP_GT_OQ);
+            best[k] = _mm256_blendv_pd(best[k], test, gt);
+            bestidx[k] = _mm256_blendv_pd(bestidx[k], idx, gt);
+        }
+        idx = _mm256_add_pd(idx, step);
+    }
+
+    for (int k=0; k<count; k++) {
+        double value[4], index[4];
+        _mm256_storeu_pd(value, best[k]);
+        _mm256_storeu_pd(index, bestidx[k]);
+
+        data_t candidate=0;
+        int best_i=0;
+        reduceLanes(value, index, 4, candidate, best_i);
+
+        int length = lengths[k];
+        for (int j=i; j<1+datalength-length; j++) {
+            data_t test_energy=dataseries_i[length+j]-dataseries_i[j];
+            if (test_energy>candidate) {
+                candidate=test_energy;
+                best_i=j;
+            }
+        }
+        results[k] = candidate;
+        if (offsets) offsets[k] = best_i;
+    }
+}
+#endif
+
+static MeanMaxKernel::Isa
+detect()
+{
+#ifdef GC_MEANMAX_AVX2
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7) {
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1<<27)) != 0;
+        bool avx = (info[2] & (1<<28)) != 0;
+        __cpuidex(info, 7, 0);
+        bool avx2 = (info[1] & (1<<5)) != 0;
+        if (osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6) return MeanMaxKernel::AVX2;
+    }
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return MeanMaxKernel::AVX2;
+#endif
+#endif
+#ifdef GC_MEANMAX_SSE2
+    return MeanMaxKernel::SSE2;
+#else
+    return MeanMaxKernel::Scalar;
+#endif
+}
+
+// brute force is only the same as the divided windows when the
+// integrated series never goes down, since the pruning relies on it
+static bool
+rising(const data_t *integrated, int datalength)
+{
+    bool rising = true;
+    for (int j=0; rising && j<datalength; j++) rising = integrated[j+1] >= integrated[j];
+    return rising;
+}
+
+static void
+brute(MeanMaxKernel::Isa isa, const data_t *integrated, int datalength, const int *lengths, int count, data_t *results, int *offsets)
+{
+#ifdef GC_MEANMAX_AVX2
+    if (isa == MeanMaxKernel::AVX2) return brute_max_mean_avx2(integrated, datalength, lengths, count, results, offsets);
+#endif
+#ifdef GC_MEANMAX_SSE2
+    brute_max_mean_sse2(integrated, datalength, lengths, count, results, offsets);
+#else
+    (void)isa; (void)integrated; (void)datalength; (void)lengths; (void)count; (void)results; (void)offsets;
+#endif
+}
+
+MeanMaxKernel::Isa
+MeanMaxKernel::available()
+{
+    static const Isa isa = detect();
+    return isa;
+}
+
+const char *
+MeanMaxKernel::name(Isa isa)
+{
+    switch (isa) {
+    case AVX2: return "avx2";
+    case SSE2: return "sse2";
+    default:
+    case Scalar: return "scalar";
+    }
+}
+
+int
+MeanMaxKernel::nextLength(int i)
+{
+    // increments to limit search scope
+    if (i<120) i++;
+    else if (i<600) i+= 2;
+    else if (i<1200) i += 5;
+    else if (i<3600) i += 20;
+    else if (i<7200) i += 120;
+    else i += 300;
+    return i;
+}
+
+data_t
+MeanMaxKernel::dividedMaxMean(const data_t *integrated, int datalength, int length, int *offset)
+{
+    return divided_max_mean(integrated, datalength, length, offset, partial_max_mean);
+}
+
+void
+MeanMaxKernel::search(const data_t *integrated, int datalength, data_t *results, int *offsets)
+{
+    search(integrated, datalength, results, offsets, available());
+}
+
+void
+MeanMaxKernel::search(const data_t *integrated, int datalength, data_t *results, int *offsets, Isa isa)
+{
+    if (isa > available()) isa = available();
+
+    partialfn partial = partial_max_mean;
+#ifdef GC_MEANMAX_SSE2
+    if (isa == SSE2) partial = partial_max_mean_sse2;
+#endif
+#ifdef GC_MEANMAX_AVX2
+    if (isa == AVX2) partial = partial_max_mean_avx2;
+#endif
+
+    int i=1;
+
+    if (isa != Scalar && rising(integrated, datalength)) {
+
+        // results and offsets are indexed by length
+        int lengths[4], offset[4];
+        data_t result[4];
+        int count=0;
+        auto flush = [&]() {
+            brute(isa, integrated, datalength, lengths, count, result, offset);
+            for (int k=0; k<count; k++) {
+                results[lengths[k]] = result[k];
+                if (offsets) offsets[lengths[k]] = offset[k];
+            }
+            count = 0;
+        };
+
+        for (; i<datalength; i=nextLength(i)) {
+            lengths[count++] = i;
+            if (count == 4) flush();
+        }
+        if (count) flush();
+    }
+
+    // series that go down (or anything left) use the divided windows
+    for (; i<datalength; i=nextLength(i)) {
+        int offset=0;
+        results[i] = divided_max_mean(integrated, datalength, i, &offset, partial);
+        if (offsets) offsets[i] = offset;
+    }
+}
+
+bool
+MeanMaxKernel::search(const data_t *integrated, int datalength, const int *lengths, int count, data_t *results, int *offsets, Isa isa)
+{
+    if (isa > available()) isa = available();
+    if (isa == Scalar || !rising(integrated, datalength)) return false;
+
+    for (int k=0; k<count; k += 4)
+        brute(isa, integrated, datalength, lengths+k, count-k < 4 ? count-k : 4, results+k, offsets+k);
+    return true;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_MeanMaxKernel_h
+#define _GC_MeanMaxKernel_h 1
+
+// used by Mark Rages' Mean Max Algorithm
+typedef double data_t;
+
+// MeanMaxKernel finds the best total over every duration searched
+// when computing mean max, working on the integrated (prefix sum) series
+// so the total for any window is integrated[i+length] - integrated[i].
+//
+// The reference is Mark Rages' divided_max_mean, see RideFileCache.cpp
+// for the description. search() uses SSE2 or AVX2 when the cpu has it:
+//
+//  - when the series is never negative every duration is found by brute
+//    force, four durations at a time, sharing each load of the integrated
+//    series across them. With vectors this beats pruning the windows.
+//
+//  - series that can be negative, like the deltas, keep the divided windows
+//    and the pruning, but scan each window a vector at a time.
+//
+// Either way the result is the same, to the bit, as calling divided_max_mean
+// for each duration, including the offset of the first best window. The
+// benchmark in test/benchmark/meanmax checks that.
+class MeanMaxKernel
+{
+    public:
+
+        enum isa { Scalar=0, SSE2, AVX2 };
+        typedef enum isa Isa;
+
+        // best instruction set available on this cpu
+        static Isa available();
+        static const char *name(Isa isa);
+
+        // the durations searched, 1s to 2m every 1s then ever coarser
+        static int nextLength(int length);
+
+        // reference implementation, a single duration
+        static data_t dividedMaxMean(const data_t *integrated, int datalength, int length, int *offset);
+
+        // all durations from 1 to datalength-1 stepped by nextLength(), results and
+        // offsets (may be NULL) are indexed by length and need datalength+1 entries.
+        // durations that aren't searched are left alone.
+        static void search(const data_t *integrated, int datalength, data_t *results, int *offsets);
+        static void search(const data_t *integrated, int datalength, data_t *results, int *offsets, Isa isa);
+
+        // just the durations given, ascending from 1 to datalength, with results and offsets
+        // indexed the same. Each load of the series is shared by four durations, it is only
+        // the same as dividedMaxMean when the series never goes down, or there are no
+        // vector instructions, otherwise it returns false and does nothing.
+        static bool search(const data_t *integrated, int datalength, const int *lengths, int count,
+                           data_t *results, int *offsets, Isa isa);
+};
+
+#endif // _GC_MeanMaxKernel_h
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "PeakSearch.h"
+
+#include <algorithm>
+#include <vector>
+
+PeakSearch::Peak
+PeakSearch::best(const data_t *integrated, int datalength, int duration)
+{
+    Peak returning;
+    if (duration <= 0) return returning;
+
+    for (int i=0; i+duration <= datalength; i++) {
+        data_t total = integrated[i+duration] - integrated[i];
+        if (returning.offset < 0 || total > returning.total) {
+            returning.offset = i;
+            returning.total = total;
+        }
+    }
+    return returning;
+}
+
+void
+PeakSearch::search(const data_t *integrated, int datalength, const int *durations, int count, Peak *peaks)
+{
+    for (int j=0; j<count; j++) peaks[j] = Peak();
+
+    // the kernel wants the durations in order and no longer than the series
+    std::vector<int> order;
+    for (int j=0; j<count; j++) if (durations[j] > 0 && durations[j] <= datalength) order.push_back(j);
+    std::stable_sort(order.begin(), order.end(), [durations](int a, int b) { return durations[a] < durations[b]; });
+
+    std::vector<int> lengths(order.size()), offsets(order.size());
+    std::vector<data_t> totals(order.size());
+    for (size_t k=0; k<order.size(); k++) lengths[k] = durations[order[k]];
+
+    if (MeanMaxKernel::search(integrated, datalength, lengths.data(), int(lengths.size()),
+                              totals.data(), offsets.data(), MeanMaxKernel::available())) {
+        for (size_t k=0; k<order.size(); k++) {
+            peaks[order[k]].offset = offsets[k];
+            peaks[order[k]].total = totals[k];
+        }
+        return;
+    }
+
+    // the rest a duration at a time
+    for (int j=0; j<count; j++) peaks[j] = best(integrated, datalength, durations[j]);
+}
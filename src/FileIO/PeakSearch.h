@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_PeakSearch_h
+#define _GC_PeakSearch_h 1
+
+#include "MeanMaxKernel.h" // data_t
+
+// PeakSearch finds the best window for each of a set of durations, as used
+// when discovering peak power and pace intervals, working on the integrated
+// (prefix sum) series so each window total is a subtraction.
+//
+// Power and speed never go down once integrated, for those the durations are
+// searched together by MeanMaxKernel, four at a time a vector at a time, so
+// every load of the series is shared between them. Otherwise, or without
+// vector instructions, each duration is found on its own with best().
+//
+// The series is at fixed intervals, see RideFile::resampled(), and the
+// durations are counted in them. Where windows tie the first one wins, so
+// the result is the same as best() for each duration. The mean max
+// benchmark in test/benchmark/meanmax checks that and times it.
+class PeakSearch
+{
+    public:
+
+        struct Peak {
+            Peak() : offset(-1), total(0) {}
+
+            int offset;     // first value in the window, -1 if none
+            data_t total;   // of the values in the window
+        };
+
+        // integrated has datalength+1 entries, peaks needs one for each
+        // duration, durations longer than the series aren't found
+        static void search(const data_t *integrated, int datalength, const int *durations, int count, Peak *peaks);
+
+        // reference implementation, a single duration
+        static Peak best(const data_t *integrated, int datalength, int duration);
+};
+
+#endif // _GC_PeakSearch_h
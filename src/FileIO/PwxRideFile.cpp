@@ -599,6 +599,16 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
 
 bool
 PwxFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file) const
+{
+    if (!file.open(QIODevice::WriteOnly)) return(false);
+    file.resize(0);
+    bool ok = streamRideFile(context, ride, file);
+    file.close();
+    return(ok);
+}
+
+bool
+PwxFileReader::streamRideFile(Context *context, const RideFile *ride, QIODevice &device) const
 {
     QDomText text; // used all over
     QDomDocument doc;
@@ -982,15 +992,12 @@ PwxFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file
     }
 
     QByteArray xml = doc.toByteArray(4);
-    if (!file.open(QIODevice::WriteOnly)) return(false);
-    file.resize(0);
-    QTextStream out(&file);
+    QTextStream out(&device);
 #if QT_VERSION < 0x060000
     out.setCodec("UTF-8");
 #endif
     out.setGenerateByteOrderMark(true);
     out << xml;
     out.flush();
-    file.close();
-    return(true);
+    return(out.status() == QTextStream::Ok);
 }
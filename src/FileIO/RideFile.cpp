@@ -19,6 +19,7 @@
  */
 
 #include "RideFile.h"
+#include "RideFileColumns.h"
 #include "FilterHRV.h"
 #include "WPrime.h"
 #include "Athlete.h"
@@ -31,6 +32,8 @@
 #include "SplineLookup.h"
 
 #include <QtXml/QtXml>
+#include <QTemporaryFile>
+#include <QTemporaryDir>
 #include <algorithm> // for std::lower_bound
 #include <assert.h>
 #ifdef Q_CC_MSVC
@@ -65,7 +68,8 @@ const QChar deltaChar(0x0394);
 RideFile::RideFile(const QDateTime &startTime, double recIntSecs) :
             wstale(true), startTime_(startTime), recIntSecs_(recIntSecs),
             data(NULL), wprime_(NULL),
-            weight_(0), totalCount(0), totalTemp(0), dstale(true)
+            weight_(0), totalCount(0), totalTemp(0), dstale(true),
+            ccount(0), cstale(true)
 {
     command = new RideFileCommand(this);
 
@@ -80,7 +84,8 @@ RideFile::RideFile(const QDateTime &startTime, double recIntSecs) :
 // and we want to get special fields and ESPECIALLY "CP" and "Weight"
 RideFile::RideFile(RideFile *p) :
     wstale(true), recIntSecs_(p->recIntSecs_), data(NULL), wprime_(NULL),
-    weight_(p->weight_), totalCount(0), totalTemp(0), dstale(true)
+    weight_(p->weight_), totalCount(0), totalTemp(0), dstale(true),
+    ccount(0), cstale(true)
 {
     startTime_ = p->startTime_;
     tags_ = p->tags_;
@@ -101,7 +106,8 @@ RideFile::RideFile(RideFile *p) :
 
 RideFile::RideFile() : 
     wstale(true), recIntSecs_(0.0), data(NULL), wprime_(NULL),
-    weight_(0), totalCount(0), totalTemp(0), dstale(true)
+    weight_(0), totalCount(0), totalTemp(0), dstale(true),
+    ccount(0), cstale(true)
 {
     command = new RideFileCommand(this);
 
@@ -787,6 +793,33 @@ RideFileFactory::writeRideFile(Context *context, const RideFile *ride, QFile &fi
     else return reader->writeRideFile(context, ride, file);
 }
 
+bool
+RideFileFactory::streamRideFile(Context *context, const RideFile *ride, QIODevice &out, QString format) const
+{
+    RideFileReader *reader = readFuncs_.value(format.toLower());
+
+    if (!reader || !reader->hasWrite()) return false;
+    else return reader->streamRideFile(context, ride, out);
+}
+
+bool
+RideFileReader::streamRideFile(Context *context, const RideFile *ride, QIODevice &out) const
+{
+    // writers that can't stream yet go via a temporary file
+    QTemporaryFile tmp;
+    if (!tmp.open()) return false;
+    tmp.close();
+    if (!writeRideFile(context, ride, tmp)) return false;
+
+    if (!tmp.open()) return false;
+    QByteArray chunk;
+    while (!(chunk = tmp.read(64*1024)).isEmpty()) {
+        if (out.write(chunk) != chunk.size()) return false;
+    }
+    tmp.close();
+    return true;
+}
+
 RideFileReader *RideFileFactory::readerForSuffix(QString suffix) const
 {
     return readFuncs_.value(suffix.toLower());
@@ -899,8 +932,13 @@ RideFile *RideFileFactory::openRideFile(Context *context, QFile &file,
     // if we uncompressed a ride, we need to save to a temporary ride for import
     if (uncompressed) {
 
-        // create a temporary ride
-        QString tmp = context->athlete->home->temp().absolutePath() + "/" + QFileInfo(file.fileName()).baseName() + "." + suffix;
+        // create a temporary ride, in a directory of its own since files are
+        // opened in parallel when importing and inputs can share a name. The
+        // name is kept as some readers get the date and time from it
+        QString tmpdir = context->athlete->home->temp().absolutePath();
+        QTemporaryDir dir(tmpdir + "/uncompressed-XXXXXX");
+        if (dir.isValid()) tmpdir = dir.path();
+        QString tmp = tmpdir + "/" + QFileInfo(file.fileName()).baseName() + "." + suffix;
 
         QFile ufile(tmp); // look at uncompressed version mot the source
         ufile.open(QFile::ReadWrite);
@@ -1578,6 +1616,7 @@ void RideFile::appendOrUpdatePoint(double secs, double cad, double hr, double km
     if (forceAppend) { // note forceAppend = true above do not convert to else clause
         dataPoints_.append(point);
     }
+    cstale = true;
 
     dataPresent.secs     |= (secs != 0);
     dataPresent.cad      |= (cad != 0);
@@ -1637,6 +1676,7 @@ void RideFile::appendPoint(const RideFilePoint &point)
 
 void
 RideFile::updatePoint(RideFilePoint *point, const RideFilePoint *oldPoint){
+    cstale = true;
     if (point->cad == 0 && oldPoint->cad != 0)
         point->cad = oldPoint->cad;
     if (point->hr == 0 && oldPoint->hr != 0)
@@ -1763,6 +1803,7 @@ RideFile::setDataPresent(SeriesType series, bool value)
         default:
         case none : break;
     }
+    cstale = true;
     updateDataTag();
 }
 
@@ -1867,6 +1908,7 @@ RideFile::setPointValue(int index, SeriesType series, double value)
         default:
         case none : break;
     }
+    cstale = true;
 }
 
 double
@@ -2197,11 +2239,66 @@ RideFile::minimumFor(SeriesType series)
     return 0; // default
 }
 
+QSharedPointer<const RideFileColumns>
+RideFile::columns(const QList<SeriesType> &series)
+{
+    QMutexLocker locker(&columnsLock);
+
+    // samples can be appended without going through the command
+    // so we check the count too, not just the stale flag
+    if (cstale || ccount != dataPoints_.count()) {
+
+        // anyone still using the old ones keeps them
+        cstale = false;
+        ccount = dataPoints_.count();
+        for (int i=0; i<static_cast<int>(none); i++) columns_[i].clear();
+
+        // resampled from the old samples
+        QMutexLocker resampledLocker(&resampledLock);
+        resampled_.clear();
+    }
+
+    RideFileColumns *returning = new RideFileColumns();
+    returning->count_ = ccount;
+
+    for (int i=0; i<static_cast<int>(none); i++) {
+
+        SeriesType s = static_cast<SeriesType>(i);
+        if (!series.isEmpty() && !series.contains(s)) continue;
+
+        if (columns_[i].isNull()) {
+            QVector<double> *add = RideFileColumns::build(this, s);
+            if (add) columns_[i] = QSharedPointer<const QVector<double> >(add);
+        }
+        returning->columns_[i] = columns_[i];
+    }
+    return QSharedPointer<const RideFileColumns>(returning);
+}
+
+RideFileResampled
+RideFile::resampled(SeriesType series, double interval, bool hold)
+{
+    // make sure the columns are up to date first
+    QSharedPointer<const RideFileColumns> columns = this->columns(QList<SeriesType>() << secs << series);
+
+    QMutexLocker locker(&resampledLock);
+
+    quint64 key = (quint64(qRound(interval * 1000.0)) << 32) | (quint64(series) << 1) | (hold ? 1 : 0);
+    QHash<quint64, RideFileResampled>::const_iterator it = resampled_.constFind(key);
+    if (it != resampled_.constEnd()) return it.value();
+
+    RideFileResampled add;
+    add.build(columns.data(), series, recIntSecs_, interval, hold ? RideFileResampled::Hold : RideFileResampled::Zero);
+    resampled_.insert(key, add);
+    return add;
+}
+
 void
 RideFile::deletePoint(int index)
 {
     delete dataPoints_[index];
     dataPoints_.remove(index);
+    cstale = true;
 }
 
 void
@@ -2209,12 +2306,14 @@ RideFile::deletePoints(int index, int count)
 {
     for(int i=index; i<(index+count); i++) delete dataPoints_[i];
     dataPoints_.remove(index, count);
+    cstale = true;
 }
 
 void
 RideFile::insertPoint(int index, RideFilePoint *point)
 {
     dataPoints_.insert(index, point);
+    cstale = true;
 }
 
 void
@@ -2235,6 +2334,7 @@ void
 RideFile::appendPoints(QVector <struct RideFilePoint *> newRows)
 {
     dataPoints_ += newRows;
+    cstale = true;
 }
 
 void
@@ -2248,7 +2348,7 @@ void
 RideFile::emitSaved()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = dstale = cstale = true;
     emit saved();
 }
 
@@ -2256,7 +2356,7 @@ void
 RideFile::emitReverted()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = dstale = cstale = true;
     emit reverted();
 }
 
@@ -2264,7 +2364,7 @@ void
 RideFile::emitModified()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = dstale = cstale = true;
     emit modified();
 }
 
@@ -2903,8 +3003,9 @@ RideFile::recalculateDerivedSeries(bool force)
     avgPoint->apower = APcount ? (APtotal / APcount) : 0;
     totalPoint->apower = APtotal;
 
-    // and we're done
+    // and we're done, columns need the new derived values
     dstale=false;
+    cstale=true;
 }
 
 #ifdef GC_HAVE_SAMPLERATE
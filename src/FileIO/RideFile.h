@@ -28,6 +28,10 @@
 #include <QVector>
 #include <QObject>
 #include <QRegExp>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <QHash>
 
 class RideItem;
 class RideCache;
@@ -40,6 +44,8 @@ class XDataPoint;
 struct RideFilePoint;
 struct RideFileDataPresent;
 class RideFileInterval;
+class RideFileColumns; // columnar copy of the samples
+class RideFileResampled; // a series at fixed intervals
 class EditorData;      // attached to a RideFile
 class RideFileCommand; // for manipulating ride data
 class Context;      // for context; cyclist, homedir
@@ -298,6 +304,23 @@ class RideFile : public QObject // QObject to emit signals
 
         const QVector<RideFilePoint*> &dataPoints() const { return dataPoints_; }
 
+        // the same samples held as one contiguous array per series, only
+        // the series asked for (all that are present if none are) and only
+        // those present. Each is built on demand and kept until the samples
+        // change, call recalculateDerivedSeries() first if you need those.
+        // A rebuild makes a new copy, so what is returned stays valid
+        // and unchanged for as long as the caller holds on to it
+        QSharedPointer<const RideFileColumns> columns(const QList<SeriesType> &series = QList<SeriesType>());
+
+        // samples were changed by writing through dataPoints() rather
+        // than with the methods above, so the columns need rebuilding
+        void invalidateColumns() { cstale = true; }
+
+        // a series at fixed intervals with gaps filled, and its running
+        // total, built on demand and shared until the samples are edited
+        // gaps are zero unless hold is set, when the last value is kept
+        RideFileResampled resampled(SeriesType series, double interval=1.0, bool hold=false);
+
         // recalculate all the derived data series
         // might want to move to a factory for these
         // at some point, but for now hard coded
@@ -319,7 +342,7 @@ class RideFile : public QObject // QObject to emit signals
         void setStartTime(const QDateTime &value);
     
         double recIntSecs() const { return recIntSecs_; }
-        void setRecIntSecs(double value) { recIntSecs_ = value; }
+        void setRecIntSecs(double value) { recIntSecs_ = value; cstale = true; }
         const QString deviceType() const { return getTag("Device", "unknown"); }
         void setDeviceType(const QString &value) { setTag("Device", value); }
         const QString &fileFormat() const { return fileFormat_; }
@@ -455,6 +478,14 @@ class RideFile : public QObject // QObject to emit signals
 
         bool dstale; // is derived data up to date?
 
+        QSharedPointer<const QVector<double> > columns_[none]; // by series, as they are asked for
+        int ccount; // samples when they were built
+        QAtomicInt cstale; // are columns up to date?
+        QMutex columnsLock; // columns() is called from mean max threads
+
+        QHash<quint64, RideFileResampled> resampled_; // by series, interval and fill
+        QMutex resampledLock;
+
         // data required to compute headwind based on weather broadcast
         double windSpeed_, windHeading_;
 };
@@ -628,6 +659,10 @@ struct RideFileReader {
     // if hasWrite capability should re-implement writeRideFile and hasWrite
     virtual bool hasWrite() const { return false; }
     virtual bool writeRideFile(Context *, const RideFile *, QFile &) const { return false; }
+
+    // write to any open sink (socket, http response, buffer) as it goes rather
+    // than via a file, the default writes a temporary file and copies it across
+    virtual bool streamRideFile(Context *, const RideFile *, QIODevice &) const;
 };
 
 class MetricAggregator;
@@ -663,6 +698,7 @@ class RideFileFactory {
                            RideFileReader *reader);
         RideFile *openRideFile(Context *context, QFile &file, QStringList &errors, QList<RideFile*>* = 0) const;
         bool writeRideFile(Context *context, const RideFile *ride, QFile &file, QString format) const;
+        bool streamRideFile(Context *context, const RideFile *ride, QIODevice &out, QString format) const;
         QStringList suffixes() const;
         QStringList writeSuffixes() const;
         bool supportedFormat(QString filename) const;
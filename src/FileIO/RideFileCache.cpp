@@ -17,6 +17,8 @@
  */
 
 #include "RideFileCache.h"
+#include "MeanMaxIndex.h"
+#include "RideFileColumns.h"
 #include "MainWindow.h"
 #include "Context.h"
 #include "Athlete.h"
@@ -28,10 +30,15 @@
 #include "LTMSettings.h" // getAllBestsFor needs this
 
 #include <cmath> // for pow()
+#include <cstring> // for memcpy()
 #include <QDebug>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QMessageBox>
 #include <QtAlgorithms> // for qStableSort
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QTimer>
 
 static const int maxcache = 25; // lets max out at 25 caches
 
@@ -211,115 +218,128 @@ RideFileCache::checkStale(Context *context, RideItem*item)
     return true;
 }
 
-// returns offset from end of head
-static long offsetForMeanMax(RideFileCacheHeader head, RideFile::SeriesType series)
+//
+// MEMORY MAPPED ACCESS
+//
+RideFileCacheMap::RideFileCacheMap(QString cacheFileName) : file(cacheFileName), data(NULL), index(NULL)
 {
-    long offset = 0;
+    if (file.open(QIODevice::ReadOnly) == false) return;
+
+    qint64 size = file.size();
+    if (size < qint64(sizeof(RideFileCacheHeader) + sizeof(RideFileCacheIndex))) {
+        file.close();
+        return;
+    }
 
+    uchar *mapped = file.map(0, size);
+    if (mapped == NULL) {
+        file.close();
+        return;
+    }
+
+    // current version and the index looks sane ?
+    const RideFileCacheHeader *head = (const RideFileCacheHeader*)mapped;
+    const RideFileCacheIndex *idx = (const RideFileCacheIndex*)(mapped + sizeof(RideFileCacheHeader));
+    bool valid = head->version == RideFileCacheVersion &&
+                 idx->magic == RideFileCacheMagic &&
+                 idx->blocks == RideFileCacheBlocks;
+
+    for (int i=0; valid && i<RideFileCacheBlocks; i++) {
+        if (idx->block[i].offset % sizeof(float) ||
+            qint64(idx->block[i].offset) + (qint64(idx->block[i].count) * qint64(sizeof(float))) > size)
+            valid = false;
+    }
+
+    if (!valid) {
+        file.unmap(mapped);
+        file.close();
+        return;
+    }
+
+    data = mapped;
+    index = idx;
+}
+
+RideFileCacheMap::~RideFileCacheMap()
+{
+    if (data) file.unmap(const_cast<uchar*>(data));
+    file.close();
+}
+
+const float *
+RideFileCacheMap::block(RideFileCacheBlockId id, int &count) const
+{
+    count = 0;
+    if (data == NULL || id < 0 || id >= RideFileCacheBlocks) return NULL;
+
+    count = index->block[id].count;
+    return (const float*)(data + index->block[id].offset);
+}
+
+RideFileCacheBlockId
+RideFileCacheMap::meanMaxBlock(RideFile::SeriesType series)
+{
     switch (series) {
-    case RideFile::aPowerKg : offset += head.aPowerMeanMaxCount * sizeof(float); // intentional fallthrough
-    case RideFile::aPower : offset += head.vamMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::vam : offset += head.npMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::IsoPower : offset += head.xPowerMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::xPower : offset += head.kphMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::hrd : offset += head.hrdMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::nmd : offset += head.nmdMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::cadd : offset += head.caddMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::wattsd : offset += head.wattsdMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::kphd : offset += head.kphdMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::kph : offset += head.nmMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::nm : offset += head.cadMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::cad : offset += head.hrMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::hr : offset += head.wattsKgMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::wattsKg : offset += head.wattsMeanMaxCount * sizeof(float);  // intentional fallthrough
-    case RideFile::watts : offset += 0;  // intentional fallthrough
+    case RideFile::watts : return wattsMeanMaxBlock;
+    case RideFile::wattsKg : return wattsKgMeanMaxBlock;
+    case RideFile::hr : return hrMeanMaxBlock;
+    case RideFile::cad : return cadMeanMaxBlock;
+    case RideFile::nm : return nmMeanMaxBlock;
+    case RideFile::kph : return kphMeanMaxBlock;
+    case RideFile::kphd : return kphdMeanMaxBlock;
+    case RideFile::wattsd : return wattsdMeanMaxBlock;
+    case RideFile::cadd : return caddMeanMaxBlock;
+    case RideFile::nmd : return nmdMeanMaxBlock;
+    case RideFile::hrd : return hrdMeanMaxBlock;
+    case RideFile::xPower : return xPowerMeanMaxBlock;
+    case RideFile::IsoPower : return npMeanMaxBlock;
+    case RideFile::vam : return vamMeanMaxBlock;
+    case RideFile::aPower : return aPowerMeanMaxBlock;
+    case RideFile::aPowerKg : return aPowerKgMeanMaxBlock;
     default:
         break;
     }
+    return RideFileCacheBlocks;
+}
 
-    return offset;
-}
-
-//offset to tiz table
-static long offsetForTiz(RideFileCacheHeader head, RideFile::SeriesType series)
-{
-    long offset = 0;
-
-    // skip past the mean max arrays
-    offset += head.aPowerKgMeanMaxCount * sizeof(float);
-    offset += head.aPowerMeanMaxCount * sizeof(float);
-    offset += head.vamMeanMaxCount * sizeof(float);
-    offset += head.npMeanMaxCount * sizeof(float);
-    offset += head.xPowerMeanMaxCount * sizeof(float);
-    offset += head.hrdMeanMaxCount * sizeof(float);
-    offset += head.nmdMeanMaxCount * sizeof(float);
-    offset += head.caddMeanMaxCount * sizeof(float);
-    offset += head.wattsdMeanMaxCount * sizeof(float);
-    offset += head.kphdMeanMaxCount * sizeof(float);
-    offset += head.kphMeanMaxCount * sizeof(float);
-    offset += head.nmMeanMaxCount * sizeof(float);
-    offset += head.cadMeanMaxCount * sizeof(float);
-    offset += head.hrMeanMaxCount * sizeof(float);
-    offset += head.wattsKgMeanMaxCount * sizeof(float);
-    offset += head.wattsMeanMaxCount * sizeof(float);
-
-    // skip past the distribution arrays
-    offset += head.wattsDistCount * sizeof(float);
-    offset += head.hrDistCount * sizeof(float);
-    offset += head.cadDistCount * sizeof(float);
-    offset += head.gearDistCount * sizeof(float);
-    offset += head.nmDistrCount * sizeof(float);
-    offset += head.kphDistCount * sizeof(float);
-    offset += head.xPowerDistCount * sizeof(float);
-    offset += head.npDistCount * sizeof(float);
-    offset += head.wattsKgDistCount * sizeof(float);
-    offset += head.aPowerDistCount * sizeof(float);
-    offset += head.smo2DistCount * sizeof(float);
-    offset += head.wbalDistCount * sizeof(float);
-
-    // tiz ist currently just for RideFile:watts, RideFile:hr, RideFile:kph and RideFile:wbal
-    // watts is first - so move on with offset only for 'hr' and 'kph' and 'wbal'
-    // structure for "tiz" data - watts(10)/CPwatts(4)/HR(10)/CPhr(4)/PACE(10)/CPpace
-    if (series == RideFile::hr) offset += (10+4) * sizeof(float);
-    if (series == RideFile::kph) offset += 2*(10+4) * sizeof(float);
-    if (series == RideFile::wbal) offset += 3*(10+4) * sizeof(float);
-
-    return offset;
-}
-
-
-// returns offset from end of head
-static long countForMeanMax(RideFileCacheHeader head, RideFile::SeriesType series)
+RideFileCacheBlockId
+RideFileCacheMap::distributionBlock(RideFile::SeriesType series)
 {
     switch (series) {
-    case RideFile::aPowerKg : return head.aPowerKgMeanMaxCount;
-    case RideFile::aPower : return head.aPowerMeanMaxCount;
-    case RideFile::wattsKg : return head.wattsKgMeanMaxCount;
-    case RideFile::vam : return head.vamMeanMaxCount;
-    case RideFile::IsoPower : return head.npMeanMaxCount;
-    case RideFile::xPower :  return head.xPowerMeanMaxCount;
-    case RideFile::kph :  return head.kphMeanMaxCount;
-    case RideFile::kphd :  return head.kphdMeanMaxCount;
-    case RideFile::wattsd :  return head.wattsdMeanMaxCount;
-    case RideFile::cadd :  return head.caddMeanMaxCount;
-    case RideFile::nmd :  return head.nmdMeanMaxCount;
-    case RideFile::hrd :  return head.hrdMeanMaxCount;
-    case RideFile::nm :  return head.nmMeanMaxCount;
-    case RideFile::cad :  return head.cadMeanMaxCount;
-    case RideFile::hr :  return head.hrMeanMaxCount;
-    case RideFile::watts :  return head.wattsMeanMaxCount;
+    case RideFile::watts : return wattsDistBlock;
+    case RideFile::hr : return hrDistBlock;
+    case RideFile::cad : return cadDistBlock;
+    case RideFile::gear : return gearDistBlock;
+    case RideFile::nm : return nmDistBlock;
+    case RideFile::kph : return kphDistBlock;
+    case RideFile::xPower : return xPowerDistBlock;
+    case RideFile::IsoPower : return npDistBlock;
+    case RideFile::wattsKg : return wattsKgDistBlock;
+    case RideFile::aPower : return aPowerDistBlock;
+    case RideFile::smo2 : return smo2DistBlock;
+    case RideFile::wbal : return wbalDistBlock;
     default:
         break;
     }
+    return RideFileCacheBlocks;
+}
 
-    return 0;
+// tiz is currently just for RideFile:watts, RideFile:hr, RideFile:kph (pace) and RideFile:wbal
+RideFileCacheBlockId
+RideFileCacheMap::tizBlock(RideFile::SeriesType series)
+{
+    switch (series) {
+    case RideFile::hr : return hrTizBlock;
+    case RideFile::kph : return paceTizBlock;
+    case RideFile::wbal : return wbalTizBlock;
+    default : return wattsTizBlock;
+    }
 }
 
 QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float> &wpk, QDate from, QDate to, QVector<QDate>*dates, QString sport)
 {
-    QVector<float> returning;
-    QVector<float> returningwpk;
-    bool first = true;
+    QStringList filenames;
+    QVector<QDate> rideDates;
 
     // look at all the rides
     foreach (RideItem *item, context->athlete->rideCache->rides()) {
@@ -328,16 +348,33 @@ QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float> &
 
         if (item->sport != sport) continue; // they don't want these
 
+        filenames << item->fileName;
+        rideDates << item->dateTime.date();
+    }
+
+    return meanMaxPowerFor(context, wpk, filenames, rideDates, dates);
+}
+
+QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float> &wpk, const QStringList &filenames,
+                                              const QVector<QDate> &rideDates, QVector<QDate> *dates)
+{
+    QVector<float> returning;
+    QVector<float> returningwpk;
+    bool first = true;
+    QString path = context->athlete->home->activities().canonicalPath() + "/";
+
+    for (int r=0; r<filenames.count(); r++) {
+
         // get the power data
         if (first == true) {
 
             // first time through the whole thing is going to be best
-            returning =  meanMaxPowerFor(context, returningwpk, context->athlete->home->activities().canonicalPath() + "/" + item->fileName);
+            returning =  meanMaxPowerFor(context, returningwpk, path + filenames[r]);
 
             // set a;; dates to this
             if (dates) {
                 dates->resize(returning.size());
-                for(int i=0; i<dates->size(); i++) (*dates)[i]=item->dateTime.date();
+                for(int i=0; i<dates->size(); i++) (*dates)[i]=rideDates[r];
             }
             first = false;
 
@@ -346,7 +383,7 @@ QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float> &
             QVector<float> thiswpk;
 
             // next time through we should only pick out better times
-            QVector<float> ridebest = meanMaxPowerFor(context, thiswpk, context->athlete->home->activities().canonicalPath() + "/" + item->fileName);
+            QVector<float> ridebest = meanMaxPowerFor(context, thiswpk, path + filenames[r]);
 
             // do we need to increase the returning array?
             if (returning.size() < ridebest.size()) returning.resize(ridebest.size());
@@ -356,7 +393,7 @@ QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float> &
             for (int i=0; i<ridebest.size(); i++) {
                 if (ridebest[i] > returning[i]) {
                     returning[i] = ridebest[i];
-                    (*dates)[i]=item->dateTime.date();
+                    if (dates) (*dates)[i]=rideDates[r];
                 }
            }
 
@@ -376,53 +413,27 @@ QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float> &
 
 QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float>&wpk, QString fileName)
 {
-    QElapsedTimer start;
-    start.start();
-
     QVector<float> returning;
 
     // Get info for ride file and cache file
     QFileInfo rideFileInfo(fileName);
     QString cacheFilename = context->athlete->home->cache().canonicalPath() + "/" + rideFileInfo.baseName() + ".cpx";
-    QFileInfo cacheFileInfo(cacheFilename);
-
-    // is it up-to-date?
-    if (cacheFileInfo.exists() && cacheFileInfo.size() >= (int)sizeof(struct RideFileCacheHeader)) {
-
-        // we have a file, it is more recent than the ride file
-        // but is it the latest version?
-        RideFileCacheHeader head;
-        QFile cacheFile(cacheFilename);
-        if (cacheFile.open(QIODevice::ReadOnly) == true) {
-
-            // read the header
-            QDataStream inFile(&cacheFile);
-            inFile.readRawData((char *) &head, sizeof(head));
 
-            // check its an up to date format and contains power
-            if (head.version == RideFileCacheVersion && head.wattsMeanMaxCount > 0) {
+    // will be invalid if no up to date cache
+    RideFileCacheMap map(cacheFilename);
+    if (map.isValid()) {
 
-                // seek to start of meanmax array in the cache
-                long offset = offsetForMeanMax(head, RideFile::watts) + sizeof(head);
-                cacheFile.seek(qint64(offset));
-
-                // read from cache and put straight into QVector memory
-                // a little naughty but seems to work ok
-                returning.resize(head.wattsMeanMaxCount);
-                inFile.readRawData((char*)returning.constData(), head.wattsMeanMaxCount * sizeof(float));
-
-                offset = offsetForMeanMax(head, RideFile::wattsKg) + sizeof(head);
-                cacheFile.seek(qint64(offset));
-
-                wpk.resize(head.wattsKgMeanMaxCount);
-                inFile.readRawData((char*)wpk.constData(), head.wattsKgMeanMaxCount * sizeof(float));
-                for(int i=0; i<wpk.size(); i++) wpk[i] = wpk[i] / 100.00f;
+        int count = 0;
+        const float *watts = map.block(wattsMeanMaxBlock, count);
 
-                //qDebug()<<"retrieved:"<<head.wattsMeanMaxCount<<"in:"<<start.elapsed()<<"ms";
-            }
+        // check it contains power
+        if (count > 0) {
+            returning.resize(count);
+            memcpy(returning.data(), watts, count * sizeof(float));
 
-            // we're done reading
-            cacheFile.close();
+            const float *wattsKg = map.block(wattsKgMeanMaxBlock, count);
+            wpk.resize(count);
+            for(int i=0; i<count; i++) wpk[i] = wattsKg[i] / 100.00f;
         }
     }
 
@@ -436,44 +447,17 @@ QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float>&w
 // API bests for a ride
 QVector<float> RideFileCache::meanMaxFor(QString cacheFilename, RideFile::SeriesType series)
 {
-    QElapsedTimer start;
-    start.start();
-
     QVector<float> returning;
 
-    // Get info for ride file and cache file
-    QFileInfo cacheFileInfo(cacheFilename);
-
-    // is it up-to-date?
-    if (cacheFileInfo.exists() && cacheFileInfo.size() >= (int)sizeof(struct RideFileCacheHeader)) {
-
-        // we have a file, it is more recent than the ride file
-        // but is it the latest version?
-        RideFileCacheHeader head;
-        QFile cacheFile(cacheFilename);
-        if (cacheFile.open(QIODevice::ReadOnly) == true) {
-
-            // read the header
-            QDataStream inFile(&cacheFile);
-            inFile.readRawData((char *) &head, sizeof(head));
-
-            int count = countForMeanMax(head, series);
-
-            // check its an up to date format and contains power
-            if (head.version == RideFileCacheVersion && count>0) {
-
-                // seek to start of meanmax array in the cache
-                long offset = offsetForMeanMax(head, series) + sizeof(head);
-                cacheFile.seek(qint64(offset));
+    // will be invalid if no up to date cache
+    RideFileCacheMap map(cacheFilename);
+    if (map.isValid()) {
 
-                // read from cache and put straight into QVector memory
-                // a little naughty but seems to work ok
-                returning.resize(count);
-                inFile.readRawData((char*)returning.constData(), count * sizeof(float));
-            }
-
-            // we're done reading
-            cacheFile.close();
+        int count = 0;
+        const float *values = map.block(RideFileCacheMap::meanMaxBlock(series), count);
+        if (count > 0) {
+            returning.resize(count);
+            memcpy(returning.data(), values, count * sizeof(float));
         }
     }
 
@@ -716,129 +700,153 @@ QList<RideFile::SeriesType> RideFileCache::meanMaxList()
 QVector<double> &
 RideFileCache::meanMaxArray(RideFile::SeriesType series)
 {
+    QVector<double> *returning;
+
     switch (series) {
 
         case RideFile::watts:
-            return wattsMeanMaxDouble;
+            returning = &wattsMeanMaxDouble;
             break;
 
         case RideFile::cad:
-            return cadMeanMaxDouble;
+            returning = &cadMeanMaxDouble;
             break;
 
         case RideFile::hr:
-            return hrMeanMaxDouble;
+            returning = &hrMeanMaxDouble;
             break;
 
         case RideFile::nm:
-            return nmMeanMaxDouble;
+            returning = &nmMeanMaxDouble;
             break;
 
         case RideFile::kph:
-            return kphMeanMaxDouble;
+            returning = &kphMeanMaxDouble;
             break;
 
         case RideFile::kphd:
-            return kphdMeanMaxDouble;
+            returning = &kphdMeanMaxDouble;
             break;
 
         case RideFile::wattsd:
-            return wattsdMeanMaxDouble;
+            returning = &wattsdMeanMaxDouble;
             break;
 
         case RideFile::cadd:
-            return caddMeanMaxDouble;
+            returning = &caddMeanMaxDouble;
             break;
 
         case RideFile::nmd:
-            return nmdMeanMaxDouble;
+            returning = &nmdMeanMaxDouble;
             break;
 
         case RideFile::hrd:
-            return hrdMeanMaxDouble;
+            returning = &hrdMeanMaxDouble;
             break;
 
         case RideFile::xPower:
-            return xPowerMeanMaxDouble;
+            returning = &xPowerMeanMaxDouble;
             break;
 
         case RideFile::IsoPower:
-            return npMeanMaxDouble;
+            returning = &npMeanMaxDouble;
             break;
 
         case RideFile::vam:
-            return vamMeanMaxDouble;
+            returning = &vamMeanMaxDouble;
             break;
 
         case RideFile::aPower:
-            return aPowerMeanMaxDouble;
+            returning = &aPowerMeanMaxDouble;
             break;
 
         case RideFile::aPowerKg:
-            return aPowerKgMeanMaxDouble;
+            returning = &aPowerKgMeanMaxDouble;
             break;
 
         case RideFile::wattsKg:
-            return wattsKgMeanMaxDouble;
+            returning = &wattsKgMeanMaxDouble;
             break;
 
         default:
             //? dunno give em power anyway
-            return wattsMeanMaxDouble;
+            returning = &wattsMeanMaxDouble;
+            series = RideFile::watts;
             break;
     }
+
+    // when mapped from disk we unpack on first use
+    if (map && returning->isEmpty()) {
+        int count = 0;
+        const float *values = meanMaxView(series, count);
+        double divisor = pow(10, decimalsFor(series));
+        returning->resize(count);
+        for (int i=0; i<count; i++) (*returning)[i] = double(values[i]) / divisor;
+    }
+    return *returning;
 }
 
 QVector<double> &
 RideFileCache::distributionArray(RideFile::SeriesType series)
 {
+    QVector<double> *returning;
+
     switch (series) {
 
         case RideFile::watts:
-            return wattsDistributionDouble;
+            returning = &wattsDistributionDouble;
             break;
 
         case RideFile::cad:
-            return cadDistributionDouble;
+            returning = &cadDistributionDouble;
             break;
 
        case RideFile::gear:
-           return gearDistributionDouble;
+           returning = &gearDistributionDouble;
            break;
 
         case RideFile::hr:
-            return hrDistributionDouble;
+            returning = &hrDistributionDouble;
             break;
 
         case RideFile::nm:
-            return nmDistributionDouble;
+            returning = &nmDistributionDouble;
             break;
 
         case RideFile::kph:
-            return kphDistributionDouble;
+            returning = &kphDistributionDouble;
             break;
 
         case RideFile::aPower:
-            return aPowerDistributionDouble;
+            returning = &aPowerDistributionDouble;
             break;
 
         case RideFile::smo2:
-            return smo2DistributionDouble;
+            returning = &smo2DistributionDouble;
             break;
 
         case RideFile::wbal:
-            return wbalDistributionDouble;
+            returning = &wbalDistributionDouble;
             break;
 
         case RideFile::wattsKg:
-            return wattsKgDistributionDouble;
+            returning = &wattsKgDistributionDouble;
             break;
 
         default:
             //? dunno give em power anyway
-            return wattsMeanMaxDouble;
+            return meanMaxArray(RideFile::watts);
             break;
     }
+
+    // when mapped from disk we unpack on first use
+    if (map && returning->isEmpty()) {
+        int count = 0;
+        const float *values = distributionView(series, count);
+        returning->resize(count);
+        for (int i=0; i<count; i++) (*returning)[i] = double(values[i]);
+    }
+    return *returning;
 }
 
 RideFileCache *
@@ -858,8 +866,9 @@ RideFileCache::refreshCache()
     // set head crc
     crc = RideFile::computeFileCRC(rideFileName);
 
-    // update cache!
-    QFile cacheFile(cacheFileName);
+    // update cache! -- we write a new file and swap it in, rather
+    // than truncate, since it may be memory mapped by a reader
+    QSaveFile cacheFile(cacheFileName);
 
     if (cacheFile.open(QIODevice::WriteOnly) == true) {
 
@@ -873,11 +882,12 @@ RideFileCache::refreshCache()
         serialize(&outFile);
 
         // all done now, phew
-        cacheFile.close();
+        if (!cacheFile.commit()) qDebug()<<"cannot replace cache file"<<cacheFileName;
 
         // invalidate any incore cache of aggregate
         // that contains this ride in its date range
         QDate date = ride->startTime().date();
+        if (context->athlete->meanMaxIndex) context->athlete->meanMaxIndex->invalidate(date);
         for (int i=0; i<context->athlete->cpxCache.count();) {
             if (date >= context->athlete->cpxCache.at(i)->start &&
                 date <= context->athlete->cpxCache.at(i)->end) {
@@ -928,6 +938,9 @@ void RideFileCache::RideFileCache::compute()
         return;
     }
 
+    // we're computing from the ride now, not viewing the cache file
+    map.clear();
+
     // all the mean maxes
     MeanMaxComputer thread1(ride, wattsMeanMax, RideFile::watts); thread1.start();
     MeanMaxComputer thread2(ride, hrMeanMax, RideFile::hr); thread2.start();
@@ -1127,6 +1140,8 @@ void RideFileCache::RideFileCache::compute()
        useful optimization if the windows are reused per the previous
        idea.
 
+   The search itself is in MeanMaxKernel.cpp, where it is vectorised.
+
 */
 
 static data_t *
@@ -1146,85 +1161,6 @@ integrate_series(cpintdata &data)
     return integrated;
 }
 
-static data_t
-partial_max_mean(data_t *dataseries_i, int start, int end, int length, int *offset)
-{
-    int i=0;
-    data_t candidate=0;
-
-    int best_i=0;
-
-    for (i=start; i<(1+end-length); i++) {
-        data_t test_energy=dataseries_i[length+i]-dataseries_i[i];
-        if (test_energy>candidate) {
-            candidate=test_energy;
-            best_i=i;
-        }
-    }
-    if (offset) *offset=best_i;
-
-    return candidate;
-}
-
-
-static data_t
-divided_max_mean(data_t *dataseries_i, int datalength, int length, int *offset)
-{
-    int shift=length;
-
-    //if sorting data the following is an important speedup hack
-    if (shift>180) shift=180;
-
-    int window_length=length+shift;
-
-    if (window_length>datalength) window_length=datalength;
-
-    // put down as many windows as will fit without overrunning data
-    int start=0;
-    int end=0;
-    data_t energy=0;
-
-    data_t candidate=0;
-    int this_offset=0;
-
-    for (start=0; start+window_length<=datalength; start+=shift) {
-        end=start+window_length;
-        energy=dataseries_i[end]-dataseries_i[start];
-
-        if (energy < candidate) {
-          continue;
-        }
-        data_t window_mm=partial_max_mean(dataseries_i, start, end, length, &this_offset);
-
-        if (window_mm>candidate) {
-            candidate=window_mm;
-            if (offset) *offset=this_offset;
-        }
-    }
-
-    // if the overlapping windows don't extend to the end of the data,
-    // let's tack another one on at the end
-
-    if (end<datalength) {
-        start=datalength-window_length;
-        end=datalength;
-        energy=dataseries_i[end]-dataseries_i[start];
-
-        if (energy >= candidate) {
-
-            data_t window_mm=partial_max_mean(dataseries_i, start, end, length, &this_offset);
-
-            if (window_mm>candidate) {
-                candidate=window_mm;
-                if (offset) *offset=this_offset;
-            }
-        }
-    }
-
-    return candidate;
-}
-
-
 void
 MeanMaxComputer::run()
 {
@@ -1414,10 +1350,14 @@ MeanMaxComputer::run()
 
     data_t *dataseries_i = integrate_series(data);
 
-    for (int i=1; i<data.points.size();) {
+    // best totals for every duration searched, in one go
+    QVector<data_t> totals(data.points.size()+1);
+    MeanMaxKernel::search(dataseries_i, data.points.size(), totals.data(), NULL);
+    free(dataseries_i);
 
-        int offset;
-        data_t c=divided_max_mean(dataseries_i,data.points.size(),i,&offset);
+    for (int i=1; i<data.points.size(); i = MeanMaxKernel::nextLength(i)) {
+
+        data_t c=totals[i];
 
         // snaffle it away
         int sec = i*ride->recIntSecs();
@@ -1429,17 +1369,7 @@ MeanMaxComputer::run()
             else
                 ride_bests[sec] = val;
         }
-
-
-        // increments to limit search scope
-        if (i<120) i++;
-        else if (i<600) i+= 2;
-        else if (i<1200) i += 5;
-        else if (i<3600) i += 20;
-        else if (i<7200) i += 120;
-        else i += 300;
     }
-    free(dataseries_i);
 
     //
     // FILL IN THE GAPS AND FILL TARGET ARRAY
@@ -1506,26 +1436,19 @@ void RideFileCache::fastSearch(QVector<int>&input, QVector<int>&ride_bests, QVec
     }
     dataseries_i[j]=acc;
 
-    // run the algorithm
-    for (int i=1; i<input.count();) {
+    // run the algorithm, every duration in one go
+    QVector<data_t> totals(input.count()+1);
+    QVector<int> offsets(input.count()+1);
+    MeanMaxKernel::search(dataseries_i, input.count(), totals.data(), offsets.data());
 
-        int offset;
-        data_t c=divided_max_mean(dataseries_i,input.count(),i,&offset);
+    for (int i=1; i<input.count(); i = MeanMaxKernel::nextLength(i)) {
 
         // snaffle it away
-        data_t val = c / (data_t)i;
+        data_t val = totals[i] / (data_t)i;
 
         // save away
         ride_bests[i] = val;
-        ride_offsets[i] = offset;
-
-        // increments to limit search scope
-        if (i<120) i++;
-        else if (i<600) i+= 2;
-        else if (i<1200) i += 5;
-        else if (i<3600) i += 20;
-        else if (i<7200) i += 120;
-        else i += 300;
+        ride_offsets[i] = offsets[i];
     }
 #ifdef Q_CC_MSVC
     delete[] dataseries_i;
@@ -1703,52 +1626,65 @@ RideFileCache::computeDistribution(QVector<float> &array, RideFile::SeriesType s
 // AGGREGATE FOR A GIVEN DATE RANGE
 //
 
-// select and update bests
-static void meanMaxAggregate(QVector<double> &into, QVector<double> &other, QVector<QDate>&dates, QDate rideDate)
+// select and update bests, straight from the other cache's view
+// so rides read from disk are never unpacked into their own arrays
+static void meanMaxAggregate(QVector<double> &into, const RideFileCache &other, RideFile::SeriesType series, QVector<QDate>&dates, QDate rideDate)
 {
-    if (into.size() < other.size()) {
-        into.resize(other.size());
-        dates.resize(other.size());
+    int count = 0;
+    const float *values = other.meanMaxView(series, count);
+    double divisor = pow(10, RideFileCache::decimalsFor(series));
+
+    if (into.size() < count) {
+        into.resize(count);
+        dates.resize(count);
     }
 
-    for (int i=0; i<other.size(); i++)
-        if (other[i] > into[i]) {
-            into[i] = other[i];
+    for (int i=0; i<count; i++) {
+        double value = double(values[i]) / divisor;
+        if (value > into[i]) {
+            into[i] = value;
             dates[i] = rideDate;
         }
+    }
 }
 
 // resize into and then sum the arrays
-static void distAggregate(QVector<double> &into, QVector<double> &other)
+static void distAggregate(QVector<double> &into, const RideFileCache &other, RideFile::SeriesType series)
 {
-    if (into.size() < other.size()) into.resize(other.size());
-    for (int i=0; i<other.size(); i++) into[i] += other[i];
+    int count = 0;
+    const float *values = other.distributionView(series, count);
+
+    if (into.size() < count) into.resize(count);
+    for (int i=0; i<count; i++) into[i] += double(values[i]);
 
 }
 
 RideFileCache::RideFileCache(Context *context, QDate start, QDate end, bool filter, QStringList files, bool onhome, RideItem *rideItem)
                : start(start), end(end), incomplete(false), context(context), rideFileName(""), ride(0)
 {
+    initRange(filter, files, onhome);
+
+    // Oh lets get from the cache if we can
+    if (fromCpxCache(rideItem)) return;
+
+    QString sport;
+    QVector<RideFileCacheRide> rides;
+    MeanMaxIndex *index = rangeRides(rideItem, rides, sport);
+
+    // callers want the answer now, charts use RideFileCacheAggregate
+    // to do this in the background and refresh when it's done
+    aggregateRange(index, sport, rides, NULL);
+    remember();
+}
 
+void
+RideFileCache::initRange(bool filter, QStringList files, bool onhome)
+{
     // remember parameters for getting heat
     this->filter = filter;
     this->files = files;
     this->onhome = onhome;
 
-    // Oh lets get from the cache if we can -- but not if filtered
-    if (!filter && !context->isfiltered && !rideItem) {
-
-        // oh and not if we're onhome and homefiltered
-        if ((onhome && !context->ishomefiltered) || !onhome) {
-            foreach(RideFileCache *p, context->athlete->cpxCache) {
-                if (p->start == start && p->end == end) {
-                    *this = *p;
-                    return;
-                }
-            }
-        }
-    }
-
     // resize all the arrays to zero - expand as neccessary
     xPowerMeanMax.resize(0);
     npMeanMax.resize(0);
@@ -1789,85 +1725,74 @@ RideFileCache::RideFileCache(Context *context, QDate start, QDate end, bool filt
     paceTimeInZone.resize(10);
     paceCPTimeInZone.resize(4);
     wbalTimeInZone.resize(4);
+}
+
+// copy an aggregate for the same dates -- but not if filtered
+bool
+RideFileCache::fromCpxCache(RideItem *rideItem)
+{
+    if (filter || context->isfiltered || rideItem) return false;
+
+    // oh and not if we're onhome and homefiltered
+    if (onhome && context->ishomefiltered) return false;
+
+    foreach(RideFileCache *p, context->athlete->cpxCache) {
+        if (p->start == start && p->end == end) {
+            *this = *p;
+            return true;
+        }
+    }
+    return false;
+}
 
-    // set cursor busy whilst we aggregate -- bit of feedback
-    // and less intrusive than a popup box
-    context->mainWindow->setCursor(Qt::WaitCursor);
+// the rides to aggregate, copied from the ride cache so this must be
+// called on the GUI thread. Returns the index to use, if any.
+MeanMaxIndex *
+RideFileCache::rangeRides(RideItem *rideItem, QVector<RideFileCacheRide> &rides, QString &sport)
+{
+    // unfiltered we can use the pre-aggregated weeks, months and years, the
+    // index uses an empty sport for all rides so can't select for no sport
+    bool unfiltered = !filter && !context->isfiltered && !(onhome && context->ishomefiltered) &&
+                      (!rideItem || rideItem->sport != "");
+    MeanMaxIndex *index = unfiltered ? context->athlete->meanMaxIndex : NULL;
+    sport = rideItem ? rideItem->sport : "";
 
     // Iterate over the ride files (not the cpx files since they /might/ not
-    // exist, or /might/ be out of date.
+    // exist, or /might/ be out of date. The index picks the rides it needs
+    // for each sport, otherwise we select them here.
     foreach (RideItem *item, context->athlete->rideCache->rides()) {
 
         QDate rideDate = item->dateTime.date();
+        if (rideDate < start || rideDate > end) continue;
 
-        if (((filter == true && files.contains(item->fileName)) || filter == false) &&
-            rideDate >= start && rideDate <= end) {
+        if (!index) {
+            if (filter == true && !files.contains(item->fileName)) continue;
 
             // skip globally filtered values
             if (context->isfiltered && !context->filters.contains(item->fileName)) continue;
             if (onhome && context->ishomefiltered && !context->homeFilters.contains(item->fileName)) continue;
             // skip other sports if rideItem is given
             if (rideItem && (rideItem->sport != item->sport)) continue;
-
-            // get its cached values (will NOT! refresh if needed...)
-            // the true means it will check only
-            RideFileCache rideCache(context, context->athlete->home->activities().canonicalPath() + "/" + item->fileName, item->getWeight(), NULL, false, false);
-            if (rideCache.incomplete == true) {
-                // ack, data not available !
-                incomplete = true;
-            } else {
-
-                // lets aggregate
-                meanMaxAggregate(wattsMeanMaxDouble, rideCache.wattsMeanMaxDouble, wattsMeanMaxDate, rideDate);
-                meanMaxAggregate(hrMeanMaxDouble, rideCache.hrMeanMaxDouble, hrMeanMaxDate, rideDate);
-                meanMaxAggregate(cadMeanMaxDouble, rideCache.cadMeanMaxDouble, cadMeanMaxDate, rideDate);
-                meanMaxAggregate(nmMeanMaxDouble, rideCache.nmMeanMaxDouble, nmMeanMaxDate, rideDate);
-                meanMaxAggregate(kphMeanMaxDouble, rideCache.kphMeanMaxDouble, kphMeanMaxDate, rideDate);
-                meanMaxAggregate(kphdMeanMaxDouble, rideCache.kphdMeanMaxDouble, kphdMeanMaxDate, rideDate);
-                meanMaxAggregate(wattsdMeanMaxDouble, rideCache.wattsdMeanMaxDouble, wattsdMeanMaxDate, rideDate);
-                meanMaxAggregate(caddMeanMaxDouble, rideCache.caddMeanMaxDouble, caddMeanMaxDate, rideDate);
-                meanMaxAggregate(nmdMeanMaxDouble, rideCache.nmdMeanMaxDouble, nmdMeanMaxDate, rideDate);
-                meanMaxAggregate(hrdMeanMaxDouble, rideCache.hrdMeanMaxDouble, hrdMeanMaxDate, rideDate);
-                meanMaxAggregate(xPowerMeanMaxDouble, rideCache.xPowerMeanMaxDouble, xPowerMeanMaxDate, rideDate);
-                meanMaxAggregate(npMeanMaxDouble, rideCache.npMeanMaxDouble, npMeanMaxDate, rideDate);
-                meanMaxAggregate(vamMeanMaxDouble, rideCache.vamMeanMaxDouble, vamMeanMaxDate, rideDate);
-                meanMaxAggregate(wattsKgMeanMaxDouble, rideCache.wattsKgMeanMaxDouble, wattsKgMeanMaxDate, rideDate);
-                meanMaxAggregate(aPowerMeanMaxDouble, rideCache.aPowerMeanMaxDouble, aPowerMeanMaxDate, rideDate);
-                meanMaxAggregate(aPowerKgMeanMaxDouble, rideCache.aPowerKgMeanMaxDouble, aPowerKgMeanMaxDate, rideDate);
-
-                distAggregate(wattsDistributionDouble, rideCache.wattsDistributionDouble);
-                distAggregate(hrDistributionDouble, rideCache.hrDistributionDouble);
-                distAggregate(cadDistributionDouble, rideCache.cadDistributionDouble);
-                distAggregate(gearDistributionDouble, rideCache.gearDistributionDouble);
-                distAggregate(nmDistributionDouble, rideCache.nmDistributionDouble);
-                distAggregate(kphDistributionDouble, rideCache.kphDistributionDouble);
-                distAggregate(xPowerDistributionDouble, rideCache.xPowerDistributionDouble);
-                distAggregate(npDistributionDouble, rideCache.npDistributionDouble);
-                distAggregate(wattsKgDistributionDouble, rideCache.wattsKgDistributionDouble);
-                distAggregate(aPowerDistributionDouble, rideCache.aPowerDistributionDouble);
-                distAggregate(smo2DistributionDouble, rideCache.smo2DistributionDouble);
-                distAggregate(wbalDistributionDouble, rideCache.wbalDistributionDouble);
-
-                // cumulate timeinzones
-                for (int i=0; i<10; i++) {
-                    paceTimeInZone[i] += rideCache.paceTimeInZone[i];
-                    hrTimeInZone[i] += rideCache.hrTimeInZone[i];
-                    wattsTimeInZone[i] += rideCache.wattsTimeInZone[i];
-                    if (i<4) {
-                        paceCPTimeInZone[i] += rideCache.paceCPTimeInZone[i];
-                        hrCPTimeInZone[i] += rideCache.hrCPTimeInZone[i];
-                        wattsCPTimeInZone[i] += rideCache.wattsCPTimeInZone[i];
-                        wbalTimeInZone[i] += rideCache.wbalTimeInZone[i];
-                    }
-                }
-            }
         }
+
+        rides << rideDetails(item);
     }
+    return index;
+}
 
-    // set the cursor back to normal
-    context->mainWindow->setCursor(Qt::ArrowCursor);
+// only reads the cpx files so can run on any thread
+void
+RideFileCache::aggregateRange(MeanMaxIndex *index, QString sport, const QVector<RideFileCacheRide> &rides,
+                              RideFileCacheProgress *progress)
+{
+    if (index) index->aggregate(this, start, end, sport, rides, progress);
+    else aggregateRides(context, this, rides, progress);
+}
 
-    // lets add to the cache for others to re-use -- but not if filtered or incomplete
+// lets add to the cache for others to re-use -- but not if filtered or incomplete
+void
+RideFileCache::remember()
+{
     if (incomplete == false && !context->isfiltered && (!context->ishomefiltered || !onhome) && !filter) {
 
         if (context->athlete->cpxCache.count() > maxcache) {
@@ -1878,6 +1803,284 @@ RideFileCache::RideFileCache(Context *context, QDate start, QDate end, bool filt
     }
 }
 
+RideFileCacheAggregate::RideFileCacheAggregate(Context *context, QDate start, QDate end, bool filter, QStringList files,
+                                               bool onhome, RideItem *rideItem, QObject *parent)
+    : QObject(parent), cache(new RideFileCache(context))
+{
+    cache->start = start;
+    cache->end = end;
+    cache->initRange(filter, files, onhome);
+
+    // already done, but still tell them later so callers only have one path
+    if (cache->fromCpxCache(rideItem)) {
+        QTimer::singleShot(0, this, SIGNAL(finished()));
+        return;
+    }
+
+    QString sport;
+    QVector<RideFileCacheRide> rides;
+    MeanMaxIndex *index = cache->rangeRides(rideItem, rides, sport);
+
+    // the ride details were copied above so nothing
+    // touches the ride cache from the background
+    RideFileCache *into = cache;
+    RideFileCacheProgress *counting = &progress;
+    connect(&watcher, SIGNAL(finished()), this, SLOT(completed()));
+    watcher.setFuture(QtConcurrent::run([into, index, sport, rides, counting]() {
+        into->aggregateRange(index, sport, rides, counting);
+    }));
+}
+
+RideFileCacheAggregate::~RideFileCacheAggregate()
+{
+    progress.abort = 1;
+    watcher.waitForFinished();
+    delete cache;
+}
+
+void
+RideFileCacheAggregate::completed()
+{
+    cache->remember();
+    emit finished();
+}
+
+RideFileCache *
+RideFileCacheAggregate::take()
+{
+    RideFileCache *returning = cache;
+    cache = NULL;
+    return returning;
+}
+
+// an empty aggregate, filled via aggregate() and merge()
+RideFileCache::RideFileCache(Context *context) :
+               incomplete(false), context(context), rideFileName(""), ride(0),
+               CP(0), WPRIME(0), LTHR(0), CV(0), WEIGHT(0), filter(false), onhome(false)
+{
+    // time in zone are fixed to 10 zone max
+    wattsTimeInZone.resize(10);
+    wattsCPTimeInZone.resize(4);
+    hrTimeInZone.resize(10);
+    hrCPTimeInZone.resize(4);
+    paceTimeInZone.resize(10);
+    paceCPTimeInZone.resize(4);
+    wbalTimeInZone.resize(4);
+}
+
+// add a single ride's cached values to this aggregate
+void
+RideFileCache::aggregate(const RideFileCache &rideCache, QDate rideDate)
+{
+    if (rideCache.incomplete == true) {
+        // ack, data not available !
+        incomplete = true;
+        return;
+    }
+
+    // lets aggregate
+    meanMaxAggregate(wattsMeanMaxDouble, rideCache, RideFile::watts, wattsMeanMaxDate, rideDate);
+    meanMaxAggregate(hrMeanMaxDouble, rideCache, RideFile::hr, hrMeanMaxDate, rideDate);
+    meanMaxAggregate(cadMeanMaxDouble, rideCache, RideFile::cad, cadMeanMaxDate, rideDate);
+    meanMaxAggregate(nmMeanMaxDouble, rideCache, RideFile::nm, nmMeanMaxDate, rideDate);
+    meanMaxAggregate(kphMeanMaxDouble, rideCache, RideFile::kph, kphMeanMaxDate, rideDate);
+    meanMaxAggregate(kphdMeanMaxDouble, rideCache, RideFile::kphd, kphdMeanMaxDate, rideDate);
+    meanMaxAggregate(wattsdMeanMaxDouble, rideCache, RideFile::wattsd, wattsdMeanMaxDate, rideDate);
+    meanMaxAggregate(caddMeanMaxDouble, rideCache, RideFile::cadd, caddMeanMaxDate, rideDate);
+    meanMaxAggregate(nmdMeanMaxDouble, rideCache, RideFile::nmd, nmdMeanMaxDate, rideDate);
+    meanMaxAggregate(hrdMeanMaxDouble, rideCache, RideFile::hrd, hrdMeanMaxDate, rideDate);
+    meanMaxAggregate(xPowerMeanMaxDouble, rideCache, RideFile::xPower, xPowerMeanMaxDate, rideDate);
+    meanMaxAggregate(npMeanMaxDouble, rideCache, RideFile::IsoPower, npMeanMaxDate, rideDate);
+    meanMaxAggregate(vamMeanMaxDouble, rideCache, RideFile::vam, vamMeanMaxDate, rideDate);
+    meanMaxAggregate(wattsKgMeanMaxDouble, rideCache, RideFile::wattsKg, wattsKgMeanMaxDate, rideDate);
+    meanMaxAggregate(aPowerMeanMaxDouble, rideCache, RideFile::aPower, aPowerMeanMaxDate, rideDate);
+    meanMaxAggregate(aPowerKgMeanMaxDouble, rideCache, RideFile::aPowerKg, aPowerKgMeanMaxDate, rideDate);
+
+    distAggregate(wattsDistributionDouble, rideCache, RideFile::watts);
+    distAggregate(hrDistributionDouble, rideCache, RideFile::hr);
+    distAggregate(cadDistributionDouble, rideCache, RideFile::cad);
+    distAggregate(gearDistributionDouble, rideCache, RideFile::gear);
+    distAggregate(nmDistributionDouble, rideCache, RideFile::nm);
+    distAggregate(kphDistributionDouble, rideCache, RideFile::kph);
+    distAggregate(xPowerDistributionDouble, rideCache, RideFile::xPower);
+    distAggregate(npDistributionDouble, rideCache, RideFile::IsoPower);
+    distAggregate(wattsKgDistributionDouble, rideCache, RideFile::wattsKg);
+    distAggregate(aPowerDistributionDouble, rideCache, RideFile::aPower);
+    distAggregate(smo2DistributionDouble, rideCache, RideFile::smo2);
+    distAggregate(wbalDistributionDouble, rideCache, RideFile::wbal);
+
+    // cumulate timeinzones
+    for (int i=0; i<10; i++) {
+        paceTimeInZone[i] += rideCache.paceTimeInZone[i];
+        hrTimeInZone[i] += rideCache.hrTimeInZone[i];
+        wattsTimeInZone[i] += rideCache.wattsTimeInZone[i];
+        if (i<4) {
+            paceCPTimeInZone[i] += rideCache.paceCPTimeInZone[i];
+            hrCPTimeInZone[i] += rideCache.hrCPTimeInZone[i];
+            wattsCPTimeInZone[i] += rideCache.wattsCPTimeInZone[i];
+            wbalTimeInZone[i] += rideCache.wbalTimeInZone[i];
+        }
+    }
+}
+
+// a run of rides aggregated by one pool thread
+struct RideFileCacheChunk {
+    Context *context;
+    QStringList filenames;
+    QVector<double> weights;
+    QVector<QDate> dates;
+    RideFileCache *result;
+    RideFileCacheProgress *progress;
+};
+
+static void aggregateChunk(RideFileCacheChunk &chunk)
+{
+    for (int i=0; i<chunk.filenames.count(); i++) {
+
+        // cancelled, whatever we have is partial
+        if (chunk.progress && chunk.progress->abort) {
+            chunk.result->incomplete = true;
+            return;
+        }
+
+        // get its cached values (will NOT! refresh if needed...)
+        RideFileCache rideCache(chunk.context, chunk.filenames[i], chunk.weights[i], NULL, false, false);
+        chunk.result->aggregate(rideCache, chunk.dates[i]);
+
+        if (chunk.progress) chunk.progress->done.ref();
+    }
+}
+
+// left is earlier, so keeps its dates on ties
+static void mergeChunks(QPair<RideFileCache*, RideFileCache*> &pair)
+{
+    pair.first->merge(*pair.second);
+}
+
+RideFileCacheRide
+RideFileCache::rideDetails(RideItem *item)
+{
+    // getWeight() may need to look at measures, so GUI thread only
+    RideFileCacheRide ride;
+    ride.fileName = item->fileName;
+    ride.sport = item->sport;
+    ride.date = item->dateTime.date();
+    ride.weight = item->getWeight();
+    ride.crc = item->crc;
+    ride.fingerprint = item->fingerprint;
+    return ride;
+}
+
+void
+RideFileCache::aggregateRides(Context *context, RideFileCache *into, const QVector<RideFileCacheRide> &rides,
+                              RideFileCacheProgress *progress)
+{
+    // rides per chunk, fixed so the sums are always added up the same way
+    static const int chunksize = 16;
+
+    if (rides.isEmpty()) return;
+    if (progress) progress->rides.fetchAndAddOrdered(rides.count());
+
+    QString path = context->athlete->home->activities().canonicalPath() + "/";
+    QVector<RideFileCacheChunk> chunks;
+    for (int i=0; i<rides.count(); i++) {
+        if (i % chunksize == 0) {
+            RideFileCacheChunk chunk;
+            chunk.context = context;
+            chunk.result = new RideFileCache(context);
+            chunk.progress = progress;
+            chunks << chunk;
+        }
+        RideFileCacheChunk &chunk = chunks.last();
+        chunk.filenames << path + rides[i].fileName;
+        chunk.weights << rides[i].weight;
+        chunk.dates << rides[i].date;
+    }
+
+    // each chunk is one task, idle threads pick up the next one
+    QtConcurrent::blockingMap(chunks, aggregateChunk);
+
+    // pairwise tree reduce, neighbours so the dates stay in order
+    for (int step=1; step < chunks.count(); step *= 2) {
+        QVector<QPair<RideFileCache*, RideFileCache*> > pairs;
+        for (int i=0; i+step < chunks.count(); i += 2*step)
+            pairs << qMakePair(chunks[i].result, chunks[i+step].result);
+        QtConcurrent::blockingMap(pairs, mergeChunks);
+    }
+
+    into->merge(*chunks[0].result);
+    foreach(RideFileCacheChunk chunk, chunks) delete chunk.result;
+}
+
+// the arrays held by an aggregate, in a fixed order for merging and persisting
+void
+RideFileCache::aggregateArrays(QList<QVector<double>*> &meanmax, QList<QVector<QDate>*> &dates,
+                               QList<QVector<double>*> &dist, QList<QVector<float>*> &tiz)
+{
+    meanmax << &wattsMeanMaxDouble << &hrMeanMaxDouble << &cadMeanMaxDouble << &nmMeanMaxDouble
+            << &kphMeanMaxDouble << &kphdMeanMaxDouble << &wattsdMeanMaxDouble << &caddMeanMaxDouble
+            << &nmdMeanMaxDouble << &hrdMeanMaxDouble << &xPowerMeanMaxDouble << &npMeanMaxDouble
+            << &vamMeanMaxDouble << &wattsKgMeanMaxDouble << &aPowerMeanMaxDouble << &aPowerKgMeanMaxDouble;
+
+    dates << &wattsMeanMaxDate << &hrMeanMaxDate << &cadMeanMaxDate << &nmMeanMaxDate
+          << &kphMeanMaxDate << &kphdMeanMaxDate << &wattsdMeanMaxDate << &caddMeanMaxDate
+          << &nmdMeanMaxDate << &hrdMeanMaxDate << &xPowerMeanMaxDate << &npMeanMaxDate
+          << &vamMeanMaxDate << &wattsKgMeanMaxDate << &aPowerMeanMaxDate << &aPowerKgMeanMaxDate;
+
+    dist << &wattsDistributionDouble << &hrDistributionDouble << &cadDistributionDouble
+         << &gearDistributionDouble << &nmDistributionDouble << &kphDistributionDouble
+         << &xPowerDistributionDouble << &npDistributionDouble << &wattsKgDistributionDouble
+         << &aPowerDistributionDouble << &smo2DistributionDouble << &wbalDistributionDouble;
+
+    tiz << &wattsTimeInZone << &wattsCPTimeInZone << &hrTimeInZone << &hrCPTimeInZone
+        << &paceTimeInZone << &paceCPTimeInZone << &wbalTimeInZone;
+}
+
+// add another aggregate to this one, the other must cover a later period
+// so that ties keep the earliest date, as they do when aggregating rides
+void
+RideFileCache::merge(RideFileCache &other)
+{
+    if (other.incomplete) incomplete = true;
+
+    QList<QVector<double>*> meanmax, othermeanmax, dist, otherdist;
+    QList<QVector<QDate>*> dates, otherdates;
+    QList<QVector<float>*> tiz, othertiz;
+    aggregateArrays(meanmax, dates, dist, tiz);
+    other.aggregateArrays(othermeanmax, otherdates, otherdist, othertiz);
+
+    for (int s=0; s<meanmax.count(); s++) {
+        QVector<double> &into = *meanmax[s];
+        QVector<QDate> &intodates = *dates[s];
+        const QVector<double> &from = *othermeanmax[s];
+        const QVector<QDate> &fromdates = *otherdates[s];
+
+        if (into.size() < from.size()) {
+            into.resize(from.size());
+            intodates.resize(from.size());
+        }
+        for (int i=0; i<from.size(); i++) {
+            if (from[i] > into[i]) {
+                into[i] = from[i];
+                intodates[i] = i < fromdates.size() ? fromdates[i] : QDate();
+            }
+        }
+    }
+
+    for (int s=0; s<dist.count(); s++) {
+        QVector<double> &into = *dist[s];
+        const QVector<double> &from = *otherdist[s];
+        if (into.size() < from.size()) into.resize(from.size());
+        for (int i=0; i<from.size(); i++) into[i] += from[i];
+    }
+
+    for (int s=0; s<tiz.count(); s++) {
+        QVector<float> &into = *tiz[s];
+        const QVector<float> &from = *othertiz[s];
+        for (int i=0; i<from.size() && i<into.size(); i++) into[i] += from[i];
+    }
+}
+
 //
 // Get heat mean max -- if an aggregated curve
 //
@@ -1905,10 +2108,11 @@ QVector<float> &RideFileCache::heatMeanMaxArray()
             // get its cached values (will refresh if needed...)
             RideFileCache rideCache(context, context->athlete->home->activities().canonicalPath() + "/" + item->fileName, item->getWeight());
 
-            for(int i=0; i<rideCache.wattsMeanMaxDouble.count() && i<wattsMeanMaxDouble.count(); i++) {
+            QVector<double> &rideBests = rideCache.meanMaxArray(RideFile::watts);
+            for(int i=0; i<rideBests.count() && i<wattsMeanMaxDouble.count(); i++) {
 
                 // is it within 10% of the best we have ?
-                if (rideCache.wattsMeanMaxDouble[i] >= (0.9f * wattsMeanMaxDouble[i]))
+                if (rideBests[i] >= (0.9f * wattsMeanMaxDouble[i]))
                     heatMeanMax[i] = heatMeanMax[i] + 1;
             }
         }
@@ -1952,7 +2156,7 @@ RideFileCache::serialize(QDataStream *out)
     head.aPowerKgMeanMaxCount = aPowerKgMeanMax.size();
     head.wattsDistCount = wattsDistribution.size();
     head.xPowerDistCount = xPowerDistribution.size();
-    head.npDistCount = xPowerDistribution.size();
+    head.npDistCount = npDistribution.size();
     head.hrDistCount = hrDistribution.size();
     head.cadDistCount = cadDistribution.size();
     head.gearDistCount = gearDistribution.size();
@@ -1963,170 +2167,142 @@ RideFileCache::serialize(QDataStream *out)
     head.smo2DistCount = smo2Distribution.size();
     head.wbalDistCount = wbalDistribution.size();
 
-    out->writeRawData((const char *) &head, sizeof(head));
+    // the blocks in file order, see RideFileCacheBlockId
+    const QVector<float> *blocks[RideFileCacheBlocks] = {
+
+        // meanmax
+        &wattsMeanMax, &wattsKgMeanMax, &hrMeanMax, &cadMeanMax,
+        &nmMeanMax, &kphMeanMax, &kphdMeanMax, &wattsdMeanMax,
+        &caddMeanMax, &nmdMeanMax, &hrdMeanMax, &xPowerMeanMax,
+        &npMeanMax, &vamMeanMax, &aPowerMeanMax, &aPowerKgMeanMax,
+
+        // dist
+        &wattsDistribution, &hrDistribution, &cadDistribution, &gearDistribution, &nmDistribution,
+        &kphDistribution, &xPowerDistribution, &npDistribution, &wattsKgDistribution,
+        &aPowerDistribution, &smo2Distribution, &wbalDistribution,
+
+        // time in zone
+        &wattsTimeInZone, &wattsCPTimeInZone, &hrTimeInZone, &hrCPTimeInZone,
+        &paceTimeInZone, &paceCPTimeInZone, &wbalTimeInZone
+    };
+
+    // work out where each block goes, the first on a page boundary
+    // and the rest aligned so they can be mapped and read directly
+    RideFileCacheIndex index;
+    memset(&index, 0, sizeof(index));
+    index.magic = RideFileCacheMagic;
+    index.blocks = RideFileCacheBlocks;
+
+    unsigned int offset = sizeof(head) + sizeof(index);
+    offset = ((offset + RideFileCachePageSize - 1) / RideFileCachePageSize) * RideFileCachePageSize;
+    for (int i=0; i<RideFileCacheBlocks; i++) {
+        index.block[i].offset = offset;
+        index.block[i].count = blocks[i]->size();
+        offset += sizeof(float) * blocks[i]->size();
+        offset = ((offset + RideFileCacheBlockAlign - 1) / RideFileCacheBlockAlign) * RideFileCacheBlockAlign;
+    }
 
-    // write meanmax
-    out->writeRawData((const char *) wattsMeanMax.data(), sizeof(float) * wattsMeanMax.size());
-    out->writeRawData((const char *) wattsKgMeanMax.data(), sizeof(float) * wattsKgMeanMax.size());
-    out->writeRawData((const char *) hrMeanMax.data(), sizeof(float) * hrMeanMax.size());
-    out->writeRawData((const char *) cadMeanMax.data(), sizeof(float) * cadMeanMax.size());
-    out->writeRawData((const char *) nmMeanMax.data(), sizeof(float) * nmMeanMax.size());
-    out->writeRawData((const char *) kphMeanMax.data(), sizeof(float) * kphMeanMax.size());
-    out->writeRawData((const char *) kphdMeanMax.data(), sizeof(float) * kphdMeanMax.size());
-    out->writeRawData((const char *) wattsdMeanMax.data(), sizeof(float) * wattsdMeanMax.size());
-    out->writeRawData((const char *) caddMeanMax.data(), sizeof(float) * caddMeanMax.size());
-    out->writeRawData((const char *) nmdMeanMax.data(), sizeof(float) * nmdMeanMax.size());
-    out->writeRawData((const char *) hrdMeanMax.data(), sizeof(float) * hrdMeanMax.size());
-    out->writeRawData((const char *) xPowerMeanMax.data(), sizeof(float) * xPowerMeanMax.size());
-    out->writeRawData((const char *) npMeanMax.data(), sizeof(float) * npMeanMax.size());
-    out->writeRawData((const char *) vamMeanMax.data(), sizeof(float) * vamMeanMax.size());
-    out->writeRawData((const char *) aPowerMeanMax.data(), sizeof(float) * aPowerMeanMax.size());
-    out->writeRawData((const char *) aPowerKgMeanMax.data(), sizeof(float) * aPowerKgMeanMax.size());
-
-
-    // write dist
-    out->writeRawData((const char *) wattsDistribution.data(), sizeof(float) * wattsDistribution.size());
-    out->writeRawData((const char *) hrDistribution.data(), sizeof(float) * hrDistribution.size());
-    out->writeRawData((const char *) cadDistribution.data(), sizeof(float) * cadDistribution.size());
-    out->writeRawData((const char *) gearDistribution.data(), sizeof(float) * gearDistribution.size());
-    out->writeRawData((const char *) nmDistribution.data(), sizeof(float) * nmDistribution.size());
-    out->writeRawData((const char *) kphDistribution.data(), sizeof(float) * kphDistribution.size());
-    out->writeRawData((const char *) xPowerDistribution.data(), sizeof(float) * xPowerDistribution.size());
-    out->writeRawData((const char *) npDistribution.data(), sizeof(float) * npDistribution.size());
-    out->writeRawData((const char *) wattsKgDistribution.data(), sizeof(float) * wattsKgDistribution.size());
-    out->writeRawData((const char *) aPowerDistribution.data(), sizeof(float) * aPowerDistribution.size());
-    out->writeRawData((const char *) smo2Distribution.data(), sizeof(float) * smo2Distribution.size());
-    out->writeRawData((const char *) wbalDistribution.data(), sizeof(float) * wbalDistribution.size());
-
-    // time in zone
-    out->writeRawData((const char *) wattsTimeInZone.data(), sizeof(float) * wattsTimeInZone.size());
-    out->writeRawData((const char *) wattsCPTimeInZone.data(), sizeof(float) * wattsCPTimeInZone.size());
-    out->writeRawData((const char *) hrTimeInZone.data(), sizeof(float) * hrTimeInZone.size());
-    out->writeRawData((const char *) hrCPTimeInZone.data(), sizeof(float) * hrCPTimeInZone.size());
-    out->writeRawData((const char *) paceTimeInZone.data(), sizeof(float) * paceTimeInZone.size());
-    out->writeRawData((const char *) paceCPTimeInZone.data(), sizeof(float) * paceCPTimeInZone.size());
-    out->writeRawData((const char *) wbalTimeInZone.data(), sizeof(float) * wbalTimeInZone.size());
+    out->writeRawData((const char *) &head, sizeof(head));
+    out->writeRawData((const char *) &index, sizeof(index));
+
+    // write the blocks, padding up to each offset
+    static const char padding[RideFileCachePageSize] = { 0 };
+    unsigned int written = sizeof(head) + sizeof(index);
+    for (int i=0; i<RideFileCacheBlocks; i++) {
+        out->writeRawData(padding, index.block[i].offset - written);
+        out->writeRawData((const char *) blocks[i]->constData(), sizeof(float) * blocks[i]->size());
+        written = index.block[i].offset + sizeof(float) * blocks[i]->size();
+    }
 }
 
 void
 RideFileCache::readCache()
 {
-    RideFileCacheHeader head;
-    QFile cacheFile(cacheFileName);
-
-    if (cacheFile.open(QIODevice::ReadOnly) == true) {
-        QDataStream inFile(&cacheFile);
-
-        inFile.readRawData((char *) &head, sizeof(head));
-
-        // resize all the arrays to fit
-        wattsMeanMax.resize(head.wattsMeanMaxCount);
-        hrMeanMax.resize(head.hrMeanMaxCount);
-        cadMeanMax.resize(head.cadMeanMaxCount);
-        nmMeanMax.resize(head.nmMeanMaxCount);
-        kphMeanMax.resize(head.kphMeanMaxCount);
-        kphdMeanMax.resize(head.kphdMeanMaxCount);
-        wattsdMeanMax.resize(head.wattsdMeanMaxCount);
-        caddMeanMax.resize(head.caddMeanMaxCount);
-        nmdMeanMax.resize(head.nmdMeanMaxCount);
-        hrdMeanMax.resize(head.hrdMeanMaxCount);
-        npMeanMax.resize(head.npMeanMaxCount);
-        vamMeanMax.resize(head.vamMeanMaxCount);
-        xPowerMeanMax.resize(head.xPowerMeanMaxCount);
-        wattsKgMeanMax.resize(head.wattsKgMeanMaxCount);
-        aPowerMeanMax.resize(head.aPowerMeanMaxCount);
-        aPowerKgMeanMax.resize(head.aPowerKgMeanMaxCount);
-
-        wattsDistribution.resize(head.wattsDistCount);
-        hrDistribution.resize(head.hrDistCount);
-        cadDistribution.resize(head.cadDistCount);
-        gearDistribution.resize(head.gearDistCount);
-        nmDistribution.resize(head.nmDistrCount);
-        kphDistribution.resize(head.kphDistCount);
-        xPowerDistribution.resize(head.xPowerDistCount);
-        npDistribution.resize(head.npDistCount);
-        wattsKgDistribution.resize(head.wattsKgDistCount);
-        aPowerDistribution.resize(head.aPowerDistCount);
-        smo2Distribution.resize(head.smo2DistCount);
-        wbalDistribution.resize(head.wbalDistCount);
-
-        // read in the arrays
-        inFile.readRawData((char *) wattsMeanMax.data(), sizeof(float) * wattsMeanMax.size());
-        inFile.readRawData((char *) wattsKgMeanMax.data(), sizeof(float) * wattsKgMeanMax.size());
-        inFile.readRawData((char *) hrMeanMax.data(), sizeof(float) * hrMeanMax.size());
-        inFile.readRawData((char *) cadMeanMax.data(), sizeof(float) * cadMeanMax.size());
-        inFile.readRawData((char *) nmMeanMax.data(), sizeof(float) * nmMeanMax.size());
-        inFile.readRawData((char *) kphMeanMax.data(), sizeof(float) * kphMeanMax.size());
-        inFile.readRawData((char *) kphdMeanMax.data(), sizeof(float) * kphdMeanMax.size());
-        inFile.readRawData((char *) wattsdMeanMax.data(), sizeof(float) * wattsdMeanMax.size());
-        inFile.readRawData((char *) caddMeanMax.data(), sizeof(float) * caddMeanMax.size());
-        inFile.readRawData((char *) nmdMeanMax.data(), sizeof(float) * nmdMeanMax.size());
-        inFile.readRawData((char *) hrdMeanMax.data(), sizeof(float) * hrdMeanMax.size());
-        inFile.readRawData((char *) xPowerMeanMax.data(), sizeof(float) * xPowerMeanMax.size());
-        inFile.readRawData((char *) npMeanMax.data(), sizeof(float) * npMeanMax.size());
-        inFile.readRawData((char *) vamMeanMax.data(), sizeof(float) * vamMeanMax.size());
-        inFile.readRawData((char *) aPowerMeanMax.data(), sizeof(float) * aPowerMeanMax.size());
-        inFile.readRawData((char *) aPowerKgMeanMax.data(), sizeof(float) * aPowerKgMeanMax.size());
-
-
-        // write dist
-        inFile.readRawData((char *) wattsDistribution.data(), sizeof(float) * wattsDistribution.size());
-        inFile.readRawData((char *) hrDistribution.data(), sizeof(float) * hrDistribution.size());
-        inFile.readRawData((char *) cadDistribution.data(), sizeof(float) * cadDistribution.size());
-        inFile.readRawData((char *) gearDistribution.data(), sizeof(float) * gearDistribution.size());
-        inFile.readRawData((char *) nmDistribution.data(), sizeof(float) * nmDistribution.size());
-        inFile.readRawData((char *) kphDistribution.data(), sizeof(float) * kphDistribution.size());
-        inFile.readRawData((char *) xPowerDistribution.data(), sizeof(float) * xPowerDistribution.size());
-        inFile.readRawData((char *) npDistribution.data(), sizeof(float) * npDistribution.size());
-        inFile.readRawData((char *) wattsKgDistribution.data(), sizeof(float) * wattsKgDistribution.size());
-        inFile.readRawData((char *) aPowerDistribution.data(), sizeof(float) * aPowerDistribution.size());
-        inFile.readRawData((char *) smo2Distribution.data(), sizeof(float) * smo2Distribution.size());
-        inFile.readRawData((char *) wbalDistribution.data(), sizeof(float) * wbalDistribution.size());
+    // the mean max and distribution arrays are not read, they are
+    // viewed in the mapping and only unpacked when they are asked for
+    QSharedPointer<RideFileCacheMap> mapped(new RideFileCacheMap(cacheFileName));
+    if (!mapped->isValid()) return;
+    map = mapped;
+
+    // time in zone arrays are small and handed out by reference
+    QVector<float> *tiz[7] = { &wattsTimeInZone, &wattsCPTimeInZone, &hrTimeInZone, &hrCPTimeInZone,
+                               &paceTimeInZone, &paceCPTimeInZone, &wbalTimeInZone };
+    for (int i=0; i<7; i++) {
+        int count = 0;
+        const float *values = map->block(static_cast<RideFileCacheBlockId>(wattsTizBlock+i), count);
+        for (int j=0; j<count && j<tiz[i]->size(); j++) (*tiz[i])[j] = values[j];
+    }
+}
 
-        // time in zone
-        inFile.readRawData((char *) wattsTimeInZone.data(), sizeof(float) * 10);
-        inFile.readRawData((char *) wattsCPTimeInZone.data(), sizeof(float) * 4);
-        inFile.readRawData((char *) hrTimeInZone.data(), sizeof(float) * 10);
-        inFile.readRawData((char *) hrCPTimeInZone.data(), sizeof(float) * 4);
-        inFile.readRawData((char *) paceTimeInZone.data(), sizeof(float) * 10);
-        inFile.readRawData((char *) paceCPTimeInZone.data(), sizeof(float) * 4);
-        inFile.readRawData((char *) wbalTimeInZone.data(), sizeof(float) * 4);
-
-        // setup the doubles the users use
-        doubleArray(wattsMeanMaxDouble, wattsMeanMax, RideFile::watts);
-        doubleArray(hrMeanMaxDouble, hrMeanMax, RideFile::hr);
-        doubleArray(cadMeanMaxDouble, cadMeanMax, RideFile::cad);
-        doubleArray(nmMeanMaxDouble, nmMeanMax, RideFile::nm);
-        doubleArray(kphMeanMaxDouble, kphMeanMax, RideFile::kph);
-        doubleArray(kphdMeanMaxDouble, kphdMeanMax, RideFile::kphd);
-        doubleArray(wattsdMeanMaxDouble, wattsdMeanMax, RideFile::wattsd);
-        doubleArray(caddMeanMaxDouble, caddMeanMax, RideFile::cadd);
-        doubleArray(nmdMeanMaxDouble, nmdMeanMax, RideFile::nmd);
-        doubleArray(hrdMeanMaxDouble, hrdMeanMax, RideFile::hrd);
-        doubleArray(npMeanMaxDouble, npMeanMax, RideFile::IsoPower);
-        doubleArray(vamMeanMaxDouble, vamMeanMax, RideFile::vam);
-        doubleArray(xPowerMeanMaxDouble, xPowerMeanMax, RideFile::xPower);
-        doubleArray(wattsKgMeanMaxDouble, wattsKgMeanMax, RideFile::wattsKg);
-        doubleArray(aPowerMeanMaxDouble, aPowerMeanMax, RideFile::aPower);
-        doubleArray(aPowerKgMeanMaxDouble, aPowerKgMeanMax, RideFile::aPowerKg);
-
-        doubleArrayForDistribution(wattsDistributionDouble, wattsDistribution);
-        doubleArrayForDistribution(hrDistributionDouble, hrDistribution);
-        doubleArrayForDistribution(cadDistributionDouble, cadDistribution);
-        doubleArrayForDistribution(gearDistributionDouble, gearDistribution);
-        doubleArrayForDistribution(nmDistributionDouble, nmDistribution);
-        doubleArrayForDistribution(kphDistributionDouble, kphDistribution);
-        doubleArrayForDistribution(xPowerDistributionDouble, xPowerDistribution);
-        doubleArrayForDistribution(npDistributionDouble, npDistribution);
-        doubleArrayForDistribution(wattsKgDistributionDouble, wattsKgDistribution);
-        doubleArrayForDistribution(aPowerDistributionDouble, aPowerDistribution);
-        doubleArrayForDistribution(smo2DistributionDouble, smo2Distribution);
-        doubleArrayForDistribution(wbalDistributionDouble, wbalDistribution);
-
-        cacheFile.close();
+// the float array for a series, when computed rather than mapped
+const QVector<float> &
+RideFileCache::meanMaxFloats(RideFile::SeriesType series) const
+{
+    static const QVector<float> empty;
+
+    switch (series) {
+    case RideFile::watts : return wattsMeanMax;
+    case RideFile::wattsKg : return wattsKgMeanMax;
+    case RideFile::hr : return hrMeanMax;
+    case RideFile::cad : return cadMeanMax;
+    case RideFile::nm : return nmMeanMax;
+    case RideFile::kph : return kphMeanMax;
+    case RideFile::kphd : return kphdMeanMax;
+    case RideFile::wattsd : return wattsdMeanMax;
+    case RideFile::cadd : return caddMeanMax;
+    case RideFile::nmd : return nmdMeanMax;
+    case RideFile::hrd : return hrdMeanMax;
+    case RideFile::xPower : return xPowerMeanMax;
+    case RideFile::IsoPower : return npMeanMax;
+    case RideFile::vam : return vamMeanMax;
+    case RideFile::aPower : return aPowerMeanMax;
+    case RideFile::aPowerKg : return aPowerKgMeanMax;
+    default: return empty;
+    }
+}
+
+const QVector<float> &
+RideFileCache::distributionFloats(RideFile::SeriesType series) const
+{
+    static const QVector<float> empty;
+
+    switch (series) {
+    case RideFile::watts : return wattsDistribution;
+    case RideFile::hr : return hrDistribution;
+    case RideFile::cad : return cadDistribution;
+    case RideFile::gear : return gearDistribution;
+    case RideFile::nm : return nmDistribution;
+    case RideFile::kph : return kphDistribution;
+    case RideFile::xPower : return xPowerDistribution;
+    case RideFile::IsoPower : return npDistribution;
+    case RideFile::wattsKg : return wattsKgDistribution;
+    case RideFile::aPower : return aPowerDistribution;
+    case RideFile::smo2 : return smo2Distribution;
+    case RideFile::wbal : return wbalDistribution;
+    default: return empty;
     }
 }
 
+const float *
+RideFileCache::meanMaxView(RideFile::SeriesType series, int &count) const
+{
+    if (map) return map->block(RideFileCacheMap::meanMaxBlock(series), count);
+
+    const QVector<float> &values = meanMaxFloats(series);
+    count = values.count();
+    return values.constData();
+}
+
+const float *
+RideFileCache::distributionView(RideFile::SeriesType series, int &count) const
+{
+    if (map) return map->block(RideFileCacheMap::distributionBlock(series), count);
+
+    const QVector<float> &values = distributionFloats(series);
+    count = values.count();
+    return values.constData();
+}
+
 // unpack the longs into a double array
 void RideFileCache::doubleArray(QVector<double> &into, QVector<float> &from, RideFile::SeriesType series)
 {
@@ -2177,38 +2353,20 @@ int RideFileCache::rank(Context *context, RideFile::SeriesType series, int durat
 double 
 RideFileCache::best(Context *context, QString filename, RideFile::SeriesType series, int duration)
 {
-    // read the header
     QFileInfo rideFileInfo(context->athlete->home->activities().canonicalPath() + "/" + filename);
     QString cacheFileName(context->athlete->home->cache().canonicalPath() + "/" + rideFileInfo.baseName() + ".cpx");
-    QFileInfo cacheFileInfo(cacheFileName);
-
-    // head
-    RideFileCacheHeader head;
-    QFile cacheFile(cacheFileName);
-
-    if (cacheFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) == true) {
-        QDataStream inFile(&cacheFile);
-        inFile.readRawData((char *) &head, sizeof(head));
-
-        // out of date or not enough samples
-        if (head.version != RideFileCacheVersion || duration > countForMeanMax(head, series)) {
-            cacheFile.close();
-            return 0;
-        }
 
-        // jump to correct offset
-        long offset = offsetForMeanMax(head, series) + (sizeof(float) * (duration));
-        inFile.skipRawData(offset);
+    // out of date or missing
+    RideFileCacheMap map(cacheFileName);
+    if (!map.isValid()) return 0;
 
-        float readhere = 0;
-        inFile.readRawData((char*)&readhere, sizeof(float));
-        cacheFile.close();
+    // not enough samples
+    int count = 0;
+    const float *values = map.block(RideFileCacheMap::meanMaxBlock(series), count);
+    if (duration < 0 || duration >= count) return 0;
 
-        double divisor = pow(10, decimalsFor(series)); // ? 10 : 1;
-        return readhere / divisor; // will convert to double
-    }
-
-    return 0;
+    double divisor = pow(10, decimalsFor(series)); // ? 10 : 1;
+    return values[duration] / divisor; // will convert to double
 }
 
 int 
@@ -2216,48 +2374,29 @@ RideFileCache::tiz(Context *context, QString filename, RideFile::SeriesType seri
 {
     if (zone < 1 || zone > 10) return 0;
 
-    // read the header
     QFileInfo rideFileInfo(context->athlete->home->activities().canonicalPath() + "/" + filename);
     QString cacheFileName(context->athlete->home->cache().canonicalPath() + "/" + rideFileInfo.baseName() + ".cpx");
-    QFileInfo cacheFileInfo(cacheFileName);
-
-    // head
-    RideFileCacheHeader head;
-    QFile cacheFile(cacheFileName);
-
-    if (cacheFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) == true) {
-        QDataStream inFile(&cacheFile);
-        inFile.readRawData((char *) &head, sizeof(head));
-
-        // out of date 
-        if (head.version != RideFileCacheVersion) {
-            cacheFile.close();
-            return 0;
-        }
 
-        // jump to correct offset
-        long offset = offsetForTiz(head, series) + (sizeof(float) * (zone-1));
-        inFile.skipRawData(offset);
+    // out of date or missing
+    RideFileCacheMap map(cacheFileName);
+    if (!map.isValid()) return 0;
 
-        float readhere = 0;
-        inFile.readRawData((char*)&readhere, sizeof(float));
-        cacheFile.close();
+    int count = 0;
+    const float *values = map.block(RideFileCacheMap::tizBlock(series), count);
+    if (zone > count) return 0;
 
-        return readhere; // will convert to double
-    }
-
-    return 0;
+    return values[zone-1]; // will convert to int
 }
 
 // get best values (as passed in the list of MetricDetails between the dates specified
 // and return as an array of RideBests)
 //
 // this is to 're-use' the metric api (especially in the LTM code) for passing back multiple
-// bests across multiple rides in one object. We do this so we can optimise the read/seek across
+// bests across multiple rides in one object. We do this so we can optimise the reads across
 // the CPX files within a single call.
 //
-// We order the bests requested in the order they will appear in the CPX file so we can open
-// and seek forward to each value before putting into the summary metric. Since it is placed
+// Each CPX file is mapped once and every best requested is read directly from the mapping
+// via the block index before putting into the summary metric. Since it is placed
 // on the stack as a return parameter we also don't need to worry about memory allocation just
 // like the metric code works.
 // 
@@ -2286,21 +2425,10 @@ RideFileCache::getAllBestsFor(Context *context, QList<MetricDetail> metrics, Spe
         // CPX ?
         QFileInfo rideFileInfo(context->athlete->home->activities().canonicalPath() + "/" + ride->fileName);
         QString cacheFileName(context->athlete->home->cache().canonicalPath() + "/" + rideFileInfo.baseName() + ".cpx");
-        RideFileCacheHeader head;
-        QFile cacheFile(cacheFileName);
-
-        // open ok ?
-        if (cacheFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) == false) continue;
-
-        // get header
-        QDataStream inFile(&cacheFile);
-        inFile.readRawData((char *) &head, sizeof(head));
 
-        // out of date - just skip
-        if (head.version != RideFileCacheVersion) {
-            cacheFile.close();
-            continue;
-        }
+        // missing or out of date - just skip
+        RideFileCacheMap map(cacheFileName);
+        if (!map.isValid()) continue;
 
         RideBest add;
         add.setFileName(ride->fileName);
@@ -2310,21 +2438,14 @@ RideFileCache::getAllBestsFor(Context *context, QList<MetricDetail> metrics, Spe
         foreach (MetricDetail workitem, worklist) {
 
             int seconds = workitem.duration * workitem.duration_units;
-            float value;
-
-            if (seconds > countForMeanMax(head, workitem.series)) value=0.0;
-            else {
-
-                // get the values and place into the summarymetric map
-                long offset = offsetForMeanMax(head, workitem.series) + 
-                              (sizeof(head)) +
-                              (sizeof(float) * ((workitem.duration*workitem.duration_units)));
+            float value = 0.0;
 
-                cacheFile.seek(qint64(offset));
-                inFile.readRawData((char*)&value, sizeof(float));
+            // get the value and place into the summarymetric map
+            int count = 0;
+            const float *values = map.block(RideFileCacheMap::meanMaxBlock(workitem.series), count);
+            if (seconds >= 0 && seconds < count) {
                 double divisor = pow(10, decimalsFor(workitem.series));
-                value = value / divisor;
-
+                value = values[seconds] / divisor;
             }
             add.setForSymbol(workitem.bestSymbol, value);
 
@@ -2332,9 +2453,6 @@ RideFileCache::getAllBestsFor(Context *context, QList<MetricDetail> metrics, Spe
 
         // add to the results
         results << add;
-
-        // close CPX file
-        cacheFile.close();
     }
 
     // all done, return results
@@ -2357,21 +2475,10 @@ RideFileCache::getAllBestsFor(Context *context, RideFile::SeriesType series, int
         // CPX ?
         QFileInfo rideFileInfo(context->athlete->home->activities().canonicalPath() + "/" + ride->fileName);
         QString cacheFileName(context->athlete->home->cache().canonicalPath() + "/" + rideFileInfo.baseName() + ".cpx");
-        RideFileCacheHeader head;
-        QFile cacheFile(cacheFileName);
-
-        // open ok ?
-        if (cacheFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) == false) continue;
 
-        // get header
-        QDataStream inFile(&cacheFile);
-        inFile.readRawData((char *) &head, sizeof(head));
-
-        // out of date - just skip
-        if (head.version != RideFileCacheVersion) {
-            cacheFile.close();
-            continue;
-        }
+        // missing or out of date - just skip
+        RideFileCacheMap map(cacheFileName);
+        if (!map.isValid()) continue;
 
         if (series == RideFile::none) {
 
@@ -2381,23 +2488,15 @@ RideFileCache::getAllBestsFor(Context *context, RideFile::SeriesType series, int
         } else {
 
             float value = 0.0;
-            if (duration <= countForMeanMax(head, series)) {
-
-                // get the values and place into the summarymetric map
-                long offset = offsetForMeanMax(head, series) + sizeof(head) + (sizeof(float) * duration);
-
-                cacheFile.seek(qint64(offset));
-                inFile.readRawData((char*)&value, sizeof(float));
+            int count = 0;
+            const float *values = map.block(RideFileCacheMap::meanMaxBlock(series), count);
+            if (duration >= 0 && duration < count) {
                 double divisor = pow(10, decimalsFor(series));
-                value = value / divisor;
-
+                value = values[duration] / divisor;
             }
             results << double(value);
 
         }
-
-        // close CPX file
-        cacheFile.close();
     }
 
     // all done, return results
@@ -2430,10 +2529,12 @@ RideFileCache::bestTime(double km)
     // divisor for series and conversion from secs to hours
     double divisor = pow(10, decimalsFor(RideFile::kph)) * 3600.0;
     // linear search over kph mean max array
+    int count = 0;
+    const float *kphMeanMax = meanMaxView(RideFile::kph, count);
     int secs = 0;
-    while (secs < kphMeanMax.count() &&
+    while (secs < count &&
            double(kphMeanMax[secs] * secs) / divisor < km) secs++;
-    if (secs < kphMeanMax.count()) return secs;
+    if (secs < count) return secs;
     return RideFile::NIL;
 }
 
@@ -23,25 +23,51 @@
 #include <QDataStream>
 #include <QVector>
 #include <QThread>
+#include <QFile>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QDate>
+#include <QObject>
+#include <QFutureWatcher>
 
 class Context;
 class RideFile;
 class RideBest;
 class MetricDetail;
 class Specification;
+class RideItem;
+class MeanMaxIndex;
 
 #include "GoldenCheetah.h"
 
 // used by Mark Rages' Mean Max Algorithm
 #include <stdlib.h>
 #include <stdint.h>
-typedef double data_t;
+#include "MeanMaxKernel.h"
+
+// the details of a ride needed to aggregate its cpx, copied from the
+// RideItem on the GUI thread so the aggregation can run in the background
+struct RideFileCacheRide {
+    QString fileName;
+    QString sport;
+    QDate date;
+    double weight;
+    quint64 crc, fingerprint;
+};
+
+// shared with an aggregation running in the background, rides is the
+// number of rides it will read (it grows as it works) and done how many
+// it has read so far. Setting abort stops it early.
+struct RideFileCacheProgress {
+    RideFileCacheProgress() : rides(0), done(0), abort(0) {}
+    QAtomicInt rides, done, abort;
+};
 
 // RideFileCache is used to get meanmax and sample distribution
 // arrays when plotting CP curves and histograms. It is precoputed
 // to save time and cached in a file .cpx
 //
-static const unsigned int RideFileCacheVersion = 25;
+static const unsigned int RideFileCacheVersion = 26;
 // revision history:
 // version  date         description
 // 1        29-Apr-11    Initial - header, mean-max & distribution data blocks
@@ -68,13 +94,20 @@ static const unsigned int RideFileCacheVersion = 25;
 // 23       14-Jun-15    Added W'bal TiZ and Distribution
 // 24       15-Jun-15    Fix percentify error on W'bal Distribution
 // 25       19-Dec-16    Added aPower
+// 26       17-Oct-26    Added block index and page aligned blocks for mmap
 
 // The cache file (.cpx) has a binary format:
 // 1 x Header data - describing the version and contents of the cache
+// 1 x Block index - offset and count for every block below
+// padding to the next page boundary
 // n x Blocks - meanmax or distribution arrays
 // 1 x Watts TIZ - 10 floats
 // 1 x Heartrate TIZ - 10 floats
 // 1 x W'Bal TIX - 10 floats
+//
+// Each block starts on a 16 byte boundary and the first one on a page
+// boundary, so the file can be memory mapped and any block, or any single
+// value within a block, can be found in constant time via the index.
 
 // The header is written directly to disk, the only
 // field which is endian sensitive is the count field
@@ -123,6 +156,69 @@ struct RideFileCacheHeader {
 };
 
 
+// The blocks in the order they are written to the .cpx file
+enum RideFileCacheBlockId {
+
+    // mean maximals
+    wattsMeanMaxBlock=0, wattsKgMeanMaxBlock, hrMeanMaxBlock, cadMeanMaxBlock,
+    nmMeanMaxBlock, kphMeanMaxBlock, kphdMeanMaxBlock, wattsdMeanMaxBlock,
+    caddMeanMaxBlock, nmdMeanMaxBlock, hrdMeanMaxBlock, xPowerMeanMaxBlock,
+    npMeanMaxBlock, vamMeanMaxBlock, aPowerMeanMaxBlock, aPowerKgMeanMaxBlock,
+
+    // distributions
+    wattsDistBlock, hrDistBlock, cadDistBlock, gearDistBlock, nmDistBlock,
+    kphDistBlock, xPowerDistBlock, npDistBlock, wattsKgDistBlock,
+    aPowerDistBlock, smo2DistBlock, wbalDistBlock,
+
+    // time in zone
+    wattsTizBlock, wattsCPTizBlock, hrTizBlock, hrCPTizBlock,
+    paceTizBlock, paceCPTizBlock, wbalTizBlock,
+
+    RideFileCacheBlocks // must always be last
+};
+
+static const unsigned int RideFileCacheMagic = 0x31585043; // "CPX1"
+static const unsigned int RideFileCachePageSize = 4096;
+static const unsigned int RideFileCacheBlockAlign = 16;
+
+struct RideFileCacheBlock {
+    unsigned int offset; // from start of file in bytes
+    unsigned int count;  // number of floats
+};
+
+// follows the header, the blocks are found via this
+struct RideFileCacheIndex {
+    unsigned int magic;
+    unsigned int blocks; // RideFileCacheBlocks when written
+    RideFileCacheBlock block[RideFileCacheBlocks];
+};
+
+// A read-only memory map of a .cpx file, the values returned
+// point directly into the mapping so nothing is copied and any
+// value can be read without reading the rest of the file
+class RideFileCacheMap
+{
+    public:
+        RideFileCacheMap(QString cacheFileName);
+        ~RideFileCacheMap();
+
+        // mapped, current version and index is sane
+        bool isValid() const { return data != NULL; }
+
+        const RideFileCacheHeader *header() const { return (const RideFileCacheHeader*)data; }
+        const float *block(RideFileCacheBlockId id, int &count) const;
+
+        // block for the data series, or RideFileCacheBlocks if not cached
+        static RideFileCacheBlockId meanMaxBlock(RideFile::SeriesType series);
+        static RideFileCacheBlockId distributionBlock(RideFile::SeriesType series);
+        static RideFileCacheBlockId tizBlock(RideFile::SeriesType series);
+
+    private:
+        QFile file;
+        const uchar *data;
+        const RideFileCacheIndex *index;
+};
+
 // Each block of data is an array of uint32_t (32-bit "local-endian")
 // integers so the "count" setting within the block definition tells
 // us how long it is so we can read in one instruction and reference
@@ -173,6 +269,10 @@ class RideFileCache
         static QVector<float> meanMaxPowerFor(Context *context, QVector<float>&wpk, QDate from, QDate to, QVector<QDate> *dates, QString sport="Bike");
         static QVector<float> meanMaxPowerFor(Context *context, QVector<float>&wpk, QString filename);
 
+        // as above for a list of rides (filenames and dates), doesn't use RideItem so safe in a thread
+        static QVector<float> meanMaxPowerFor(Context *context, QVector<float>&wpk, const QStringList &filenames,
+                                              const QVector<QDate> &rideDates, QVector<QDate> *dates);
+
         // Fast standalone search reads input and outputs into ride_bests
         static void fastSearch(QVector<int>&input, QVector<int>&ride_bests, QVector<int>&ride_offsets);
 
@@ -218,6 +318,12 @@ class RideFileCache
 
         QVector<float> &heatMeanMaxArray();  // will compute if neccessary
 
+        // the raw values, these point into the memory mapped cache file
+        // when it was read from disk so avoid the copy made by the arrays
+        // above. Mean max values are multiplied by 10^decimalsFor(series)
+        const float *meanMaxView(RideFile::SeriesType, int &count) const;
+        const float *distributionView(RideFile::SeriesType, int &count) const;
+
         // explain the array binning / sampling
         static double binsize(RideFile::SeriesType);
 
@@ -231,12 +337,39 @@ class RideFileCache
 
     protected:
 
+        friend class MeanMaxIndex;
+        friend class RideFileCacheAggregate;
+
         void refreshCache();              // compute arrays and update cache
         void readCache();                 // just read from saved file and setup arrays
         void serialize(QDataStream *out); // write to file
 
         void compute();             // compute all arrays
 
+        // aggregating across rides, merge() expects the other to be later
+        RideFileCache(Context *context); // empty aggregate
+        void aggregate(const RideFileCache &rideCache, QDate rideDate);
+        void merge(RideFileCache &other);
+
+        // aggregate rides (in date order) on the thread pool, the rides are split
+        // into fixed size chunks and merged as a tree so the result doesn't
+        // depend on the number of threads. If progress is given it counts the
+        // rides read and stops early, leaving into incomplete, when aborted
+        static void aggregateRides(Context *context, RideFileCache *into, const QVector<RideFileCacheRide> &rides,
+                                   RideFileCacheProgress *progress = NULL);
+        static RideFileCacheRide rideDetails(RideItem *item);
+
+        // the date range constructor in steps, so RideFileCacheAggregate can
+        // select the rides on the GUI thread and aggregate them in the background
+        void initRange(bool filter, QStringList files, bool onhome);
+        bool fromCpxCache(RideItem *rideItem);
+        MeanMaxIndex *rangeRides(RideItem *rideItem, QVector<RideFileCacheRide> &rides, QString &sport);
+        void aggregateRange(MeanMaxIndex *index, QString sport, const QVector<RideFileCacheRide> &rides,
+                            RideFileCacheProgress *progress);
+        void remember(); // add to the athlete's cpxCache
+        void aggregateArrays(QList<QVector<double>*> &meanmax, QList<QVector<QDate>*> &dates,
+                             QList<QVector<double>*> &dist, QList<QVector<float>*> &tiz);
+
         // NOW replaced computeMeanMax with MeanMaxComputer class see bottom of file
         //void computeMeanMax(QVector<float>&, RideFile::SeriesType);      // compute mean max arrays
         void computeDistribution(QVector<float>&, RideFile::SeriesType); // compute the distributions
@@ -249,6 +382,13 @@ class RideFileCache
         QString cacheFileName; // filename of cache file
         RideFile *ride;
 
+        // when read from disk the mean max and distribution arrays are
+        // not copied, they are viewed via the map and the double arrays
+        // are only filled when asked for by meanMaxArray/distributionArray
+        QSharedPointer<RideFileCacheMap> map;
+        const QVector<float> &meanMaxFloats(RideFile::SeriesType) const;
+        const QVector<float> &distributionFloats(RideFile::SeriesType) const;
+
         // used for zoning
         int CP;
         int WPRIME;
@@ -362,6 +502,33 @@ class RideFileCache
         QVector<float> wbalTimeInZone;      // time in zone in seconds
 };
 
+// Aggregates a date range in the background, the same as the date range
+// constructor but without blocking. finished() is emitted on the GUI thread
+// when the cache can be taken, deleting it before then cancels.
+class RideFileCacheAggregate : public QObject
+{
+    Q_OBJECT
+
+    public:
+        RideFileCacheAggregate(Context *context, QDate start, QDate end, bool filter = false, QStringList files = QStringList(),
+                               bool onhome = true, RideItem *rideItem = NULL, QObject *parent = NULL);
+        ~RideFileCacheAggregate();
+
+        // the aggregate once finished, the caller owns it
+        RideFileCache *take();
+
+    signals:
+        void finished();
+
+    private slots:
+        void completed();
+
+    private:
+        RideFileCache *cache;
+        RideFileCacheProgress progress;
+        QFutureWatcher<void> watcher;
+};
+
 // Ride Bests in an associative array
 // used to plot peak x seconds on LTM
 
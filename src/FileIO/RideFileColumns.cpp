@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideFileColumns.h"
+
+#include <cmath>
+
+RideFileColumns::RideFileColumns() : count_(0)
+{
+}
+
+bool
+RideFileColumns::isStored(RideFile::SeriesType series)
+{
+    switch (series) {
+
+    // these are computed on the fly, or held elsewhere (wbal)
+    case RideFile::vam:
+    case RideFile::wattsKg:
+    case RideFile::aPowerKg:
+    case RideFile::wprime:
+    case RideFile::wbal:
+    case RideFile::clength:
+    case RideFile::index:
+    case RideFile::none:
+        return false;
+
+    default:
+        return true;
+    }
+}
+
+double
+RideFileColumns::defaultFor(RideFile::SeriesType series)
+{
+    // as per RideFilePoint() constructor
+    if (series == RideFile::temp || series == RideFile::lrbalance) return RideFile::NA;
+    return 0.0;
+}
+
+QVector<double> *
+RideFileColumns::build(RideFile *ride, RideFile::SeriesType series)
+{
+    if (ride == NULL || !isStored(series)) return NULL;
+
+    // only channels that are actually present, secs is always
+    // needed since everything else is indexed against it. xPower and
+    // IsoPower don't have a series flag, just the datapresent flags
+    bool present = series == RideFile::secs || ride->isDataPresent(series);
+    if (series == RideFile::IsoPower) present = ride->areDataPresent()->np;
+    if (series == RideFile::xPower) present = ride->areDataPresent()->xp;
+    if (!present) return NULL;
+
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+    QVector<double> *returning = new QVector<double>(points.count());
+    double *into = returning->data();
+    for (int j=0; j<points.count(); j++) into[j] = points[j]->value(series);
+    return returning;
+}
+
+bool
+RideFileColumns::isPresent(RideFile::SeriesType series) const
+{
+    if (series < 0 || series >= RideFile::none) return false;
+    return count_ > 0 && columns_[series] && columns_[series]->count() == count_;
+}
+
+const double *
+RideFileColumns::column(RideFile::SeriesType series) const
+{
+    if (!isPresent(series)) return NULL;
+    return columns_[series]->constData();
+}
+
+double
+RideFileColumns::value(int index, RideFile::SeriesType series) const
+{
+    if (index < 0 || index >= count_ || !isPresent(series)) return defaultFor(series);
+    return columns_[series]->at(index);
+}
+
+RideFilePoint
+RideFileColumns::point(int index) const
+{
+    RideFilePoint returning;
+    if (index < 0 || index >= count_) return returning;
+
+    for (int i=0; i<static_cast<int>(RideFile::none); i++) {
+        if (isPresent(static_cast<RideFile::SeriesType>(i)))
+            returning.setValue(static_cast<RideFile::SeriesType>(i), columns_[i]->at(index));
+    }
+    return returning;
+}
+
+long
+RideFileColumns::memoryUsage() const
+{
+    long bytes = 0;
+    for (int i=0; i<static_cast<int>(RideFile::none); i++) if (columns_[i]) bytes += columns_[i]->capacity() * sizeof(double);
+    return bytes;
+}
+
+void
+RideFileResampled::build(const RideFileColumns *columns, RideFile::SeriesType series,
+                         double recIntSecs, double interval, fill gaps)
+{
+    this->interval = interval > 0 ? interval : 1.0;
+    start = 0;
+    values.resize(0);
+    sums.fill(0, 1);
+
+    const double *secs = columns ? columns->column(RideFile::secs) : NULL;
+    const double *from = columns ? columns->column(series) : NULL;
+    if (secs == NULL || from == NULL) return;
+
+    int n = columns->count();
+    double rec = recIntSecs > 0 ? recIntSecs : 1.0;
+
+    // start at the first sample, the last covers recIntSecs
+    start = secs[0];
+    double end = secs[n-1] - start + rec;
+
+    // don't allow data more than two days, or time going backwards
+    if (end <= 0 || end > 2*24*60*60) return;
+
+    int count = ceil(end / this->interval - 0.0001);
+    values.fill(0, count);
+
+    double covered = 0;
+    for (int i=0; i<n; i++) {
+
+        double lo = qMax(secs[i] - start, covered);
+        double hi = secs[i] - start + rec;
+
+        // samples closer together than recIntSecs don't overlap
+        // and when holding we cover the gap to the next one too
+        if (i+1 < n) {
+            double next = secs[i+1] - start;
+            if (next > lo && (next < hi || gaps == Hold)) hi = next;
+        }
+        if (hi > end) hi = end;
+
+        // time went backwards or a duplicate
+        if (hi <= lo) continue;
+        covered = hi;
+
+        // spread across the intervals it covers
+        double value = from[i];
+        int k = lo / this->interval;
+        while (lo < hi && k < count) {
+            double edge = qMin(hi, (k+1) * this->interval);
+            values[k] += value * (edge - lo);
+            lo = edge;
+            k++;
+        }
+    }
+
+    // from time weighted totals to means, and the running total
+    sums.resize(count+1);
+    for (int k=0; k<count; k++) {
+        values[k] /= this->interval;
+        sums[k+1] = sums[k] + values[k];
+    }
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideFileColumns_h
+#define _GC_RideFileColumns_h 1
+#include "GoldenCheetah.h"
+
+#include "RideFile.h"
+#include <QVector>
+#include <QSharedPointer>
+
+// RideFileColumns is a columnar (structure-of-arrays) copy of the samples
+// held in a RideFile. Each RideFilePoint carries every channel we know
+// about, but most rides only record a handful, so here we allocate one
+// contiguous array per series that is actually present and nothing for
+// the rest.
+//
+// Loops that walk a single series across the whole ride (mean-max,
+// distributions, metrics, plots) should use column() which is a plain
+// array of doubles, rather than chasing a pointer per sample.
+//
+// Old code that wants a RideFilePoint can still get one via point(), it
+// is filled from the columns with the usual defaults for absent series.
+//
+// Use RideFile::columns() to get at it, asking for the series you need.
+// The ride builds each series the first time it is asked for and shares
+// it until the samples change, so a caller on another thread never sees
+// one change underneath it. RideFile's own methods and RideFileCommand
+// mark them stale, code that writes to the samples through dataPoints()
+// must call RideFile::invalidateColumns() after.
+class RideFileColumns
+{
+    public:
+        RideFileColumns();
+
+        // a series from the ride samples, NULL if not present. Derived
+        // series will only be there if recalculateDerivedSeries() was called
+        static QVector<double> *build(RideFile *ride, RideFile::SeriesType series);
+
+        // number of samples
+        int count() const { return count_; }
+
+        // is the series held, only those present in the ride are
+        bool isPresent(RideFile::SeriesType series) const;
+
+        // contiguous array of count() values or NULL if not present
+        const double *column(RideFile::SeriesType series) const;
+
+        // single value, with the RideFilePoint default if not present
+        double value(int index, RideFile::SeriesType series) const;
+
+        // RideFilePoint style access for older code
+        RideFilePoint point(int index) const;
+
+        // bytes held in the columns
+        long memoryUsage() const;
+
+        // series that have a sample value in RideFilePoint and can be held
+        static bool isStored(RideFile::SeriesType series);
+
+        // default for a sample when the series isn't present
+        static double defaultFor(RideFile::SeriesType series);
+
+    private:
+        friend class RideFile;
+
+        int count_;
+        QSharedPointer<const QVector<double> > columns_[RideFile::none];
+};
+
+// RideFileResampled is a single series at fixed intervals from the start
+// of the ride, with gaps in recording filled, and its running total so the
+// total or mean for any stretch of the ride is just a subtraction.
+//
+// Each sample is taken to cover recIntSecs from its timestamp, and each
+// value is the time weighted mean of the samples that cover it, so
+// 1s recordings come through unchanged and others are spread or averaged
+// into intervals. Time not covered by a sample is either zero (power,
+// hr et al) or holds the last value (distance, altitude et al).
+//
+// Use RideFile::resampled() to get at it, the ride keeps them cached
+// alongside the columns and drops them when the samples are edited.
+class RideFileResampled
+{
+    public:
+        enum fill { Zero=0, Hold };
+
+        RideFileResampled() : interval(1.0), start(0) {}
+
+        // (re)build from the columns, empty if the series isn't present or
+        // the ride is silly long (more than two days)
+        void build(const RideFileColumns *columns, RideFile::SeriesType series,
+                   double recIntSecs, double interval, fill gaps);
+
+        // number of intervals
+        int count() const { return values.count(); }
+
+        // total and mean of values [from, to)
+        double total(int from, int to) const { return sums[to] - sums[from]; }
+        double mean(int from, int to) const { return to > from ? total(from, to) / double(to-from) : 0; }
+
+        double interval;            // seconds between values
+        double start;               // ride secs of the first value
+        QVector<double> values;
+        QVector<double> sums;       // count()+1, sums[i] is the total of values[0..i-1]
+};
+
+#endif // _GC_RideFileColumns_h
@@ -219,6 +219,7 @@ RideFileCommand::doCommand(RideCommand *cmd, bool noexec)
         luw->addCommand(cmd);
         beginCommand(false, cmd);
         cmd->doCommand(); // luw must be executed as added!!!
+        ride->invalidateColumns();
         cmd->docount++;
         endCommand(false, cmd);
         return;
@@ -236,6 +237,7 @@ RideFileCommand::doCommand(RideCommand *cmd, bool noexec)
     if (noexec == false) {
         beginCommand(false, cmd); // signal
         cmd->doCommand(); // execute
+        ride->invalidateColumns(); // whatever the command wrote
     }
     cmd->docount++;
     endCommand(false, cmd); // signal - even if LUW
@@ -250,6 +252,7 @@ RideFileCommand::redoCommand()
     if (stackptr < stack.count()) {
         beginCommand(false, stack[stackptr]); // signal
         stack[stackptr]->doCommand();
+        ride->invalidateColumns();
         stack[stackptr]->docount++;
         stackptr++; // increment before end to keep in sync in case
                     // it is queried 'after' the command is executed
@@ -266,6 +269,7 @@ RideFileCommand::undoCommand()
 
         beginCommand(true, stack[stackptr]); // signal
         stack[stackptr]->undoCommand();
+        ride->invalidateColumns();
         endCommand(true, stack[stackptr]); // signal
     }
 }
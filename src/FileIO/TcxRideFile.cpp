@@ -475,17 +475,24 @@ TcxFileReader::toByteArray(Context *context, const RideFile *ride, bool withAlt,
 bool
 TcxFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file) const
 {
-    QByteArray xml = toByteArray(context, ride, true, true, true, true);
-
     if (!file.open(QIODevice::WriteOnly)) return(false);
     file.resize(0);
-    QTextStream out(&file);
+    bool ok = streamRideFile(context, ride, file);
+    file.close();
+    return(ok);
+}
+
+bool
+TcxFileReader::streamRideFile(Context *context, const RideFile *ride, QIODevice &device) const
+{
+    QByteArray xml = toByteArray(context, ride, true, true, true, true);
+
+    QTextStream out(&device);
 #if QT_VERSION < 0x060000
     out.setCodec("UTF-8");
 #endif
     out.setGenerateByteOrderMark(true);
     out << xml;
     out.flush();
-    file.close();
-    return(true);
+    return(out.status() == QTextStream::Ok);
 }
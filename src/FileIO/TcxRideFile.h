@@ -30,6 +30,7 @@ class TcxFileReader : public RideFileReader {
     virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*>* = 0) const; 
     QByteArray toByteArray(Context *context, const RideFile *ride, bool withAlt, bool withWatts, bool withHr, bool withCad) const;
     bool writeRideFile(Context *context, const RideFile *ride, QFile &file) const;
+    bool streamRideFile(Context *context, const RideFile *ride, QIODevice &out) const;
     bool hasWrite() const { return true; }
 };
 
@@ -639,6 +639,7 @@ BatchProcessingDialog::runDataProcessorOnActivities(const QString& processorName
             // now run the data processor
             if (dp->postProcess(rideF, config, "UPDATE")) {
                 // rideFile is now dirty!
+                rideF->invalidateColumns();
                 rideI->setDirty(true);
                 current->setText(4, tr("Processed"));
                 processed++;
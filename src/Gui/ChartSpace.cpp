@@ -33,6 +33,7 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonValue>
+#include <QtConcurrent>
 
 double gl_major;
 static double gl_wheelscale = 6; // rate we scroll for wheel events
@@ -113,6 +114,14 @@ ChartSpace::ChartSpace(Context *context, int scope, GcWindow *window) :
     connect(scroller, SIGNAL(finished()), this, SLOT(scrollFinished()));
     connect(scrollbar, SIGNAL(valueChanged(int)), this, SLOT(scrollbarMoved(int)));
 
+    // trends tiles finish as the pass gets to them, the rest one at a time
+    qRegisterMetaType<ChartSpaceItem*>("ChartSpaceItem*");
+    connect(this, SIGNAL(itemComputed(int,ChartSpaceItem*)), this, SLOT(itemFinished(int,ChartSpaceItem*)), Qt::QueuedConnection);
+    queue = new QTimer(this);
+    queue->setSingleShot(true);
+    queue->setInterval(0);
+    connect(queue, SIGNAL(timeout()), this, SLOT(nextQueued()));
+
     // set the widgets etc
     configChanged(CONFIG_APPEARANCE);
 
@@ -122,6 +131,12 @@ ChartSpace::ChartSpace(Context *context, int scope, GcWindow *window) :
     currentRideItem=NULL;
 }
 
+ChartSpace::~ChartSpace()
+{
+    // the pass uses the tiles
+    cancel();
+}
+
 // add the item
 void
 ChartSpace::addItem(int order, int column, int span, int deep, ChartSpaceItem *item)
@@ -132,7 +147,7 @@ ChartSpace::addItem(int order, int column, int span, int deep, ChartSpaceItem *i
     item->deep = deep;
     items.append(item);
     if (scope&OverviewScope::ANALYSIS && currentRideItem) item->setData(currentRideItem);
-    if (scope&OverviewScope::TRENDS) item->setDateRange(currentDateRange);
+    if (scope&OverviewScope::TRENDS) compute(item);
 }
 
 void
@@ -141,9 +156,19 @@ ChartSpace::removeItem(ChartSpaceItem *item)
     for(int i=0; i<items.count(); i++) {
         ChartSpaceItem *p = items.at(i);
         if (p == item) {
+
+            // not while the pass is using it
+            bool restart = unfinished.contains(p);
+            if (restart) cancel();
+            unfinished.removeAll(p);
+            queued.removeAll(p);
+
             scene->removeItem(p);
             items.removeAt(i);
             delete p;
+
+            // the others still need finishing
+            if (restart) compute(QList<ChartSpaceItem*>());
             return;
         }
     }
@@ -202,8 +227,8 @@ ChartSpace::dateRangeChanged(DateRange dr)
         return;
     }
 
-    // ride item changed
-    foreach(ChartSpaceItem *ChartSpaceItem, items) ChartSpaceItem->setDateRange(dr);
+    // date range changed, tiles update as their results arrive
+    compute(items);
 
     // update
     updateView();
@@ -212,6 +237,80 @@ ChartSpace::dateRangeChanged(DateRange dr)
     stale=false;
 }
 
+// Tiles that can are computed in one pass over the rides on the thread pool
+// rather than each looping over all the rides on the gui thread, and are
+// finished as the pass gets to them. The rest are updated one at a time from
+// the event loop so the view can paint and respond in between.
+void
+ChartSpace::compute(QList<ChartSpaceItem*> tiles)
+{
+    // stop the pass that's running, the tiles it didn't finish go again
+    cancel();
+    foreach(ChartSpaceItem *tile, tiles) if (!unfinished.contains(tile)) unfinished << tile;
+
+    QList<ChartSpaceItem*> pass;
+    foreach(ChartSpaceItem *tile, unfinished) {
+        if (tile->prepare(currentDateRange)) pass << tile;
+        else if (!queued.contains(tile)) queued << tile;
+    }
+    unfinished = pass;
+
+    if (!queued.isEmpty()) queue->start();
+    if (!pass.isEmpty()) running = QtConcurrent::run(computePass, this, int(generation.loadAcquire()), currentDateRange,
+                                                     context->athlete->rideCache->rides(), pass);
+}
+
+void
+ChartSpace::computePass(ChartSpace *space, int generation, DateRange dr, QVector<RideItem*> rides, QList<ChartSpaceItem*> tiles)
+{
+    // each ride once, for all the tiles
+    foreach(RideItem *item, rides) {
+        if (space->generation.loadAcquire() != generation) return;
+        if (!dr.pass(item->dateTime.date())) continue;
+
+        foreach(ChartSpaceItem *tile, tiles)
+            if (tile->spec.pass(item)) tile->accumulate(item);
+    }
+
+    // and they can be shown as each completes
+    foreach(ChartSpaceItem *tile, tiles) {
+        if (space->generation.loadAcquire() != generation) return;
+
+        tile->complete();
+        emit space->itemComputed(generation, tile);
+    }
+}
+
+void
+ChartSpace::cancel()
+{
+    // the pass checks between rides, so doesn't take long to stop
+    generation.fetchAndAddOrdered(1);
+    running.waitForFinished();
+}
+
+void
+ChartSpace::itemFinished(int generation, ChartSpaceItem *tile)
+{
+    // cancelled since, or removed
+    if (generation != this->generation.loadAcquire() || !unfinished.removeOne(tile)) return;
+
+    tile->finish();
+    tile->update();
+}
+
+void
+ChartSpace::nextQueued()
+{
+    if (queued.isEmpty()) return;
+
+    ChartSpaceItem *tile = queued.takeFirst();
+    tile->setDateRange(currentDateRange);
+    tile->update();
+
+    if (!queued.isEmpty()) queue->start();
+}
+
 QColor
 ChartSpaceItem::color()
 {
@@ -225,6 +324,19 @@ ChartSpaceItem::setData(RideItem *item)
     // ignored
 }
 
+void
+ChartSpaceItem::setDateRange(DateRange dr)
+{
+    // just this tile, as the pass would
+    if (!prepare(dr)) return;
+
+    foreach(RideItem *item, parent->context->athlete->rideCache->rides())
+        if (dr.pass(item->dateTime.date()) && spec.pass(item)) accumulate(item);
+
+    complete();
+    finish();
+}
+
 void
 ChartSpaceItem::setDrag(bool x)
 {
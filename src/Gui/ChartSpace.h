@@ -27,6 +27,7 @@
 #include "Context.h"
 #include "Athlete.h"
 #include "RideItem.h"
+#include "Specification.h"
 
 // QGraphics
 #include <QGraphicsScene>
@@ -39,6 +40,8 @@
 #include <QScrollBar>
 #include <QIcon>
 #include <QTimer>
+#include <QFuture>
+#include <QAtomicInt>
 
 // geometry basics
 #define SPACING 80
@@ -84,13 +87,26 @@ class ChartSpaceItem : public QGraphicsWidget
         virtual void itemPaint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) =0;
         virtual void itemGeometryChanged() =0;
         virtual void setData(RideItem *item)=0;
-        virtual void setDateRange(DateRange )=0;
+        virtual void setDateRange(DateRange ); // default computes as the pass would, on the gui thread
         virtual QColor color();
         virtual QRectF hotspot() { return QRectF(0,0,0,0); } // don't steal events from this area of the item
 
         virtual QWidget *config()=0; // must supply a widget to configure
         virtual void configChanged(qint32) {}
 
+        // trends tiles can be computed in a pass over the rides shared by all
+        // the tiles on the thread pool, instead of in setDateRange(). prepare()
+        // is called on the gui thread and returns true to join the pass, after
+        // setting spec and copying any config it needs. accumulate() is called
+        // from the pass for each ride that passes spec and then complete(),
+        // and finish() back on the gui thread shows the results. Nothing the
+        // pass changes should be painted until finish() is called.
+        virtual bool prepare(DateRange) { return false; }
+        virtual void accumulate(RideItem *) {}
+        virtual void complete() {}
+        virtual void finish() {}
+        Specification spec;
+
         // turn off/on the config corner button
         void setShowConfig(bool x) { showconfig=x; update(); }
         bool showConfig() const { return showconfig; }
@@ -212,6 +228,7 @@ class ChartSpace : public QWidget
     public:
 
         ChartSpace(Context *context, int scope, GcWindow *window);
+        ~ChartSpace();
         QGraphicsScene *getScene() { return scene; }
 
         // current state for event processing
@@ -242,6 +259,7 @@ class ChartSpace : public QWidget
 
     signals:
         void itemConfigRequested(ChartSpaceItem*);
+        void itemComputed(int, ChartSpaceItem*); // from the pass
 
     public slots:
 
@@ -250,6 +268,11 @@ class ChartSpace : public QWidget
         void dateRangeChanged(DateRange);
         void filterChanged();
 
+        // trends data for the current date range, cancels the pass
+        // that is running, its unfinished tiles are computed again
+        void compute(QList<ChartSpaceItem*> tiles);
+        void compute(ChartSpaceItem *tile) { compute(QList<ChartSpaceItem*>() << tile); }
+
         // column sizing
         QVector<int> columnWidths() { return columns; }
         void setColumnWidths(QVector<int> x) { columns =x; updateGeometry(); }
@@ -299,6 +322,11 @@ class ChartSpace : public QWidget
         // how many items are in this column?
         int columnCount(int x);
 
+    private slots:
+
+        void itemFinished(int, ChartSpaceItem*); // results from the pass
+        void nextQueued();
+
     protected:
 
         // process events
@@ -306,6 +334,11 @@ class ChartSpace : public QWidget
 
     private:
 
+        // the pass, on the thread pool
+        static void computePass(ChartSpace *space, int generation, DateRange dr,
+                                QVector<RideItem*> rides, QList<ChartSpaceItem*> tiles);
+        void cancel(); // and wait
+
         // gui setup
         QGraphicsScene *scene;
         QScrollBar *scrollbar;
@@ -357,6 +390,13 @@ class ChartSpace : public QWidget
 
         bool stale;
         bool configured;
+
+        // trends computation
+        QAtomicInt generation;              // bumped to cancel the pass
+        QFuture<void> running;              // the pass
+        QList<ChartSpaceItem*> unfinished;  // tiles in the pass not yet finished
+        QList<ChartSpaceItem*> queued;      // tiles waiting for setDateRange()
+        QTimer *queue;
 };
 
 // each chart has an entry like this in the registry
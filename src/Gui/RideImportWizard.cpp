@@ -42,6 +42,9 @@
 #include <QDebug>
 #include <QWaitCondition>
 #include <QMessageBox>
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QEventLoop>
 
 enum WizardTable {
     FILENAME_COLUMN = 0,
@@ -52,6 +55,75 @@ enum WizardTable {
     STATUS_COLUMN,
 };
 
+// how many files are parsed or saved at a time, keeps memory flat
+static int
+importWindow()
+{
+    return qMax(2, QThread::idealThreadCount() * 2);
+}
+
+// parse a file, on the thread pool. The readers keep their state per
+// file; the few tables they share are filled once behind a mutex (bin,
+// fit) or only read (3dp, bin2, caf, csv, epm, fitlog, gc, gpx, hrm,
+// json, man, osyn, pwx, qla, raw, slf, smf, sml, srd, srm, tcx, txt, wko)
+static void
+parseJob(RideImportJob &job)
+{
+    if (job.skip) return;
+
+    QFile thisfile(job.filename);
+    job.ride = RideFileFactory::instance().openRideFile(job.context, thisfile, job.errors, &job.rides);
+}
+
+// parsed rides that weren't taken
+static void
+clearJobs(QVector<RideImportJob> &jobs)
+{
+    for (int i=0; i<jobs.count(); i++) {
+        if (jobs[i].rides.count() > 1) qDeleteAll(jobs[i].rides);
+        else delete jobs[i].ride;
+        jobs[i].ride = NULL;
+        jobs[i].rides.clear();
+    }
+}
+
+// open, process and write the json into tmpActivities, on the thread pool
+static void
+saveJob(RideImportJob &job)
+{
+    if (job.skip) return;
+
+    QFile thisfile(job.filename);
+    RideFile *ride(RideFileFactory::instance().openRideFile(job.context, thisfile, job.errors));
+
+    // did the input file parse ok ? (should be fine here - since it was alrady checked before - but just in case)
+    if (!ride) return;
+    job.opened = true;
+
+    // update ridedatetime and set the Source File name
+    ride->setStartTime(job.ridedatetime);
+    ride->setTag("Source Filename", job.importsTarget);
+    ride->setTag("Filename", job.activitiesTarget);
+    if (job.errors.count() > 0)
+        ride->setTag("Import errors", job.errors.join("\n"));
+
+    // process linked defaults
+    RideMetadata::setLinkedDefaults(ride, job.defaults);
+
+    // run the processor first... import, python fixes take turns
+    DataProcessorFactory::instance().autoProcess(ride, "Auto", "Import");
+    ride->recalculateDerivedSeries();
+    // now metrics have been calculated
+    DataProcessorFactory::instance().autoProcess(ride, "Save", "ADD");
+
+    // serialize
+    JsonFileReader reader;
+    QFile target(job.target);
+    job.written = reader.writeRideFile(job.context, ride, target);
+
+    delete ride;
+}
+
 // drag and drop passes urls ... convert to a list of files and call main constructor
 RideImportWizard::RideImportWizard(QList<QUrl> *urls, Context *context, QWidget *parent) : QDialog(parent), context(context)
 {
@@ -545,27 +617,45 @@ RideImportWizard::process()
     QApplication::processEvents();
 
     // Pass 2 - Read in with the relevant RideFileReader method
+    //          a window of files is parsed on the thread pool and
+    //          the results are then taken in order
 
     phaseLabel->setText(tr("Step 2 of 4: Validating Files"));
+   QVector<RideImportJob> parsed;
+   int window = 0; // row of parsed[0]
    for (int i=0; i< filenames.count(); i++) {
 
+        // parse the next window
+        if (i >= window + parsed.count()) {
+            parsed.clear();
+            window = i;
+            for (int j=i; j<filenames.count() && j<i+importWindow(); j++) {
+                RideImportJob job(context, filenames[j]);
+                job.skip = tableWidget->item(j,STATUS_COLUMN)->text().startsWith(tr("Error"));
+                if (!job.skip) tableWidget->item(j,STATUS_COLUMN)->setText(tr("Parsing..."));
+                parsed << job;
+            }
+            tableWidget->setCurrentCell(i,5);
+            this->repaint();
+
+            runJobs(parsed, parseJob);
+            if (aborted) { clearJobs(parsed); done(0); return 0; }
+        }
+        RideImportJob &job = parsed[i - window];
 
         // does the status say Queued?
-        if (!tableWidget->item(i,STATUS_COLUMN)->text().startsWith(tr("Error"))) {
+        if (!job.skip) {
 
-              QStringList errors;
+              QStringList errors = job.errors;
               QFile thisfile(filenames[i]);
 
-              tableWidget->item(i,STATUS_COLUMN)->setText(tr("Parsing..."));
               tableWidget->setCurrentCell(i,5);
-              QApplication::processEvents();
-
-              if (aborted) { done(0); return 0; }
-              this->repaint();
-              QApplication::processEvents();
 
-              QList<RideFile*> rides;
-              RideFile *ride = RideFileFactory::instance().openRideFile(context, thisfile, errors, &rides);
+              // ours now
+              QList<RideFile*> rides = job.rides;
+              RideFile *ride = job.ride;
+              job.rides.clear();
+              job.ride = NULL;
 
               // is this an archive of files?
               if (rides.count() > 1) {
@@ -654,6 +744,8 @@ RideImportWizard::process()
 
                  // then go back one and re-parse from there
                  rides.clear();
+                 clearJobs(parsed);
+                 parsed.clear();
    
                  i--;
                  goto next; // buttugly I know, but count em across 100,000 lines of code
@@ -725,7 +817,7 @@ RideImportWizard::process()
         }
         progressBar->setValue(progressBar->value()+1);
         QApplication::processEvents();
-        if (aborted) { done(0); return 0; }
+        if (aborted) { clearJobs(parsed); done(0); return 0; }
         this->repaint();
 
         next:;
@@ -1013,135 +1105,137 @@ RideImportWizard::abortClicked()
     QChar zero = QLatin1Char ( '0' );
 
 
-    // Saving now - process the files one-by-one
-    for (int i=0; i< filenames.count(); i++) {
-
-        if (tableWidget->item(i,STATUS_COLUMN)->text().startsWith(tr("Error"))) continue; // skip errors
-
-        tableWidget->item(i,STATUS_COLUMN)->setText(tr("Saving..."));
-        tableWidget->setCurrentCell(i,5);
-        QApplication::processEvents();
-        if (aborted) { done(0); return; }
-        this->repaint();
-
-
-        // SAVE STEP 3 - prepare the new file names for the next steps - basic name and .JSON in GC format
-
-        QDateTime ridedatetime = QDateTime(QDate().fromString(tableWidget->item(i,DATE_COLUMN)->text(), Qt::ISODate),
-                                           QTime().fromString(tableWidget->item(i,TIME_COLUMN)->text(), "hh:mm:ss"));
-        QString targetnosuffix = QString ( "%1_%2_%3_%4_%5_%6" )
-                .arg ( ridedatetime.date().year(), 4, 10, zero )
-                .arg ( ridedatetime.date().month(), 2, 10, zero )
-                .arg ( ridedatetime.date().day(), 2, 10, zero )
-                .arg ( ridedatetime.time().hour(), 2, 10, zero )
-                .arg ( ridedatetime.time().minute(), 2, 10, zero )
-                .arg ( ridedatetime.time().second(), 2, 10, zero );
-        QString activitiesTarget = QString ("%1.%2" ).arg ( targetnosuffix ).arg ( "json" );
-
-        // create filenames incl. directory path for GC .JSON for both /tmpActivities and /activities directory
-        QString tmpActivitiesFulltarget = tmpActivities.canonicalPath() + "/" + activitiesTarget;
-        QString finalActivitiesFulltarget = homeActivities.canonicalPath() + "/" + activitiesTarget;
-
-        // check if a ride at this point of time already exists in /activities - if yes, skip import
-        if (QFileInfo(finalActivitiesFulltarget).exists()) { tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - Activity file exists")); continue; }
-
-        // in addition, also check the RideCache for a Ride with the same point in Time in UTC, which also indicates
-        // that there was already a ride imported - reason is that RideCache start time is in UTC, while the file Name is in "localTime"
-        // which causes problems when importing the same file (for files which do not have time/date in the file name),
-        // while the computer has been set to a different time zone
-        if (context->athlete->rideCache->getRide(ridedatetime.toUTC())) { tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - Activity file with same start date/time exists")); continue; };
-
-        // SAVE STEP 4 - copy the source file to "/imports" directory (if it's not taken from there as source)
-        // add the date/time of the target to the source file name (for identification)
-
-        // copy the sourceFile to /imports ONLY if the source is NOT coming from /imports itself
-        QFileInfo sourceFileInfo (filenames[i]);
-        QString importsTarget;
-        if (sourceFileInfo.canonicalPath() != homeImports.canonicalPath()) {
-
-            // add the GC file base name to create unique file names during import
-            // there should not be 2 ride files with exactly the same time stamp (as this is also not foreseen for the .json)
-            importsTarget = sourceFileInfo.baseName() + "_" + targetnosuffix + "." + sourceFileInfo.suffix();
-            QString importsFulltarget = homeImports.canonicalPath() + "/" + importsTarget;
-            // copy the source file to /imports with adjusted name
-            QFile source(filenames[i]);
-            if (!source.copy(importsFulltarget)) {
-                tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - copy of %1 to import directory failed").arg(importsTarget));
+    // Saving now - a window of files at a time; checked and copied in order, then
+    // opened, processed and written as .JSON on the thread pool, then added to the
+    // RideCache in order
+    QVector<RideImportJob> saving;
+    for (int from=0; from < filenames.count(); from += importWindow()) {
+
+        int to = qMin(filenames.count(), from + importWindow());
+        QSet<QString> claimed; // same date/time twice in this window
+        saving.clear();
+
+        for (int i=from; i<to; i++) {
+
+            saving << RideImportJob(context, filenames[i]);
+            RideImportJob &job = saving.last();
+            job.skip = true;
+
+            if (tableWidget->item(i,STATUS_COLUMN)->text().startsWith(tr("Error"))) continue; // skip errors
+
+            tableWidget->item(i,STATUS_COLUMN)->setText(tr("Saving..."));
+
+            // SAVE STEP 3 - prepare the new file names for the next steps - basic name and .JSON in GC format
+
+            QDateTime ridedatetime = QDateTime(QDate().fromString(tableWidget->item(i,DATE_COLUMN)->text(), Qt::ISODate),
+                                               QTime().fromString(tableWidget->item(i,TIME_COLUMN)->text(), "hh:mm:ss"));
+            QString targetnosuffix = QString ( "%1_%2_%3_%4_%5_%6" )
+                    .arg ( ridedatetime.date().year(), 4, 10, zero )
+                    .arg ( ridedatetime.date().month(), 2, 10, zero )
+                    .arg ( ridedatetime.date().day(), 2, 10, zero )
+                    .arg ( ridedatetime.time().hour(), 2, 10, zero )
+                    .arg ( ridedatetime.time().minute(), 2, 10, zero )
+                    .arg ( ridedatetime.time().second(), 2, 10, zero );
+            QString activitiesTarget = QString ("%1.%2" ).arg ( targetnosuffix ).arg ( "json" );
+
+            // create filenames incl. directory path for GC .JSON for both /tmpActivities and /activities directory
+            QString tmpActivitiesFulltarget = tmpActivities.canonicalPath() + "/" + activitiesTarget;
+            QString finalActivitiesFulltarget = homeActivities.canonicalPath() + "/" + activitiesTarget;
+
+            // check if a ride at this point of time already exists in /activities - if yes, skip import
+            if (QFileInfo(finalActivitiesFulltarget).exists() || claimed.contains(activitiesTarget)) { tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - Activity file exists")); continue; }
+
+            // in addition, also check the RideCache for a Ride with the same point in Time in UTC, which also indicates
+            // that there was already a ride imported - reason is that RideCache start time is in UTC, while the file Name is in "localTime"
+            // which causes problems when importing the same file (for files which do not have time/date in the file name),
+            // while the computer has been set to a different time zone
+            if (context->athlete->rideCache->getRide(ridedatetime.toUTC())) { tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - Activity file with same start date/time exists")); continue; };
+
+            // SAVE STEP 4 - copy the source file to "/imports" directory (if it's not taken from there as source)
+            // add the date/time of the target to the source file name (for identification)
+
+            // copy the sourceFile to /imports ONLY if the source is NOT coming from /imports itself
+            QFileInfo sourceFileInfo (filenames[i]);
+            QString importsTarget;
+            if (sourceFileInfo.canonicalPath() != homeImports.canonicalPath()) {
+
+                // add the GC file base name to create unique file names during import
+                // there should not be 2 ride files with exactly the same time stamp (as this is also not foreseen for the .json)
+                importsTarget = sourceFileInfo.baseName() + "_" + targetnosuffix + "." + sourceFileInfo.suffix();
+                QString importsFulltarget = homeImports.canonicalPath() + "/" + importsTarget;
+                // copy the source file to /imports with adjusted name
+                QFile source(filenames[i]);
+                if (!source.copy(importsFulltarget)) {
+                    tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - copy of %1 to import directory failed").arg(importsTarget));
+                }
+            } else {
+                // file is re-imported from /imports - keep the name for .JSON Source File Tag
+                importsTarget = sourceFileInfo.fileName();
             }
-        } else {
-            // file is re-imported from /imports - keep the name for .JSON Source File Tag
-            importsTarget = sourceFileInfo.fileName();
-        }
 
+            // SAVE STEP 5 - open the file with the respective format reader and export as .JSON
+            // to track if addRideCache() has caused an error due to bad data we work with a interim directory for the activities
+            // -- first   export to /tmpactivities (on the thread pool)
+            // -- second  create RideCache() entry
+            // -- third   move file from /tmpactivities to /activities
+            job.ridedatetime = ridedatetime;
+            job.importsTarget = importsTarget;
+            job.activitiesTarget = activitiesTarget;
+            job.target = tmpActivitiesFulltarget;
+            job.defaults = GlobalContext::context()->rideMetadata->getDefaults();
+            job.skip = false;
+            claimed << activitiesTarget;
+        }
 
-        // SAVE STEP 5 - open the file with the respective format reader and export as .JSON
-        // to track if addRideCache() has caused an error due to bad data we work with a interim directory for the activities
-        // -- first   export to /tmpactivities
-        // -- second  create RideCache() entry
-        // -- third   move file from /tmpactivities to /activities
+        tableWidget->setCurrentCell(from,5);
+        this->repaint();
 
-        // serialize the file to .JSON
-        QStringList errors;
-        QFile thisfile(filenames[i]);
-        RideFile *ride(RideFileFactory::instance().openRideFile(context, thisfile, errors));
+        // python fixes are registered on first use, do it here not in the jobs
+        DataProcessorFactory::instance().getProcessors();
 
-        // did the input file parse ok ? (should be fine here - since it was alrady checked before - but just in case)
-        if (ride) {
+        runJobs(saving, saveJob);
 
-            // update ridedatetime and set the Source File name
-            ride->setStartTime(ridedatetime);
-            ride->setTag("Source Filename", importsTarget);
-            ride->setTag("Filename", activitiesTarget);
-            if (errors.count() > 0)
-                ride->setTag("Import errors", errors.join("\n"));
+        // nothing is in the RideCache yet, so don't leave them behind
+        if (aborted) {
+            foreach(RideImportJob job, saving) if (job.written) QFile::remove(job.target);
+            done(0);
+            return;
+        }
 
-            // process linked defaults
-            GlobalContext::context()->rideMetadata->setLinkedDefaults(ride);
+        for (int i=from; i<to; i++) {
 
-            // run the processor first... import
-            tableWidget->item(i,STATUS_COLUMN)->setText(tr("Processing..."));
-            DataProcessorFactory::instance().autoProcess(ride, "Auto", "Import");
-            ride->recalculateDerivedSeries();
-            // now metrics have been calculated
-            DataProcessorFactory::instance().autoProcess(ride, "Save", "ADD");
+            RideImportJob &job = saving[i-from];
+            if (job.skip) continue;
 
+            if (!job.opened) {
+                tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - Import of activitiy file failed"));
 
-            tableWidget->item(i,STATUS_COLUMN)->setText(tr("Saving file..."));
+            } else if (!job.written) {
+                tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - .JSON creation failed"));
 
-            // serialize
-            JsonFileReader reader;
-            QFile target(tmpActivitiesFulltarget);
-            if (reader.writeRideFile(context, ride, target)) {
+            } else {
 
                 // now try adding the Ride to the RideCache - since this may fail due to various reason, the activity file
                 // is stored in tmpActivities during this process to understand which file has create the problem when restarting GC
                 // - only after the step was successful the file is moved
                 // to the "clean" activities folder
-                context->athlete->addRide(QFileInfo(tmpActivitiesFulltarget).fileName(),
+                context->athlete->addRide(QFileInfo(job.target).fileName(),
                                           tableWidget->rowCount() < 20 ? true : false, // don't signal if mass importing
                                           true, true);                                       // file is available only in /tmpActivities, so use this one please
                 // rideCache is successfully updated, let's move the file to the real /activities
-                if (moveFile(tmpActivitiesFulltarget, finalActivitiesFulltarget)) {
+                if (moveFile(job.target, homeActivities.canonicalPath() + "/" + job.activitiesTarget)) {
                     tableWidget->item(i,STATUS_COLUMN)->setText(tr("File Saved"));
                     // and correct the path locally stored in Ride Item
-                    context->ride->setFileName(homeActivities.canonicalPath(), activitiesTarget);
+                    context->ride->setFileName(homeActivities.canonicalPath(), job.activitiesTarget);
                 }  else {
-                    tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - Moving %1 to activities folder").arg(activitiesTarget));
+                    tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - Moving %1 to activities folder").arg(job.activitiesTarget));
                 }
-
-            }  else {
-                tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - .JSON creation failed"));
             }
-        } else {
-            tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - Import of activitiy file failed"));
+            progressBar->setValue(progressBar->value()+1);
         }
 
-        // clear
-        delete ride;
-
         QApplication::processEvents();
         if (aborted) { done(0); return; }
-        progressBar->setValue(progressBar->value()+1);
         this->repaint();
     }
 
@@ -1168,6 +1262,18 @@ RideImportWizard::abortClicked()
 }
 
 
+// run the jobs on the thread pool, the dialog stays
+// responsive (and can be aborted) while they run
+void
+RideImportWizard::runJobs(QVector<RideImportJob> &jobs, void (*job)(RideImportJob &))
+{
+    QEventLoop loop;
+    QFutureWatcher<void> watcher;
+    connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    watcher.setFuture(QtConcurrent::map(jobs, job));
+    loop.exec();
+}
+
 bool
 RideImportWizard::moveFile(const QString &source, const QString &target) {
 
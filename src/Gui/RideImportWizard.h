@@ -30,8 +30,36 @@
 #include <QList>
 #include <QListIterator>
 #include <QItemDelegate>
+#include <QDateTime>
+#include <QVector>
 #include "Context.h"
 #include "RideAutoImportConfig.h"
+#include "RideMetadata.h" // for DefaultDefinition
+
+class RideFile;
+
+// a file on its way through the import, the parse and save
+// stages run a window of these at a time on the thread pool
+struct RideImportJob
+{
+    RideImportJob(Context *context = NULL, QString filename = "") : context(context), filename(filename),
+                  skip(false), ride(NULL), opened(false), written(false) {}
+
+    Context *context;
+    QString filename;
+    bool skip;
+
+    // parsing
+    RideFile *ride;
+    QList<RideFile*> rides; // when its an archive
+    QStringList errors;
+
+    // saving as json into tmpActivities
+    QDateTime ridedatetime;
+    QString importsTarget, activitiesTarget, target;
+    QList<DefaultDefinition> defaults; // linked defaults, copied on the GUI thread
+    bool opened, written;
+};
 
 // Dialog class to show filenames, import progress and to capture user input
 // of ride date and time
@@ -69,6 +97,7 @@ private slots:
 private:
     void init(QList<QString> files, Context *context);
     bool moveFile(const QString &source, const QString &target);
+    void runJobs(QVector<RideImportJob> &jobs, void (*job)(RideImportJob &));
 
     QList <QString> filenames; // list of filenames passed
     int numberOfFiles; // number of files to be processed
@@ -23,6 +23,7 @@
 #include "SearchBox.h"
 #include "Athlete.h"
 #include "RideCache.h"
+#include "MetricStore.h"
 #include "RideItem.h"
 
 SearchFilterBox::SearchFilterBox(QWidget *parent, Context *context, bool nochooser) : QWidget(parent), context(context)
@@ -86,12 +87,8 @@ SearchFilterBox::matches(Context *context, QString filter)
     // search or filter then.......
     if (mode == SearchBox::Filter) {
 
-        DataFilter df(NULL, context, spec);
-        foreach(RideItem *item, context->athlete->rideCache->rides()) {
-            Result res = df.evaluate(item, NULL);
-            if (res.isNumber && res.number())
-                returning << item->fileName;
-        }
+        // remembered until the rides change
+        returning = context->athlete->rideCache->metricStore()->filter(context, spec);
     }
 
     if (mode == SearchBox::Search) {
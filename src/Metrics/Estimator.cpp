@@ -26,6 +26,9 @@
 
 #include "Banister.h"
 
+#include <QFileInfo>
+#include <QtConcurrent>
+
 Q_DECLARE_LOGGING_CATEGORY(gcEstimator)
 Q_LOGGING_CATEGORY(gcEstimator, "gc.estimator")
 
@@ -147,24 +150,171 @@ Estimator::calculate()
     start();
 }
 
+// bests for a week and the best performance in it, only held whilst
+// the weeks around it are being fitted
+struct EstimatorBests {
+    Context *context;
+    QString sport;
+    QDate begin;
+    QStringList filenames;
+    QVector<QDate> rideDates;
+    QVector<float> bests, wpk;
+    Performance performance;
+    bool needed; // in a window to fit
+    bool *abort;
+    bool done;
+};
+
+// on the thread pool
+static void weekBests(EstimatorBests &week)
+{
+    // check if we've been asked to stop, or not needed
+    if (*week.abort == true || !week.needed) return;
+
+    QVector<QDate> dates;
+    week.bests = RideFileCache::meanMaxPowerFor(week.context, week.wpk, week.filenames, week.rideDates, &dates);
+
+    // lets extract the best performance of the week first.
+    // only care about performances between 3-20 minutes.
+    Performance bestperformance(week.begin.addDays(6),0,0,0);
+    for (int t=240; t<week.bests.length() && t<3600; t++) {
+
+        double p = double(week.bests[t]);
+        if (week.bests[t]<=0) continue;
+
+        double pix = powerIndex(p, t, week.sport);
+        if (pix > bestperformance.powerIndex) {
+            bestperformance.duration = t;
+            bestperformance.power = p;
+            bestperformance.powerIndex = pix;
+            bestperformance.when = dates[t];
+            bestperformance.sport = week.sport;
+
+            // for filter, saves having to convert as we go
+            bestperformance.x = bestperformance.when.toJulianDay();
+        }
+    }
+    week.performance = bestperformance;
+    week.done = true;
+}
+
+// the model fits for the six weeks ending with a week
+struct EstimatorFit {
+    Context *context;
+    QString sport;
+    QDate begin;
+    QVector<float> bests, wpk; // rolling six weeks
+    QList<PDEstimate> estimates;
+    bool *abort;
+    bool done;
+};
+
+static void estimateWeek(EstimatorFit &fit)
+{
+    // check if we've been asked to stop
+    if (*fit.abort == true) return;
+
+    QString sport = fit.sport;
+    QDate begin = fit.begin;
+    QDate end = begin.addDays(6);
+
+    printd("%s Model progress %d/%d/%d\n", sport.toStdString().c_str(), begin.year(), begin.month(), begin.day());
+
+    // set up the models we support, each fit has its own
+    CP2Model p2model(fit.context);
+    CP3Model p3model(fit.context);
+    ExtendedModel extmodel(fit.context);
+#if 0 // disable until model fitting errors are fixed (!!!)
+    WSModel wsmodel(fit.context);
+    MultiModel multimodel(fit.context);
+#endif
+
+    QList <PDModel *> models;
+    models << &p2model;
+    models << &p3model;
+    models << &extmodel;
+#if 0 // disable until model fitting errors are fixed (!!!)
+    models << &multimodel;
+    models << &wsmodel;
+#endif
+
+    // we now have the data
+    foreach(PDModel *model, models) {
+
+        PDEstimate add;
+
+        // set the data
+        model->setData(fit.bests);
+        model->saveParameters(add.parameters); // save the computed parms
+
+        add.sport = sport;
+        add.wpk = false;
+        add.from = begin;
+        add.to = end;
+        add.model = model->code();
+        add.WPrime = model->hasWPrime() ? model->WPrime() : 0;
+        add.CP = model->hasCP() ? model->CP() : 0;
+        add.PMax = model->hasPMax() ? model->PMax() : 0;
+        add.FTP = model->hasFTP() ? model->FTP() : 0;
+
+        if (add.CP && add.WPrime) add.EI = add.WPrime / add.CP ;
+
+        // so long as the important model derived values are sensible ...
+        if (add.WPrime > 1000 && add.CP > 100 && add.CP < 1000) {
+            printd("%s Estimates for %s - %s (%s): CP=%.f W'=%.f\n", sport.toStdString().c_str(), add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str(), add.model.toStdString().c_str(), add.CP, add.WPrime);
+            fit.estimates << add;
+        } else {
+            printd("%s Estimates for %s - %s (%s): Not available\n", sport.toStdString().c_str(), add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str(), add.model.toStdString().c_str());
+        }
+
+        // set the wpk data
+        model->setData(fit.wpk);
+        model->saveParameters(add.parameters); // save the computed parms
+
+        add.wpk = true;
+        add.from = begin;
+        add.to = end;
+        add.model = model->code();
+        add.WPrime = model->hasWPrime() ? model->WPrime() : 0;
+        add.CP = model->hasCP() ? model->CP() : 0;
+        add.PMax = model->hasPMax() ? model->PMax() : 0;
+        add.FTP = model->hasFTP() ? model->FTP() : 0;
+        if (add.CP && add.WPrime) add.EI = add.WPrime / add.CP ;
+
+        // so long as the model derived values are sensible ...
+        if ((!model->hasWPrime() || add.WPrime > 10.0f) &&
+            (!model->hasCP() || (add.CP > 1.0f && add.CP < 10.0)) &&
+            (!model->hasPMax() || add.PMax > 1.0f) &&
+            (!model->hasFTP() || add.FTP > 1.0f)) {
+            printd("%s WPK Estimates for %s - %s (%s): CP=%.1f W'=%.1f\n", sport.toStdString().c_str(), add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str(), add.model.toStdString().c_str(), add.CP, add.WPrime);
+            fit.estimates << add;
+        } else {
+            printd("%s WPK Estimates for %s - %s (%s): Not available\n", sport.toStdString().c_str(), add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str(), add.model.toStdString().c_str(), add.CP, add.WPrime);
+        }
+    }
+    fit.done = true;
+}
+
 // threaded code here
 void
 Estimator::run()
 {
   bool first = true;
 
+  // rides by sport and week commencing, so we don't look at every ride for every week
+  QHash<QString, QMap<QDate, QList<RideItem*> > > rideweeks;
+  foreach(RideItem *item, rides) {
+      QDate date = item->dateTime.date();
+      rideweeks[item->sport][date.addDays(1-date.dayOfWeek())] << item;
+  }
+  QString cachedir = context->athlete->home->cache().canonicalPath() + "/";
+
   foreach (QString sport, GlobalContext::context()->rideMetadata->sports()) {
 
     sport = RideFile::sportTag(sport); // Normalize sport name
 
     printd("%s Estimates start.\n", sport.toStdString().c_str());
 
-    // this needs to be done once all the other metrics
-    // Calculate a *weekly* estimate of CP, W' etc using
-    // bests data from the previous 6 weeks
-    RollingBests bests(6);
-    RollingBests bestsWPK(6);
-
     // clear any previous calculations
     QList<PDEstimate> est;
     QList<Performance> perfs;
@@ -197,134 +347,130 @@ Estimator::run()
     // if we don't have 2 rides or more then skip this
     if (from == to || to == QDate()) {
         printd("%s Estimator ends, less than 2 rides with power data.\n", sport.toStdString().c_str());
+        weeks.remove(sport);
         continue;
     }
 
-    // set up the models we support
-    CP2Model p2model(context);
-    CP3Model p3model(context);
-    ExtendedModel extmodel(context);
-#if 0 // disable until model fitting errors are fixed (!!!)
-    WSModel wsmodel(context);
-    MultiModel multimodel(context);
-#endif
-
-    QList <PDModel *> models;
-    models << &p2model;
-    models << &p3model;
-    models << &extmodel;
-#if 0 // disable until model fitting errors are fixed (!!!)
-    models << &multimodel;
-    models << &wsmodel;
-#endif
-
     // from starts a week having first ride with Power data / looking at the next 7 days of data with Power
     // calculate Estimates for all data per week including the week of the last Power recording
+    //
+    // weeks whose rides (or their .cpx) haven't changed since last time are kept as they are
+    QMap<QDate, EstimatorWeek> &cached = weeks[sport];
+    QMap<QDate, EstimatorWeek> current;
+    QVector<EstimatorWeek> pending;
+    QSet<QDate> changed;
     QDate date = from.addDays((1-from.dayOfWeek())); // Weeks start on monday in GC
     while (date <= to) {
 
-        // check if we've been asked to stop
-        if (abort == true) {
-            printd("Model estimator aborted.\n");
-            abort = false;
-            return;
+        EstimatorWeek week;
+        week.sport = sport;
+        week.begin = date;
+        foreach(RideItem *item, rideweeks.value(sport).value(date)) {
+            QFileInfo cpx(cachedir + QFileInfo(item->fileName).baseName() + ".cpx");
+            week.filenames << item->fileName;
+            week.rideDates << item->dateTime.date();
+            week.signature += QString("%1:%2:%3:%4:%5;").arg(item->fileName).arg(item->crc).arg(item->timestamp)
+                                                        .arg(item->weight).arg(cpx.lastModified().toMSecsSinceEpoch());
         }
 
-        QDate begin = date;
-        QDate end = date.addDays(6);
-
-        printd("%s Model progress %d/%d/%d\n", sport.toStdString().c_str(), date.year(), date.month(), date.day());
-
-        // bests is a rolling 6 weeks sets of bests
-        QVector<float> wpk; // for getting the wpk values
-
-        // include only rides or runs or ..........................................................vvvvv
-        QVector<QDate> weekdates;
-        QVector<float> week = RideFileCache::meanMaxPowerFor(context, wpk, begin, end, &weekdates, sport);
-
-        // lets extract the best performance of the week first.
-        // only care about performances between 3-20 minutes.
-        Performance bestperformance(end,0,0,0);
-        for (int t=240; t<week.length() && t<3600; t++) {
-
-            double p = double(week[t]);
-            if (week[t]<=0) continue;
-
-            double pix = powerIndex(p, t, sport);
-            if (pix > bestperformance.powerIndex) {
-                bestperformance.duration = t;
-                bestperformance.power = p;
-                bestperformance.powerIndex = pix;
-                bestperformance.when = weekdates[t];
-                bestperformance.sport = sport;
-
-                // for filter, saves having to convert as we go
-                bestperformance.x = bestperformance.when.toJulianDay();
-            }
+        if (cached.contains(date) && cached.value(date).signature == week.signature) {
+            current.insert(date, cached.value(date));
+        } else {
+            changed << date;
+            pending << week;
         }
-        if (bestperformance.duration > 0) perfs << bestperformance;
 
-        bests.addBests(week);
-        bestsWPK.addBests(wpk);
+        // go forward a week
+        date = date.addDays(7);
+    }
 
-        // we now have the data
-        foreach(PDModel *model, models) {
+    // weeks that are gone change the windows they were in too
+    foreach(QDate gone, cached.keys()) if (!current.contains(gone)) changed << gone;
+    foreach(EstimatorWeek week, pending) current.insert(week.begin, week);
+
+    // only fit the models for the weeks with a change in the 6 weeks ending with them
+    QSet<QDate> refit;
+    QMap<QDate, EstimatorWeek>::iterator week;
+    for (week=current.begin(); week != current.end(); ++week) {
+        bool fit = !week->estimated;
+        for (int i=0; i<6 && !fit; i++) fit = changed.contains(week->begin.addDays(-7*i));
+        if (fit) refit << week->begin;
+    }
 
-            PDEstimate add;
+    // bests is a rolling 6 weeks sets of bests, the bests for each week are
+    // read for a block of weeks at a time on the thread pool and dropped once
+    // the block has been fitted, so they're never all held at once
+    static const int blocksize = 26;
+    RollingBests bests(6);
+    RollingBests bestsWPK(6);
+    QSet<QDate> found;
+    QList<QDate> dates = current.keys();
+    for (int b=0; b<dates.count() && abort == false; b += blocksize) {
+
+        QVector<EstimatorBests> block;
+        for (int i=b; i<b+blocksize && i<dates.count(); i++) {
+            const EstimatorWeek &w = current[dates[i]];
+            EstimatorBests add;
+            add.context = context;
+            add.sport = sport;
+            add.begin = w.begin;
+            add.filenames = w.filenames;
+            add.rideDates = w.rideDates;
+            add.performance = w.performance;
+            add.needed = changed.contains(w.begin);
+            for (int k=0; k<6 && !add.needed; k++) add.needed = refit.contains(w.begin.addDays(7*k));
+            add.abort = &abort;
+            add.done = false;
+            block << add;
+        }
+        QtConcurrent::blockingMap(block, weekBests);
 
-            // set the data
-            model->setData(bests.aggregate());
-            model->saveParameters(add.parameters); // save the computed parms
+        QVector<EstimatorFit> fits;
+        foreach(const EstimatorBests &add, block) {
 
-            add.sport = sport;
-            add.wpk = false;
-            add.from = begin;
-            add.to = end;
-            add.model = model->code();
-            add.WPrime = model->hasWPrime() ? model->WPrime() : 0;
-            add.CP = model->hasCP() ? model->CP() : 0;
-            add.PMax = model->hasPMax() ? model->PMax() : 0;
-            add.FTP = model->hasFTP() ? model->FTP() : 0;
-
-            if (add.CP && add.WPrime) add.EI = add.WPrime / add.CP ;
-
-            // so long as the important model derived values are sensible ...
-            if (add.WPrime > 1000 && add.CP > 100 && add.CP < 1000) {
-                printd("%s Estimates for %s - %s (%s): CP=%.f W'=%.f\n", sport.toStdString().c_str(), add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str(), add.model.toStdString().c_str(), add.CP, add.WPrime);
-                est << add;
-            } else {
-                printd("%s Estimates for %s - %s (%s): Not available\n", sport.toStdString().c_str(), add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str(), add.model.toStdString().c_str());
+            if (add.done) {
+                current[add.begin].performance = add.performance;
+                found << add.begin;
             }
 
-            // set the wpk data
-            model->setData(bestsWPK.aggregate());
-            model->saveParameters(add.parameters); // save the computed parms
-
-            add.wpk = true;
-            add.from = begin;
-            add.to = end;
-            add.model = model->code();
-            add.WPrime = model->hasWPrime() ? model->WPrime() : 0;
-            add.CP = model->hasCP() ? model->CP() : 0;
-            add.PMax = model->hasPMax() ? model->PMax() : 0;
-            add.FTP = model->hasFTP() ? model->FTP() : 0;
-            if (add.CP && add.WPrime) add.EI = add.WPrime / add.CP ;
-
-            // so long as the model derived values are sensible ...
-            if ((!model->hasWPrime() || add.WPrime > 10.0f) &&
-                (!model->hasCP() || (add.CP > 1.0f && add.CP < 10.0)) &&
-                (!model->hasPMax() || add.PMax > 1.0f) &&
-                (!model->hasFTP() || add.FTP > 1.0f)) {
-                printd("%s WPK Estimates for %s - %s (%s): CP=%.1f W'=%.1f\n", sport.toStdString().c_str(), add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str(), add.model.toStdString().c_str(), add.CP, add.WPrime);
-                est << add;
-            } else {
-                printd("%s WPK Estimates for %s - %s (%s): Not available\n", sport.toStdString().c_str(), add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str(), add.model.toStdString().c_str(), add.CP, add.WPrime);
+            bests.addBests(add.bests);
+            bestsWPK.addBests(add.wpk);
+
+            if (refit.contains(add.begin)) {
+                EstimatorFit fit;
+                fit.context = context;
+                fit.sport = sport;
+                fit.begin = add.begin;
+                fit.bests = bests.aggregate();
+                fit.wpk = bestsWPK.aggregate();
+                fit.abort = &abort;
+                fit.done = false;
+                fits << fit;
             }
+        }
 
+        // fit the models for each week on the thread pool
+        QtConcurrent::blockingMap(fits, estimateWeek);
+        foreach(EstimatorFit fit, fits) {
+            current[fit.begin].estimates = fit.estimates;
+            current[fit.begin].estimated = fit.done;
         }
+    }
 
-        // go forward a week
-        date = date.addDays(7);
+    // changed weeks we didn't get to aren't kept, so they're done next time
+    foreach(QDate d, changed) if (!found.contains(d)) current.remove(d);
+    cached = current;
+
+    // check if we've been asked to stop
+    if (abort == true) {
+        printd("Model estimator aborted.\n");
+        abort = false;
+        return;
+    }
+
+    for (week=current.begin(); week != current.end(); ++week) {
+        est << week->estimates;
+        if (week->performance.duration > 0) perfs << week->performance;
     }
 
     // filter performances
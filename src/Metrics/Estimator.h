@@ -45,6 +45,31 @@ class Performance {
         double x; // different units, but basically when as a julian day
 };
 
+// a week of rides for a sport, its best performance and the estimates for
+// the six weeks ending with it, kept between runs so only weeks with rides
+// that changed, and the six week windows they are in, are done again. The
+// bests themselves are read again from the .cpx files when they're needed
+class EstimatorWeek {
+
+    public:
+        EstimatorWeek() : performance(QDate(),0,0,0), estimated(false) {}
+
+        QString sport;
+        QDate begin;
+
+        // rides in the week and their state when the bests were found
+        QStringList filenames;
+        QVector<QDate> rideDates;
+        QString signature;
+
+        // the best performance in the week
+        Performance performance;
+
+        // for the six weeks ending with this one
+        QList<PDEstimate> estimates;
+        bool estimated;
+};
+
 class Banister;
 class Estimator : public QThread {
 
@@ -88,6 +113,9 @@ class Estimator : public QThread {
         QVector<RideItem*> rides; // worklist
         QTimer singleshot;
 
+        // weeks by sport, only used by the thread
+        QHash<QString, QMap<QDate, EstimatorWeek> > weeks;
+
         bool abort;
 };
 
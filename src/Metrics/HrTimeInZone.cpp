@@ -44,6 +44,7 @@ public:
     }
 
     bool isTime() const { return true; }
+    bool isThreadSafe() const { return true; } // only reads samples and zones
 
     void setLevel(int level) { this->level=level-1; } // zones start from zero not 1
 
@@ -29,12 +29,14 @@
 
 #include <stdio.h>
 #include <cmath>
+#include <algorithm>
 
 #include <QSharedPointer>
 #include <QProgressDialog>
 
 PMCData::PMCData(Context *context, Specification spec, QString metricName, int stsDays, int ltsDays) 
-    : context(context), specification_(spec), metricName_(metricName), stsDays_(stsDays), ltsDays_(ltsDays), isstale(true)
+    : context(context), specification_(spec), metricName_(metricName), stsDays_(stsDays), ltsDays_(ltsDays),
+      stsUsed(0), ltsUsed(0), sbTodayUsed(false), isstale(true), full(true)
 {
     // get defaults if not passed
     useDefaults = false;
@@ -58,15 +60,16 @@ PMCData::PMCData(Context *context, Specification spec, QString metricName, int s
 
 
     refresh();
-    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(invalidate()));
-    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(invalidate()));
+    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(invalidate(RideItem*)));
+    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(rideDeleted(RideItem*)));
     connect(context, SIGNAL(refreshUpdate(QDate)), this, SLOT(invalidate()));
-    connect(context->athlete->rideCache, SIGNAL(itemChanged(RideItem*)), this, SLOT(invalidate()));
+    connect(context->athlete->rideCache, SIGNAL(itemChanged(RideItem*)), this, SLOT(invalidate(RideItem*)));
     connect(context->athlete->seasons, SIGNAL(seasonsChanged()), this, SLOT(invalidate()));
 }
 
 PMCData::PMCData(Context *context, Specification spec, Leaf *expr, DataFilterRuntime *df, int stsDays, int ltsDays) 
-    : context(context), specification_(spec), metricName_(""), stsDays_(stsDays), ltsDays_(ltsDays), isstale(true)
+    : context(context), specification_(spec), metricName_(""), stsDays_(stsDays), ltsDays_(ltsDays),
+      stsUsed(0), ltsUsed(0), sbTodayUsed(false), isstale(true), full(true)
 {
     // get defaults if not passed
     useDefaults = false;
@@ -100,17 +103,67 @@ PMCData::PMCData(Context *context, Specification spec, Leaf *expr, DataFilterRun
 
 
     refresh();
-    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(invalidate()));
-    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(invalidate()));
+    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(invalidate(RideItem*)));
+    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(rideDeleted(RideItem*)));
     connect(context, SIGNAL(refreshUpdate(QDate)), this, SLOT(invalidate()));
-    connect(context->athlete->rideCache, SIGNAL(itemChanged(RideItem*)), this, SLOT(invalidate()));
+    connect(context->athlete->rideCache, SIGNAL(itemChanged(RideItem*)), this, SLOT(invalidate(RideItem*)));
 }
 
 void PMCData::invalidate()
 {
+    // start again
     isstale=true;
+    full=true;
 }
 
+void PMCData::invalidate(RideItem *item)
+{
+    // stress changed from the day the ride was and is on
+    isstale=true;
+    if (full) return;
+
+    changed << item;
+    if (counted.contains(item)) dirty << counted.value(item);
+}
+
+void PMCData::rideDeleted(RideItem *item)
+{
+    // stress changed from the day it was on, but it's gone
+    isstale=true;
+    if (full) return;
+
+    changed.remove(item);
+    if (counted.contains(item)) dirty << counted.take(item);
+}
+
+// add the stress for a ride, remembering the day it went on
+void PMCData::addStress(RideItem *item, DataFilter *df)
+{
+    if (!specification_.pass(item)) return;
+
+    // seed with score for this one
+    int offset = start_.daysTo(item->dateTime.date());
+    if (offset > 0 && offset < stress_.count()) {
+
+        // although metrics are cleansed, we check here because development
+        // builds have a rideDB.json that has nan and inf values in it.
+        double value = 0;;
+        if (fromDataFilter) value = expr->eval(&df->rt, expr, Result(0), 0, item).number();
+        else value = item->getForSymbol(metricName_);
+
+        if (!std::isinf(value) && !std::isnan(value)) {
+            if (item->planned)
+                planned_stress_[offset] += value;
+            else
+                stress_[offset] += value;
+            counted.insert(item, offset);
+            //qDebug()<<"stress_["<<offset<<"] :"<<stress_[offset];
+        }
+    }
+}
+
+struct comparerideday { bool operator()(const RideItem *p1, const QDate &p2) { return p1->dateTime.date() < p2; } };
+
 void PMCData::refresh()
 {
     if (!isstale) return;
@@ -140,7 +193,7 @@ void PMCData::refresh()
     foreach(Season x, context->athlete->seasons->seasons)
         if (x.getSeed() && (seed == QDate() || x.getStart() < seed))
             seed = x.getStart();
-    
+
     // take into account any rides, some might be before
     // the start of the first defined season
     QDate first, last;
@@ -152,17 +205,26 @@ void PMCData::refresh()
     }
 
     // what is earliest date we got ? (substract 1 day to include first ride)
-    start_ = QDate(9999,12,31);
-    if (seed != QDate() && seed < start_) start_ = seed;
-    if (first != QDate() && first < start_) start_ = first.addDays(-1);
+    QDate start = QDate(9999,12,31);
+    if (seed != QDate() && seed < start) start = seed;
+    if (first != QDate() && first < start) start = first.addDays(-1);
 
     // whats the latest date we got ? (and add a year for decay)
-    end_ = QDate();
-    if (last > seed) end_ = last.addDays(365);
-    else if (seed != QDate()) end_ = seed.addDays(365);
+    QDate end = QDate();
+    if (last > seed) end = last.addDays(365);
+    else if (seed != QDate()) end = seed.addDays(365);
 
     // back to null date if not set, just to get round date arithmetic
-    if (start_ == QDate(9999,12,31)) start_ = QDate();
+    if (start == QDate(9999,12,31)) start = QDate();
+
+    // anything but rides changing within the range means starting again,
+    // the expected values depend upon today too
+    bool sbToday = appsettings->cvalue(context->athlete->cyclist, GC_SB_TODAY).toInt();
+    if (start != start_ || end != end_ || stsDays_ != stsUsed || ltsDays_ != ltsUsed ||
+        sbToday != sbTodayUsed || QDate::currentDate() != today) full = true;
+
+    start_ = start;
+    end_ = end;
 
     // We got a valid range ?
     if (start_ != QDate() && end_ != QDate() && start_ < end_) {
@@ -209,6 +271,9 @@ void PMCData::refresh()
         expected_sb_.resize(0);
         expected_rr_.resize(0);
 
+        counted.clear();
+        changed.clear();
+        dirty.clear();
 
         // give up
         return;
@@ -218,93 +283,117 @@ void PMCData::refresh()
     //
     // STEP TWO What are the seedings and ride values
     //
-    bool sbToday = appsettings->cvalue(context->athlete->cyclist, GC_SB_TODAY).toInt();
     double lte = (double)exp(-1.0/ltsDays_);
     double ste = (double)exp(-1.0/stsDays_);
+    int from = 0;
 
-    // clear what's there
-    stress_.fill(0);
-    lts_.fill(0);
-    sts_.fill(0);
-    sb_.fill(0);
-    rr_.fill(0);
-
-    planned_stress_.fill(0);
-    planned_lts_.fill(0);
-    planned_sts_.fill(0);
-    planned_sb_.fill(0);
-    planned_rr_.fill(0);
-
-    expected_lts_.fill(0);
-    expected_sts_.fill(0);
-    expected_sb_.fill(0);
-    expected_rr_.fill(0);
-
-    // add the seeded values from seasons
-    foreach(Season x, context->athlete->seasons->seasons) {
-        if (x.getSeed()) {
-            int offset = start_.daysTo(x.getStart());
-            lts_[offset] = x.getSeed() * -1;
-            sts_[offset] = x.getSeed() * -1;
-
-            planned_lts_[offset] = x.getSeed() * -1;
-            planned_sts_[offset] = x.getSeed() * -1;
+    DataFilter* df = new DataFilter(this, context);
+
+    if (full) {
+
+        // clear what's there
+        stress_.fill(0);
+        lts_.fill(0);
+        sts_.fill(0);
+        sb_.fill(0);
+        rr_.fill(0);
+
+        planned_stress_.fill(0);
+        planned_lts_.fill(0);
+        planned_sts_.fill(0);
+        planned_sb_.fill(0);
+        planned_rr_.fill(0);
+
+        expected_lts_.fill(0);
+        expected_sts_.fill(0);
+        expected_sb_.fill(0);
+        expected_rr_.fill(0);
+
+        // the seeded values from seasons
+        seeds.clear();
+        foreach(Season x, context->athlete->seasons->seasons) {
+            if (x.getSeed() > 0) seeds.insert(start_.daysTo(x.getStart()), x.getSeed());
+            else if (x.getSeed()) seeds.remove(start_.daysTo(x.getStart()));
         }
-    }
 
-    DataFilter* df = new DataFilter(this, context);
+        // add the stress scores
+        counted.clear();
+        foreach(RideItem *item, context->athlete->rideCache->rides()) addStress(item, df);
+
+    } else {
 
-    // add the stress scores
-    foreach(RideItem *item, context->athlete->rideCache->rides()) {
+        // the days changed rides are on now
+        foreach(RideItem *item, changed) dirty << start_.daysTo(item->dateTime.date());
 
-        if (!specification_.pass(item)) continue;
+        // forget the stress counted on those days
+        QMutableHashIterator<RideItem*,int> i(counted);
+        while (i.hasNext()) {
+            i.next();
+            if (dirty.contains(i.value())) i.remove();
+        }
 
-        // seed with score for this one
-        int offset = start_.daysTo(item->dateTime.date());
-        if (offset > 0 && offset < stress_.count()) {
+        // and count it again, in the same order as a full refresh
+        from = days_;
+        const QVector<RideItem*> &rides = context->athlete->rideCache->rides();
+        foreach(int day, dirty) {
+            if (day <= 0 || day >= days_) continue;
 
-            // although metrics are cleansed, we check here because development
-            // builds have a rideDB.json that has nan and inf values in it.
-            double value = 0;;
-            if (fromDataFilter) value = expr->eval(&df->rt, expr, Result(0), 0, item).number();
-            else value = item->getForSymbol(metricName_);
+            stress_[day] = 0;
+            planned_stress_[day] = 0;
 
-            if (!std::isinf(value) && !std::isnan(value)) {
-                if (item->planned)
-                    planned_stress_[offset] += value;
-                else
-                    stress_[offset] += value;
-                //qDebug()<<"stress_["<<offset<<"] :"<<stress_[offset];
-            }
+            QDate date = start_.addDays(day);
+            QVector<RideItem*>::const_iterator it = std::lower_bound(rides.begin(), rides.end(), date, comparerideday());
+            for (; it != rides.end() && (*it)->dateTime.date() == date; ++it) addStress(*it, df);
+
+            if (day < from) from = day;
         }
     }
 
     delete df;
 
     //
-    // STEP THREE Calculate sts/lts, sb and rr
+    // STEP THREE Calculate sts/lts, sb and rr from the first day changed
     //
+    today = QDate::currentDate();
+    recompute(from, sbToday, lte, ste);
+
+    changed.clear();
+    dirty.clear();
+    stsUsed = stsDays_;
+    ltsUsed = ltsDays_;
+    sbTodayUsed = sbToday;
+
+    //qDebug()<<"refresh PMC in="<<timer.elapsed()<<"ms"<<(full ? "full" : "from")<<from;
+
+    full=false;
+    isstale=false;
+}
+
+// the recurrences only depend upon the day before, and the
+// rolling stress is carried in rr, so we can start from any day
+void PMCData::recompute(int from, bool sbToday, double lte, double ste)
+{
     double lastLTS=0.0f;
     double lastSTS=0.0f;
 
-    double rollingStress=0;
+    double rollingStress= from ? rr_[from-1] : 0;
 
     double planned_lastLTS=0.0f;
     double planned_lastSTS=0.0f;
 
-    double planned_rollingStress=0;
+    double planned_rollingStress= from ? planned_rr_[from-1] : 0;
 
 #if notyet
     double expected_lastLTS=0.0f;
     double expected_lastSTS=0.0f;
 #endif
 
-    double expected_rollingStress=0;
+    double expected_rollingStress= from ? expected_rr_[from-1] : 0;
 
-    for(int day=0; day < days_; day++) {
+    for(int day=from; day < days_; day++) {
 
         // not seeded
-        if (lts_[day] >=0 || sts_[day]>=0) {
+        if (!seeds.contains(day)) {
 
             // LTS
             if (day) lastLTS = lts_[day-1];
@@ -314,10 +403,10 @@ void PMCData::refresh()
             if (day) lastSTS = sts_[day-1];
             sts_[day] = (stress_[day] * (1.0 - ste)) + (lastSTS * ste);
 
-        } else if (lts_[day]< 0 || sts_[day]<0) {
+        } else {
 
-            lts_[day] *= -1;
-            sts_[day] *= -1;
+            lts_[day] = seeds.value(day);
+            sts_[day] = seeds.value(day);
         }
 
         // rolling stress for STS days
@@ -341,7 +430,7 @@ void PMCData::refresh()
         // *******************
 
         // not seeded
-        if (planned_lts_[day] >=0 || planned_sts_[day]>=0) {
+        if (!seeds.contains(day)) {
 
             // LTS
             if (day) planned_lastLTS = planned_lts_[day-1];
@@ -351,10 +440,10 @@ void PMCData::refresh()
             if (day) planned_lastSTS = planned_sts_[day-1];
             planned_sts_[day] = (planned_stress_[day] * (1.0 - ste)) + (planned_lastSTS * ste);
 
-        } else if (planned_lts_[day]< 0 || planned_sts_[day]<0) {
+        } else {
 
-            planned_lts_[day] *= -1;
-            planned_sts_[day] *= -1;
+            planned_lts_[day] = seeds.value(day);
+            planned_sts_[day] = seeds.value(day);
         }
 
         // rolling stress for STS days
@@ -377,14 +466,14 @@ void PMCData::refresh()
         // ****  EXPECTED  ****
         // ********************
 
-        if (start_.addDays(day).daysTo(QDate::currentDate())<0) {
+        if (start_.addDays(day).daysTo(today)<0) {
             double lastLts = 0.0;
             double lastSts = 0.0;
             double ltsAtStsDays1 = 0.0;
             double ltsAtStsDays2 = 0.0;
 
             if (day) {
-                if (start_.addDays(day).daysTo(QDate::currentDate())<-1) {
+                if (start_.addDays(day).daysTo(today)<-1) {
                     lastLts = expected_lts_[day-1];
                     lastSts = expected_sts_[day-1];
                 } else {
@@ -392,13 +481,12 @@ void PMCData::refresh()
                     lastSts = sts_[day-1];
                 }
                 if (day > stsDays_) {
-                    if (start_.addDays(day).daysTo(QDate::currentDate())<-1-stsDays_) {
+                    if (start_.addDays(day).daysTo(today)<-1-stsDays_) {
                         ltsAtStsDays1 = expected_lts_[day-stsDays_-1];
                     } else {
                         ltsAtStsDays1 = lts_[day-stsDays_-1];
                     }
-
-                    if (start_.addDays(day).daysTo(QDate::currentDate())<-stsDays_) {
+                    if (start_.addDays(day).daysTo(today)<-stsDays_) {
                         ltsAtStsDays2 = expected_lts_[day-stsDays_];
                     } else {
                         ltsAtStsDays2 = lts_[day-stsDays_];
@@ -406,18 +494,12 @@ void PMCData::refresh()
                 }
             }
 
-            // not seeded
-            if (expected_lts_[day] >=0 || expected_sts_[day]>=0) {
-                // LTS
-                expected_lts_[day] = (planned_stress_[day] * (1.0 - lte)) + (lastLts * lte);
-
-                // STS
-                expected_sts_[day] = (planned_stress_[day] * (1.0 - ste)) + (lastSts * ste);
+            // never seeded
+            // LTS
+            expected_lts_[day] = (planned_stress_[day] * (1.0 - lte)) + (lastLts * lte);
 
-            } else if (expected_lts_[day]< 0 || expected_sts_[day]<0) {
-                expected_lts_[day] *= -1;
-                expected_sts_[day] *= -1;
-            }
+            // STS
+            expected_sts_[day] = (planned_stress_[day] * (1.0 - ste)) + (lastSts * ste);
 
             // rolling stress for STS days
             if (day && day <= stsDays_) {
@@ -443,10 +525,6 @@ void PMCData::refresh()
         }
 
     }
-
-    //qDebug()<<"refresh PMC in="<<timer.elapsed()<<"ms";
-
-    isstale=false;
 }
 
 int
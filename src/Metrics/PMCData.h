@@ -32,6 +32,7 @@
 #include <QTreeWidgetItem>
 
 class Context;
+class RideItem;
 
 class PMCData : public QObject {
 
@@ -105,12 +106,18 @@ class PMCData : public QObject {
     public slots:
 
         // as underlying ride data changes the
-        // contents are invalidated and refreshed
+        // contents are invalidated and refreshed, when
+        // a ride changes only from the day it's on
         void invalidate();
+        void invalidate(RideItem *);
+        void rideDeleted(RideItem *);
         void refresh();
 
     private:
 
+        void addStress(RideItem *, DataFilter *);
+        void recompute(int from, bool sbToday, double lte, double ste);
+
         // who we for ?
         Context *context;
         Specification specification_;
@@ -131,7 +138,19 @@ class PMCData : public QObject {
         QVector<double> planned_stress_, planned_lts_, planned_sts_, planned_sb_, planned_rr_;
         QVector<double> expected_lts_, expected_sts_, expected_sb_, expected_rr_;
 
+        // what it was computed with, if any change we start again
+        QHash<int, double> seeds;
+        int stsUsed, ltsUsed;
+        bool sbTodayUsed;
+        QDate today;
+
+        // rides changed since, the days they were counted on and need recounting
+        QHash<RideItem*, int> counted;
+        QSet<RideItem*> changed;
+        QSet<int> dirty;
+
         bool isstale; // needs refreshing
+        bool full; // from the start
 };
 
 #endif // _GC_StressCalculator_h
@@ -45,6 +45,7 @@ class PaceZoneTime : public RideMetric {
     }
 
     bool isTime() const { return true; }
+    bool isThreadSafe() const { return true; } // only reads samples and zones
     void setLevel(int level) { this->level=level-1; } // zones start from zero not 1
 
     void compute(RideItem *item, Specification spec, const QHash<QString,RideMetric*> &) {
@@ -112,6 +112,7 @@ class PeakHr : public RideMetric {
         setType(RideMetric::Peak);
     }
     void setSecs(double secs) { this->secs=secs; }
+    bool isThreadSafe() const { return true; } // only reads samples
 
     void compute(RideItem *item, Specification spec, const QHash<QString,RideMetric*> &) {
 
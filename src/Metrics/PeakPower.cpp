@@ -285,6 +285,7 @@ class PeakPower : public RideMetric {
         setType(RideMetric::Peak);
     }
     void setSecs(double secs) { this->secs=secs; }
+    bool isThreadSafe() const { return true; } // only reads samples
 
     void compute(RideItem *item, Specification spec, const QHash<QString,RideMetric*> &) {
 
@@ -1391,13 +1391,19 @@ FormField::setLinkedDefault(QString text)
 
 void
 RideMetadata::setLinkedDefaults(RideFile* ride)
+{
+    setLinkedDefaults(ride, getDefaults());
+}
+
+void
+RideMetadata::setLinkedDefaults(RideFile* ride, QList<DefaultDefinition> defaults)
 {
     bool changed;
 
     do {
         changed = false;
 
-        foreach (DefaultDefinition adefault, getDefaults())
+        foreach (DefaultDefinition adefault, defaults)
             if (ride->getTag(adefault.field, "") == adefault.value)
                 if (ride->getTag(adefault.linkedField, "") == "" && adefault.linkedValue != "") {
                     ride->setTag(adefault.linkedField, adefault.linkedValue);
@@ -206,6 +206,7 @@ class RideMetadata : public QWidget
         QPalette palette; // to be applied to all widgets
 
         void setLinkedDefaults(RideFile* ride);
+        static void setLinkedDefaults(RideFile* ride, QList<DefaultDefinition> defaults); // a copy, off the GUI thread
 
         bool active;            // ignore signals when editing is active
 
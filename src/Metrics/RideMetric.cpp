@@ -25,6 +25,8 @@
 #include "Zones.h"
 #include "HrZones.h"
 
+#include <QtConcurrent>
+
 // DB Schema Version - YOU MUST UPDATE THIS IF THE SCHEMA VERSION CHANGES!!!
 // Schema version will change if a) the default metadata.xml is updated
 //                            or b) new metrics are added / old changed
@@ -167,8 +169,9 @@
 // 157 27  May 2021 Ale Martinez       Added Pace Row
 // 158 28  Feb 2024 Ale Martinez       Enabled Pace for Walking
 // 159 28  Apr 2024 Ale Martinez       Fix Avg Speed aggregation
+// 160 17  Oct 2026 agent              Mean max sampling, peak/climb intervals and W'bal over the resampled series
 
-int DBSchemaVersion = 159;
+int DBSchemaVersion = 160;
 
 RideMetricFactory *RideMetricFactory::_instance;
 QVector<QString> RideMetricFactory::noDeps;
@@ -194,28 +197,96 @@ RideMetric::userMetricFingerprint(QList<UserMetricSettings> these)
 #endif
 }
 
+void
+RideMetricFactory::updateGraph() const
+{
+    QMutexLocker locker(&graphMutex);
+    if (!graphStale) return;
+
+    int count = metricNames.count();
+
+    dependencyIndexes_.fill(QVector<int>(), count);
+    for (int i=0; i<count; i++) {
+        foreach(const QString &dependency, dependencies(metricNames[i])) {
+            const RideMetric *m = metrics.value(dependency, NULL);
+            if (m) dependencyIndexes_[i] << m->index();
+            else qDebug()<<"metric dep error:"<<dependency;
+        }
+    }
+
+    // a metric goes in the wave after the last of its dependencies, they
+    // are mostly registered after what they depend upon so few passes
+    waves_.fill(0, count);
+    bool changed = true;
+    for (int pass=0; changed && pass <= count; pass++) {
+        changed = false;
+        for (int i=0; i<count; i++) {
+            int wave = 0;
+            foreach(int dependency, dependencyIndexes_[i]) wave = qMax(wave, waves_[dependency]+1);
+            if (wave != waves_[i]) {
+                waves_[i] = wave;
+                changed = true;
+            }
+        }
+    }
+    if (changed) qDebug()<<"metric dep error: circular dependency";
+
+    waveCount_ = 0;
+    foreach(int wave, waves_) waveCount_ = qMax(waveCount_, wave+1);
+
+    graphStale = false;
+}
+
+// computes a metric on a pool thread, it only reads the
+// dependencies computed in earlier waves
+struct RideMetricCompute {
+    typedef void result_type;
+
+    RideItem *item;
+    Specification spec;
+    const QHash<QString,RideMetric*> *done;
+
+    void operator()(RideMetric *&m) const { m->compute(item, spec, *done); }
+};
+
 QHash<QString,RideMetricPtr>
 RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList &metrics)
 {
+    // waves with fewer metrics than this aren't worth the threads
+    static const int parallelwave = 16;
+
     const RideMetricFactory &factory = RideMetricFactory::instance();
+    factory.updateGraph();
+    int count = factory.metricCount();
 
-    // generate worklist from metrics we know
-    // bear in mind this can change as users add
+    // generate worklist from metrics we know, and everything they
+    // depend upon. bear in mind this can change as users add
     // and remove user metrics
     // builtin User metrics are computed after builtins
     // since they don't have explicit dependencies set, yet.
-    QStringList builtin;
-    QStringList user;
-    foreach(QString metric, metrics)
-        if (factory.haveMetric(metric)) {
-            if (factory.rideMetric(metric)->isUser())
-                user << metric;
-            else
-                builtin << metric;
-        }
+    QVector<bool> needed(count, false);
+    QVector<int> todo, user;
+    foreach(QString symbol, metrics) {
+        const RideMetric *m = factory.rideMetric(symbol);
+        if (!m) continue;
+        if (m->isUser()) {
+            if (!needed[m->index()]) user << m->index();
+            needed[m->index()] = true;
+        } else todo << m->index();
+    }
+    while (!todo.isEmpty()) {
+        int i = todo.takeLast();
+        if (needed[i]) continue;
+        needed[i] = true;
+        foreach(int dependency, factory.dependencyIndexes(i))
+            if (!needed[dependency]) todo << dependency;
+    }
 
-    // this is what we've completed as we go
-    QHash<QString,RideMetric*> done;
+    // builtins by wave, a wave only depends upon those before it
+    QVector<QVector<int> > waves(factory.waveCount());
+    for (int i=0; i<count; i++)
+        if (needed[i] && !factory.metric(i)->isUser()) waves[factory.wave(i)] << i;
+    waves << user;
 
     // resize the metric array in the interval if needed
     if (spec.interval() && spec.interval()->metrics().size() < factory.metricCount()) 
@@ -225,39 +296,53 @@ RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList
     if (!spec.interval() && item->metrics().size() < factory.metricCount())
         item->metrics().resize(factory.metricCount());
 
-    // working through the todo list...
-    while (!builtin.isEmpty() || !user.isEmpty()) {
-
-        // next one to do, builtins first then user defined
-        QString symbol = builtin.isEmpty() ? user.takeFirst() :
-                                             builtin.takeFirst();
-
-        // doesn't exist !
-        if (!factory.haveMetric(symbol)) continue;
-
-        // does this one have any dependencies?
-        const QVector<QString> &deps = factory.dependencies(symbol);
+    // this is what we've completed as we go, by index and by
+    // symbol since that is how compute() looks up dependencies
+    QVector<RideMetric*> computed(count, NULL);
+    QHash<QString,RideMetric*> done;
+    bool primed = false;
 
-        bool ready = true;
+    // working through the waves, user metrics last one at a
+    // time since they can look at each other's values
+    for (int w=0; w<waves.count(); w++) {
 
-        // if the dependencies aren't done yet add to the end of the list
-        foreach (QString dep, deps) {
-            if (!done.contains(dep)) {
-                ready = false;
-                if (!builtin.contains(dep))
-                    builtin.append(dep);
-            }
-        }
+        const QVector<int> &wave = waves[w];
+        bool inparallel = w < waves.count()-1 && wave.count() >= parallelwave;
 
-        // if all our depencies are computed we can do this one
-        if (ready) {
+        QVector<RideMetric*> parallel;
+        foreach(int i, wave) {
 
             // we clone so we can remain thread safe
             // do not be tempted to change this (!)
-            RideMetric *m = factory.newMetric(symbol);
+            RideMetric *m = factory.metric(i)->clone();
             m->setValue(0.0);
             m->setCount(0);
-            m->compute(item, spec, done);
+            computed[i] = m;
+            if (inparallel && m->isThreadSafe()) parallel << m;
+        }
+
+        // not enough that can run alongside each other to bother, and ride()
+        // tries to open the file again each time it's called when it failed
+        // to read, so that has to stay on this thread
+        if (parallel.count() < parallelwave || !item->ride()) parallel.clear();
+
+        if (parallel.count()) {
+
+            // build anything the ride builds lazily, so
+            // the metrics only ever read it
+            if (!primed) item->ride()->wprimeData();
+            primed = true;
+
+            RideMetricCompute compute = { item, spec, &done };
+            QtConcurrent::blockingMap(parallel, compute);
+        }
+
+        foreach(int i, wave) {
+
+            RideMetric *m = computed[i];
+            QString symbol = m->symbol();
+
+            if (parallel.isEmpty() || !m->isThreadSafe()) m->compute(item, spec, done);
 
             // override the computed value if set by user, but not for intervals
             if (!spec.interval() && item->ride() && item->ride()->metricOverrides.contains(symbol))
@@ -275,13 +360,6 @@ RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList
                 if (spec.interval()) spec.interval()->metrics()[m->index()] = m->value();
                 else item->metrics()[m->index()] = m->value();
             }
-
-        } else {
-
-            // we need to wait for our dependencies so add
-            // to the back of the list 
-            if (!builtin.contains(symbol))
-                builtin.append(symbol);
         }
     }
 
@@ -289,15 +367,15 @@ RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList
     // which is deleted when reference count 0 and goes out of scope
     QHash<QString,RideMetricPtr> result;
     foreach (QString symbol, metrics) {
-        if (factory.haveMetric(symbol)) {
-            result.insert(symbol, QSharedPointer<RideMetric>(done.value(symbol)));
-            done.remove(symbol);
+        const RideMetric *m = factory.rideMetric(symbol);
+        if (m && computed[m->index()]) {
+            result.insert(symbol, QSharedPointer<RideMetric>(computed[m->index()]));
+            computed[m->index()] = NULL;
         }
     }
 
     // delete the cloned metrics, no memory leak here :)
-    foreach (QString symbol, done.keys())
-        delete done.value(symbol);
+    foreach (RideMetric *m, computed) delete m;
 
     // and we're done
     return result;
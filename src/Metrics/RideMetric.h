@@ -94,6 +94,12 @@ public:
     // is this a user defined one?
     virtual bool isUser() const { return false; }
 
+    // can compute() run alongside other metrics for the same ride, only
+    // metrics that have been checked to just read the samples, zones and
+    // their dependencies say yes. RideItem::getWeight() and fileCache()
+    // write to the ride item so anything that uses them can't
+    virtual bool isThreadSafe() const { return false; }
+
     // need an index for offset into array, each metric
     // now has a numeric identifier from 0 - metricCount
     int index() const { return index_; }
@@ -367,7 +373,15 @@ private:
     QHash<QString,QVector<QString>*> dependencyMap;
     bool dependenciesChecked;
 
-    RideMetricFactory() : dependenciesChecked(false) {}
+    // dependencies by metric index, and the wave each builtin can be
+    // computed in, it only depends on metrics in earlier waves
+    mutable QVector<QVector<int> > dependencyIndexes_;
+    mutable QVector<int> waves_;
+    mutable int waveCount_;
+    mutable bool graphStale;
+    mutable QMutex graphMutex;
+
+    RideMetricFactory() : dependenciesChecked(false), waveCount_(0), graphStale(true) {}
     RideMetricFactory(const RideMetricFactory &other);
     RideMetricFactory &operator=(const RideMetricFactory &other);
 
@@ -413,6 +427,14 @@ private:
         return metrics.value(symbol)->clone();
     }
 
+    // the dependency graph, updateGraph() must be called first
+    // and it is rebuilt when metrics are added or removed
+    void updateGraph() const;
+    const RideMetric *metric(int index) const { return metrics.value(metricNames[index], NULL); }
+    const QVector<int> &dependencyIndexes(int index) const { return dependencyIndexes_[index]; }
+    int wave(int index) const { return waves_[index]; }
+    int waveCount() const { return waveCount_; }
+
     // clear out user metrics, we're readding them
     void removeUserMetrics() {
         int firstUser=-1;
@@ -434,6 +456,7 @@ private:
                 metricNames.takeAt(firstUser);
                 metricTypes.remove(firstUser);
             }
+            graphStale = true;
         }
     }
 
@@ -445,6 +468,7 @@ private:
         metrics.insert(metric.symbol(), newMetric);
         metricNames.append(metric.symbol());
         metricTypes.append(metric.type());
+        graphStale = true;
         if (deps) {
             QVector<QString> *copy = new QVector<QString>;
             for (int i = 0; i < deps->size(); ++i)
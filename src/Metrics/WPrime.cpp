@@ -46,14 +46,19 @@
 // There may be room for improvement by adopting a different integration strategy
 // in the future, but now, a typical 4 hour hilly ride can be computed in 250ms on
 // and Athlon dual core CPU where previously it took 4000ms.
+//
+// It is now a recurrence; the decayed sum at t is the sum at t-1 decayed by
+// exp(-1/TAU) plus the power above CP at t, see WPrimeStream. This is O(1) per
+// sample, doesn't overflow exp(t/TAU) on long rides and can resume from any
+// point, so edits to the end of a ride only recompute from there.
 
 
 #include "WPrime.h"
 #include "RideItem.h"
+#include "RideFileColumns.h" // resampled watts
 #include "Units.h" // for MILES_PER_KM
 #include "Settings.h" // for GC_WBALFORM
 
-#include <qwt_spline_cubic.h> // smoothing
 
 #if notyet
 const double WprimeMultConst = 1.0;
@@ -91,6 +96,9 @@ WPrime::WPrime()
     // XXX will need to reset metrics when they are added
     minY = maxY = 0;
     wasIntegral = (appsettings->value(NULL, GC_WBALFORM, "int").toString() == "int");
+    rideFile = NULL;
+    computedIntegral = wasIntegral;
+    computedCP = computedWPRIME = computedTAU = 0;
 }
 
 void
@@ -113,8 +121,11 @@ WPrime::setRide(RideFile *input)
     QElapsedTimer time; // for profiling performance of the code
     time.start();
 
-    // remember the ride for next time
+    // remember the ride for next time, and what we computed last time
+    // since we may only need to recompute the end of the ride
+    bool sameride = (rideFile == input);
     rideFile = input;
+    QVector<double> prior = values;
 
     // reset from previous
     values.resize(0); // the memory is kept for next time so this is efficient
@@ -129,51 +140,24 @@ WPrime::setRide(RideFile *input)
     }
 
     // STEP 1: CONVERT POWER DATA TO A 1 SECOND TIME SERIES
-    // create a raw time series in the format QwtSpline wants
-    QVector<QPointF> points;
-    QVector<QPointF> pointsd;
+    // gaps in recording are zero watts, but distance carries on from
+    // where it was. These are shared with the mean max and effort
+    // discovery so the ride is only resampled once
     double convert = GlobalContext::context()->useMetricUnits ? 1.00f : MILES_PER_KM;
 
-    last=0;
-    double offset = 0; // always start from zero seconds (e.g. intervals start at and offset in ride)
-    bool first = true;
-
-    RideFilePoint *lp=NULL;
-    foreach(RideFilePoint *p, input->dataPoints()) {
-
-        // yuck! nasty data
-        if (p->secs > (25*60*60)) return;
-
-        if (first) {
-            offset = p->secs;
-            first = false;
-        }
+    // yuck! nasty data
+    last = 0;
+    if (input->dataPoints().last()->secs > (25*60*60)) return;
 
-        // fill gaps in recording with zeroes
-        if (lp)
-            for(double t=lp->secs+input->recIntSecs();
-                (t + input->recIntSecs()) < p->secs;
-                t += input->recIntSecs()) {
-                points << QPointF(t-offset, 0);
-                pointsd << QPointF(t-offset, p->km * convert); // not zero !!!! this is a map from secs -> km not a series
-            }
+    smoothed = input->resampled(RideFile::watts).values;
+    distance = input->resampled(RideFile::km, 1.0, true).values;
+    if (smoothed.count() == 0) return;
 
-        // lets not go backwards -- or two samples at the same time
-        if ((lp && p->secs > lp->secs) || !lp) {
-            points << QPointF(p->secs - offset, p->watts);
-            pointsd << QPointF(p->secs - offset, p->km * convert);
-        }
+    // always start from zero seconds (e.g. intervals start at and offset in ride)
+    last = smoothed.count() - 1;
+    distance.resize(smoothed.count());
+    for (int t=0; t<=last; t++) distance[t] *= convert;
 
-        // update state
-        last = p->secs - offset;
-        lp = p;
-    }
-
-    // Create a spline
-    QwtSplineCubic spline;
-    spline.setBoundaryType(QwtSpline::PeriodicPolygon);
-    distance.update(spline, QPolygonF(pointsd), 0.5);
-    smoothed.update(spline, QPolygonF(points), 0.5);
     // Get CP
     CP = 250; // default
     WPRIME = 20000;
@@ -200,7 +184,7 @@ WPrime::setRide(RideFile *input)
     EXP = 0;
     for (int i=0; i<last; i++) {
 
-        int value = smoothed.valueY(i);
+        int value = smoothed[i];
         if (value < 0) value = 0; // don't go negative now
 
         powerValues[i] = value > CP ? value-CP : 0;
@@ -224,70 +208,46 @@ WPrime::setRide(RideFile *input)
     }
 
     // STEP 2: ITERATE OVER DATA TO CREATE W' DATA SERIES
+    //
+    // integral formula Skiba et al or differential equation Froncioni / Clarke
+    // the W'bal at a point is all we need to carry on from there, so when the
+    // ride was edited we only recompute from the first second that changed
+    QVector<int> watts(last+1);
+    for (int t=0; t<=last; t++) watts[t] = smoothed[t];
+
+    int from = 0;
+    if (sameride && integral == computedIntegral && CP == computedCP && WPRIME == computedWPRIME && TAU == computedTAU) {
+        int n = qMin(qMin(computed.count(), watts.count()), prior.count());
+        while (from < n && computed[from] == watts[from]) from++;
+    }
 
-    if (integral) {
-
-        // integral formula Skiba et al
-
-        minY = WPRIME;
-        maxY = WPRIME;
-        values.resize(last+1);
-        xvalues.resize(last+1);
-        xdvalues.resize(last+1);
-
-        QVector<double> myvalues(last+1);
-
-        WPrimeIntegrator a(powerValues, 0, last, TAU);
-
-        a.start();
-        a.wait();
-
-        // sum values
-        for (int t=0; t<=last; t++) {
-            values[t] = a.output[t];
-            xvalues[t] = t / 60.00f;
-        }
-
-        // now subtract WPRIME and work out minimum etc
-        for(int t=0; t <= last; t++) {
-            double value = WPRIME - values[t];
-            values[t] = value;
-            xdvalues[t] = distance.valueY(t);
-
-            if (value > maxY) maxY = value;
-            if (value < minY) minY = value;
-        }
-
-    } else {
-
-        // differential equation Froncioni / Clarke
+    WPrimeStream stream(integral, CP, WPRIME, TAU);
+    if (from) stream.resume(prior[from-1]);
 
-        // lets run forward from 0s to end of ride
-        minY = WPRIME;
-        maxY = WPRIME;
-        values.resize(last+1);
-        xvalues.resize(last+1);
-        xdvalues.resize(last+1);
+    minY = WPRIME;
+    maxY = WPRIME;
+    values.resize(last+1);
+    xvalues.resize(last+1);
+    xdvalues.resize(last+1);
 
-        double W = WPRIME;
-        for (int t=0; t<=last; t++) {
-            int smoothedValue = smoothed.valueY(t);
+    for (int t=0; t<=last; t++) {
 
-            if (smoothedValue < CP) {
-                W  = W + (CP-smoothedValue)*(WPRIME-W)/WPRIME;
-            } else {
-                W  = W + (CP-smoothedValue);
-            }
+        double W = t < from ? prior[t] : stream.add(watts[t]);
 
-            if (W > maxY) maxY = W;
-            if (W < minY) minY = W;
+        if (W > maxY) maxY = W;
+        if (W < minY) minY = W;
 
-            values[t] = W;
-            xvalues[t] = double(t) / 60.00f;
-            xdvalues[t] = distance.valueY(t);
-        }
+        values[t] = W;
+        xvalues[t] = double(t) / 60.00f;
+        xdvalues[t] = distance[t];
     }
 
+    computed = watts;
+    computedIntegral = integral;
+    computedCP = CP;
+    computedWPRIME = WPRIME;
+    computedTAU = TAU;
+
     if (minY < -30000) minY = 0; // the data is definitely out of bounds!
                                  // so lets not exacerbate the problem - truncate
 
@@ -301,7 +261,7 @@ WPrime::setRide(RideFile *input)
     smoothArray.resize(last+1);
     QVector<int> rawArray(last+1);
     for (int i=0; i<last; i++) {
-        smoothArray[i] = smoothed.valueY(i);
+        smoothArray[i] = smoothed[i];
         rawArray[i] = smoothArray[i];
     }
 
@@ -374,100 +334,46 @@ WPrime::setRide(RideFile *input)
     }
 }
 
+// W'bal series for a workout, 1 second per sample with x in msecs
+static void workoutSeries(QVector<int> &watts, bool integral, double CP, double WPRIME, double TAU,
+                          QVector<double> &values, QVector<double> &xvalues, double &minY, double &maxY)
+{
+    // the integral form has always ended with a sample at zero watts
+    int last = watts.count();
+    int count = integral ? last+1 : last;
+    values.resize(count);
+    xvalues.resize(count);
+
+    WPrimeStream stream(integral, CP, WPRIME, TAU);
+    for (int t=0; t<count; t++) {
+
+        double W = stream.add(t < last ? watts[t] : 0);
+
+        if (W > maxY) maxY = W;
+        if (W < minY) minY = W;
+
+        values[t] = W;
+        xvalues[t] = t * 1000.00f;
+    }
+}
+
 void
 WPrime::setWatts(Context *context, QVector<int>&wattsArray, int CP, int WPRIME)
 {
     bool integral = (appsettings->value(NULL, GC_WBALFORM, "int").toString() == "int");
 
-    QElapsedTimer time; // for profiling performance of the code
-    time.start();
-
     // reset from previous
     values.resize(0); // the memory is kept for next time so this is efficient
     xvalues.resize(0);
     minY = maxY = WPRIME;
 
-    if (integral) {
-
-        last = wattsArray.count();
-        values.resize(last);
-        xvalues.resize(last);
-
-        // input array contains the actual W' expenditure
-        // and will also contain non-zero values
-        double totalBelowCP=0;
-        double countBelowCP=0;
-        QVector<int> powerValues(last+1);
-        EXP = 0;
-        for (int i=0; i<last; i++) {
-
-            // get watts at point in time
-            int value = wattsArray[i];
-
-            powerValues[i] = value > CP ? value-CP : 0;
-
-            if (value < CP) {
-                totalBelowCP += value;
-                countBelowCP++;
-            } else EXP += value; // total expenditure above CP
-        }
-
-        TAU = appsettings->cvalue(context->athlete->cyclist, GC_WBALTAU, 300).toInt();
-
-        // lets run forward from 0s to end of ride
-        values.resize(last+1);
-        xvalues.resize(last+1);
-
-        QVector<double> myvalues(last+1);
-
-        WPrimeIntegrator a(powerValues, 0, last, TAU);
-
-        a.start();
-        a.wait();
-
-        // sum values
-        for (int t=0; t<=last; t++) {
-            values[t] = a.output[t];
-            xvalues[t] = t * 1000.00f;
-        }
-
-        // now subtract WPRIME and work out minimum etc
-        for(int t=0; t <= last; t++) {
-            double value = WPRIME - values[t];
-            values[t] = value;
-
-            if (value > maxY) maxY = value;
-            if (value < minY) minY = value;
-        }
-
-    } else {
-
-        // how many points ?
-        last = wattsArray.count();
-        values.resize(last);
-        xvalues.resize(last);
-
-        // input array contains the actual W' expenditure
-        // and will also contain non-zero values
-        double W = WPRIME;
-        for (int i=0; i<last; i++) {
-
-            // get watts at point in time
-            int value = wattsArray[i];
-
-            if(value < CP) {
-                W  = W + (CP-value)*(WPRIME-W)/WPRIME;
-            } else {
-                W  = W + (CP-value);
-            }
+    // total expenditure above CP
+    last = wattsArray.count();
+    EXP = 0;
+    for (int i=0; i<last; i++) if (wattsArray[i] >= CP) EXP += wattsArray[i];
 
-            if (W > maxY) maxY = W;
-            if (W < minY) minY = W;
-
-            values[i] = W;
-            xvalues[i] = i*1000;
-        }
-    }
+    TAU = appsettings->cvalue(context->athlete->cyclist, GC_WBALTAU, 300).toInt();
+    workoutSeries(wattsArray, integral, CP, WPRIME, TAU, values, xvalues, minY, maxY);
 
     if (minY < -30000) minY = 0; // the data is definitely out of bounds!
                                  // so lets not exacerbate the problem - truncate
@@ -478,9 +384,6 @@ WPrime::setErg(ErgFile *input)
 {
     bool integral = (appsettings->value(NULL, GC_WBALFORM, "int").toString() == "int");
 
-    QElapsedTimer time; // for profiling performance of the code
-    time.start();
-
     // reset from previous
     values.resize(0); // the memory is kept for next time so this is efficient
     xvalues.resize(0);
@@ -505,91 +408,19 @@ WPrime::setErg(ErgFile *input)
 
     minY = maxY = WPRIME;
 
-    if (integral) {
-
-        last = ergFileQueryAdapter.Duration() / 1000; 
-        values.resize(last);
-        xvalues.resize(last);
-
-        // input array contains the actual W' expenditure
-        // and will also contain non-zero values
-        double totalBelowCP=0;
-        double countBelowCP=0;
-        QVector<int> powerValues(last+1);
-        EXP = 0;
-        for (int i=0; i<last; i++) {
-
-            // get watts at point in time
-            int lap;
-            int value = ergFileQueryAdapter.wattsAt(i*1000, lap);
-
-            powerValues[i] = value > CP ? value-CP : 0;
-
-            if (value < CP) {
-                totalBelowCP += value;
-                countBelowCP++;
-            } else EXP += value; // total expenditure above CP
-        }
-
-        TAU = appsettings->cvalue(input->context->athlete->cyclist, GC_WBALTAU, 300).toInt();
-
-        // lets run forward from 0s to end of ride
-        values.resize(last+1);
-        xvalues.resize(last+1);
-
-        QVector<double> myvalues(last+1);
-
-        WPrimeIntegrator a(powerValues, 0, last, TAU);
-
-        a.start();
-        a.wait();
-
-        // sum values
-        for (int t=0; t<=last; t++) {
-            values[t] = a.output[t];
-            xvalues[t] = t * 1000.00f;
-        }
-
-        // now subtract WPRIME and work out minimum etc
-        for(int t=0; t <= last; t++) {
-            double value = WPRIME - values[t];
-            values[t] = value;
-
-            if (value > maxY) maxY = value;
-            if (value < minY) minY = value;
-        }
-
-    } else {
-
-        // how many points ?
-        last = ergFileQueryAdapter.Duration() / 1000; 
-        values.resize(last);
-        xvalues.resize(last);
-
-        // input array contains the actual W' expenditure
-        // and will also contain non-zero values
-        double W = WPRIME;
-        int lap; // passed by reference
-
-        for (int i=0; i<last; i++) {
-
-            // get watts at point in time
-            int value = ergFileQueryAdapter.wattsAt(i*1000, lap);
-
-            if(value < CP) {
-                W  = W + (CP-value)*(WPRIME-W)/WPRIME;
-            } else {
-                W  = W + (CP-value);
-            }
-
-            if (W > maxY) maxY = W;
-            if (W < minY) minY = W;
-
-            values[i] = W;
-            xvalues[i] = i*1000;
-        }
+    // get watts at each second
+    last = ergFileQueryAdapter.Duration() / 1000;
+    QVector<int> watts(last);
+    EXP = 0;
+    int lap; // passed by reference
+    for (int i=0; i<last; i++) {
+        watts[i] = ergFileQueryAdapter.wattsAt(i*1000, lap);
+        if (watts[i] >= CP) EXP += watts[i]; // total expenditure above CP
     }
 
+    TAU = appsettings->cvalue(input->context->athlete->cyclist, GC_WBALTAU, 300).toInt();
+    workoutSeries(watts, integral, CP, WPRIME, TAU, values, xvalues, minY, maxY);
+
     if (minY < -30000) minY = 0; // the data is definitely out of bounds!
                                  // so lets not exacerbate the problem - truncate
 }
@@ -620,8 +451,8 @@ WPrime::minForCP(int cp)
     // lets run forward from 0s to end of ride
     int min = WPRIME;
     double W = WPRIME;
-    for (int t=0; t<=last; t++) {
-        int smoothedValue = smoothed.valueY(t);
+    for (int t=0; t<=last && t<smoothed.count(); t++) {
+        int smoothedValue = smoothed[t];
         if(smoothedValue < cp) {
             W  = W + (cp-smoothedValue)*(WPRIME-W)/WPRIME;
         } else {
@@ -644,22 +475,48 @@ WPrime::maxMatch()
 }
 
 
-// decay and integrate -- split into threads for best performance
-WPrimeIntegrator::WPrimeIntegrator(QVector<int> &source, int begin, int end, double TAU) :
-    source(source), begin(begin), end(end), TAU(TAU)
+//
+// W'bal one sample at a time
+//
+void
+WPrimeStream::reset(bool integral, double CP, double WPRIME, double TAU)
 {
-    output.resize(source.size());
+    this->integral = integral;
+    this->CP = CP;
+    this->WPRIME = WPRIME;
+    this->TAU = TAU > 0 ? TAU : 300;
+    expended = 0;
+    W = WPRIME;
+    secs = 1;
+    decay = exp(-secs / this->TAU);
 }
 
 void
-WPrimeIntegrator::run()
+WPrimeStream::resume(double wbal)
+{
+    expended = WPRIME - wbal;
+    W = wbal;
+}
+
+double
+WPrimeStream::add(double watts, double secs)
 {
-    // run from start to stop adding decay to end
-    double I = 0.00f;
-    for (int t=0; t<=end; t++) {
+    if (integral) {
+
+        // decay what was expended so far, then add anything above CP
+        if (secs != this->secs) {
+            this->secs = secs;
+            decay = exp(-secs / TAU);
+        }
+        expended = (expended * decay) + (watts > CP ? (watts - CP) * secs : 0);
+        return WPRIME - expended;
+
+    } else {
 
-        I += exp(((double)(t) / TAU)) * source[t];
-        output[t] = exp(-((double)(t) / TAU)) * I;
+        // recover below CP in proportion to what has been used
+        if (watts < CP) W += secs * (CP-watts)*(WPRIME-W)/WPRIME;
+        else W += secs * (CP-watts);
+        return W;
     }
 }
 
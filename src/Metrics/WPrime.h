@@ -25,7 +25,6 @@
 #include "Athlete.h"
 #include "Zones.h"
 #include "RideMetric.h"
-#include "SplineLookup.h"
 #include <QVector>
 #include <QThread>
 #include <cmath>
@@ -95,29 +94,45 @@ class WPrime {
         QVector<double> mxvalues;      // W' time series in 1s intervals
         QVector<double> mxdvalues;      // W' distance
 
-        SplineLookup smoothed;
-        SplineLookup distance;
+        QVector<double> smoothed;   // watts in 1s intervals
+        QVector<double> distance;   // km (or miles) in 1s intervals
         int last;
 
+        // what the W'bal series was computed from, to resume after an edit
+        QVector<int> computed;
+        bool computedIntegral;
+        double computedCP, computedWPRIME, computedTAU;
+
         void check(); // check we don't need to recompute
         bool wasIntegral;
 };
 
-class WPrimeIntegrator : public QThread
+// W'bal one sample at a time, for rides, workouts and live in train view.
+//
+// The integral form (Skiba et al) is the sum of the W' expended above CP
+// decaying exponentially with TAU, kept as a running total that decays
+// each sample, so it doesn't overflow on long rides like exp(t/TAU) did.
+// The differential form (Froncioni / Clarke) is already a recurrence.
+//
+// Either way the W'bal of a sample is all we need to carry on from there,
+// so resume() from any earlier value to recompute only after a change.
+class WPrimeStream
 {
     public:
-        WPrimeIntegrator(QVector<int> &source, int begin, int end, double TAU);
+        WPrimeStream(bool integral=true, double CP=250, double WPRIME=20000, double TAU=300) { reset(integral, CP, WPRIME, TAU); }
 
-        // integrate from start to stop from source into output
-        // basically sums in the exponential decays, but we break it
-        // into threads to parallelise the work
-        void run();
+        void reset(bool integral, double CP, double WPRIME, double TAU);
+        void resume(double wbal);
 
-        QVector<int> &source;
-        int begin, end;
-        double TAU;
+        // power for secs, returns W'bal afterwards
+        double add(double watts, double secs=1.0);
+        double wbal() const { return integral ? WPRIME - expended : W; }
 
-        // resized to match source holds results
-        QVector<double> output;
+    private:
+        bool integral;
+        double CP, WPRIME, TAU;
+        double expended;            // integral, decayed W' expended
+        double W;                   // differential, W'bal
+        double secs, decay;         // exp(-secs/TAU) for the last secs
 };
 #endif
@@ -1626,7 +1626,9 @@ Bindings::postProcess(QString processor, PyObject *activity) const
 
     DataProcessor* dp = DataProcessorFactory::instance().getProcessors().value(processor, nullptr);
     if (!dp) return false;
-    return dp->postProcess(f, nullptr, "PYTHON");
+    bool changed = dp->postProcess(f, nullptr, "PYTHON");
+    f->invalidateColumns();
+    return changed;
 }
 
 bool
@@ -2060,7 +2062,7 @@ Bindings::seasonPmc(bool all, QString metric) const
             }
         }
 
-        // create the data
+        // create the data, our own since we're not on the GUI thread
         PMCData pmcData(context, Specification(), metric);
 
         // how many entries ?
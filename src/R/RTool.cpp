@@ -3360,7 +3360,7 @@ RTool::pmc(SEXP pAll, SEXP pMetric)
             }
         }
 
-        // create the data
+        // create the data, our own since scripts may not be on the GUI thread
         PMCData pmcData(rtool->context, Specification(), metric);
 
         // how many entries ?
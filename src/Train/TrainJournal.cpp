@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "TrainJournal.h"
+
+#include <QTextStream>
+#include <QDebug>
+#include <string.h>
+
+// header is padded to keep the records 8 byte aligned
+struct TrainJournalHeader
+{
+    char magic[4];
+    quint32 version, size, spare;
+};
+
+static const char JOURNAL_MAGIC[4] = { 'G', 'C', 'T', 'J' };
+static const quint32 JOURNAL_VERSION = 1;
+static const int JOURNAL_WAIT = 100; // msecs between writes
+
+TrainJournal::TrainJournal(QObject *parent) : QThread(parent), head(0), tail(0), stopping(0), drops(0)
+{
+}
+
+TrainJournal::~TrainJournal()
+{
+    close();
+}
+
+bool
+TrainJournal::open(QString filename)
+{
+    close();
+
+    file.setFileName(filename);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) return false;
+
+    TrainJournalHeader header;
+    memcpy(header.magic, JOURNAL_MAGIC, 4);
+    header.version = JOURNAL_VERSION;
+    header.size = sizeof(TrainSample);
+    header.spare = 0;
+    file.write((const char *)&header, sizeof(header));
+    file.flush();
+
+    head.storeRelease(0);
+    tail.storeRelease(0);
+    stopping.storeRelease(0);
+    drops = 0;
+
+    start();
+    return true;
+}
+
+void
+TrainJournal::close()
+{
+    if (!file.isOpen()) return;
+
+    // the writer drains the ring before it exits
+    stopping.storeRelease(1);
+    wait();
+    file.close();
+
+    if (drops) qDebug() << "train journal dropped" << drops << "samples";
+}
+
+bool
+TrainJournal::push(const TrainSample &sample)
+{
+    int h = head.loadAcquire();
+    int next = (h + 1) % SLOTS;
+
+    // full, the writer is a long way behind
+    if (next == tail.loadAcquire()) {
+        drops++;
+        return false;
+    }
+
+    ring[h] = sample;
+    head.storeRelease(next);
+    return true;
+}
+
+void
+TrainJournal::drain()
+{
+    int t = tail.loadAcquire();
+    int h = head.loadAcquire();
+    if (t == h) return;
+
+    // at most two runs, up to the end of the ring and from the start
+    if (h < t) {
+        file.write((const char *)(ring + t), (SLOTS - t) * sizeof(TrainSample));
+        t = 0;
+    }
+    file.write((const char *)(ring + t), (h - t) * sizeof(TrainSample));
+    tail.storeRelease(h);
+
+    // hand it to the os, so it survives us crashing
+    file.flush();
+}
+
+void
+TrainJournal::run()
+{
+    while (!stopping.loadAcquire()) {
+        drain();
+        msleep(JOURNAL_WAIT);
+    }
+    drain();
+}
+
+// rates are averaged over the second, everything else is the last value
+static void
+accumulate(TrainSample &sum, const TrainSample &sample)
+{
+    sum.cad += sample.cad;
+    sum.hr += sample.hr;
+    sum.kph += sample.kph;
+    sum.watts += sample.watts;
+    sum.lte += sample.lte;
+    sum.rte += sample.rte;
+    sum.lps += sample.lps;
+    sum.rps += sample.rps;
+    sum.smo2 += sample.smo2;
+    sum.thb += sample.thb;
+    sum.o2hb += sample.o2hb;
+    sum.hhb += sample.hhb;
+    sum.target += sample.target;
+}
+
+static void
+average(TrainSample &row, const TrainSample &sum, int n)
+{
+    row.cad = sum.cad / n;
+    row.hr = sum.hr / n;
+    row.kph = sum.kph / n;
+    row.watts = sum.watts / n;
+    row.lte = sum.lte / n;
+    row.rte = sum.rte / n;
+    row.lps = sum.lps / n;
+    row.rps = sum.rps / n;
+    row.smo2 = sum.smo2 / n;
+    row.thb = sum.thb / n;
+    row.o2hb = sum.o2hb / n;
+    row.hhb = sum.hhb / n;
+    row.target = sum.target / n;
+}
+
+bool
+TrainJournal::convert(QString journal, QString csv)
+{
+    QFile in(journal);
+    if (!in.open(QFile::ReadOnly)) return false;
+    QByteArray data = in.readAll();
+    in.close();
+
+    TrainJournalHeader header;
+    if (data.size() < (int)sizeof(header)) return false;
+    memcpy(&header, data.constData(), sizeof(header));
+    if (memcmp(header.magic, JOURNAL_MAGIC, 4) || header.version != JOURNAL_VERSION || header.size != sizeof(TrainSample))
+        return false;
+
+    QFile out(csv);
+    if (!out.open(QFile::WriteOnly | QFile::Truncate)) return false;
+
+    QTextStream stream(&out);
+    stream << "secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, slope, temp, interval, lrbalance, lte, rte, lps, rps, smo2, thb, o2hb, hhb, target\n";
+
+    const char *records = data.constData() + sizeof(header);
+    int count = (data.size() - sizeof(header)) / sizeof(TrainSample);
+
+    TrainSample row, sample;
+    memset(&row, 0, sizeof(row));
+    bool started = false;
+
+    int i = 0;
+    for (qint64 secs = 1; i < count; secs++) {
+
+        // everything that falls in this second
+        TrainSample sum;
+        memset(&sum, 0, sizeof(sum));
+        int n = 0;
+        while (i < count) {
+            memcpy(&sample, records + i * sizeof(TrainSample), sizeof(TrainSample));
+            if (sample.msecs > secs * 1000) break;
+            accumulate(sum, sample);
+            row = sample;
+            n++;
+            i++;
+        }
+        if (n) average(row, sum, n);
+
+        // seconds we missed repeat the last
+        if (n) started = true;
+        if (!started) continue;
+
+        stream << secs
+               << "," << row.cad
+               << "," << row.hr
+               << "," << row.km
+               << "," << row.kph
+               << "," << 0 // torque
+               << "," << row.watts;
+
+        // location data needs much more than the default precision of 6
+        stream.setRealNumberPrecision(20);
+        stream << "," << row.alt
+               << "," << row.lon
+               << "," << row.lat;
+        stream.setRealNumberPrecision(6);
+
+        stream << "," // headwind
+               << "," // slope
+               << "," // temp
+               << "," << row.interval
+               << "," << row.lrbalance
+               << "," << row.lte
+               << "," << row.rte
+               << "," << row.lps
+               << "," << row.rps
+               << "," << row.smo2
+               << "," << row.thb
+               << "," << row.o2hb
+               << "," << row.hhb
+               << "," << row.target
+               << "," << "\n";
+    }
+    stream.flush();
+    out.close();
+    return true;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_TrainJournal_h
+#define _GC_TrainJournal_h 1
+#include "GoldenCheetah.h"
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QFile>
+#include <QString>
+
+// one sample of telemetry as recorded, fixed size so a journal
+// cut short by a crash loses at most the record being written
+struct TrainSample
+{
+    qint64 msecs;                               // session time
+    qint32 interval, spare;
+    double cad, hr, km, kph, watts, alt, lon, lat;
+    double lrbalance, lte, rte, lps, rps;
+    double smo2, thb, o2hb, hhb, target;
+};
+
+// Records a train session to disk off the GUI thread. Samples are
+// pushed onto a single producer single consumer ring without locks
+// and a writer thread appends them to the journal as they arrive.
+// When the session ends the journal is converted into the usual
+// 1s csv for import; samples are averaged into the second they fall
+// in. The samples come from the telemetry refresh on the GUI thread,
+// so a second the GUI stalled through has none and repeats the one
+// before, as the old disk timer did.
+class TrainJournal : public QThread
+{
+    public:
+        TrainJournal(QObject *parent = 0);
+        ~TrainJournal();
+
+        bool open(QString filename);
+        void close(); // drains what is left and stops the writer
+        QString fileName() const { return file.fileName(); }
+
+        // from the GUI thread, false if the writer fell behind
+        bool push(const TrainSample &sample);
+        int dropped() const { return drops; }
+
+        // journal to csv, truncated journals convert up to the last whole record
+        static bool convert(QString journal, QString csv);
+
+    protected:
+        void run();
+
+    private:
+        void drain();
+
+        static const int SLOTS = 1024;
+        TrainSample ring[SLOTS];
+        QAtomicInt head, tail;      // head is written by push, tail by the writer
+        QAtomicInt stopping;
+        int drops;
+
+        QFile file;
+};
+#endif
@@ -337,7 +337,6 @@ TrainSidebar::TrainSidebar(Context *context) : GcWindow(context), context(contex
 
     // now the GUI is setup lets sort our control variables
     gui_timer = new QTimer(this);
-    disk_timer = new QTimer(this);
     load_timer = new QTimer(this);
     start_timer = new QTimer(this);
     start_timer->setSingleShot(true);
@@ -349,7 +348,7 @@ TrainSidebar::TrainSidebar(Context *context) : GcWindow(context), context(contex
     secs_to_start = 0;
 
     rrFile = recordFile = vo2File = NULL;
-    lastRecordSecs = 0;
+    journal = new TrainJournal(this);
     status = 0;
     setStatusFlags(RT_MODE_ERGO);         // ergo mode by default
     mode = ERG;
@@ -361,7 +360,8 @@ TrainSidebar::TrainSidebar(Context *context) : GcWindow(context), context(contex
     hrcount = 0;
     spdcount = 0;
     lodcount = 0;
-    wbalr = wbal = 0;
+    wbal = 0;
+    wbalMsecs = 0;
     load_msecs = total_msecs = lap_msecs = 0;
     displayWorkoutDistance = displayDistance = displayPower = displayHeartRate =
     displaySpeed = displayCadence = slope = load = 0;
@@ -371,7 +371,6 @@ TrainSidebar::TrainSidebar(Context *context) : GcWindow(context), context(contex
     displayLatitude = displayLongitude = displayAltitude = 0.0;
 
     connect(gui_timer, SIGNAL(timeout()), this, SLOT(guiUpdate()));
-    connect(disk_timer, SIGNAL(timeout()), this, SLOT(diskUpdate()));
     connect(load_timer, SIGNAL(timeout()), this, SLOT(loadUpdate()));
     connect(start_timer, SIGNAL(timeout()), this, SLOT(Start()));
 
@@ -1185,7 +1184,6 @@ void TrainSidebar::Start()       // when start button is pressed
 
         //foreach(int dev, activeDevices) Devices[dev].controller->restart();
         //gui_timer->start(REFRESHRATE);
-        if (status & RT_RECORDING) disk_timer->start(SAMPLERATE);
         load_period.restart();
         load_timer->start(LOADRATE);
 
@@ -1211,7 +1209,6 @@ void TrainSidebar::Start()       // when start button is pressed
         setStatusFlags(RT_PAUSED);
         //foreach(int dev, activeDevices) Devices[dev].controller->pause();
         //gui_timer->stop();
-        if (status & RT_RECORDING) disk_timer->stop();
         load_timer->stop();
         load_msecs += load_period.restart();
 
@@ -1296,7 +1293,8 @@ void TrainSidebar::Start()       // when start button is pressed
         session_elapsed_msec = 0;
         lap_time.start();
         lap_elapsed_msec = 0;
-        wbalr = 0;
+        wbalStream.reset(true, FTP, WPRIME, appsettings->cvalue(context->athlete->cyclist, GC_WBALTAU, 300).toInt());
+        wbalMsecs = 0;
         wbal = WPRIME;
         
         resetTextAudioEmitTracking();
@@ -1336,19 +1334,24 @@ void TrainSidebar::Start()       // when start button is pressed
 
             QString fulltarget = context->athlete->home->records().canonicalPath() + "/" + filename;
 
+            // journals left behind by a crash become csv files so the sessions aren't
+            // lost, they are imported along with this one when we stop
+            QDir records = context->athlete->home->records();
+            foreach(QString name, records.entryList(QStringList() << "*.journal", QDir::Files)) {
+                QString left = records.canonicalPath() + "/" + name;
+                QString csv = left.left(left.length() - QString(".journal").length()) + ".csv";
+                if (TrainJournal::convert(left, csv)) {
+                    QFile::remove(left);
+                    if (!recovered.contains(csv)) recovered << csv;
+                }
+            }
+
+            // the csv is written from the journal when we stop
             if (recordFile) delete recordFile;
             recordFile = new QFile(fulltarget);
-            lastRecordSecs = 0;
-            if (!recordFile->open(QFile::WriteOnly | QFile::Truncate)) {
+            QString journalname = fulltarget.left(fulltarget.length() - QString(".csv").length()) + ".journal";
+            if (!journal->open(journalname)) {
                 clearStatusFlags(RT_RECORDING);
-            } else {
-
-                // CSV File header
-
-                QTextStream recordFileStream(recordFile);
-                recordFileStream << "secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, slope, temp, interval, lrbalance, lte, rte, lps, rps, smo2, thb, o2hb, hhb, target\n";
-
-                disk_timer->start(SAMPLERATE);  // start screen
             }
         }
         gui_timer->start(REFRESHRATE);      // start recording
@@ -1371,7 +1374,6 @@ void TrainSidebar::Pause()        // pause capture to recalibrate
         clearStatusFlags(RT_PAUSED);
         foreach(int dev, activeDevices) Devices[dev].controller->restart();
         gui_timer->start(REFRESHRATE);
-        if (status & RT_RECORDING) disk_timer->start(SAMPLERATE);
         load_period.restart();
         load_timer->start(LOADRATE);
 
@@ -1391,7 +1393,6 @@ void TrainSidebar::Pause()        // pause capture to recalibrate
         foreach(int dev, activeDevices) Devices[dev].controller->pause();
         setStatusFlags(RT_PAUSED);
         gui_timer->stop();
-        if (status & RT_RECORDING) disk_timer->stop();
         load_timer->stop();
         load_msecs += load_period.restart();
 
@@ -1451,10 +1452,11 @@ void TrainSidebar::Stop(int deviceStatus)        // when stop button is pressed
     QDateTime now = QDateTime::currentDateTime();
 
     if (status & RT_RECORDING) {
-        disk_timer->stop();
 
-        // close and reset File
-        recordFile->close();
+        // finish the journal and turn it into the csv we import
+        journal->close();
+        bool converted = TrainJournal::convert(journal->fileName(), recordFile->fileName());
+        if (converted) QFile::remove(journal->fileName());
 
         // Request mutual exclusion with ANT+/BTLE threads to change status and close rr/vo2 files
         rrMutex.lock();
@@ -1483,18 +1485,27 @@ void TrainSidebar::Stop(int deviceStatus)        // when stop button is pressed
         rrMutex.unlock();
         vo2Mutex.unlock();
 
+        // any sessions recovered at start are imported too
+        QList<QString> list = recovered;
+        recovered.clear();
+
         if(deviceStatus == DEVICE_ERROR)
         {
             recordFile->remove();
+            QFile::remove(journal->fileName());
+        }
+        else if (!converted) {
+            qDebug() << "Unable to convert train journal" << journal->fileName();
         }
         else {
             // add to the view - using basename ONLY
             QString name;
             name = recordFile->fileName();
 
-            QList<QString> list;
             list.append(name);
+        }
 
+        if (!list.isEmpty()) {
             RideImportWizard *dialog = new RideImportWizard (list, context);
             dialog->process(); // do it!
         }
@@ -1527,7 +1538,8 @@ void TrainSidebar::Stop(int deviceStatus)        // when stop button is pressed
     spdcount = 0;
     lodcount = 0;
     displayWorkoutLap = 0;
-    wbalr = 0;
+    wbalStream.reset(true, FTP, WPRIME, appsettings->cvalue(context->athlete->cyclist, GC_WBALTAU, 300).toInt());
+    wbalMsecs = 0;
     wbal = WPRIME;
     session_elapsed_msec = 0;
     session_time.restart();
@@ -1995,20 +2007,40 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
 
             rtData.setVirtualSpeed(vs);
 
-            // W'bal on the fly
-            // using Dave Waterworth's reformulation
-            double TAU = appsettings->cvalue(context->athlete->cyclist, GC_WBALTAU, 300).toInt();
-
-            // any watts expended in last 200msec?
-            double JOULES = double(rtData.getWatts() - FTP) / 5.00f;
-            if (JOULES < 0) JOULES = 0;
-
-            // running total of replenishment
-            wbalr += JOULES * exp((total_msecs/1000.00f) / TAU);
-            wbal = WPRIME - (wbalr * exp((-total_msecs/1000.00f) / TAU));
+            // W'bal on the fly, the integral form as a
+            // recurrence over the time since the last update
+            wbal = wbalStream.add(rtData.getWatts(), (total_msecs - wbalMsecs) / 1000.00f);
+            wbalMsecs = total_msecs;
 
             rtData.setWbal(wbal);
 
+            // record it at the refresh rate, the journal writes it out on its own thread
+            if ((status&RT_RECORDING) && (status&RT_RUNNING) && ((status&RT_PAUSED) == 0)) {
+                TrainSample sample;
+                sample.msecs = total_msecs;
+                sample.interval = displayWorkoutLap;
+                sample.spare = 0;
+                sample.cad = displayCadence;
+                sample.hr = displayHeartRate;
+                sample.km = displayDistance;
+                sample.kph = displaySpeed;
+                sample.watts = displayPower;
+                sample.alt = displayAltitude;
+                sample.lon = displayLongitude;
+                sample.lat = displayLatitude;
+                sample.lrbalance = displayLRBalance;
+                sample.lte = displayLTE;
+                sample.rte = displayRTE;
+                sample.lps = displayLPS;
+                sample.rps = displayRPS;
+                sample.smo2 = displaySMO2;
+                sample.thb = displayTHB;
+                sample.o2hb = displayO2HB;
+                sample.hhb = displayHHB;
+                sample.target = load;
+                journal->push(sample);
+            }
+
             // go update the displays...
             context->notifyTelemetryUpdate(rtData); // signal everyone to update telemetry
         }
@@ -2071,82 +2103,6 @@ void TrainSidebar::warnnoConfig()
     QMessageBox::warning(this, tr("No Devices Configured"), tr("Please configure a device in Preferences."));
 }
 
-template<class T, typename T_GetMethod, typename T_SetMethod, typename T_arg>
-struct ScopedOp
-{
-    T* m_pt;
-    T_SetMethod m_setMethod;
-    T_arg m_argSave;
-
-    ScopedOp(T* pt, T_GetMethod getMethod, T_SetMethod setMethod, T_arg argNew) : m_pt(pt), m_setMethod(setMethod) {
-        m_argSave = (m_pt->*getMethod)();
-        (m_pt->*m_setMethod)(argNew);
-    }
-
-    virtual ~ScopedOp() { (m_pt->*m_setMethod)(m_argSave); }
-};
-
-struct ScopedPrecision : ScopedOp<QTextStream, int (QTextStream::*)() const, void (QTextStream::*)(int), int> {
-    ScopedPrecision(QTextStream* pc, int tempPrecision) : ScopedOp::ScopedOp(pc, &QTextStream::realNumberPrecision, &QTextStream::setRealNumberPrecision, tempPrecision) {}
-};
-
-//----------------------------------------------------------------------
-// DISK UPDATE FUNCTIONS
-//----------------------------------------------------------------------
-void TrainSidebar::diskUpdate()
-{
-    int  secs;
-
-    long torq = 0;
-    QTextStream recordFileStream(recordFile);
-
-    if (calibrating) return;
-
-    // convert from milliseconds to secondes
-    total_msecs = session_elapsed_msec + session_time.elapsed();
-    secs = round(total_msecs / 1000.0);
-
-    if (secs <= lastRecordSecs) return; // Avoid duplicates
-    lastRecordSecs = secs;
-
-    // GoldenCheetah CVS Format "secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, slope, temp, interval, lrbalance, lte, rte, lps, rps, smo2, thb, o2hb, hhb\n";
-
-    recordFileStream    << secs
-                        << "," << displayCadence
-                        << "," << displayHeartRate
-                        << "," << displayDistance
-                        << "," << displaySpeed
-                        << "," << torq
-                        << "," << displayPower;
-
-    // QTextStream default precision is 6, location data needs much more than that.
-    // Avoid extra precision for other fields since it isn't needed and would grow
-    // the intermediate file for no reason.
-    {
-        ScopedPrecision tempPrecision(&recordFileStream, 20);
-
-        recordFileStream << "," << displayAltitude
-                         << "," << displayLongitude
-                         << "," << displayLatitude;
-    }
-
-    recordFileStream    << "," // headwind
-                        << "," // slope
-                        << "," // temp
-                        << "," << displayWorkoutLap
-                        << "," << displayLRBalance
-                        << "," << displayLTE
-                        << "," << displayRTE
-                        << "," << displayLPS
-                        << "," << displayRPS
-                        << "," << displaySMO2
-                        << "," << displayTHB
-                        << "," << displayO2HB
-                        << "," << displayHHB
-                        << "," << load
-                        << "," << "\n";
-}
-
 //----------------------------------------------------------------------
 // WORKOUT MODE
 //----------------------------------------------------------------------
@@ -2229,7 +2185,6 @@ void TrainSidebar::toggleCalibration()
 
         clearStatusFlags(RT_CALIBRATING);
         load_timer->start(LOADRATE);
-        if (status & RT_RECORDING) disk_timer->start(SAMPLERATE);
         context->notifyUnPause(); // get video started again, amongst other things
 
         // back to ergo/slope mode and restore load/gradient
@@ -2261,7 +2216,6 @@ void TrainSidebar::toggleCalibration()
         lap_elapsed_msec += lap_time.elapsed();
 
         setStatusFlags(RT_CALIBRATING);
-        if (status & RT_RECORDING) disk_timer->stop();
         load_timer->stop();
         load_msecs += load_period.restart();
 
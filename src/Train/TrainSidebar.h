@@ -51,6 +51,8 @@
 
 #include "PhysicsUtility.h"
 #include "BicycleSim.h"
+#include "WPrime.h"
+#include "TrainJournal.h"
 
 
 // Status settings
@@ -70,7 +72,6 @@
 // msecs constants for timers
 #define REFRESHRATE    200 // screen refresh in milliseconds
 #define STREAMRATE     200 // rate at which we stream updates to remote peer
-#define SAMPLERATE     1000 // disk update in milliseconds
 #define LOADRATE       1000 // rate at which load is adjusted
 
 // device treeview node types
@@ -196,7 +197,6 @@ class TrainSidebar : public GcWindow
 
         // Timed actions
         void guiUpdate();           // refreshes the telemetry
-        void diskUpdate();          // writes to CSV file
         void loadUpdate();          // sets Load on CT like devices
 
         // When no config has been setup
@@ -272,7 +272,8 @@ class TrainSidebar : public GcWindow
         int displaymode;
 
         QFile *recordFile;      // where we record!
-        int lastRecordSecs;     // to avoid duplicates
+        TrainJournal *journal;  // samples as they arrive, converted to recordFile at the end
+        QStringList recovered;  // csv from journals left by a crash, imported at the end
         QMutex rrMutex;         // to coordinate async recording from ANT+ thread
         QFile *rrFile;          // r-r records, if any received.
         QMutex vo2Mutex;         // to coordinate async recording from ANT+ thread
@@ -300,8 +301,7 @@ class TrainSidebar : public GcWindow
 
         QTimer      *gui_timer,     // refresh the gui
                     *load_timer,    // change the load on the device
-                    *start_timer,   // delayed start
-                    *disk_timer;    // write to .CSV file
+                    *start_timer;   // delayed start
 
         bool autoConnect;
         bool pendingConfigChange;
@@ -316,7 +316,9 @@ class TrainSidebar : public GcWindow
         QCheckBox   *recordSelector;
         QSharedPointer<QFileSystemWatcher> watcher;
         bool calibrating;
-        double wbalr, wbal;
+        WPrimeStream wbalStream; // W'bal on the fly
+        long wbalMsecs;
+        double wbal;
 };
 
 class MultiDeviceDialog : public QDialog
@@ -0,0 +1,37 @@
+#
+# Standalone test for ANT capture replay, plays back the synthetic
+# antlog.raw in this directory through the ANT class and checks the
+# heart rate and power decoded from it and the telemetry that results,
+# the playback speed and reports throughput
+#
+#   qmake && make && ./antreplay antlog.raw
+#
+# settings.cpp stands in for the app settings and device configuration
+# so the ANT sources link without the rest of GoldenCheetah
+#
+TEMPLATE = app
+TARGET = antreplay
+CONFIG += console c++17
+CONFIG -= app_bundle
+QT += xml sql network svg widgets concurrent serialport multimedia multimediawidgets
+
+INCLUDEPATH += ../../src/ANT ../../src/Train ../../src/FileIO ../../src/Cloud ../../src/Charts \
+               ../../src/Metrics ../../src/Gui ../../src/Core ../../src/Planning
+INCLUDEPATH += ../../qwt/src ../../contrib/qxt/src ../../contrib/qtsolutions/json \
+               ../../contrib/qtsolutions/qwtcurve ../../contrib/lmfit ../../contrib/boost
+DEFINES += QXT_STATIC
+
+HEADERS += ../../src/ANT/ANT.h \
+           ../../src/ANT/ANTChannel.h \
+           ../../src/ANT/ANTMessage.h \
+           ../../src/ANT/ANTReplay.h \
+           ../../src/Train/RealtimeData.h \
+           ../../src/Train/CalibrationData.h
+
+SOURCES += ../../src/ANT/ANT.cpp \
+           ../../src/ANT/ANTChannel.cpp \
+           ../../src/ANT/ANTMessage.cpp \
+           ../../src/ANT/ANTReplay.cpp \
+           ../../src/Train/RealtimeData.cpp \
+           ../../src/Train/CalibrationData.cpp \
+           settings.cpp main.cpp
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+//
+// ANT replay test
+//
+// Plays back antlog.raw through the ANT class, as when the device is a
+// capture file, so the wire bytes ANTReplay returns go through
+// ANT::receiveByte and ANT::processMessage into the channels and on to
+// the telemetry the train view reads.
+//
+// The capture is synthetic, two minutes of a heart rate strap on channel 0
+// and a power meter on channel 1, each sending at 4Hz, so every value is
+// known (see expected() below). It starts with the stick's reset, which is
+// when the channels are opened as ANT::setup does, and also has messages
+// we sent, which must be skipped, channel responses and a damaged record.
+// Regenerate it with
+//
+//   antreplay --write antlog.raw
+//
+// Then checks
+//   - every message is processed once, in order, the damaged one dropped
+//   - heart rate, power and cadence decode to the values that were written
+//   - the telemetry at the end is the last values that were written
+//   - @40 plays back at 40 times real time
+//   - throughput at @0, messages/s and MB/s of capture
+//
+// usage: antreplay [antlog.raw] [repeats]
+//
+// exits non-zero if any check fails
+//
+
+#include "ANT.h"
+#include "ANTChannel.h"
+#include "ANTMessage.h"
+#include "DeviceConfiguration.h"
+#include "RealtimeData.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSemaphore>
+#include <QString>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// what is in the capture
+static const qint64 START = 1700000000000LL;    // msecs since epoch
+static const int SAMPLES = 480;                 // each channel, 4Hz for 2 minutes
+static const int PERIOD = 250;                  // msecs between broadcasts
+static const int TORQUE = 4;                    // torque effectiveness every 4th power broadcast
+static const int BROADCASTS = SAMPLES * 2 + SAMPLES / TORQUE;
+static const int SETUP = 3;                     // startup and channel responses
+static const int MESSAGES = BROADCASTS + SETUP;
+static const qint64 SPAN = 20 + (SAMPLES-1) * PERIOD + PERIOD/2; // first to last received
+
+struct Sample {
+    int hr, watts, cadence;
+};
+
+// values for the k'th broadcast on each channel
+static Sample expected(int k)
+{
+    Sample s;
+    s.hr = 100 + (k % 60);
+    s.watts = 150 + 2 * (k % 100);
+    s.cadence = 80 + (k % 20);
+    return s;
+}
+
+//
+// write the capture, as ANTLogger::logRawAntMessage
+//
+static void record(std::ofstream &out, char rs, qint64 millis, const std::vector<uint8_t> &message)
+{
+    out.put(rs);
+    for (int i=0; i<8; i++) out.put(char((millis >> (8*i)) & 0xff));
+    for (int i=0; i<12; i++) out.put(char(i < int(message.size()) ? message[i] : 0));
+}
+
+static std::vector<uint8_t> broadcast(int channel, const uint8_t payload[8])
+{
+    std::vector<uint8_t> m = { 0xA4, 9, 0x4E, uint8_t(channel) };
+    for (int i=0; i<8; i++) m.push_back(payload[i]);
+    return m;
+}
+
+static bool write(const char *name)
+{
+    std::ofstream out(name, std::ios::binary);
+    if (!out) return false;
+
+    // the stick resetting, then setting up the channels, what we sent
+    // and what the stick said
+    record(out, 'S', START - 30, { 0xA4, 1, 0x4A, 0 });
+    record(out, 'R', START - 20, { 0xA4, 1, 0x6F, 0x20 });
+    record(out, 'S', START - 15, { 0xA4, 3, 0x42, 0, 0, 0 });
+    record(out, 'R', START - 10, { 0xA4, 3, 0x40, 0, 0x42, 0 });
+    record(out, 'S', START - 5, { 0xA4, 3, 0x42, 1, 0, 0 });
+    record(out, 'R', START - 5, { 0x00, 3, 0x40, 1, 0x42, 0 }); // damaged, no sync
+    record(out, 'R', START, { 0xA4, 3, 0x40, 1, 0x42, 0 });
+
+    int accumulated = 0;
+    for (int k=0; k<SAMPLES; k++) {
+        Sample s = expected(k);
+        qint64 t = START + k * PERIOD;
+
+        // heart rate, page 4, computed heart rate is the last byte
+        int beattime = (k * 1024 * 60 / s.hr) & 0xffff;
+        uint8_t hr[8] = { uint8_t(0x04 | ((k/4)%2 ? 0x80 : 0)), 0xff, 0, 0,
+                          uint8_t(beattime & 0xff), uint8_t(beattime >> 8), uint8_t(k), uint8_t(s.hr) };
+        record(out, 'R', t, broadcast(0, hr));
+
+        // standard power, page 0x10
+        accumulated = (accumulated + s.watts) & 0xffff;
+        uint8_t pw[8] = { 0x10, uint8_t(k), 0xff, uint8_t(s.cadence),
+                          uint8_t(accumulated & 0xff), uint8_t(accumulated >> 8),
+                          uint8_t(s.watts & 0xff), uint8_t(s.watts >> 8) };
+        record(out, 'R', t + PERIOD/2, broadcast(1, pw));
+
+        // torque effectiveness and pedal smoothness, page 0x13, with the
+        // same event count, a power meter interleaves it with page 0x10
+        if (k % TORQUE == 0) {
+            uint8_t te[8] = { 0x13, uint8_t(k), 140, 150, 40, 0xfe, 0xff, 0xff };
+            record(out, 'R', t + PERIOD/2, broadcast(1, te));
+        }
+
+        // and we keep asking for the power meter's battery
+        if (k % 120 == 0) record(out, 'S', t + PERIOD/2, { 0xA4, 9, 0x4F, 1, 0x46, 0xff, 0xff, 0xff, 0xff, 0x01, 0x52, 0x01 });
+    }
+    return bool(out);
+}
+
+//
+// play it back through the ANT class
+//
+struct Result {
+    int messages, setup, hr, power, torque;
+    int errors;
+    RealtimeData telemetry;
+    Result() : messages(0), setup(0), hr(0), power(0), torque(0), errors(0) {}
+};
+
+static void fail(Result &result, const std::string &what)
+{
+    if (result.errors++ < 10) fprintf(stderr, "FAIL: %s\n", what.c_str());
+}
+
+// a message as decoded by ANT::processMessage
+static void decode(const ANTMessage &message, Result &result)
+{
+    result.messages++;
+
+    if (message.type == ANT_NOTIF_STARTUP || message.type == ANT_CHANNEL_EVENT) {
+        result.setup++;
+        return;
+    }
+    if (message.type != ANT_BROADCAST_DATA) {
+        fail(result, "unexpected message id " + std::to_string(message.type));
+        return;
+    }
+
+    switch (message.data[3]) {
+    case 0:
+        {
+            Sample s = expected(result.hr++);
+            if (message.instantHeartrate != s.hr) fail(result, "heart rate " + std::to_string(message.instantHeartrate) + " expected " + std::to_string(s.hr));
+        }
+        break;
+    case 1:
+        if (message.data_page == ANT_TE_AND_PS_POWER) {
+            result.torque++;
+        } else if (message.data_page == ANT_STANDARD_POWER) {
+            Sample s = expected(result.power++);
+            if (message.instantPower != s.watts) fail(result, "power " + std::to_string(message.instantPower) + " expected " + std::to_string(s.watts));
+            if (message.instantCadence != s.cadence) fail(result, "cadence " + std::to_string(message.instantCadence) + " expected " + std::to_string(s.cadence));
+        } else {
+            fail(result, "power page " + std::to_string(message.data_page));
+        }
+        break;
+    default:
+        fail(result, "unexpected channel " + std::to_string(message.data[3]));
+        break;
+    }
+}
+
+// msecs is from starting to the last message being processed
+static Result replay(const QString &spec, qint64 &msecs)
+{
+    Result result;
+    QSemaphore done;
+
+    DeviceConfiguration config;
+    config.portSpec = spec;
+    ANT ant(NULL, &config);
+
+    // runs on the ANT thread as each message is processed, the channels
+    // are opened when the stick has reset, as ANT::setup does
+    QObject::connect(&ant, &ANT::receivedAntMessage, [&](const unsigned char, const ANTMessage message, const struct timeval) {
+        if (message.type == ANT_NOTIF_STARTUP) {
+            ant.addDevice(0, ANTChannel::CHANNEL_TYPE_HR, 0);
+            ant.addDevice(0, ANTChannel::CHANNEL_TYPE_POWER, 1);
+        }
+        decode(message, result);
+        if (result.messages == MESSAGES) done.release();
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    ant.start();
+    if (ant.channelCount() == 0) {
+        ant.wait();
+        fail(result, "can't open " + spec.toStdString());
+        return result;
+    }
+
+    if (!done.tryAcquire(1, int(2 * SPAN))) fail(result, "timed out");
+    msecs = timer.elapsed();
+    ant.getRealtimeData(result.telemetry);
+
+    ant.stop();
+    ant.wait();
+    return result;
+}
+
+static bool check(const char *what, const Result &result)
+{
+    Sample last = expected(SAMPLES-1);
+    int hr = result.telemetry.getHr();
+    int watts = result.telemetry.getWatts();
+    int cadence = result.telemetry.getCadence();
+
+    bool ok = result.errors == 0 && result.messages == MESSAGES && result.setup == SETUP
+              && result.hr == SAMPLES && result.power == SAMPLES && result.torque == SAMPLES / TORQUE
+              && hr == last.hr && watts == last.watts && cadence == last.cadence;
+
+    printf("%-10s %5d messages %3d setup %4d hr %4d power %3d torque %d errors, telemetry %d bpm %d watts %d rpm: %s\n", what,
+           result.messages, result.setup, result.hr, result.power, result.torque, result.errors, hr, watts, cadence, ok ? "OK" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && std::string(argv[1]) == "--write") {
+        if (!write(argv[2])) {
+            fprintf(stderr, "can't write %s\n", argv[2]);
+            return 1;
+        }
+        return 0;
+    }
+
+    QCoreApplication app(argc, argv);
+
+    QString capture = argc > 1 ? argv[1] : "antlog.raw";
+    int repeats = argc > 2 ? atoi(argv[2]) : 100;
+    if (repeats < 1) repeats = 1;
+    bool ok = true;
+
+    // as fast as it decodes, the values
+    qint64 msecs = 0;
+    ok &= check("@0", replay(capture + "@0", msecs));
+
+    // at 40 times real time it should take span/40, allow some slack
+    // for starting the thread and the 50ms wait on each read
+    Result paced = replay(capture + "@40", msecs);
+    ok &= check("@40", paced);
+    qint64 want = SPAN / 40;
+    bool ontime = msecs >= want && msecs <= want + 250;
+    printf("@40 took %lld ms, expected %lld ms: %s\n", (long long)msecs, (long long)want, ontime ? "OK" : "FAIL");
+    ok &= ontime;
+
+    // throughput
+    qint64 total = 0;
+    for (int i=0; i<repeats; i++) {
+        ok &= replay(capture + "@0", msecs).errors == 0;
+        total += msecs;
+    }
+    double secs = total > 0 ? total / 1000.0 : 0.001;
+    double megabytes = std::ifstream(capture.toStdString(), std::ios::binary | std::ios::ate).tellg() / (1024.0 * 1024.0);
+    printf("throughput %d replays in %.3f s, %.0f messages/s, %.1f MB/s\n",
+           repeats, secs, (double(MESSAGES) * repeats) / secs, (megabytes * repeats) / secs);
+
+    return ok ? 0 : 1;
+}
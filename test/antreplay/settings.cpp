@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+//
+// What the ANT sources need from the rest of GoldenCheetah, so the test
+// links ANT.cpp, ANTChannel.cpp and ANTMessage.cpp as they are without
+// Settings.cpp and DeviceConfiguration.cpp and everything they pull in.
+//
+// Settings always give the default, nothing is saved.
+//
+
+#include "Settings.h"
+#include "DeviceConfiguration.h"
+
+int OperatingSystem = LINUX;
+
+GSettings::GSettings(QString, QSettings::Format) : newFormat(false), systemsettings(NULL), oldsystemsettings(NULL), global(NULL) {}
+GSettings::~GSettings() {}
+
+QVariant
+GSettings::value(const QObject *, const QString, const QVariant def)
+{
+    return def;
+}
+
+void
+GSettings::setValue(QString, QVariant)
+{
+}
+
+QVariant
+GSettings::cvalue(QString, QString, QVariant def)
+{
+    return def;
+}
+
+GSettings *appsettings = new GSettings("", QSettings::IniFormat);
+
+DeviceConfiguration::DeviceConfiguration()
+{
+    type=0;
+    wheelSize=2100;
+    postProcess=0;
+    stridelength=80;
+    controller = NULL;
+    virtualPowerDefinitionString = "";
+}
@@ -0,0 +1,15 @@
+#
+# Standalone benchmark for the FIT decoder, decodes the .fit files in
+# test/rides from memory and reports MB/s and records/s
+#
+#   qmake && make && ./fit ../../rides
+#
+TEMPLATE = app
+TARGET = fit
+CONFIG += console c++17
+CONFIG -= app_bundle
+QT = core
+
+INCLUDEPATH += ../../../src/FileIO
+HEADERS += ../../../src/FileIO/FitDecoder.h
+SOURCES += ../../../src/FileIO/FitDecoder.cpp main.cpp
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+//
+// FIT decoder benchmark
+//
+// Reads every .fit file in the rides directory into memory and then
+// decodes all the definition and data messages in them with FitDecoder,
+// as FitFileParser does when importing, reporting MB/s and records/s
+// (record messages are the samples) for each file and overall.
+//
+// usage: fit [rides directory] [repeats]
+//
+// exits non-zero if a file can't be decoded
+//
+
+#include "FitDecoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+struct Counts {
+    long definitions, messages, records;
+    Counts() : definitions(0), messages(0), records(0) {}
+};
+
+// the same walk as FitFileParser::run(), including chained files
+static bool decode(const std::vector<uchar> &bytes, Counts &counts, std::string &error)
+{
+    FitDecoder in;
+    in.setData(bytes.data(), bytes.size());
+
+    FitMessage local[16];
+    bool defined[16] = { false };
+    std::vector<FitValue> values;
+    QStringList errors;
+
+    try {
+        do {
+            int data_size = 0;
+            if (!in.header(data_size, errors)) {
+                if (counts.messages) break; // trailing bytes after a file
+                error = errors.isEmpty() ? "bad header" : errors.last().toStdString();
+                return false;
+            }
+
+            qint64 end = in.position() + data_size;
+            while (in.position() < end) {
+                int header_byte = in.uint8();
+                if (!(header_byte & 0x80) && (header_byte & 0x40)) {
+                    in.definition(header_byte, local[header_byte & 0xf]);
+                    defined[header_byte & 0xf] = true;
+                    counts.definitions++;
+                } else {
+                    int num = (header_byte & 0x80) ? (header_byte >> 5) & 0x3 : header_byte & 0xf;
+                    if (!defined[num]) {
+                        error = "data message without a definition";
+                        return false;
+                    }
+                    values.clear();
+                    in.values(local[num], values);
+                    counts.messages++;
+                    if (local[num].global_msg_num == 20) counts.records++;
+                }
+            }
+            in.uint16(false); // crc
+
+        } while (in.has(12));
+
+    } catch (FitDecoder::TruncatedRead &) {
+        error = "truncated";
+        return false;
+    }
+    return true;
+}
+
+static double now()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv)
+{
+    std::string dir = argc > 1 ? argv[1] : "../../rides";
+    int repeats = argc > 2 ? atoi(argv[2]) : 20;
+    if (repeats < 1) repeats = 1;
+
+    std::vector<std::filesystem::path> paths;
+    for (auto &entry : std::filesystem::directory_iterator(dir)) {
+        std::string ext = entry.path().extension().string();
+        for (auto &c : ext) c = tolower(c);
+        if (ext == ".fit") paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    printf("%d fit files from %s, best of %d\n", int(paths.size()), dir.c_str(), repeats);
+    if (paths.empty()) return 1;
+
+    printf("%-36s %10s %8s %8s %10s %10s %12s\n", "file", "bytes", "messages", "records", "ms", "MB/s", "records/s");
+
+    int failed = 0;
+    double bytes = 0, took = 0;
+    long records = 0;
+    for (const auto &path : paths) {
+
+        std::ifstream file(path, std::ios::binary);
+        std::vector<uchar> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        // best time, so we measure the decoder and not the scheduler
+        Counts counts;
+        std::string error;
+        double best = 0;
+        bool ok = true;
+        for (int r=0; r<repeats && ok; r++) {
+            Counts run;
+            double start = now();
+            ok = decode(contents, run, error);
+            double ms = now() - start;
+            if (r == 0 || ms < best) best = ms;
+            counts = run;
+        }
+
+        std::string name = path.filename().string();
+        if (!ok) {
+            printf("%-36s FAIL %s\n", name.c_str(), error.c_str());
+            failed++;
+            continue;
+        }
+
+        double secs = best > 0 ? best / 1000.0 : 1e-9;
+        printf("%-36s %10d %8ld %8ld %10.3f %10.1f %12.0f\n", name.c_str(), int(contents.size()),
+               counts.messages, counts.records, best, contents.size() / secs / 1e6, counts.records / secs);
+
+        bytes += contents.size();
+        records += counts.records;
+        took += best;
+    }
+
+    double secs = took > 0 ? took / 1000.0 : 1e-9;
+    printf("%-36s %10.0f %8s %8ld %10.3f %10.1f %12.0f\n", "total", bytes, "", records, took, bytes / secs / 1e6, records / secs);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+//
+// Mean max kernel benchmark
+//
+// Reads every numeric column from the csv files and every sample
+// key from the json files in the rides directory, then for each
+// instruction set available:
+//
+//  - checks MeanMaxKernel::search() gives exactly the same bests and
+//    offsets as the reference divided_max_mean, duration by duration
+//  - times it against the reference
+//
+// then does the same for PeakSearch, as used by peak interval discovery,
+// against finding each duration on its own, for the series that never go
+// down (power, speed and the like) and the rest apart.
+//
+// usage: meanmax [rides directory] [repeats]
+//
+// exits non-zero if anything doesn't match
+//
+
+#include "MeanMaxKernel.h"
+#include "PeakSearch.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Series {
+    std::string name;
+    std::vector<data_t> integrated;
+    int count() const { return int(integrated.size()) - 1; }
+};
+
+static bool number(std::string text, double &value)
+{
+    // trim and unquote
+    size_t a = text.find_first_not_of(" \t\r\"");
+    size_t b = text.find_last_not_of(" \t\r\"");
+    if (a == std::string::npos) return false;
+    text = text.substr(a, b-a+1);
+
+    char *end = NULL;
+    value = strtod(text.c_str(), &end);
+    return end && *end == '\0';
+}
+
+static std::vector<std::string> split(const std::string &line)
+{
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, ',')) fields.push_back(field);
+    return fields;
+}
+
+static void add(std::vector<Series> &all, const std::string &name, const std::vector<double> &samples)
+{
+    if (samples.size() < 2) return;
+
+    Series series;
+    series.name = name;
+    series.integrated.resize(samples.size()+1);
+    data_t acc=0;
+    for (size_t i=0; i<samples.size(); i++) {
+        series.integrated[i] = acc;
+        acc += samples[i];
+    }
+    series.integrated[samples.size()] = acc;
+    all.push_back(series);
+}
+
+// header line then rows, any column that is numeric all the way down
+static void readCsv(const std::filesystem::path &path, std::vector<Series> &all)
+{
+    std::ifstream file(path);
+    std::string line;
+    if (!std::getline(file, line)) return;
+
+    std::vector<std::string> header = split(line);
+    std::vector<std::vector<double> > columns(header.size());
+    std::vector<bool> numeric(header.size(), true);
+
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields = split(line);
+        for (size_t i=0; i<header.size(); i++) {
+            double value;
+            if (i < fields.size() && number(fields[i], value)) columns[i].push_back(value);
+            else numeric[i] = false;
+        }
+    }
+
+    for (size_t i=0; i<header.size(); i++)
+        if (numeric[i]) add(all, path.filename().string() + ":" + header[i], columns[i]);
+}
+
+// GoldenCheetah json, one sample per line { "SECS":1, "WATTS":100 ... }
+static void readJson(const std::filesystem::path &path, std::vector<Series> &all)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::map<std::string, std::vector<double> > columns;
+
+    while (std::getline(file, line)) {
+        if (line.find("{ \"SECS\"") == std::string::npos) continue;
+
+        size_t pos = 0;
+        while ((pos = line.find('"', pos)) != std::string::npos) {
+            size_t close = line.find('"', pos+1);
+            if (close == std::string::npos) break;
+            std::string key = line.substr(pos+1, close-pos-1);
+            size_t colon = line.find(':', close);
+            size_t next = line.find_first_of(",}", colon);
+            double value;
+            if (colon != std::string::npos && next != std::string::npos &&
+                number(line.substr(colon+1, next-colon-1), value))
+                columns[key].push_back(value);
+            pos = next == std::string::npos ? line.size() : next;
+        }
+    }
+
+    for (auto &column : columns) add(all, path.filename().string() + ":" + column.first, column.second);
+}
+
+static double now()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv)
+{
+    std::string dir = argc > 1 ? argv[1] : "../../rides";
+    int repeats = argc > 2 ? atoi(argv[2]) : 5;
+    if (repeats < 1) repeats = 1;
+
+    std::vector<Series> all;
+    for (auto &entry : std::filesystem::directory_iterator(dir)) {
+        std::string ext = entry.path().extension().string();
+        for (auto &c : ext) c = tolower(c);
+        if (ext == ".csv") readCsv(entry.path(), all);
+        else if (ext == ".json") readJson(entry.path(), all);
+    }
+
+    long samples = 0;
+    for (const Series &series : all) samples += series.count();
+    printf("%d series, %ld samples from %s\n", int(all.size()), samples, dir.c_str());
+    if (all.empty()) return 1;
+
+    // reference, as RideFileCache used to call it
+    std::vector<std::vector<data_t> > bests(all.size());
+    std::vector<std::vector<int> > offsets(all.size());
+    double start = now();
+    for (int r=0; r<repeats; r++) {
+        for (size_t s=0; s<all.size(); s++) {
+            const Series &series = all[s];
+            bests[s].assign(series.count()+1, 0);
+            offsets[s].assign(series.count()+1, 0);
+            for (int i=1; i<series.count(); i=MeanMaxKernel::nextLength(i)) {
+                int offset=0;
+                bests[s][i] = MeanMaxKernel::dividedMaxMean(series.integrated.data(), series.count(), i, &offset);
+                offsets[s][i] = offset;
+            }
+        }
+    }
+    double reference = (now() - start) / repeats;
+    printf("%-10s %10.2f ms\n", "reference", reference);
+
+    int failed = 0;
+    for (int isa=MeanMaxKernel::Scalar; isa<=MeanMaxKernel::available(); isa++) {
+
+        std::vector<data_t> results;
+        std::vector<int> where;
+        int mismatches = 0;
+
+        start = now();
+        for (int r=0; r<repeats; r++) {
+            for (size_t s=0; s<all.size(); s++) {
+                const Series &series = all[s];
+                results.assign(series.count()+1, 0);
+                where.assign(series.count()+1, 0);
+                MeanMaxKernel::search(series.integrated.data(), series.count(), results.data(), where.data(),
+                                      static_cast<MeanMaxKernel::Isa>(isa));
+
+                // bit for bit
+                if (r == 0 && (memcmp(results.data(), bests[s].data(), results.size() * sizeof(data_t)) ||
+                               where != offsets[s])) {
+                    printf("MISMATCH %s %s\n", MeanMaxKernel::name(static_cast<MeanMaxKernel::Isa>(isa)), series.name.c_str());
+                    mismatches++;
+                }
+            }
+        }
+        double took = (now() - start) / repeats;
+        printf("%-10s %10.2f ms  x%.2f  %s\n", MeanMaxKernel::name(static_cast<MeanMaxKernel::Isa>(isa)),
+               took, reference / took, mismatches ? "FAIL" : "ok");
+        failed += mismatches;
+    }
+
+    // peak intervals, the durations RideItem looks for
+    static const int durations[] = { 1, 5, 10, 15, 20, 30, 60, 300, 600, 1200, 1800, 2700, 3600 };
+    const int count = sizeof(durations) / sizeof(durations[0]);
+
+    // power and speed never go down once integrated and PeakSearch can
+    // use the kernel for those, anything else searches a block at a time
+    for (int rising=1; rising>=0; rising--) {
+
+        std::vector<const Series*> group;
+        for (const Series &series : all) {
+            bool up = true;
+            for (int i=0; up && i<series.count(); i++) up = series.integrated[i+1] >= series.integrated[i];
+            if (up == bool(rising)) group.push_back(&series);
+        }
+        if (group.empty()) continue;
+
+        std::vector<std::vector<PeakSearch::Peak> > peaks(group.size(), std::vector<PeakSearch::Peak>(count));
+        start = now();
+        for (int r=0; r<repeats; r++)
+            for (size_t s=0; s<group.size(); s++)
+                for (int j=0; j<count; j++)
+                    peaks[s][j] = PeakSearch::best(group[s]->integrated.data(), group[s]->count(), durations[j]);
+        reference = (now() - start) / repeats;
+        printf("%-10s %10.2f ms  %d %s series\n", "peaks ref", reference, int(group.size()), rising ? "rising" : "other");
+
+        std::vector<PeakSearch::Peak> found(count);
+        int mismatches = 0;
+        start = now();
+        for (int r=0; r<repeats; r++) {
+            for (size_t s=0; s<group.size(); s++) {
+                PeakSearch::search(group[s]->integrated.data(), group[s]->count(), durations, count, found.data());
+                for (int j=0; r == 0 && j<count; j++) {
+                    if (found[j].offset != peaks[s][j].offset || memcmp(&found[j].total, &peaks[s][j].total, sizeof(data_t))) {
+                        printf("MISMATCH peaks %s %ds\n", group[s]->name.c_str(), durations[j]);
+                        mismatches++;
+                    }
+                }
+            }
+        }
+        double took = (now() - start) / repeats;
+        printf("%-10s %10.2f ms  x%.2f  %s\n", "peaks", took, reference / took, mismatches ? "FAIL" : "ok");
+        failed += mismatches;
+    }
+
+    return failed ? 1 : 0;
+}
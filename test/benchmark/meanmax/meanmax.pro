@@ -0,0 +1,14 @@
+#
+# Standalone benchmark for the mean max kernel and peak search, runs
+# them over the samples in test/rides and checks against the reference
+#
+#   qmake && make && ./meanmax ../../rides
+#
+TEMPLATE = app
+TARGET = meanmax
+CONFIG += console c++17
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../../../src/FileIO
+HEADERS += ../../../src/FileIO/MeanMaxKernel.h ../../../src/FileIO/PeakSearch.h
+SOURCES += ../../../src/FileIO/MeanMaxKernel.cpp ../../../src/FileIO/PeakSearch.cpp main.cpp